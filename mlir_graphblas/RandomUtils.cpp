@@ -1,12 +1,273 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
-#include <random>
-#include <set>
+#include <limits>
+#include <memory>
 
 using namespace std;
 
+// Random numbers come from Philox4x32-10 (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3"), a counter-based generator: every block of
+// 128 random bits is a pure function of a 128-bit counter and a 64-bit key.
+// The key is the seed of the context and the counter names the stream, so
+// that parallel rows draw from independent, reproducible streams without
+// sharing any mutable state. A counter is laid out as
+//   [ block | row (low) | row (high) | op stream << 2 | kind ]
+// where `row` identifies the caller within an op and every op using a
+// context starts a new op stream with `start_random_stream`.
+struct RandomContext {
+  explicit RandomContext(uint64_t seed) : seed(seed) {}
+  const uint64_t seed;
+  atomic<uint64_t> opStream{0};
+  atomic<uint64_t> sequentialDraws{0}; // of `random_double`
+};
+
+// What a stream is drawn for; keeps the kinds of callers apart
+enum RandomStreamKind : uint32_t {
+  kStreamRow = 0,        // a row of a sampler
+  kStreamElement = 1,    // an element: the stream of its row, at its column
+  kStreamSequential = 2, // a `random_double` call
+};
+
+static void philox4x32(uint32_t counter[4], const uint32_t key[2]) {
+  const uint64_t mul0 = 0xD2511F53, mul1 = 0xCD9E8D57;
+  const uint32_t weyl0 = 0x9E3779B9, weyl1 = 0xBB67AE85;
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++) {
+    uint64_t p0 = mul0 * counter[0], p1 = mul1 * counter[2];
+    uint32_t c1 = counter[1], c3 = counter[3];
+    counter[0] = uint32_t(p1 >> 32) ^ c1 ^ k0;
+    counter[1] = uint32_t(p1);
+    counter[2] = uint32_t(p0 >> 32) ^ c3 ^ k1;
+    counter[3] = uint32_t(p0);
+    k0 += weyl0;
+    k1 += weyl1;
+  }
+}
+
+// The high half of the 128-bit product of a and b, and its low half in `low`
+static uint64_t multiplyWide(uint64_t a, uint64_t b, uint64_t &low) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t product = __uint128_t(a) * b;
+  low = uint64_t(product);
+  return uint64_t(product >> 64);
+#else
+  // Schoolbook multiplication of 32-bit halves
+  uint64_t aLow = uint32_t(a), aHigh = a >> 32;
+  uint64_t bLow = uint32_t(b), bHigh = b >> 32;
+  uint64_t lowLow = aLow * bLow, highLow = aHigh * bLow;
+  uint64_t lowHigh = aLow * bHigh, highHigh = aHigh * bHigh;
+  uint64_t middle = (lowLow >> 32) + uint32_t(highLow) + uint32_t(lowHigh);
+  low = middle << 32 | uint32_t(lowLow);
+  return highHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32);
+#endif
+}
+
+// The random numbers of one stream, generated a block at a time
+class RandomStream {
+public:
+  RandomStream(const RandomContext *ctx, RandomStreamKind kind, uint64_t row)
+      : seedHigh(uint32_t(ctx->seed >> 32)),
+        key{uint32_t(ctx->seed), seedHigh},
+        counter{0, uint32_t(row), uint32_t(row >> 32),
+                uint32_t(ctx->opStream.load(memory_order_relaxed) << 2 |
+                         kind)} {}
+
+  uint64_t next() {
+    if (used == 4) {
+      copy(counter, counter + 4, block);
+      philox4x32(block, key);
+      // The block counter only has 32 bits, so later blocks continue under
+      // the next key, which is another Philox stream
+      if (++counter[0] == 0)
+        key[1]++;
+      used = 0;
+    }
+    uint64_t bits = uint64_t(block[used]) << 32 | block[used + 1];
+    used += 2;
+    return bits;
+  }
+
+  // Continues from the `index`-th block, which makes the stream random access
+  void seek(uint64_t index) {
+    counter[0] = uint32_t(index);
+    key[1] = seedHigh + uint32_t(index >> 32);
+    used = 4;
+  }
+
+  // Uniform in [0, 1)
+  double nextDouble() { return (next() >> 11) * (1.0 / (uint64_t(1) << 53)); }
+
+  // Uniform in [0, bound), by multiplying and rejecting the biased low end
+  // (Lemire, "Fast Random Integer Generation in an Interval")
+  uint64_t nextBelow(uint64_t bound) {
+    uint64_t low;
+    uint64_t high = multiplyWide(next(), bound, low);
+    if (low < bound) {
+      uint64_t threshold = -bound % bound;
+      while (low < threshold)
+        high = multiplyWide(next(), bound, low);
+    }
+    return high;
+  }
+
+private:
+  uint32_t seedHigh;
+  uint32_t key[2];
+  uint32_t counter[4];
+  uint32_t block[4];
+  unsigned used = 4;
+};
+
+// The output memref of a sampler, which is also its only working memory
+class SampleArray {
+public:
+  SampleArray(int64_t *base, int64_t offset, int64_t stride)
+      : data(base + offset), stride(stride) {}
+  int64_t &operator[](int64_t i) const { return data[i * stride]; }
+
+  // Inserts `value` at `pos` of the first `size` entries
+  void insert(int64_t size, int64_t pos, int64_t value) const {
+    for (int64_t i = size; i > pos; i--)
+      (*this)[i] = (*this)[i - 1];
+    (*this)[pos] = value;
+  }
+
+  // The first of the first `size` (sorted) entries not less than `value`
+  int64_t lowerBound(int64_t size, int64_t value) const {
+    int64_t lo = 0, hi = size;
+    while (lo < hi) {
+      int64_t mid = lo + (hi - lo) / 2;
+      if ((*this)[mid] < value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  // Max-heap of the first `size` entries ordered by `less`
+  template <typename Less>
+  void siftDown(int64_t size, int64_t i, Less less) const {
+    for (int64_t child; (child = 2 * i + 1) < size; i = child) {
+      if (child + 1 < size && less((*this)[child], (*this)[child + 1]))
+        child++;
+      if (!less((*this)[i], (*this)[child]))
+        break;
+      swap((*this)[i], (*this)[child]);
+    }
+  }
+
+  // Heap sort of the first `size` entries into ascending order
+  void sort(int64_t size) const {
+    auto less = [](int64_t a, int64_t b) { return a < b; };
+    for (int64_t i = size / 2; i-- > 0;)
+      siftDown(size, i, less);
+    for (int64_t end = size; end-- > 1;) {
+      swap((*this)[0], (*this)[end]);
+      siftDown(end, 0, less);
+    }
+  }
+
+private:
+  int64_t *data;
+  int64_t stride;
+};
+
+// Robert Floyd's sampling of n of [0, maxIndex): one draw per sample, kept
+// sorted by insertion, so it suits n much smaller than maxIndex
+static void sampleFloyd(RandomStream &rng, int64_t n, int64_t maxIndex,
+                        const SampleArray &out) {
+  for (int64_t j = maxIndex - n, size = 0; j < maxIndex; j++, size++) {
+    int64_t t = rng.nextBelow(j + 1);
+    int64_t pos = out.lowerBound(size, t);
+    // All samples are less than j, which goes last if t was taken
+    if (pos < size && out[pos] == t)
+      out[size] = j;
+    else
+      out.insert(size, pos, t);
+  }
+}
+
+// Vitter's method A ("An Efficient Algorithm for Sequential Random
+// Sampling"): skips over [0, maxIndex) in order, drawing once per sample
+static void sampleSequential(RandomStream &rng, int64_t n, int64_t maxIndex,
+                             const SampleArray &out) {
+  int64_t current = 0, top = maxIndex - n;
+  double remaining = maxIndex;
+  for (int64_t i = 0; i < n - 1; i++) {
+    double v = rng.nextDouble();
+    double quot = top / remaining;
+    while (quot > v) {
+      current++;
+      top--;
+      remaining--;
+      quot *= top / remaining;
+    }
+    out[i] = current++;
+    remaining--;
+  }
+  if (n > 0)
+    out[n - 1] = current + rng.nextBelow(int64_t(remaining));
+}
+
+// A row with no more than n entries is taken whole
+static void takeAll(int64_t maxIndex, const SampleArray &out) {
+  for (int64_t i = 0; i < maxIndex; i++)
+    out[i] = i;
+}
+
+// The keys of the samples of choose_weighted, as a max-heap parallel to the
+// sampled indices in the output. Small heaps live on the stack.
+class SampleKeys {
+public:
+  explicit SampleKeys(int64_t n) : keys(local) {
+    if (n > kLocalSize) {
+      allocated.reset(new double[n]);
+      keys = allocated.get();
+    }
+  }
+  double operator[](int64_t i) const { return keys[i]; }
+
+  // Adds `index` with `key` as the `size`-th entry
+  void push(const SampleArray &out, int64_t size, int64_t index, double key) {
+    out[size] = index;
+    keys[size] = key;
+    for (int64_t i = size, parent;
+         i > 0 && keys[parent = (i - 1) / 2] < keys[i]; i = parent)
+      swapEntries(out, i, parent);
+  }
+
+  // Replaces the entry with the largest key by `index` with `key`
+  void replaceTop(const SampleArray &out, int64_t size, int64_t index,
+                  double key) {
+    out[0] = index;
+    keys[0] = key;
+    for (int64_t i = 0, child; (child = 2 * i + 1) < size; i = child) {
+      if (child + 1 < size && keys[child] < keys[child + 1])
+        child++;
+      if (!(keys[i] < keys[child]))
+        break;
+      swapEntries(out, i, child);
+    }
+  }
+
+private:
+  static const int64_t kLocalSize = 64;
+
+  void swapEntries(const SampleArray &out, int64_t a, int64_t b) {
+    swap(out[a], out[b]);
+    swap(keys[a], keys[b]);
+  }
+
+  double local[kLocalSize];
+  unique_ptr<double[]> allocated;
+  double *keys;
+};
+
 extern "C" {
 
 // This is a simple, fast, and "wrong" implementation that "randomly" chooses
@@ -24,10 +285,13 @@ void choose_first(int64_t rngContext, int64_t n, int64_t maxIndex,
   }
 }
 
-// A uniform sampler using a temporary set
+// Samplers draw from a stream named by the offset of their row in the
+// sparse tensor (`valOffset`), so rows sampled in parallel are independent
+// and the result does not depend on the order in which they run.
+
+// A uniform sampler without replacement
 void *create_choose_uniform_context(uint64_t seed) {
-  auto generator = new std::mt19937_64(seed);
-  return (void *)generator;
+  return new RandomContext(seed);
 }
 
 void choose_uniform(void *rngContext, int64_t n, int64_t maxIndex,
@@ -35,35 +299,29 @@ void choose_uniform(void *rngContext, int64_t n, int64_t maxIndex,
                     int64_t outSize, int64_t outStride, double *valAlloc,
                     double *valBase, int64_t valOffset, int64_t valSize,
                     int64_t valStride) {
+  RandomStream rng((RandomContext *)rngContext, kStreamRow, valOffset);
+  SampleArray out(outBase, outOffset, outStride);
 
-  std::set<int64_t> selected;
-  std::uniform_int_distribution<int64_t> choose_int(0, maxIndex - 1);
-
-  auto generator = (std::mt19937_64 *)rngContext;
-
-  while (selected.size() < (size_t)n) {
-    int64_t choice = choose_int(*generator);
-    if (selected.count(choice) == 0)
-      selected.insert(choice);
+  if (n >= maxIndex) {
+    takeAll(maxIndex, out);
+    return;
   }
 
-  // sets are stored in sorted order
-  int i = 0;
-  for (int64_t element : selected) {
-    outBase[outOffset + outStride * i] = element;
-    i++;
-  }
+  // Floyd moves about n^2 / 4 entries, method A tests every index
+  if (double(n) * n < 4.0 * maxIndex)
+    sampleFloyd(rng, n, maxIndex, out);
+  else
+    sampleSequential(rng, n, maxIndex, out);
 }
 
 void destroy_choose_uniform_context(void *rngContext) {
-  auto generator = (std::mt19937_64 *)rngContext;
-  delete generator;
+  delete (RandomContext *)rngContext;
 }
 
-// A weighted sampler using a temporary set
+// A weighted sampler without replacement, i.e. with the distribution of
+// drawing by weight and rejecting repeats
 void *create_choose_weighted_context(uint64_t seed) {
-  auto generator = new std::mt19937_64(seed);
-  return (void *)generator;
+  return new RandomContext(seed);
 }
 
 void choose_weighted(void *rngContext, int64_t n, int64_t maxIndex,
@@ -71,52 +329,63 @@ void choose_weighted(void *rngContext, int64_t n, int64_t maxIndex,
                      int64_t outSize, int64_t outStride, double *valAlloc,
                      double *valBase, int64_t valOffset, int64_t valSize,
                      int64_t valStride) {
+  RandomStream rng((RandomContext *)rngContext, kStreamRow, valOffset);
+  SampleArray out(outBase, outOffset, outStride);
 
-  std::set<int64_t> selected;
-
-  auto generator = (std::mt19937_64 *)rngContext;
-
-  // compute cumulative distribution
-  std::vector<double> cumulative(maxIndex);
-  double acc = 0.0;
-  for (int64_t i = 0; i < maxIndex; i++) {
-    acc += valBase[valOffset + i * valStride];
-    cumulative[i] = acc;
+  if (n >= maxIndex) {
+    takeAll(maxIndex, out);
+    return;
   }
 
-  std::uniform_real_distribution<double> choose_double(
-      0, cumulative[maxIndex - 1]);
-
-  while (selected.size() < (size_t)n) {
-    double r = choose_double(*generator);
+  // Efraimidis and Spirakis, "Weighted random sampling with a reservoir":
+  // the n indices with the smallest keys -log(1 - u) / weight are a sample.
+  // The output holds a max-heap of the indices, and their keys are kept
+  // alongside, so that every key is computed once.
+  SampleKeys keys(n);
+  auto key = [&](int64_t i) {
+    double weight = valBase[valOffset + i * valStride];
+    if (!(weight > 0))
+      return numeric_limits<double>::infinity();
+    rng.seek(i);
+    return -log1p(-rng.nextDouble()) / weight;
+  };
 
-    // find smallest element in cumulative distribution greater than r
-    int64_t choice = std::distance(
-        cumulative.begin(),
-        std::upper_bound(cumulative.begin(), cumulative.end(), r));
-
-    if (selected.count(choice) == 0)
-      selected.insert(choice);
+  for (int64_t i = 0; i < n; i++)
+    keys.push(out, i, i, key(i));
+  for (int64_t i = n; i < maxIndex; i++) {
+    double k = key(i);
+    if (k < keys[0])
+      keys.replaceTop(out, n, i, k);
   }
 
-  // sets are stored in sorted order
-  int i = 0;
-  for (int64_t element : selected) {
-    outBase[outOffset + outStride * i] = element;
-    i++;
-  }
+  out.sort(n);
 }
 
 void destroy_choose_weighted_context(void *rngContext) {
-  auto generator = (std::mt19937_64 *)rngContext;
-  delete generator;
+  delete (RandomContext *)rngContext;
 }
 
-std::uniform_real_distribution<> doubleDistribution(0.0, 1.0);
+// Starts a new op stream, so that an op does not repeat the numbers drawn by
+// the previous ops using the context. Called once before the op's loops.
+void start_random_stream(void *rngContext) {
+  ((RandomContext *)rngContext)->opStream.fetch_add(1, memory_order_relaxed);
+}
+
+// A double in [0, 1) for the element at (row, col) of the current op
+double random_double_at(void *rngContext, int64_t row, int64_t col) {
+  // The column is the block of the row's stream, so every element has its
+  // own counter
+  RandomStream rng((RandomContext *)rngContext, kStreamElement, row);
+  rng.seek(col);
+  return rng.nextDouble();
+}
 
+// The next double in [0, 1) of a sequence shared by all callers; safe to call
+// from several threads, but then the order of the numbers is not defined
 double random_double(void *rngContext) {
-  auto generator = (std::mt19937_64 *)rngContext;
-  return doubleDistribution(*generator);
+  auto ctx = (RandomContext *)rngContext;
+  uint64_t draw = ctx->sequentialDraws.fetch_add(1, memory_order_relaxed);
+  return RandomStream(ctx, kStreamSequential, draw).nextDouble();
 }
 
 } // extern "C"
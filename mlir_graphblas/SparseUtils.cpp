@@ -25,11 +25,25 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 #include <vector>
 
 //// -> MODIFIED
+#include <atomic>
 #include <iostream>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 //// <- MODIFIED
 
 //===----------------------------------------------------------------------===//
@@ -72,8 +86,8 @@ namespace {
 
 //// -> MODIFIED
 // used by verify
-template <typename T>
-bool issorted(const std::vector<T> &arr, uint64_t start, uint64_t stop) {
+template <typename T, typename A>
+bool issorted(const std::vector<T, A> &arr, uint64_t start, uint64_t stop) {
   if (stop <= start + 1) {
     return true;
   }
@@ -91,8 +105,8 @@ bool issorted(const std::vector<T> &arr, uint64_t start, uint64_t stop) {
   return true;
 }
 
-template <typename T>
-bool isincreasing(const std::vector<T> &arr, uint64_t start, uint64_t stop) {
+template <typename T, typename A>
+bool isincreasing(const std::vector<T, A> &arr, uint64_t start, uint64_t stop) {
   if (stop <= start + 1) {
     return true;
   }
@@ -109,47 +123,199 @@ bool isincreasing(const std::vector<T> &arr, uint64_t start, uint64_t stop) {
 }
 //// <- MODIFIED
 
-/// A sparse tensor element in coordinate scheme (value and indices).
-/// For example, a rank-1 vector element would look like
-///   ({i}, a[i])
-/// and a rank-5 tensor element like
-///   ({i,j,k,l,m}, a[i,j,k,l,m])
-template <typename V>
-struct Element {
-  Element(const std::vector<uint64_t> &ind, V val) : indices(ind), value(val){};
-  std::vector<uint64_t> indices;
-  V value;
-};
+//// -> MODIFIED
+/// Returns the number of threads to use for `work` units of work, such that
+/// every thread gets at least `grain` units.
+static unsigned getNumThreads(uint64_t work, uint64_t grain) {
+  unsigned numThreads = std::max(1u, std::thread::hardware_concurrency());
+  return std::min<uint64_t>(numThreads, work / grain + 1);
+}
+
+/// Runs body(t) for every t in [0, numThreads), with t == 0 on the calling
+/// thread.
+template <typename F>
+static void parallelFor(unsigned numThreads, const F &body) {
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < numThreads; t++)
+    threads.emplace_back(std::cref(body), t);
+  body(0);
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+/// Stable LSD radix sort of `keys` by their low `bits` bits, one byte per
+/// pass, applying the same reordering to `perm`. Every thread histograms its
+/// own block of keys and then scatters that block, so the sort is stable.
+/// Passes over a byte that is the same in all keys are skipped.
+static void radixSort(std::vector<uint64_t> &keys, std::vector<uint64_t> &perm,
+                      unsigned bits) {
+  const unsigned radixBits = 8;
+  const uint64_t numBuckets = 1 << radixBits;
+  uint64_t n = keys.size();
+  unsigned numThreads = getNumThreads(n, 1 << 16);
+  std::vector<uint64_t> keysOut(n);
+  std::vector<uint64_t> permOut(n);
+  std::vector<uint64_t> offsets(numThreads * numBuckets);
+  for (unsigned shift = 0; shift < bits; shift += radixBits) {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    parallelFor(numThreads, [&](unsigned t) {
+      uint64_t *count = &offsets[t * numBuckets];
+      for (uint64_t i = n * t / numThreads, e = n * (t + 1) / numThreads;
+           i < e; i++)
+        count[(keys[i] >> shift) & (numBuckets - 1)]++;
+    });
+    // Turn the counts into the first output position of every block within
+    // every bucket.
+    uint64_t pos = 0;
+    bool skip = false;
+    for (uint64_t b = 0; b < numBuckets; b++) {
+      uint64_t bucketStart = pos;
+      for (unsigned t = 0; t < numThreads; t++) {
+        uint64_t count = offsets[t * numBuckets + b];
+        offsets[t * numBuckets + b] = pos;
+        pos += count;
+      }
+      skip |= pos - bucketStart == n;
+    }
+    if (skip)
+      continue;
+    parallelFor(numThreads, [&](unsigned t) {
+      uint64_t *offset = &offsets[t * numBuckets];
+      for (uint64_t i = n * t / numThreads, e = n * (t + 1) / numThreads;
+           i < e; i++) {
+        uint64_t dst = offset[(keys[i] >> shift) & (numBuckets - 1)]++;
+        keysOut[dst] = keys[i];
+        permOut[dst] = perm[i];
+      }
+    });
+    keys.swap(keysOut);
+    perm.swap(permOut);
+  }
+}
+
+/// Returns the number of bits needed for all indices below `size`.
+static unsigned getIndexBits(uint64_t size) {
+  unsigned bits = 0;
+  for (uint64_t m = size ? size - 1 : 0; m; m >>= 1)
+    bits++;
+  return bits;
+}
+//// <- MODIFIED
 
 /// A memory-resident sparse tensor in coordinate scheme (collection of
 /// elements). This data structure is used to read a sparse tensor from
 /// any external format into memory and sort the elements lexicographically
 /// by indices before passing it back to the client (most packed storage
 /// formats require the elements to appear in lexicographic index order).
+//// -> MODIFIED
+/// The elements are stored as one flat array of indices per dimension plus
+/// an array of values (structure of arrays).
+//// <- MODIFIED
 template <typename V>
 struct SparseTensorCOO {
 public:
   SparseTensorCOO(const std::vector<uint64_t> &szs, uint64_t capacity)
-      : sizes(szs) {
-    if (capacity)
-      elements.reserve(capacity);
+      : sizes(szs), indices(szs.size()) {
+    if (capacity) {
+      for (std::vector<uint64_t> &idx : indices)
+        idx.reserve(capacity);
+      values.reserve(capacity);
+    }
   }
   /// Adds element as indices and value.
   void add(const std::vector<uint64_t> &ind, V val) {
     uint64_t rank = getRank();
     assert(rank == ind.size());
-    for (uint64_t r = 0; r < rank; r++)
+    for (uint64_t r = 0; r < rank; r++) {
       assert(ind[r] < sizes[r]); // within bounds
-    elements.emplace_back(ind, val);
+      indices[r].push_back(ind[r]);
+    }
+    values.push_back(val);
   }
-  /// Sorts elements lexicographically by index.
-  void sort() { std::sort(elements.begin(), elements.end(), lexOrder); }
+  //// -> MODIFIED
+  /// Appends elements whose indices are already permuted and within bounds,
+  /// e.g. the per-thread buffers of a parallel reader.
+  void append(std::vector<std::vector<uint64_t>> &&ind,
+              std::vector<V> &&vals) {
+    assert(ind.size() == getRank());
+    if (values.empty() && values.capacity() < vals.size()) {
+      for (uint64_t r = 0, rank = getRank(); r < rank; r++)
+        indices[r].swap(ind[r]);
+      values.swap(vals);
+    } else {
+      for (uint64_t r = 0, rank = getRank(); r < rank; r++)
+        indices[r].insert(indices[r].end(), ind[r].begin(), ind[r].end());
+      values.insert(values.end(), vals.begin(), vals.end());
+    }
+  }
+  /// Sorts elements lexicographically by index. The indices of consecutive
+  /// dimensions are packed into as few 64-bit keys as the dimension sizes
+  /// allow, and the keys are radix sorted starting from the least
+  /// significant one. Elements with equal indices keep their order.
+  void sort() {
+    uint64_t rank = getRank();
+    uint64_t n = values.size();
+    if (n < 2)
+      return;
+    unsigned numThreads = getNumThreads(n, 1 << 16);
+    std::vector<uint64_t> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    std::vector<uint64_t> keys(n);
+    std::vector<unsigned> indexBits(rank);
+    for (uint64_t r = 0; r < rank; r++)
+      indexBits[r] = getIndexBits(sizes[r]);
+    for (uint64_t hi = rank; hi > 0;) {
+      // Pack dimensions [lo, hi) into one key.
+      uint64_t lo = hi - 1;
+      unsigned bits = indexBits[lo];
+      while (lo > 0 && bits + indexBits[lo - 1] <= 64)
+        bits += indexBits[--lo];
+      parallelFor(numThreads, [&](unsigned t) {
+        for (uint64_t i = n * t / numThreads, e = n * (t + 1) / numThreads;
+             i < e; i++) {
+          uint64_t key = 0;
+          for (uint64_t r = lo; r < hi; r++)
+            key = (indexBits[r] < 64 ? key << indexBits[r] : 0) |
+                  indices[r][perm[i]];
+          keys[i] = key;
+        }
+      });
+      radixSort(keys, perm, bits);
+      hi = lo;
+    }
+    // Gather the indices and values in sorted order.
+    std::vector<uint64_t> sortedIndices(n);
+    for (uint64_t r = 0; r < rank; r++) {
+      parallelFor(numThreads, [&](unsigned t) {
+        for (uint64_t i = n * t / numThreads, e = n * (t + 1) / numThreads;
+             i < e; i++)
+          sortedIndices[i] = indices[r][perm[i]];
+      });
+      indices[r].swap(sortedIndices);
+    }
+    std::vector<V> sortedValues(n);
+    parallelFor(numThreads, [&](unsigned t) {
+      for (uint64_t i = n * t / numThreads, e = n * (t + 1) / numThreads;
+           i < e; i++)
+        sortedValues[i] = values[perm[i]];
+    });
+    values.swap(sortedValues);
+  }
+  //// <- MODIFIED
   /// Returns rank.
   uint64_t getRank() const { return sizes.size(); }
   /// Getter for sizes array.
   const std::vector<uint64_t> &getSizes() const { return sizes; }
-  /// Getter for elements array.
-  const std::vector<Element<V>> &getElements() const { return elements; }
+  //// -> MODIFIED
+  /// Returns the number of elements.
+  uint64_t getNumElements() const { return values.size(); }
+  /// Getter for the indices of all elements in the given dimension.
+  const std::vector<uint64_t> &getIndices(uint64_t d) const {
+    return indices[d];
+  }
+  /// Getter for the values of all elements.
+  const std::vector<V> &getValues() const { return values; }
+  //// <- MODIFIED
 
   /// Factory method. Permutes the original dimensions according to
   /// the given ordering and expects subsequent add() calls to honor
@@ -166,21 +332,389 @@ public:
   }
 
 private:
-  /// Returns true if indices of e1 < indices of e2.
-  static bool lexOrder(const Element<V> &e1, const Element<V> &e2) {
-    uint64_t rank = e1.indices.size();
-    assert(rank == e2.indices.size());
-    for (uint64_t r = 0; r < rank; r++) {
-      if (e1.indices[r] == e2.indices[r])
-        continue;
-      return e1.indices[r] < e2.indices[r];
+  std::vector<uint64_t> sizes; // per-dimension sizes
+  //// -> MODIFIED
+  std::vector<std::vector<uint64_t>> indices; // per-dimension indices
+  std::vector<V> values;
+  //// <- MODIFIED
+};
+
+//// -> MODIFIED
+/// Placement of large buffers. The policy is a combination of one NUMA flag
+/// and one huge page flag, selected per process with `set_allocation_policy`
+/// or the GRAPHBLAS_ALLOC_POLICY environment variable, e.g. "interleave,thp".
+/// With the default policy every buffer comes from operator new (malloc).
+/// Otherwise buffers of at least kLargeBufferBytes are mapped directly and
+/// aligned to huge pages; smaller ones still come from operator new. A buffer
+/// keeps the policy that was current when its tensor storage was created.
+enum AllocationPolicy : uint32_t {
+  kAllocDefault = 0,
+  kAllocInterleave = 1,      // "interleave": pages round-robin over nodes
+  kAllocFirstTouch = 2,      // "first-touch": page ranges touched in parallel
+  kAllocTransparentHuge = 4, // "thp": madvise(MADV_HUGEPAGE)
+  kAllocExplicitHuge = 8     // "hugetlb": MAP_HUGETLB from the reserved pool
+};
+
+/// What the allocation policy did, see `get_allocation_report`.
+enum AllocationStat : uint32_t {
+  kStatLargeBuffers = 0,
+  kStatLargeBytes,
+  kStatLargeReleased, // large buffers unmapped again
+  kStatInterleaved,
+  kStatFirstTouched,
+  kStatTransparentHuge,
+  kStatExplicitHuge,
+  kStatFallbacks, // a requested placement the system refused
+  kNumAllocationStats
+};
+
+static const uint64_t kLargeBufferBytes = 2 << 20; // also the huge page size
+
+static std::atomic<uint64_t> allocationStats[kNumAllocationStats];
+
+/// Parses a comma-separated policy; returns false if it is invalid.
+static bool parseAllocationPolicy(const char *spec, uint32_t &policy) {
+  static const struct {
+    const char *name;
+    uint32_t flag;
+  } flags[] = {{"default", kAllocDefault},
+               {"interleave", kAllocInterleave},
+               {"first-touch", kAllocFirstTouch},
+               {"thp", kAllocTransparentHuge},
+               {"hugetlb", kAllocExplicitHuge}};
+  policy = kAllocDefault;
+  for (const char *p = spec; *p;) {
+    const char *end = strchr(p, ',');
+    size_t len = end ? end - p : strlen(p);
+    bool found = false;
+    for (const auto &flag : flags) {
+      if (strlen(flag.name) == len && !strncmp(p, flag.name, len)) {
+        policy |= flag.flag;
+        found = true;
+      }
     }
-    return false;
+    if (!found && len)
+      return false;
+    p += end ? len + 1 : len;
   }
-  std::vector<uint64_t> sizes; // per-dimension sizes
-  std::vector<Element<V>> elements;
+  uint32_t numa = kAllocInterleave | kAllocFirstTouch;
+  uint32_t huge = kAllocTransparentHuge | kAllocExplicitHuge;
+  return (policy & numa) != numa && (policy & huge) != huge;
+}
+
+static std::atomic<uint32_t> &getAllocationPolicy() {
+  static std::atomic<uint32_t> policy([] {
+    uint32_t policy = kAllocDefault;
+    const char *env = getenv("GRAPHBLAS_ALLOC_POLICY");
+    if (env && !parseAllocationPolicy(env, policy)) {
+      fprintf(stderr, "Ignoring invalid GRAPHBLAS_ALLOC_POLICY=%s\n", env);
+      policy = kAllocDefault;
+    }
+    return policy;
+  }());
+  return policy;
+}
+
+/// Returns the mask of online NUMA nodes (at most 64), or 0 if unknown.
+static uint64_t getOnlineNodeMask() {
+  FILE *file = fopen("/sys/devices/system/node/online", "r");
+  if (!file)
+    return 0;
+  // A list of ranges, e.g. "0-1" or "0,2-3".
+  char line[256];
+  uint64_t mask = 0;
+  if (fgets(line, sizeof(line), file)) {
+    for (char *p = line; isdigit(*p);) {
+      unsigned long lo = strtoul(p, &p, 10), hi = lo;
+      if (*p == '-')
+        hi = strtoul(p + 1, &p, 10);
+      for (unsigned long n = lo; n <= hi && n < 64; n++)
+        mask |= uint64_t(1) << n;
+      if (*p == ',')
+        p++;
+    }
+  }
+  fclose(file);
+  return mask;
+}
+
+/// Interleaves the pages of [data, data + bytes) over all online nodes.
+static bool interleavePages(void *data, uint64_t bytes) {
+#ifdef SYS_mbind
+  static const uint64_t nodeMask = getOnlineNodeMask();
+  const int mpolInterleave = 3; // MPOL_INTERLEAVE from <linux/mempolicy.h>
+  if (nodeMask & (nodeMask - 1))
+    return !syscall(SYS_mbind, data, bytes, mpolInterleave, &nodeMask,
+                    uint64_t(64), 0);
+#endif
+  return false;
+}
+
+/// Touches the pages of [data, data + bytes) in contiguous ranges, one per
+/// thread, so that every range is placed on the node of the thread that
+/// will most likely process it. The threads are not pinned to nodes: pages
+/// only spread over nodes as far as the scheduler spreads the threads, so
+/// bind them (e.g. numactl --cpunodebind, taskset) for a predictable layout.
+static void touchPagesInParallel(char *data, uint64_t bytes) {
+  uint64_t pageSize = sysconf(_SC_PAGESIZE);
+  uint64_t numPages = bytes / pageSize;
+  unsigned numThreads = getNumThreads(numPages, kLargeBufferBytes / pageSize);
+  parallelFor(numThreads, [&](unsigned t) {
+    for (uint64_t i = numPages * t / numThreads,
+                  e = numPages * (t + 1) / numThreads;
+         i < e; i++)
+      data[i * pageSize] = 0;
+  });
+}
+
+static uint64_t getLargeBufferLength(uint64_t bytes) {
+  return (bytes + kLargeBufferBytes - 1) / kLargeBufferBytes *
+         kLargeBufferBytes;
+}
+
+/// Maps a buffer of at least kLargeBufferBytes following the policy.
+static void *mapLargeBuffer(uint64_t bytes, uint32_t policy) {
+  uint64_t length = getLargeBufferLength(bytes);
+  char *data = static_cast<char *>(MAP_FAILED);
+#ifdef MAP_HUGETLB
+  if (policy & kAllocExplicitHuge) {
+    data = static_cast<char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                                    -1, 0));
+    allocationStats[data != MAP_FAILED ? kStatExplicitHuge : kStatFallbacks]++;
+  }
+#endif
+  if (data == MAP_FAILED) {
+    // Over-map, then trim to a huge page boundary.
+    uint64_t mapped = length + kLargeBufferBytes;
+    char *raw = static_cast<char *>(mmap(nullptr, mapped,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED)
+      throw std::bad_alloc();
+    data = raw + (kLargeBufferBytes -
+                  reinterpret_cast<uintptr_t>(raw) % kLargeBufferBytes) %
+                     kLargeBufferBytes;
+    if (data > raw)
+      munmap(raw, data - raw);
+    if (raw + mapped > data + length)
+      munmap(data + length, raw + mapped - (data + length));
+#ifdef MADV_HUGEPAGE
+    if (policy & kAllocTransparentHuge)
+      allocationStats[madvise(data, length, MADV_HUGEPAGE)
+                          ? kStatFallbacks
+                          : kStatTransparentHuge]++;
+#endif
+  }
+  if (policy & kAllocInterleave)
+    allocationStats[interleavePages(data, length) ? kStatInterleaved
+                                                  : kStatFallbacks]++;
+  if (policy & kAllocFirstTouch) {
+    touchPagesInParallel(data, length);
+    allocationStats[kStatFirstTouched]++;
+  }
+  allocationStats[kStatLargeBuffers]++;
+  allocationStats[kStatLargeBytes] += length;
+  return data;
+}
+
+static void unmapLargeBuffer(void *data, uint64_t bytes) {
+  munmap(data, getLargeBufferLength(bytes));
+  allocationStats[kStatLargeReleased]++;
+}
+
+/// Memory owned outside of the runtime (e.g. a file mapping) that a buffer
+/// can be built on without copying. `owner` keeps the memory alive until the
+/// buffer releases it.
+struct AdoptedMemory {
+  void *data = nullptr;
+  size_t bytes = 0;
+  std::shared_ptr<void> owner;
+  bool taken = false;
 };
 
+/// Allocator of the pointers, indices and values buffers. It behaves like
+/// std::allocator, except that large buffers are placed according to the
+/// allocation policy it was created under, the first allocation of exactly
+/// the size of its adopted memory (if any) returns that memory, and elements
+/// constructed without a value are default-initialized rather than zeroed.
+/// Growing a buffer thus leaves the new elements uninitialized (and their
+/// pages untouched), and adopted memory keeps its contents.
+template <typename T>
+class BufferAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  BufferAllocator() : policy(getAllocationPolicy()) {}
+  explicit BufferAllocator(std::shared_ptr<AdoptedMemory> memory)
+      : adopted(std::move(memory)), policy(getAllocationPolicy()) {}
+  template <typename U>
+  BufferAllocator(const BufferAllocator<U> &other)
+      : adopted(other.adopted), policy(other.policy) {}
+
+  T *allocate(size_t n) {
+    if (adopted && !adopted->taken && n * sizeof(T) == adopted->bytes) {
+      adopted->taken = true;
+      return static_cast<T *>(adopted->data);
+    }
+    if (isMapped(n))
+      return static_cast<T *>(mapLargeBuffer(n * sizeof(T), policy));
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, size_t n) {
+    if (isAdopted(p)) {
+      // Forget the memory too: once its owner frees it, later buffers may be
+      // allocated at the same address.
+      adopted->data = nullptr;
+      adopted->bytes = 0;
+      adopted->owner.reset();
+    } else if (isMapped(n))
+      unmapLargeBuffer(p, n * sizeof(T));
+    else
+      ::operator delete(p);
+  }
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+  template <typename U>
+  void construct(U *p) {
+    ::new (static_cast<void *>(p)) U;
+  }
+  /// Copies of a buffer always own their memory.
+  BufferAllocator select_on_container_copy_construction() const {
+    return BufferAllocator();
+  }
+
+  template <typename U>
+  bool operator==(const BufferAllocator<U> &other) const {
+    return adopted == other.adopted && policy == other.policy;
+  }
+  template <typename U>
+  bool operator!=(const BufferAllocator<U> &other) const {
+    return !(*this == other);
+  }
+
+private:
+  template <typename U>
+  friend class BufferAllocator;
+
+  bool isAdopted(const void *p) const {
+    const char *data = adopted ? static_cast<const char *>(adopted->data) : 0;
+    const char *c = static_cast<const char *>(p);
+    return data && c >= data && c < data + adopted->bytes;
+  }
+  bool isMapped(size_t n) const {
+    return policy != kAllocDefault && n * sizeof(T) >= kLargeBufferBytes;
+  }
+
+  std::shared_ptr<AdoptedMemory> adopted;
+  uint32_t policy;
+};
+
+/// A pointers, indices or values array of a sparse tensor storage.
+template <typename T>
+using Buffer = std::vector<T, BufferAllocator<T>>;
+//// <- MODIFIED
+
+//// -> MODIFIED
+/// Memory held by live sparse tensors, see `get_memory_report`. Every buffer
+/// object (the pointers, indices or values of a tensor, which views may
+/// share) is charged once, with its capacity as of the last constructor,
+/// `dup`, `resize_*`, `swap_*` or other call of its tensors that can change
+/// it. The charge is dropped when the last tensor holding the buffer is
+/// deleted.
+enum MemoryComponent : uint32_t {
+  kMemPointers = 0,
+  kMemIndices,
+  kMemValues,
+  kNumMemoryComponents
+};
+
+enum MemoryStat : uint32_t {
+  kMemLiveTensors = 0,
+  kMemTensorAllocations, // tensors ever created
+  kMemBufferAllocations, // buffer objects ever charged, including copies
+  kMemPointerBytes,      // then one entry per MemoryComponent
+  kMemIndexBytes,
+  kMemValueBytes,
+  kMemBytes,
+  kMemPeakBytes, // high-water mark of kMemBytes, see `reset_memory_peak`
+  kNumMemoryStats
+};
+
+static std::mutex memoryMutex;
+static uint64_t memoryStats[kNumMemoryStats];
+static std::unordered_map<const void *, uint64_t> chargedBuffers;
+
+/// Replaces the charge of `buffer` by `bytes`. Needs `memoryMutex`.
+static void chargeBuffer(const void *buffer, MemoryComponent component,
+                         uint64_t bytes) {
+  auto entry = chargedBuffers.emplace(buffer, 0);
+  if (entry.second)
+    memoryStats[kMemBufferAllocations]++;
+  uint64_t &charged = entry.first->second;
+  // Unsigned wrap-around subtracts when the buffer shrank.
+  memoryStats[kMemPointerBytes + component] += bytes - charged;
+  memoryStats[kMemBytes] += bytes - charged;
+  memoryStats[kMemPeakBytes] =
+      std::max(memoryStats[kMemPeakBytes], memoryStats[kMemBytes]);
+  charged = bytes;
+}
+
+/// Drops the charge of `buffer`. Needs `memoryMutex`.
+static void dischargeBuffer(const void *buffer, MemoryComponent component) {
+  auto entry = chargedBuffers.find(buffer);
+  if (entry == chargedBuffers.end())
+    return;
+  memoryStats[kMemPointerBytes + component] -= entry->second;
+  memoryStats[kMemBytes] -= entry->second;
+  chargedBuffers.erase(entry);
+}
+
+/// Bytes allocated for a buffer, or for all buffers of a dimension array.
+template <typename T>
+static uint64_t getCapacityBytes(const Buffer<T> &buffer) {
+  return buffer.capacity() * sizeof(T);
+}
+template <typename T>
+static uint64_t getCapacityBytes(const std::vector<Buffer<T>> &buffers) {
+  uint64_t bytes = 0;
+  for (const Buffer<T> &buffer : buffers)
+    bytes += getCapacityBytes(buffer);
+  return bytes;
+}
+//// <- MODIFIED
+
+//// -> MODIFIED
+/// Layout of a sparse tensor snapshot (see `save_sparse_tensor`). Integers
+/// are stored in native byte order. The header is followed by the `sizes`
+/// and `rev` arrays (rank entries each) and then by one SnapshotArray per
+/// pointers array, per indices array and for the values, in that order.
+/// Every array starts at a multiple of `kSnapshotAlignment` bytes into the
+/// file, so that a mapping of the file can back the buffers directly.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint8_t pointerBytes;
+  uint8_t indexBytes;
+  uint8_t valueBytes;
+  uint8_t valueIsFloat;
+  uint64_t rank;
+};
+
+struct SnapshotArray {
+  uint64_t offset;
+  uint64_t length;
+};
+
+static const char kSnapshotMagic[8] = {'G', 'B', 'S', 'P', 'A', 'R', 'S', 'E'};
+static const uint32_t kSnapshotVersion = 1;
+static const uint64_t kSnapshotAlignment = 64;
+//// <- MODIFIED
+
 /// Abstract base class of sparse tensor storage. Note that we use
 /// function overloading to implement "partial" method specialization.
 class SparseTensorStorageBase {
@@ -190,22 +724,22 @@ public:
   virtual uint64_t getDimSize(uint64_t) = 0;
 
   // Overhead storage.
-  virtual void getPointers(std::vector<uint64_t> **, uint64_t) { fatal("p64"); }
-  virtual void getPointers(std::vector<uint32_t> **, uint64_t) { fatal("p32"); }
-  virtual void getPointers(std::vector<uint16_t> **, uint64_t) { fatal("p16"); }
-  virtual void getPointers(std::vector<uint8_t> **, uint64_t) { fatal("p8"); }
-  virtual void getIndices(std::vector<uint64_t> **, uint64_t) { fatal("i64"); }
-  virtual void getIndices(std::vector<uint32_t> **, uint64_t) { fatal("i32"); }
-  virtual void getIndices(std::vector<uint16_t> **, uint64_t) { fatal("i16"); }
-  virtual void getIndices(std::vector<uint8_t> **, uint64_t) { fatal("i8"); }
+  virtual void getPointers(Buffer<uint64_t> **, uint64_t) { fatal("p64"); }
+  virtual void getPointers(Buffer<uint32_t> **, uint64_t) { fatal("p32"); }
+  virtual void getPointers(Buffer<uint16_t> **, uint64_t) { fatal("p16"); }
+  virtual void getPointers(Buffer<uint8_t> **, uint64_t) { fatal("p8"); }
+  virtual void getIndices(Buffer<uint64_t> **, uint64_t) { fatal("i64"); }
+  virtual void getIndices(Buffer<uint32_t> **, uint64_t) { fatal("i32"); }
+  virtual void getIndices(Buffer<uint16_t> **, uint64_t) { fatal("i16"); }
+  virtual void getIndices(Buffer<uint8_t> **, uint64_t) { fatal("i8"); }
 
   // Primary storage.
-  virtual void getValues(std::vector<double> **) { fatal("valf64"); }
-  virtual void getValues(std::vector<float> **) { fatal("valf32"); }
-  virtual void getValues(std::vector<int64_t> **) { fatal("vali64"); }
-  virtual void getValues(std::vector<int32_t> **) { fatal("vali32"); }
-  virtual void getValues(std::vector<int16_t> **) { fatal("vali16"); }
-  virtual void getValues(std::vector<int8_t> **) { fatal("vali8"); }
+  virtual void getValues(Buffer<double> **) { fatal("valf64"); }
+  virtual void getValues(Buffer<float> **) { fatal("valf32"); }
+  virtual void getValues(Buffer<int64_t> **) { fatal("vali64"); }
+  virtual void getValues(Buffer<int32_t> **) { fatal("vali32"); }
+  virtual void getValues(Buffer<int16_t> **) { fatal("vali16"); }
+  virtual void getValues(Buffer<int8_t> **) { fatal("vali8"); }
 
   virtual ~SparseTensorStorageBase() {}
 
@@ -239,19 +773,37 @@ public:
   virtual void swap_values(void *new_values) { fatal("swap_values"); }
 
   virtual void assign_rev(uint64_t d, uint64_t index) { fatal("assign_rev"); }
-  virtual void resize_pointers(uint64_t d, uint64_t size) {
+  virtual void resize_pointers(uint64_t d, uint64_t size, bool zero) {
     fatal("resize_pointers");
   }
-  virtual void resize_index(uint64_t d, uint64_t size) {
+  virtual void resize_index(uint64_t d, uint64_t size, bool zero) {
     fatal("resize_index");
   }
-  virtual void resize_values(uint64_t size) { fatal("resize_values"); }
+  virtual void resize_values(uint64_t size, bool zero) {
+    fatal("resize_values");
+  }
   virtual void resize_dim(uint64_t d, uint64_t size) { fatal("resize_dim"); }
 
   virtual void *dup() {
     fatal("dup");
     return NULL;
   }
+  virtual void *view() {
+    fatal("view");
+    return NULL;
+  }
+  virtual void *get_pointers_buffer() {
+    fatal("get_pointers_buffer");
+    return NULL;
+  }
+  virtual void *get_indices_buffer() {
+    fatal("get_indices_buffer");
+    return NULL;
+  }
+  virtual void share_pointers(void *other) { fatal("share_pointers"); }
+  virtual void share_indices(void *other) { fatal("share_indices"); }
+  virtual void detach() { fatal("detach"); }
+  virtual void save(const char *filename) { fatal("save"); }
   //virtual void *empty_like() {
   //  fatal("empty_like");
   //  return NULL;
@@ -272,6 +824,10 @@ public:
   virtual void print_dense() {
     fatal("print_dense");
   }
+  virtual uint64_t get_memory_bytes() {
+    fatal("get_memory_bytes");
+    return 0;
+  }
   //// <- MODIFIED
 
 private:
@@ -290,41 +846,66 @@ private:
 template <typename P, typename I, typename V>
 class SparseTensorStorage : public SparseTensorStorageBase {
 public:
+  //// -> MODIFIED
+  /// The pointers, indices and values buffers are reference counted so that
+  /// views (see `view()`) can share them. A buffer is copied before it is
+  /// modified through the runtime API while it is shared (copy-on-write).
+  using PointerBuffer = std::vector<Buffer<P>>;
+  using IndexBuffer = std::vector<Buffer<I>>;
+  using ValueBuffer = Buffer<V>;
+  //// <- MODIFIED
+
   /// Constructs a sparse tensor storage scheme with the given dimensions,
   /// permutation, and per-dimension dense/sparse annotations, using
   /// the coordinate scheme tensor for the initial contents if provided.
   SparseTensorStorage(const std::vector<uint64_t> &szs, const uint64_t *perm,
                       const uint8_t *sparsity, SparseTensorCOO<V> *tensor)
-      : sizes(szs), rev(getRank()), pointers(getRank()), indices(getRank()) {
+      : sizes(szs), rev(getRank()),
+        pointers(std::make_shared<PointerBuffer>(getRank())),
+        indices(std::make_shared<IndexBuffer>(getRank())),
+        values(std::make_shared<ValueBuffer>()) { //// MODIFIED: shared buffers
     uint64_t rank = getRank();
     // Store "reverse" permutation.
     for (uint64_t r = 0; r < rank; r++)
       rev[perm[r]] = r;
     // Provide hints on capacity of pointers and indices.
     // TODO: needs fine-tuning based on sparsity
+    //// -> MODIFIED: no more entries than elements are reserved, since a
+    //// policy may first touch (commit) the whole capacity of a large buffer
+    uint64_t nnz = tensor ? tensor->getNumElements() : 0;
     for (uint64_t r = 0, s = 1; r < rank; r++) {
       s *= sizes[r];
       if (sparsity[r] == kCompressed) {
-        pointers[r].reserve(s + 1);
-        indices[r].reserve(s);
+        (*pointers)[r].reserve(std::min(s, nnz) + 1);
+        (*indices)[r].reserve(std::min(s, nnz));
         s = 1;
       } else {
         assert(sparsity[r] == kDense && "singleton not yet supported");
       }
     }
+    //// <- MODIFIED
     // Prepare sparse pointer structures for all dimensions.
     for (uint64_t r = 0; r < rank; r++)
       if (sparsity[r] == kCompressed)
-        pointers[r].push_back(0);
+        (*pointers)[r].push_back(0);
     // Then assign contents from coordinate scheme tensor if provided.
     if (tensor) {
-      uint64_t nnz = tensor->getElements().size();
-      values.reserve(nnz);
-      fromCOO(tensor, sparsity, 0, nnz, 0);
+      values->reserve(tensor->getNumElements());
+      fromCOO(tensor, sparsity); //// MODIFIED: iterative
     }
+    track(); //// MODIFIED: memory accounting
   }
 
-  virtual ~SparseTensorStorage() {}
+  //// -> MODIFIED
+  // The buffers are dropped from the memory account with their last tensor
+  virtual ~SparseTensorStorage() {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    release(pointers, kMemPointers);
+    release(indices, kMemIndices);
+    release(values, kMemValues);
+    memoryStats[kMemLiveTensors]--;
+  }
+  //// <- MODIFIED
 
   /// Get the rank of the tensor.
   uint64_t getRank() const override { return sizes.size(); } //// MODIFIED: Added override
@@ -336,15 +917,20 @@ public:
   }
 
   // Partially specialize these three methods based on template types.
-  void getPointers(std::vector<P> **out, uint64_t d) override {
+  //// -> MODIFIED
+  // These back the memrefs used by compiled code and do not detach shared
+  // buffers; code that writes into an existing tensor calls `detach_tensor`
+  // first.
+  //// <- MODIFIED
+  void getPointers(Buffer<P> **out, uint64_t d) override {
     assert(d < getRank());
-    *out = &pointers[d];
+    *out = &(*pointers)[d];
   }
-  void getIndices(std::vector<I> **out, uint64_t d) override {
+  void getIndices(Buffer<I> **out, uint64_t d) override {
     assert(d < getRank());
-    *out = &indices[d];
+    *out = &(*indices)[d];
   }
-  void getValues(std::vector<V> **out) override { *out = &values; }
+  void getValues(Buffer<V> **out) override { *out = values.get(); }
 
   /// Returns this sparse tensor storage scheme as a new memory-resident
   /// sparse tensor in coordinate scheme with the given dimension order.
@@ -356,16 +942,15 @@ public:
     for (uint64_t r = 0; r < rank; r++)
       orgsz[rev[r]] = sizes[r];
     SparseTensorCOO<V> *tensor = SparseTensorCOO<V>::newSparseTensorCOO(
-        rank, orgsz.data(), perm, values.size());
+        rank, orgsz.data(), perm, values->size());
     // Populate coordinate scheme restored from old ordering and changed with
-    // new ordering. Rather than applying both reorderings during the recursion,
+    // new ordering. Rather than applying both reorderings during the traversal,
     // we compute the combine permutation in advance.
     std::vector<uint64_t> reord(rank);
     for (uint64_t r = 0; r < rank; r++)
       reord[r] = perm[rev[r]];
-    std::vector<uint64_t> idx(rank);
-    toCOO(tensor, reord, idx, 0, 0);
-    assert(tensor->getElements().size() == values.size());
+    toCOO(tensor, reord); //// MODIFIED: iterative
+    assert(tensor->getNumElements() == values->size());
     return tensor;
   }
 
@@ -399,80 +984,116 @@ private:
   /// Initializes sparse tensor storage scheme from a memory-resident sparse
   /// tensor in coordinate scheme. This method prepares the pointers and
   /// indices arrays under the given per-dimension dense/sparse annotations.
-  void fromCOO(SparseTensorCOO<V> *tensor, const uint8_t *sparsity, uint64_t lo,
-               uint64_t hi, uint64_t d) {
-    const std::vector<Element<V>> &elements = tensor->getElements();
-    // Once dimensions are exhausted, insert the numerical values.
-    if (d == getRank()) {
-      assert(lo >= hi || lo < elements.size());
-      values.push_back(lo < hi ? elements[lo].value : 0);
-      return;
-    }
-    assert(d < getRank());
-    // Visit all elements in this interval.
-    uint64_t full = 0;
-    while (lo < hi) {
-      assert(lo < elements.size() && hi <= elements.size());
-      // Find segment in interval with same index elements in this dimension.
-      unsigned idx = elements[lo].indices[d];
-      unsigned seg = lo + 1;
-      while (seg < hi && elements[seg].indices[d] == idx)
-        seg++;
-      // Handle segment in interval for sparse or dense dimension.
-      if (sparsity[d] == kCompressed) {
-        indices[d].push_back(idx);
-      } else {
-        // For dense storage we must fill in all the zero values between
-        // the previous element (when last we ran this for-loop) and the
-        // current element.
-        for (; full < idx; full++)
-          fromCOO(tensor, sparsity, 0, 0, d + 1); // pass empty
-        full++;
+  //// -> MODIFIED
+  /// The dimensions are built one after the other. `segments` holds the
+  /// [lo, hi) range of sorted elements below every position of the previous
+  /// dimension, in storage order.
+  void fromCOO(SparseTensorCOO<V> *tensor, const uint8_t *sparsity) {
+    uint64_t rank = getRank();
+    const std::vector<V> &elementValues = tensor->getValues();
+    std::vector<uint64_t> segments = {0, tensor->getNumElements()};
+    std::vector<uint64_t> next;
+    for (uint64_t d = 0; d < rank; d++) {
+      const std::vector<uint64_t> &elementIndices = tensor->getIndices(d);
+      // Once dimensions are exhausted, insert the numerical values. Of
+      // elements with equal indices, the first one is kept.
+      bool last = d + 1 == rank;
+      auto visit = [&](uint64_t lo, uint64_t hi) {
+        if (last) {
+          values->push_back(lo < hi ? elementValues[lo] : 0);
+        } else {
+          next.push_back(lo);
+          next.push_back(hi);
+        }
+      };
+      next.clear();
+      for (uint64_t s = 0, e = segments.size(); s < e; s += 2) {
+        uint64_t lo = segments[s];
+        uint64_t hi = segments[s + 1];
+        if (sparsity[d] == kCompressed) {
+          // Visit every segment with same index elements in this dimension.
+          while (lo < hi) {
+            uint64_t idx = elementIndices[lo];
+            uint64_t seg = lo + 1;
+            while (seg < hi && elementIndices[seg] == idx)
+              seg++;
+            (*indices)[d].push_back(idx);
+            visit(lo, seg);
+            lo = seg;
+          }
+          // Finalize the sparse pointer structure of this position.
+          (*pointers)[d].push_back((*indices)[d].size());
+        } else {
+          // For dense storage every index is visited, with an empty segment
+          // if it has no elements.
+          for (uint64_t idx = 0, sz = sizes[d]; idx < sz; idx++) {
+            uint64_t seg = lo;
+            while (seg < hi && elementIndices[seg] == idx)
+              seg++;
+            visit(lo, seg);
+            lo = seg;
+          }
+        }
       }
-      fromCOO(tensor, sparsity, lo, seg, d + 1);
-      // And move on to next segment in interval.
-      lo = seg;
-    }
-    // Finalize the sparse pointer structure at this dimension.
-    if (sparsity[d] == kCompressed) {
-      pointers[d].push_back(indices[d].size());
-    } else {
-      // For dense storage we must fill in all the zero values after
-      // the last element.
-      for (uint64_t sz = sizes[d]; full < sz; full++)
-        fromCOO(tensor, sparsity, 0, 0, d + 1); // pass empty
+      segments.swap(next);
     }
+    if (rank == 0)
+      values->push_back(elementValues.empty() ? 0 : elementValues[0]);
   }
 
   /// Stores the sparse tensor storage scheme into a memory-resident sparse
-  /// tensor in coordinate scheme.
-  void toCOO(SparseTensorCOO<V> *tensor, std::vector<uint64_t> &reord,
-             std::vector<uint64_t> &idx, uint64_t pos, uint64_t d) {
-    assert(d <= getRank());
-    if (d == getRank()) {
-      assert(pos < values.size());
-      tensor->add(idx, values[pos]);
-    } else if (pointers[d].empty()) {
-      // Dense dimension.
-      for (uint64_t i = 0, sz = sizes[d], off = pos * sz; i < sz; i++) {
-        idx[reord[d]] = i;
-        toCOO(tensor, reord, idx, off + i, d + 1);
+  /// tensor in coordinate scheme. The positions are enumerated in storage
+  /// order with one [pos, end) cursor per dimension.
+  void toCOO(SparseTensorCOO<V> *tensor, const std::vector<uint64_t> &reord) {
+    uint64_t rank = getRank();
+    if (rank == 0) {
+      tensor->add({}, (*values)[0]);
+      return;
+    }
+    std::vector<uint64_t> idx(rank);
+    std::vector<uint64_t> pos(rank);
+    std::vector<uint64_t> end(rank);
+    std::vector<uint64_t> base(rank);
+    // Positions below position `parent` of the previous dimension.
+    auto enter = [&](uint64_t d, uint64_t parent) {
+      if ((*pointers)[d].empty()) {
+        // Dense dimension.
+        base[d] = pos[d] = parent * sizes[d];
+        end[d] = base[d] + sizes[d];
+      } else {
+        // Sparse dimension.
+        pos[d] = (*pointers)[d][parent];
+        end[d] = (*pointers)[d][parent + 1];
       }
-    } else {
-      // Sparse dimension.
-      for (uint64_t ii = pointers[d][pos]; ii < pointers[d][pos + 1]; ii++) {
-        idx[reord[d]] = indices[d][ii];
-        toCOO(tensor, reord, idx, ii, d + 1);
+    };
+    enter(0, 0);
+    for (uint64_t d = 0;;) {
+      if (pos[d] == end[d]) {
+        if (d == 0)
+          break;
+        pos[--d]++;
+        continue;
+      }
+      idx[reord[d]] =
+          (*pointers)[d].empty() ? pos[d] - base[d] : (*indices)[d][pos[d]];
+      if (d + 1 < rank) {
+        enter(d + 1, pos[d]);
+        d++;
+      } else {
+        assert(pos[d] < values->size());
+        tensor->add(idx, (*values)[pos[d]]);
+        pos[d]++;
       }
     }
   }
+  //// <- MODIFIED
 
 private:
   std::vector<uint64_t> sizes; // per-dimension sizes
   std::vector<uint64_t> rev;   // "reverse" permutation
-  std::vector<std::vector<P>> pointers;
-  std::vector<std::vector<I>> indices;
-  std::vector<V> values;
+  std::shared_ptr<PointerBuffer> pointers; //// MODIFIED: shared buffers
+  std::shared_ptr<IndexBuffer> indices;
+  std::shared_ptr<ValueBuffer> values;
 
   //// -> MODIFIED
 public:
@@ -517,32 +1138,116 @@ public:
   /*SparseTensorStorage(uint64_t ndims)
       : sizes(ndims), rev(ndims), pointers(ndims), indices(ndims) {}*/
 
-  // Used by `dup`
-  SparseTensorStorage(void *other)
+  // Used by `dup` (deep copy) and `view` (shares the buffers)
+  SparseTensorStorage(void *other, bool share = false)
       : sizes(static_cast<SparseTensorStorage<P, I, V> *>(other)->sizes),
-        rev(static_cast<SparseTensorStorage<P, I, V> *>(other)->rev),
-        pointers(static_cast<SparseTensorStorage<P, I, V> *>(other)->pointers),
-        indices(static_cast<SparseTensorStorage<P, I, V> *>(other)->indices),
-        values(static_cast<SparseTensorStorage<P, I, V> *>(other)->values) {}
+        rev(static_cast<SparseTensorStorage<P, I, V> *>(other)->rev) {
+    SparseTensorStorage<P, I, V> *tensor =
+        static_cast<SparseTensorStorage<P, I, V> *>(other);
+    if (share) {
+      pointers = tensor->pointers;
+      indices = tensor->indices;
+      values = tensor->values;
+    } else {
+      pointers = std::make_shared<PointerBuffer>(*tensor->pointers);
+      indices = std::make_shared<IndexBuffer>(*tensor->indices);
+      values = std::make_shared<ValueBuffer>(*tensor->values);
+    }
+    track();
+  }
 
   SparseTensorStorage(const std::vector<uint64_t> &other_sizes,
                       const std::vector<uint64_t> &other_rev, bool is_sparse)
-      : sizes(other_sizes), rev(other_rev) {
-    pointers.resize(sizes.size());
+      : sizes(other_sizes), rev(other_rev),
+        pointers(std::make_shared<PointerBuffer>()),
+        indices(std::make_shared<IndexBuffer>()),
+        values(std::make_shared<ValueBuffer>()) {
+    pointers->resize(sizes.size());
     if (is_sparse) {
-      pointers[0].resize(2);
+      (*pointers)[0].resize(2, 0);
     }
     for (size_t i = 1; i < sizes.size(); ++i) {
-      pointers[i].resize(1);
+      (*pointers)[i].resize(1, 0);
+    }
+    indices->resize(sizes.size());
+    track();
+  }
+
+  // Used by `load_sparse_tensor`; takes over the given buffers
+  SparseTensorStorage(const std::vector<uint64_t> &other_sizes,
+                      const std::vector<uint64_t> &other_rev,
+                      PointerBuffer &&other_pointers,
+                      IndexBuffer &&other_indices, ValueBuffer &&other_values)
+      : sizes(other_sizes), rev(other_rev),
+        pointers(std::make_shared<PointerBuffer>(std::move(other_pointers))),
+        indices(std::make_shared<IndexBuffer>(std::move(other_indices))),
+        values(std::make_shared<ValueBuffer>(std::move(other_values))) {
+    track();
+  }
+
+  // Writes sizes, rev, pointers, indices and values as aligned raw arrays
+  void save(const char *filename) override {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+      fprintf(stderr, "Cannot open %s\n", filename);
+      exit(1);
+    }
+    uint64_t rank = getRank();
+    SnapshotHeader header;
+    memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.pointerBytes = sizeof(P);
+    header.indexBytes = sizeof(I);
+    header.valueBytes = sizeof(V);
+    header.valueIsFloat = std::is_floating_point<V>::value;
+    header.rank = rank;
+    // Lay out the arrays after the header, sizes, rev and the array table.
+    std::vector<SnapshotArray> arrays(2 * rank + 1);
+    uint64_t offset = sizeof(SnapshotHeader) + 2 * rank * sizeof(uint64_t) +
+                      arrays.size() * sizeof(SnapshotArray);
+    for (uint64_t r = 0; r < rank; r++)
+      arrays[r] = placeSnapshotArray(offset, (*pointers)[r].size(), sizeof(P));
+    for (uint64_t r = 0; r < rank; r++)
+      arrays[rank + r] =
+          placeSnapshotArray(offset, (*indices)[r].size(), sizeof(I));
+    arrays[2 * rank] = placeSnapshotArray(offset, values->size(), sizeof(V));
+    // Write everything in file order.
+    uint64_t pos = 0;
+    writeSnapshotBytes(file, pos, &header, sizeof(header));
+    writeSnapshotBytes(file, pos, sizes.data(), rank * sizeof(uint64_t));
+    writeSnapshotBytes(file, pos, rev.data(), rank * sizeof(uint64_t));
+    writeSnapshotBytes(file, pos, arrays.data(),
+                       arrays.size() * sizeof(SnapshotArray));
+    for (uint64_t r = 0; r < rank; r++)
+      writeSnapshotArray(file, pos, arrays[r], (*pointers)[r].data());
+    for (uint64_t r = 0; r < rank; r++)
+      writeSnapshotArray(file, pos, arrays[rank + r], (*indices)[r].data());
+    writeSnapshotArray(file, pos, arrays[2 * rank], values->data());
+    if (ferror(file) | fclose(file)) {
+      fprintf(stderr, "Cannot write %s\n", filename);
+      exit(1);
     }
-    indices.resize(sizes.size());
   }
 
+  // Returned vectors may be modified by the caller, so they are detached
+  // from any views first
   void *get_rev_ptr() override { return &rev; }
   void *get_sizes_ptr() override { return &sizes; }
-  void *get_pointers_ptr() override { return &pointers; }
-  void *get_indices_ptr() override { return &indices; }
-  void *get_values_ptr() override { return &values; }
+  void *get_pointers_ptr() override {
+    copyIfShared(pointers);
+    account();
+    return pointers.get();
+  }
+  void *get_indices_ptr() override {
+    copyIfShared(indices);
+    account();
+    return indices.get();
+  }
+  void *get_values_ptr() override {
+    copyIfShared(values);
+    account();
+    return values.get();
+  }
 
   void swap_rev(void *new_rev) override {
     rev.swap(*(std::vector<uint64_t> *)new_rev);
@@ -550,29 +1255,75 @@ public:
   void swap_sizes(void *new_sizes) override {
     sizes.swap(*(std::vector<uint64_t> *)new_sizes);
   }
+  // The old contents are swapped out, so shared buffers are replaced rather
+  // than copied
   void swap_pointers(void *new_pointers) override {
-    pointers.swap(*(std::vector<std::vector<P>> *)new_pointers);
+    resetIfShared(pointers)->swap(*(PointerBuffer *)new_pointers);
+    account();
   }
   void swap_indices(void *new_indices) override {
-    indices.swap(*(std::vector<std::vector<I>> *)new_indices);
+    resetIfShared(indices)->swap(*(IndexBuffer *)new_indices);
+    account();
   }
   void swap_values(void *new_values) override {
-    values.swap(*(std::vector<V> *)new_values);
+    resetIfShared(values)->swap(*(ValueBuffer *)new_values);
+    account();
   }
   void assign_rev(uint64_t d, uint64_t index) override { rev[d] = index; }
-  void resize_pointers(uint64_t d, uint64_t size) override {
-    pointers[d].resize(size);
+  // New elements are uninitialized unless `zero` is set
+  void resize_pointers(uint64_t d, uint64_t size, bool zero) override {
+    resizeBuffer((*copyIfShared(pointers))[d], size, zero);
+    account();
+  }
+  void resize_index(uint64_t d, uint64_t size, bool zero) override {
+    resizeBuffer((*copyIfShared(indices))[d], size, zero);
+    account();
   }
-  void resize_index(uint64_t d, uint64_t size) override {
-    indices[d].resize(size);
+  void resize_values(uint64_t size, bool zero) override {
+    resizeBuffer(*copyIfShared(values), size, zero);
+    account();
   }
-  void resize_values(uint64_t size) override { values.resize(size); }
   void resize_dim(uint64_t d, uint64_t size) override { sizes[d] = size; }
   // New tensor of same type with same data
   void *dup() override {
     SparseTensorStorageBase *tensor = new SparseTensorStorage<P, I, V>(this);
     return tensor;
   }
+  // New tensor of same type sharing the data of this one. Only `sizes` and
+  // `rev` are owned by the view, so relabeling dimensions is O(rank).
+  void *view() override {
+    SparseTensorStorageBase *tensor =
+        new SparseTensorStorage<P, I, V>(this, true);
+    return tensor;
+  }
+  // `other` may have a different value type
+  void *get_pointers_buffer() override { return &pointers; }
+  void *get_indices_buffer() override { return &indices; }
+  void share_pointers(void *other) override {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    release(pointers, kMemPointers);
+    pointers = *static_cast<std::shared_ptr<PointerBuffer> *>(
+        static_cast<SparseTensorStorageBase *>(other)->get_pointers_buffer());
+  }
+  void share_indices(void *other) override {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    release(indices, kMemIndices);
+    indices = *static_cast<std::shared_ptr<IndexBuffer> *>(
+        static_cast<SparseTensorStorageBase *>(other)->get_indices_buffer());
+  }
+  // Gives this tensor private copies of any buffers shared with views, so
+  // that it can be modified in place through its memrefs
+  void detach() override {
+    copyIfShared(pointers);
+    copyIfShared(indices);
+    copyIfShared(values);
+    account();
+  }
+  // Bytes allocated for the buffers of this tensor, shared or not
+  uint64_t get_memory_bytes() override {
+    return getCapacityBytes(*pointers) + getCapacityBytes(*indices) +
+           getCapacityBytes(*values);
+  }
   // New tensor of same type with same shape
   //void *empty_like() override {
   //  SparseTensorStorageBase *tensor =
@@ -612,11 +1363,11 @@ public:
         }
       }
     }
-    if (this->pointers.size() != ndim) {
+    if (pointers->size() != ndim) {
       fprintf(stderr, "Bad tensor: len(pointers) != ndim\n");
       return false;
     }
-    if (this->indices.size() != ndim) {
+    if (indices->size() != ndim) {
       fprintf(stderr, "Bad tensor: len(indices) != ndim\n");
       return false;
     }
@@ -630,8 +1381,8 @@ public:
     uint64_t prev_ptr_len = 0;
     uint64_t prev_idx_len = 0;
     for (size_t dim = 0; dim < ndim; ++dim) {
-      auto &ptr = this->pointers[dim];
-      auto &idx = this->indices[dim];
+      auto &ptr = (*pointers)[dim];
+      auto &idx = (*indices)[dim];
       auto &size = this->sizes[dim];
       if (size <= 0) {
         fprintf(stderr, "Bad tensor (dim=%lu): size <= 0\n", dim);
@@ -756,12 +1507,12 @@ public:
       }
     }
     if (is_dense) {
-      if (cum_size != this->values.size()) {
+      if (cum_size != values->size()) {
         fprintf(stderr, "Bad tensor: cum_size != len(values)\n");
         rv = false;
       }
     } else {
-      if (prev_idx_len != this->values.size()) {
+      if (prev_idx_len != values->size()) {
         fprintf(stderr, "Bad tensor: len(last_idx) != len(values)\n");
         rv = false;
       }
@@ -799,7 +1550,7 @@ public:
     }
     if (level >= 3) {
       // Print pointers
-      std::vector<P> ptrs = pointers[rank == 2 ? 1 : 0];
+      const Buffer<P> &ptrs = (*pointers)[rank == 2 ? 1 : 0];
       std::cout << "pointers=(";
       for (uint64_t i=0; i<ptrs.size(); i++) {
         if (i != 0)
@@ -811,7 +1562,7 @@ public:
     if (level >= 2) {
       // Print indices
       std::cout << "indices=(";
-      std::vector<I> idx = indices[rank == 2 ? 1 : 0];
+      const Buffer<I> &idx = (*indices)[rank == 2 ? 1 : 0];
       for (uint64_t i=0; i<idx.size(); i++) {
         if (i != 0)
           std::cout << ", ";
@@ -822,10 +1573,10 @@ public:
     if (level >= 1) {
       // Print values
       std::cout << "values=(";
-      for (uint64_t i=0; i<values.size(); i++) {
+      for (uint64_t i=0; i<values->size(); i++) {
         if (i != 0)
           std::cout << ", ";
-        std::cout << values[i];
+        std::cout << (*values)[i];
       }
       std::cout << ")\n";
     }
@@ -835,6 +1586,82 @@ public:
     std::cout << "print_dense is not implemented";
     std::cout << '\n';
   }
+
+private:
+  static SnapshotArray placeSnapshotArray(uint64_t &offset, uint64_t length,
+                                          uint64_t elementBytes) {
+    offset = (offset + kSnapshotAlignment - 1) / kSnapshotAlignment *
+             kSnapshotAlignment;
+    SnapshotArray array = {offset, length};
+    offset += length * elementBytes;
+    return array;
+  }
+  static void writeSnapshotBytes(FILE *file, uint64_t &pos, const void *data,
+                                 uint64_t bytes) {
+    if (bytes)
+      fwrite(data, 1, bytes, file);
+    pos += bytes;
+  }
+  template <typename T>
+  static void writeSnapshotArray(FILE *file, uint64_t &pos,
+                                 const SnapshotArray &array, const T *data) {
+    static const char padding[kSnapshotAlignment] = {0};
+    writeSnapshotBytes(file, pos, padding, array.offset - pos);
+    writeSnapshotBytes(file, pos, data, array.length * sizeof(T));
+  }
+  template <typename T>
+  static std::shared_ptr<T> &copyIfShared(std::shared_ptr<T> &buffer) {
+    if (buffer.use_count() > 1)
+      buffer = std::make_shared<T>(*buffer);
+    return buffer;
+  }
+  template <typename T>
+  static std::shared_ptr<T> &resetIfShared(std::shared_ptr<T> &buffer) {
+    if (buffer.use_count() > 1)
+      buffer = std::make_shared<T>();
+    return buffer;
+  }
+  // Counts a new tensor and charges its buffers
+  void track() {
+    {
+      std::lock_guard<std::mutex> lock(memoryMutex);
+      memoryStats[kMemLiveTensors]++;
+      memoryStats[kMemTensorAllocations]++;
+    }
+    account();
+  }
+  // Charges the buffers with their current capacity
+  void account() {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    chargeBuffer(pointers.get(), kMemPointers, getCapacityBytes(*pointers));
+    chargeBuffer(indices.get(), kMemIndices, getCapacityBytes(*indices));
+    chargeBuffer(values.get(), kMemValues, getCapacityBytes(*values));
+  }
+  // Lets go of a buffer, dropping its charge if this tensor was the last to
+  // hold it. Needs `memoryMutex`, under which all tensors let go of their
+  // buffers, so that exactly one of them sees the last reference.
+  template <typename T>
+  static void release(std::shared_ptr<T> &buffer, MemoryComponent component) {
+    if (buffer.use_count() == 1)
+      dischargeBuffer(buffer.get(), component);
+    buffer.reset();
+  }
+  // Growing leaves the new elements uninitialized; with `zero`, they are
+  // zeroed by several threads, so their pages are also first touched there.
+  template <typename T>
+  static void resizeBuffer(Buffer<T> &buffer, uint64_t size, bool zero) {
+    uint64_t oldSize = buffer.size();
+    buffer.resize(size);
+    if (!zero || size <= oldSize)
+      return;
+    T *data = buffer.data() + oldSize;
+    uint64_t n = size - oldSize;
+    unsigned numThreads = getNumThreads(n, 1 << 20);
+    parallelFor(numThreads, [&](unsigned t) {
+      std::fill(data + n * t / numThreads, data + n * (t + 1) / numThreads,
+                T());
+    });
+  }
   //// <- MODIFIED
 };
 
@@ -845,8 +1672,259 @@ static char *toLower(char *token) {
   return token;
 }
 
-/// Read the MME header of a general sparse matrix of type real.
-static void readMMEHeader(FILE *file, char *name, uint64_t *idata) {
+//// -> MODIFIED
+/// The layout of the entries that follow the header of an external format.
+struct EntryFormat {
+  enum Field : uint8_t { kReal = 0, kInteger = 1, kPattern = 2 };
+  enum Symmetry : uint8_t { kGeneral = 0, kSymmetric = 1, kSkewSymmetric = 2 };
+  Field field = kReal;
+  Symmetry symmetry = kGeneral;
+};
+
+/// A memory mapping of a whole file. A writable mapping is private: pages
+/// are copied on their first write and the file itself is never modified.
+class MappedFile {
+public:
+  explicit MappedFile(const char *filename, bool writable = false) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "Cannot find %s\n", filename);
+      exit(1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      fprintf(stderr, "Cannot stat %s\n", filename);
+      exit(1);
+    }
+    size = st.st_size;
+    if (size) {
+      int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+      void *ptr = mmap(nullptr, size, prot, MAP_PRIVATE, fd, 0);
+      if (ptr == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", filename);
+        exit(1);
+      }
+      data = static_cast<const char *>(ptr);
+    }
+    close(fd);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+    if (size)
+      munmap(const_cast<char *>(data), size);
+  }
+  const char *begin() const { return data; }
+  const char *end() const { return data + size; }
+  /// Hints that the mapping will be read front to back.
+  void adviseSequential() const {
+    if (size)
+      madvise(const_cast<char *>(data), size, MADV_SEQUENTIAL);
+  }
+
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+/// Returns the end of the line starting at p (its newline, or end).
+static inline const char *findEndOfLine(const char *p, const char *end) {
+  const void *eol = p < end ? memchr(p, '\n', end - p) : nullptr;
+  return eol ? static_cast<const char *>(eol) : end;
+}
+
+/// Copies the next line (without its newline) into a null-terminated buffer
+/// of the given capacity and advances p past it. Returns false at the end.
+static bool readLine(const char *&p, const char *end, char *line,
+                     size_t capacity) {
+  if (p >= end)
+    return false;
+  const char *eol = findEndOfLine(p, end);
+  size_t len = std::min<size_t>(eol - p, capacity - 1);
+  memcpy(line, p, len);
+  line[len] = '\0';
+  p = eol < end ? eol + 1 : end;
+  return true;
+}
+
+static inline bool isDigit(char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+static inline const char *skipBlanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  return p;
+}
+
+/// Parses an unsigned decimal integer and advances p past it.
+static inline bool parseUInt(const char *&p, const char *end, uint64_t &val) {
+  p = skipBlanks(p, end);
+  const char *start = p;
+  uint64_t v = 0;
+  for (; p < end && isDigit(*p); p++)
+    v = v * 10 + (*p - '0');
+  val = v;
+  return p != start;
+}
+
+/// Parses a signed decimal integer and advances p past it.
+static inline bool parseInt(const char *&p, const char *end, int64_t &val) {
+  p = skipBlanks(p, end);
+  bool neg = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+'))
+    p++;
+  if (p == end || !isDigit(*p))
+    return false;
+  uint64_t v;
+  parseUInt(p, end, v);
+  val = neg ? -static_cast<int64_t>(v) : static_cast<int64_t>(v);
+  return true;
+}
+
+/// Parses a floating-point number and advances p past it. A mantissa that
+/// fits in 53 bits with a decimal exponent of at most 22 is converted exactly
+/// by a single multiply or divide; anything else (long mantissas, huge
+/// exponents, inf, nan) falls back to strtod.
+static bool parseDouble(const char *&p, const char *end, double &val) {
+  static const double powersOf10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  p = skipBlanks(p, end);
+  const char *start = p;
+  bool neg = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+'))
+    p++;
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool sawDigit = false;
+  for (; p < end && isDigit(*p); p++, sawDigit = true) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    } else {
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && isDigit(*p); p++, sawDigit = true) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        exponent--;
+      }
+    }
+  }
+  if (sawDigit && p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negExp = q < end && *q == '-';
+    if (q < end && (*q == '-' || *q == '+'))
+      q++;
+    if (q < end && isDigit(*q)) {
+      int e = 0;
+      for (; q < end && isDigit(*q); q++)
+        e = e < 100000 ? e * 10 + (*q - '0') : e;
+      exponent += negExp ? -e : e;
+      p = q;
+    }
+  }
+  bool atDelimiter = p == end || isspace(static_cast<unsigned char>(*p));
+  if (sawDigit && atDelimiter && mantissa <= (uint64_t(1) << 53) &&
+      exponent >= -22 && exponent <= 22) {
+    double d = static_cast<double>(mantissa);
+    d = exponent < 0 ? d / powersOf10[-exponent] : d * powersOf10[exponent];
+    val = neg ? -d : d;
+    return true;
+  }
+  // The mapped file is not null-terminated, so strtod gets a copy.
+  char token[128];
+  const char *tokenEnd = start;
+  while (tokenEnd < end && !isspace(static_cast<unsigned char>(*tokenEnd)))
+    tokenEnd++;
+  size_t len = std::min<size_t>(tokenEnd - start, sizeof(token) - 1);
+  memcpy(token, start, len);
+  token[len] = '\0';
+  char *parsed;
+  val = strtod(token, &parsed);
+  p = start + (parsed - token);
+  return parsed != token;
+}
+
+/// The elements read by one thread from its chunk of the file.
+template <typename V>
+struct ReadChunk {
+  explicit ReadChunk(uint64_t rank) : indices(rank) {}
+  std::vector<std::vector<uint64_t>> indices; // per-dimension indices
+  std::vector<V> values;
+  uint64_t entries = 0;
+  const char *error = nullptr;
+};
+
+/// Parses the entries of all lines starting in [p, end) into the chunk.
+/// Indices are permuted and made 0-based. Off-diagonal entries of symmetric
+/// and skew-symmetric matrices are mirrored.
+template <typename V>
+static void readEntries(const char *p, const char *end, uint64_t rank,
+                        const uint64_t *sizes, const uint64_t *perm,
+                        EntryFormat format, ReadChunk<V> *chunk) {
+  std::vector<uint64_t> indices(rank);
+  auto add = [&](V value) {
+    for (uint64_t r = 0; r < rank; r++)
+      chunk->indices[r].push_back(indices[r]);
+    chunk->values.push_back(value);
+  };
+  while (p < end) {
+    const char *eol = findEndOfLine(p, end);
+    const char *q = skipBlanks(p, eol);
+    p = eol < end ? eol + 1 : end;
+    // Skip blank and comment lines.
+    if (q == eol || *q == '%' || *q == '#')
+      continue;
+    for (uint64_t r = 0; r < rank; r++) {
+      uint64_t idx;
+      if (!parseUInt(q, eol, idx) || idx == 0 || idx > sizes[r]) {
+        chunk->error = "Cannot find next index";
+        return;
+      }
+      // Add 0-based index.
+      indices[perm[r]] = idx - 1;
+    }
+    // Values are cast to the sparse tensor object type.
+    V value;
+    if (format.field == EntryFormat::kPattern) {
+      value = 1;
+    } else if (format.field == EntryFormat::kInteger) {
+      int64_t ival;
+      if (!parseInt(q, eol, ival)) {
+        chunk->error = "Cannot find next value";
+        return;
+      }
+      value = static_cast<V>(ival);
+    } else {
+      double dval;
+      if (!parseDouble(q, eol, dval)) {
+        chunk->error = "Cannot find next value";
+        return;
+      }
+      value = static_cast<V>(dval);
+    }
+    chunk->entries++;
+    add(value);
+    if (format.symmetry != EntryFormat::kGeneral && indices[0] != indices[1]) {
+      std::swap(indices[0], indices[1]);
+      if (format.symmetry == EntryFormat::kSkewSymmetric)
+        value = static_cast<V>(-value);
+      add(value);
+    }
+  }
+}
+
+/// Read the MME header of a sparse matrix in coordinate format. Real (or
+/// double), integer and pattern fields are supported, as well as general,
+/// symmetric and skew-symmetric matrices.
+static void readMMEHeader(const char *&p, const char *end, char *name,
+                          uint64_t *idata, EntryFormat &entryFormat) {
   char line[1025];
   char header[64];
   char object[64];
@@ -854,32 +1932,51 @@ static void readMMEHeader(FILE *file, char *name, uint64_t *idata) {
   char field[64];
   char symmetry[64];
   // Read header line.
-  if (fscanf(file, "%63s %63s %63s %63s %63s\n", header, object, format, field,
+  if (!readLine(p, end, line, sizeof(line)) ||
+      sscanf(line, "%63s %63s %63s %63s %63s", header, object, format, field,
              symmetry) != 5) {
     fprintf(stderr, "Corrupt header in %s\n", name);
     exit(1);
   }
-  // Make sure this is a general sparse matrix.
+  // Make sure this is a sparse matrix.
   if (strcmp(toLower(header), "%%matrixmarket") ||
       strcmp(toLower(object), "matrix") ||
-      strcmp(toLower(format), "coordinate") || strcmp(toLower(field), "real") ||
-      strcmp(toLower(symmetry), "general")) {
-    fprintf(stderr,
-            "Cannot find a general sparse matrix with type real in %s\n", name);
+      strcmp(toLower(format), "coordinate")) {
+    fprintf(stderr, "Cannot find a sparse matrix in %s\n", name);
     exit(1);
   }
-  // Skip comments.
+  if (!strcmp(toLower(field), "real") || !strcmp(field, "double")) {
+    entryFormat.field = EntryFormat::kReal;
+  } else if (!strcmp(field, "integer")) {
+    entryFormat.field = EntryFormat::kInteger;
+  } else if (!strcmp(field, "pattern")) {
+    entryFormat.field = EntryFormat::kPattern;
+  } else {
+    fprintf(stderr, "Unsupported field %s in %s\n", field, name);
+    exit(1);
+  }
+  if (!strcmp(toLower(symmetry), "general")) {
+    entryFormat.symmetry = EntryFormat::kGeneral;
+  } else if (!strcmp(symmetry, "symmetric")) {
+    entryFormat.symmetry = EntryFormat::kSymmetric;
+  } else if (!strcmp(symmetry, "skew-symmetric")) {
+    entryFormat.symmetry = EntryFormat::kSkewSymmetric;
+  } else {
+    fprintf(stderr, "Unsupported symmetry %s in %s\n", symmetry, name);
+    exit(1);
+  }
+  // Skip comments and blank lines.
   while (1) {
-    if (!fgets(line, 1025, file)) {
+    if (!readLine(p, end, line, sizeof(line))) {
       fprintf(stderr, "Cannot find data in %s\n", name);
       exit(1);
     }
-    if (line[0] != '%')
+    if (line[0] != '%' && line[strspn(line, " \t\r")] != '\0')
       break;
   }
   // Next line contains M N NNZ.
   idata[0] = 2; // rank
-  if (sscanf(line, "%" PRIu64 "%" PRIu64 "%" PRIu64 "\n", idata + 2, idata + 3,
+  if (sscanf(line, "%" PRIu64 "%" PRIu64 "%" PRIu64, idata + 2, idata + 3,
              idata + 1) != 3) {
     fprintf(stderr, "Cannot find size in %s\n", name);
     exit(1);
@@ -890,11 +1987,12 @@ static void readMMEHeader(FILE *file, char *name, uint64_t *idata) {
 /// format, we assume that the file starts with optional comments followed
 /// by two lines that define the rank, the number of nonzeros, and the
 /// dimensions sizes (one per rank) of the sparse tensor.
-static void readExtFROSTTHeader(FILE *file, char *name, uint64_t *idata) {
+static void readExtFROSTTHeader(const char *&p, const char *end, char *name,
+                                uint64_t *idata) {
   char line[1025];
   // Skip comments.
   while (1) {
-    if (!fgets(line, 1025, file)) {
+    if (!readLine(p, end, line, sizeof(line))) {
       fprintf(stderr, "Cannot find data in %s\n", name);
       exit(1);
     }
@@ -902,75 +2000,317 @@ static void readExtFROSTTHeader(FILE *file, char *name, uint64_t *idata) {
       break;
   }
   // Next line contains RANK and NNZ.
-  if (sscanf(line, "%" PRIu64 "%" PRIu64 "\n", idata, idata + 1) != 2) {
+  if (sscanf(line, "%" PRIu64 "%" PRIu64, idata, idata + 1) != 2 ||
+      idata[0] > 510) {
     fprintf(stderr, "Cannot find metadata in %s\n", name);
     exit(1);
   }
   // Followed by a line with the dimension sizes (one per rank).
+  const char *eol = findEndOfLine(p, end);
   for (uint64_t r = 0; r < idata[0]; r++) {
-    if (fscanf(file, "%" PRIu64, idata + 2 + r) != 1) {
+    if (!parseUInt(p, eol, idata[2 + r])) {
       fprintf(stderr, "Cannot find dimension size %s\n", name);
       exit(1);
     }
   }
+  p = eol < end ? eol + 1 : end;
 }
 
 /// Reads a sparse tensor with the given filename into a memory-resident
-/// sparse tensor in coordinate scheme.
+/// sparse tensor in coordinate scheme. The file is memory mapped, split into
+/// chunks on line boundaries and the chunks are parsed in parallel.
 template <typename V>
 static SparseTensorCOO<V> *openSparseTensorCOO(char *filename, uint64_t rank,
                                                const uint64_t *sizes,
                                                const uint64_t *perm) {
-  // Open the file.
-  FILE *file = fopen(filename, "r");
-  if (!file) {
-    fprintf(stderr, "Cannot find %s\n", filename);
-    exit(1);
-  }
+  // Map the file. Every reader thread scans its chunk front to back.
+  MappedFile file(filename);
+  file.adviseSequential();
+  const char *begin = file.begin();
+  const char *end = file.end();
   // Perform some file format dependent set up.
   uint64_t idata[512];
+  EntryFormat format;
   if (strstr(filename, ".mtx")) {
-    readMMEHeader(file, filename, idata);
+    readMMEHeader(begin, end, filename, idata, format);
   } else if (strstr(filename, ".tns")) {
-    readExtFROSTTHeader(file, filename, idata);
+    readExtFROSTTHeader(begin, end, filename, idata);
   } else {
     fprintf(stderr, "Unknown format %s\n", filename);
     exit(1);
   }
-  // Prepare sparse tensor object with per-dimension sizes
-  // and the number of nonzeros as initial capacity.
   assert(rank == idata[0] && "rank mismatch");
   uint64_t nnz = idata[1];
   for (uint64_t r = 0; r < rank; r++)
     assert((sizes[r] == 0 || sizes[r] == idata[2 + r]) &&
            "dimension size mismatch");
-  SparseTensorCOO<V> *tensor =
-      SparseTensorCOO<V>::newSparseTensorCOO(rank, idata + 2, perm, nnz);
-  //  Read all nonzero elements.
-  std::vector<uint64_t> indices(rank);
-  for (uint64_t k = 0; k < nnz; k++) {
-    uint64_t idx = -1;
-    for (uint64_t r = 0; r < rank; r++) {
-      if (fscanf(file, "%" PRIu64, &idx) != 1) {
-        fprintf(stderr, "Cannot find next index in %s\n", filename);
-        exit(1);
-      }
-      // Add 0-based index.
-      indices[perm[r]] = idx - 1;
-    }
-    // The external formats always store the numerical values with the type
-    // double, but we cast these values to the sparse tensor object type.
-    double value;
-    if (fscanf(file, "%lg\n", &value) != 1) {
-      fprintf(stderr, "Cannot find next value in %s\n", filename);
+  // Split the entries into chunks that start on a line boundary. Small
+  // files are not worth the thread start-up.
+  unsigned numChunks = getNumThreads(end - begin, 1 << 20);
+  std::vector<const char *> bounds(numChunks + 1, end);
+  bounds[0] = begin;
+  for (unsigned t = 1; t < numChunks; t++) {
+    const char *split = begin + (end - begin) / numChunks * t;
+    const char *eol = findEndOfLine(std::max(split, bounds[t - 1]), end);
+    bounds[t] = eol < end ? eol + 1 : end;
+  }
+  // Parse all chunks in parallel, each into its own buffer.
+  std::vector<ReadChunk<V>> chunks(numChunks, ReadChunk<V>(rank));
+  parallelFor(numChunks, [&](unsigned t) {
+    readEntries<V>(bounds[t], bounds[t + 1], rank, idata + 2, perm, format,
+                   &chunks[t]);
+  });
+  uint64_t entries = 0;
+  uint64_t numElements = 0;
+  for (const ReadChunk<V> &chunk : chunks) {
+    if (chunk.error) {
+      fprintf(stderr, "%s in %s\n", chunk.error, filename);
       exit(1);
     }
-    tensor->add(indices, value);
+    entries += chunk.entries;
+    numElements += chunk.values.size();
   }
-  // Close the file and return tensor.
-  fclose(file);
+  if (entries != nnz) {
+    fprintf(stderr,
+            "Expected %" PRIu64 " entries but found %" PRIu64 " in %s\n", nnz,
+            entries, filename);
+    exit(1);
+  }
+  // Gather the chunks in file order.
+  SparseTensorCOO<V> *tensor =
+      SparseTensorCOO<V>::newSparseTensorCOO(rank, idata + 2, perm,
+                                             numElements);
+  for (ReadChunk<V> &chunk : chunks)
+    tensor->append(std::move(chunk.indices), std::move(chunk.values));
   return tensor;
 }
+//// <- MODIFIED
+
+//// -> MODIFIED
+/// Returns a buffer of `length` elements backed by `data`, which `owner`
+/// keeps alive until the buffer releases it.
+template <typename T>
+static Buffer<T> adoptArray(void *data, uint64_t length,
+                            const std::shared_ptr<void> &owner) {
+  Buffer<T> buffer;
+  if (length) {
+    std::shared_ptr<AdoptedMemory> memory = std::make_shared<AdoptedMemory>();
+    memory->data = data;
+    memory->bytes = length * sizeof(T);
+    memory->owner = owner;
+    buffer = Buffer<T>(BufferAllocator<T>(memory));
+    buffer.reserve(length);
+    buffer.resize(length);
+  }
+  return buffer;
+}
+
+/// Returns a buffer backed by an array of a mapped snapshot.
+template <typename T>
+static Buffer<T> adoptSnapshotArray(const std::shared_ptr<MappedFile> &file,
+                                    const SnapshotArray &array,
+                                    const char *filename) {
+  uint64_t fileSize = file->end() - file->begin();
+  if (array.offset % kSnapshotAlignment || array.offset > fileSize ||
+      array.length > (fileSize - array.offset) / sizeof(T)) {
+    fprintf(stderr, "Corrupt snapshot %s\n", filename);
+    exit(1);
+  }
+  return adoptArray<T>(const_cast<char *>(file->begin()) + array.offset,
+                       array.length, file);
+}
+
+/// Loads a snapshot written by `save`. The buffers of the new tensor are
+/// backed by a private mapping of the file, so nothing is read up front and
+/// a page is only copied when it is first written.
+template <typename P, typename I, typename V>
+static SparseTensorStorageBase *
+loadSnapshot(const std::shared_ptr<MappedFile> &file,
+             const SnapshotHeader &header, const char *filename) {
+  uint64_t rank = header.rank;
+  const uint64_t *meta =
+      reinterpret_cast<const uint64_t *>(file->begin() + sizeof(header));
+  const SnapshotArray *arrays =
+      reinterpret_cast<const SnapshotArray *>(meta + 2 * rank);
+  std::vector<uint64_t> sizes(meta, meta + rank);
+  std::vector<uint64_t> rev(meta + rank, meta + 2 * rank);
+  typename SparseTensorStorage<P, I, V>::PointerBuffer pointers;
+  typename SparseTensorStorage<P, I, V>::IndexBuffer indices;
+  for (uint64_t r = 0; r < rank; r++) {
+    pointers.push_back(adoptSnapshotArray<P>(file, arrays[r], filename));
+    indices.push_back(adoptSnapshotArray<I>(file, arrays[rank + r], filename));
+  }
+  Buffer<V> values = adoptSnapshotArray<V>(file, arrays[2 * rank], filename);
+  return new SparseTensorStorage<P, I, V>(sizes, rev, std::move(pointers),
+                                          std::move(indices),
+                                          std::move(values));
+}
+
+template <typename P, typename I>
+static SparseTensorStorageBase *
+loadSnapshot(const std::shared_ptr<MappedFile> &file,
+             const SnapshotHeader &header, const char *filename) {
+  if (header.valueIsFloat && header.valueBytes == 8)
+    return loadSnapshot<P, I, double>(file, header, filename);
+  if (header.valueIsFloat && header.valueBytes == 4)
+    return loadSnapshot<P, I, float>(file, header, filename);
+  if (!header.valueIsFloat && header.valueBytes == 8)
+    return loadSnapshot<P, I, int64_t>(file, header, filename);
+  if (!header.valueIsFloat && header.valueBytes == 4)
+    return loadSnapshot<P, I, int32_t>(file, header, filename);
+  if (!header.valueIsFloat && header.valueBytes == 2)
+    return loadSnapshot<P, I, int16_t>(file, header, filename);
+  if (!header.valueIsFloat && header.valueBytes == 1)
+    return loadSnapshot<P, I, int8_t>(file, header, filename);
+  fprintf(stderr, "Unsupported value type in snapshot %s\n", filename);
+  exit(1);
+}
+
+template <typename P>
+static SparseTensorStorageBase *
+loadSnapshot(const std::shared_ptr<MappedFile> &file,
+             const SnapshotHeader &header, const char *filename) {
+  switch (header.indexBytes) {
+  case 8:
+    return loadSnapshot<P, uint64_t>(file, header, filename);
+  case 4:
+    return loadSnapshot<P, uint32_t>(file, header, filename);
+  case 2:
+    return loadSnapshot<P, uint16_t>(file, header, filename);
+  case 1:
+    return loadSnapshot<P, uint8_t>(file, header, filename);
+  }
+  fprintf(stderr, "Unsupported index type in snapshot %s\n", filename);
+  exit(1);
+}
+
+/// Maps a snapshot and returns the sparse tensor storage it contains.
+static SparseTensorStorageBase *openSnapshot(const char *filename,
+                                             SnapshotHeader &header) {
+  std::shared_ptr<MappedFile> file =
+      std::make_shared<MappedFile>(filename, /*writable=*/true);
+  uint64_t fileSize = file->end() - file->begin();
+  if (fileSize >= sizeof(header))
+    memcpy(&header, file->begin(), sizeof(header));
+  if (fileSize < sizeof(header) ||
+      memcmp(header.magic, kSnapshotMagic, sizeof(header.magic))) {
+    fprintf(stderr, "Not a sparse tensor snapshot %s\n", filename);
+    exit(1);
+  }
+  if (header.version != kSnapshotVersion) {
+    fprintf(stderr, "Unsupported snapshot version %u in %s\n", header.version,
+            filename);
+    exit(1);
+  }
+  if (header.rank > (fileSize - sizeof(header)) /
+                        (2 * sizeof(uint64_t) + 2 * sizeof(SnapshotArray))) {
+    fprintf(stderr, "Corrupt snapshot %s\n", filename);
+    exit(1);
+  }
+  switch (header.pointerBytes) {
+  case 8:
+    return loadSnapshot<uint64_t>(file, header, filename);
+  case 4:
+    return loadSnapshot<uint32_t>(file, header, filename);
+  case 2:
+    return loadSnapshot<uint16_t>(file, header, filename);
+  case 1:
+    return loadSnapshot<uint8_t>(file, header, filename);
+  }
+  fprintf(stderr, "Unsupported pointer type in snapshot %s\n", filename);
+  exit(1);
+}
+
+/// Arrays of a sparse tensor storage that are owned by the caller of
+/// `adopt_sparse_tensor`. Dimensions without pointers or indices (e.g. dense
+/// ones) have zero lengths.
+struct CallerArrays {
+  uint64_t rank;
+  const uint64_t *sizes;
+  const uint64_t *rev;
+  uint64_t pointerBytes;
+  uint64_t indexBytes;
+  uint64_t valueBytes;
+  bool valueIsFloat;
+  void **pointers;
+  const uint64_t *pointerLengths;
+  void **indices;
+  const uint64_t *indexLengths;
+  void *values;
+  uint64_t numValues;
+  std::shared_ptr<void> owner;
+};
+
+/// Builds a sparse tensor storage on the caller's arrays without copying.
+template <typename P, typename I, typename V>
+static SparseTensorStorageBase *adoptCallerArrays(const CallerArrays &arrays) {
+  uint64_t rank = arrays.rank;
+  std::vector<uint64_t> sizes(arrays.sizes, arrays.sizes + rank);
+  std::vector<uint64_t> rev(arrays.rev, arrays.rev + rank);
+  typename SparseTensorStorage<P, I, V>::PointerBuffer pointers;
+  typename SparseTensorStorage<P, I, V>::IndexBuffer indices;
+  for (uint64_t r = 0; r < rank; r++) {
+    pointers.push_back(adoptArray<P>(arrays.pointers[r],
+                                     arrays.pointerLengths[r], arrays.owner));
+    indices.push_back(adoptArray<I>(arrays.indices[r], arrays.indexLengths[r],
+                                    arrays.owner));
+  }
+  Buffer<V> values =
+      adoptArray<V>(arrays.values, arrays.numValues, arrays.owner);
+  return new SparseTensorStorage<P, I, V>(sizes, rev, std::move(pointers),
+                                          std::move(indices),
+                                          std::move(values));
+}
+
+template <typename P, typename I>
+static SparseTensorStorageBase *adoptCallerArrays(const CallerArrays &arrays) {
+  if (arrays.valueIsFloat && arrays.valueBytes == 8)
+    return adoptCallerArrays<P, I, double>(arrays);
+  if (arrays.valueIsFloat && arrays.valueBytes == 4)
+    return adoptCallerArrays<P, I, float>(arrays);
+  if (!arrays.valueIsFloat && arrays.valueBytes == 8)
+    return adoptCallerArrays<P, I, int64_t>(arrays);
+  if (!arrays.valueIsFloat && arrays.valueBytes == 4)
+    return adoptCallerArrays<P, I, int32_t>(arrays);
+  if (!arrays.valueIsFloat && arrays.valueBytes == 2)
+    return adoptCallerArrays<P, I, int16_t>(arrays);
+  if (!arrays.valueIsFloat && arrays.valueBytes == 1)
+    return adoptCallerArrays<P, I, int8_t>(arrays);
+  fprintf(stderr, "Unsupported value type of adopted arrays\n");
+  exit(1);
+}
+
+template <typename P>
+static SparseTensorStorageBase *adoptCallerArrays(const CallerArrays &arrays) {
+  switch (arrays.indexBytes) {
+  case 8:
+    return adoptCallerArrays<P, uint64_t>(arrays);
+  case 4:
+    return adoptCallerArrays<P, uint32_t>(arrays);
+  case 2:
+    return adoptCallerArrays<P, uint16_t>(arrays);
+  case 1:
+    return adoptCallerArrays<P, uint8_t>(arrays);
+  }
+  fprintf(stderr, "Unsupported index type of adopted arrays\n");
+  exit(1);
+}
+
+static SparseTensorStorageBase *adoptCallerArrays(const CallerArrays &arrays) {
+  switch (arrays.pointerBytes) {
+  case 8:
+    return adoptCallerArrays<uint64_t>(arrays);
+  case 4:
+    return adoptCallerArrays<uint32_t>(arrays);
+  case 2:
+    return adoptCallerArrays<uint16_t>(arrays);
+  case 1:
+    return adoptCallerArrays<uint8_t>(arrays);
+  }
+  fprintf(stderr, "Unsupported pointer type of adopted arrays\n");
+  exit(1);
+}
+//// <- MODIFIED
 
 } // anonymous namespace
 
@@ -1037,7 +2377,7 @@ enum Action : uint32_t {
   void _mlir_ciface_##NAME(StridedMemRefType<TYPE, 1> *ref, void *tensor) {    \
     assert(ref);                                                               \
     assert(tensor);                                                            \
-    std::vector<TYPE> *v;                                                      \
+    Buffer<TYPE> *v;                                                           \
     static_cast<SparseTensorStorageBase *>(tensor)->LIB(&v);                   \
     ref->basePtr = ref->data = v->data();                                      \
     ref->offset = 0;                                                           \
@@ -1050,7 +2390,7 @@ enum Action : uint32_t {
                            uint64_t d) {                                       \
     assert(ref);                                                               \
     assert(tensor);                                                            \
-    std::vector<TYPE> *v;                                                      \
+    Buffer<TYPE> *v;                                                           \
     static_cast<SparseTensorStorageBase *>(tensor)->LIB(&v, d);                \
     ref->basePtr = ref->data = v->data();                                      \
     ref->offset = 0;                                                           \
@@ -1151,6 +2491,18 @@ _mlir_ciface_newSparseTensor(StridedMemRefType<uint8_t, 1> *aref, // NOLINT
   CASE(kU8, kU8, kI32, uint8_t, uint8_t, int32_t);
   CASE(kU8, kU8, kI16, uint8_t, uint8_t, int16_t);
   CASE(kU8, kU8, kI8, uint8_t, uint8_t, int8_t);
+  //// -> MODIFIED
+  // Integral matrices with mixed 64-bit and 32-bit overhead storage.
+  CASE(kU64, kU32, kI64, uint64_t, uint32_t, int64_t);
+  CASE(kU64, kU32, kI32, uint64_t, uint32_t, int32_t);
+  CASE(kU64, kU32, kI16, uint64_t, uint32_t, int16_t);
+  CASE(kU64, kU32, kI8, uint64_t, uint32_t, int8_t);
+  CASE(kU32, kU64, kI64, uint32_t, uint64_t, int64_t);
+  CASE(kU32, kU64, kI32, uint32_t, uint64_t, int32_t);
+  CASE(kU32, kU64, kI16, uint32_t, uint64_t, int16_t);
+  CASE(kU32, kU64, kI8, uint32_t, uint64_t, int8_t);
+  CASE(kU32, kU32, kI64, uint32_t, uint32_t, int64_t);
+  //// <- MODIFIED
 
   // Unsupported case (add above if needed).
   fputs("unsupported combination of types\n", stderr);
@@ -1234,14 +2586,27 @@ void swap_values(void *tensor, void *new_values) {
 void assign_rev(void *tensor, uint64_t d, uint64_t index) {
   static_cast<SparseTensorStorageBase *>(tensor)->assign_rev(d, index);
 }
+// Growing with these leaves the new elements uninitialized
 void resize_pointers(void *tensor, uint64_t d, uint64_t size) {
-  static_cast<SparseTensorStorageBase *>(tensor)->resize_pointers(d, size);
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_pointers(d, size,
+                                                                  false);
 }
 void resize_index(void *tensor, uint64_t d, uint64_t size) {
-  static_cast<SparseTensorStorageBase *>(tensor)->resize_index(d, size);
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_index(d, size, false);
 }
 void resize_values(void *tensor, uint64_t size) {
-  static_cast<SparseTensorStorageBase *>(tensor)->resize_values(size);
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_values(size, false);
+}
+// Growing with these zeroes the new elements
+void resize_pointers_zeroed(void *tensor, uint64_t d, uint64_t size) {
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_pointers(d, size,
+                                                                  true);
+}
+void resize_index_zeroed(void *tensor, uint64_t d, uint64_t size) {
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_index(d, size, true);
+}
+void resize_values_zeroed(void *tensor, uint64_t size) {
+  static_cast<SparseTensorStorageBase *>(tensor)->resize_values(size, true);
 }
 void resize_dim(void *tensor, uint64_t d, uint64_t size) {
   static_cast<SparseTensorStorageBase *>(tensor)->resize_dim(d, size);
@@ -1249,44 +2614,169 @@ void resize_dim(void *tensor, uint64_t d, uint64_t size) {
 void *dup_tensor(void *tensor) {
   return static_cast<SparseTensorStorageBase *>(tensor)->dup();
 }
+// Returns a new tensor sharing the pointers, indices and values of `tensor`.
+// The buffers are released once the last tensor using them is deleted.
+void *view_tensor(void *tensor) {
+  return static_cast<SparseTensorStorageBase *>(tensor)->view();
+}
+// `other` must have the same pointer and index types as `tensor`
+void share_pointers(void *tensor, void *other) {
+  static_cast<SparseTensorStorageBase *>(tensor)->share_pointers(other);
+}
+void share_indices(void *tensor, void *other) {
+  static_cast<SparseTensorStorageBase *>(tensor)->share_indices(other);
+}
+void detach_tensor(void *tensor) {
+  static_cast<SparseTensorStorageBase *>(tensor)->detach();
+}
+// Writes `tensor` to a binary snapshot that `load_sparse_tensor` can map
+void save_sparse_tensor(void *tensor, char *filename) {
+  static_cast<SparseTensorStorageBase *>(tensor)->save(filename);
+}
+// Maps a snapshot written by `save_sparse_tensor` without reading its arrays.
+// The pointer, index and value types of the tensor are returned as
+// OverheadTypeEnum and PrimaryTypeEnum values.
+void *load_sparse_tensor(char *filename, uint64_t *ptrTp, uint64_t *indTp,
+                         uint64_t *valTp) {
+  SnapshotHeader header;
+  SparseTensorStorageBase *tensor = openSnapshot(filename, header);
+  // Indexed by byte width; openSnapshot rejects any other width.
+  const uint64_t overheadTypes[9] = {0, kU8, kU16, 0, kU32, 0, 0, 0, kU64};
+  const uint64_t integralTypes[9] = {0, kI8, kI16, 0, kI32, 0, 0, 0, kI64};
+  *ptrTp = overheadTypes[header.pointerBytes];
+  *indTp = overheadTypes[header.indexBytes];
+  if (header.valueIsFloat)
+    *valTp = header.valueBytes == 8 ? kF64 : kF32;
+  else
+    *valTp = integralTypes[header.valueBytes];
+  return tensor;
+}
+// Reads a Matrix Market (*.mtx) or extended FROSTT (*.tns) file of the given
+// rank into f64 storage with 64-bit overhead, the outermost dimension dense
+// and the others compressed. Sizes are taken from the file.
+void *read_sparse_tensor(char *filename, uint64_t rank) {
+  std::vector<uint64_t> sizes(rank, 0);
+  std::vector<uint64_t> perm(rank);
+  std::iota(perm.begin(), perm.end(), 0);
+  std::vector<uint8_t> sparsity(rank, SparseTensorStorageBase::kCompressed);
+  sparsity[0] = SparseTensorStorageBase::kDense;
+  SparseTensorCOO<double> *tensor =
+      openSparseTensorCOO<double>(filename, rank, sizes.data(), perm.data());
+  return SparseTensorStorage<uint64_t, uint64_t, double>::newSparseTensor(
+      rank, sizes.data(), perm.data(), sparsity.data(), tensor);
+}
+// Selects how large buffers are placed from now on, e.g. "interleave,thp"
+// (see AllocationPolicy). An invalid `spec` leaves the policy unchanged and
+// returns false.
+bool set_allocation_policy(char *spec) {
+  uint32_t policy;
+  if (!parseAllocationPolicy(spec, policy))
+    return false;
+  getAllocationPolicy() = policy;
+  return true;
+}
+uint32_t get_allocation_policy() { return getAllocationPolicy(); }
+// Copies the kNumAllocationStats counters of what the allocation policy has
+// done so far, indexed by AllocationStat.
+void get_allocation_report(uint64_t *report) {
+  for (uint32_t i = 0; i < kNumAllocationStats; i++)
+    report[i] = allocationStats[i];
+}
+/// Fills `report` with the kNumMemoryStats memory account entries.
+void get_memory_report(uint64_t *report) {
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  for (uint32_t i = 0; i < kNumMemoryStats; i++)
+    report[i] = memoryStats[i];
+}
+/// Restarts the high-water mark from the memory currently held.
+void reset_memory_peak() {
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  memoryStats[kMemPeakBytes] = memoryStats[kMemBytes];
+}
+uint64_t get_memory_bytes(void *tensor) {
+  return static_cast<SparseTensorStorageBase *>(tensor)->get_memory_bytes();
+}
+// Builds a sparse tensor directly on caller-owned pointer, index and value
+// arrays, e.g. the arrays of a CSR or CSC matrix; nothing is copied or
+// sorted. The arrays are given in storage order, with `sizes` and `rev` as
+// the storage keeps them, and with zero lengths for dimensions without
+// pointers or indices. Their types are given as OverheadTypeEnum and
+// PrimaryTypeEnum values, and every array must be aligned for its type.
+//
+// The tensor takes ownership of the arrays and may modify them in place.
+// Once the last array is released (on deletion, resizing or replacement),
+// `deleter(context)` is called; `deleter` may be null. With `validate`, the
+// tensor is checked with `verify` and, if it is invalid, deleted and null
+// is returned.
+void *adopt_sparse_tensor(uint64_t rank, uint64_t *sizes, uint64_t *rev,
+                          uint64_t ptrTp, uint64_t indTp, uint64_t valTp,
+                          void **pointers, uint64_t *pointerLengths,
+                          void **indices, uint64_t *indexLengths,
+                          void *values, uint64_t numValues,
+                          void (*deleter)(void *), void *context,
+                          bool validate) {
+  // Indexed by OverheadTypeEnum and PrimaryTypeEnum.
+  const uint64_t overheadBytes[5] = {0, 8, 4, 2, 1};
+  const uint64_t valueBytes[7] = {0, 8, 4, 8, 4, 2, 1};
+  CallerArrays arrays;
+  arrays.rank = rank;
+  arrays.sizes = sizes;
+  arrays.rev = rev;
+  arrays.pointerBytes = ptrTp <= kU8 ? overheadBytes[ptrTp] : 0;
+  arrays.indexBytes = indTp <= kU8 ? overheadBytes[indTp] : 0;
+  arrays.valueBytes = valTp <= kI8 ? valueBytes[valTp] : 0;
+  arrays.valueIsFloat = valTp == kF64 || valTp == kF32;
+  arrays.pointers = pointers;
+  arrays.pointerLengths = pointerLengths;
+  arrays.indices = indices;
+  arrays.indexLengths = indexLengths;
+  arrays.values = values;
+  arrays.numValues = numValues;
+  if (deleter)
+    arrays.owner = std::shared_ptr<void>(context, deleter);
+  else
+    arrays.owner = std::shared_ptr<void>(context, [](void *) {});
+  SparseTensorStorageBase *tensor = adoptCallerArrays(arrays);
+  arrays.owner.reset();
+  if (validate && !tensor->verify()) {
+    delete tensor;
+    return nullptr;
+  }
+  return tensor;
+}
 //void *empty_like(void *tensor) {
 //  return static_cast<SparseTensorStorageBase *>(tensor)->empty_like();
 //}
 //void *empty(void *tensor, uint64_t ndims) {
 //  return static_cast<SparseTensorStorageBase *>(tensor)->empty(ndims);
 //}
-// Combinations of real types to !llvm.ptr<i8>
-void *matrix_csr_f64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csc_f64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csr_f32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csc_f32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csr_i64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csc_i64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csr_i32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csc_i32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csr_i8_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *matrix_csc_i8_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *vector_f64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *vector_f32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *vector_i64_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *vector_i32_p64i64_to_ptr8(void *tensor) { return tensor; }
-void *vector_i8_p64i64_to_ptr8(void *tensor) { return tensor; }
-// Combinations of !llvm.ptr<i8> to real types
-void *ptr8_to_matrix_csr_f64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csc_f64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csr_f32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csc_f32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csr_i64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csc_i64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csr_i32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csc_i32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csr_i8_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_matrix_csc_i8_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_vector_f64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_vector_f32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_vector_i64_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_vector_i32_p64i64(void *tensor) { return tensor; }
-void *ptr8_to_vector_i8_p64i64(void *tensor) { return tensor; }
+// Combinations of real types to and from !llvm.ptr<i8>, for 64-bit and
+// 32-bit pointers and indices
+#define PTR8_CAST(NAME)                                                        \
+  void *NAME##_to_ptr8(void *tensor) { return tensor; }                        \
+  void *ptr8_to_##NAME(void *tensor) { return tensor; }
+#define PTR8_CASTS(WIDTHS)                                                     \
+  PTR8_CAST(matrix_csr_f64_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csc_f64_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csr_f32_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csc_f32_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csr_i64_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csc_i64_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csr_i32_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csc_i32_##WIDTHS)                                           \
+  PTR8_CAST(matrix_csr_i8_##WIDTHS)                                            \
+  PTR8_CAST(matrix_csc_i8_##WIDTHS)                                            \
+  PTR8_CAST(vector_f64_##WIDTHS)                                               \
+  PTR8_CAST(vector_f32_##WIDTHS)                                               \
+  PTR8_CAST(vector_i64_##WIDTHS)                                               \
+  PTR8_CAST(vector_i32_##WIDTHS)                                               \
+  PTR8_CAST(vector_i8_##WIDTHS)
+PTR8_CASTS(p64i64)
+PTR8_CASTS(p64i32)
+PTR8_CASTS(p32i64)
+PTR8_CASTS(p32i32)
+#undef PTR8_CASTS
+#undef PTR8_CAST
 
 // Print functions
 void print_int_as_char(int64_t character_int) {
@@ -32,10 +32,12 @@ def _build_common_aliases():
     csr64 = SparseEncodingType(["dense", "compressed"], [0, 1], 64, 64)
     csc64 = SparseEncodingType(["dense", "compressed"], [1, 0], 64, 64)
     cv64 = SparseEncodingType(["compressed"], None, 64, 64)
+    bv64 = SparseEncodingType(["dense"], None, 64, 64)
     aliases = AliasMap()
     aliases["CSR64"] = csr64
     aliases["CSC64"] = csc64
     aliases["CV64"] = cv64
+    aliases["BV64"] = bv64
     aliases["map1d"] = AffineMap("(d0)[s0, s1] -> (d0 * s1 + s0)")
     return aliases
 
@@ -400,6 +402,9 @@ class Pagerank(Algorithm):
         starting = irb.graphblas.apply(r, "second", right=nrows_inv)
         starting_ptr8 = irb.util.tensor_to_ptr8(starting)
 
+        # A' is the same on every iteration
+        AT = irb.graphblas.transpose(A, "tensor<?x?xf64, #CSR64>")
+
         # Pagerank iterations
         rdiff = irb.new_var("f64")
         prev_score_ptr8 = irb.new_var("!llvm.ptr<i8>")
@@ -446,7 +451,6 @@ class Pagerank(Algorithm):
             new_score = irb.graphblas.apply(prev_score, "second", right=teleport)
 
             # r += A'*w
-            AT = irb.graphblas.transpose(A, "tensor<?x?xf64, #CSR64>")
             tmp = irb.graphblas.matrix_multiply(AT, w, "plus_second")
             irb.graphblas.update(tmp, new_score, accumulate="plus")
 
@@ -457,9 +461,7 @@ class Pagerank(Algorithm):
             new_rdiff = irb.graphblas.apply(new_rdiff, "abs")
             new_rdiff = irb.graphblas.reduce_to_scalar(new_rdiff, "plus")
 
-            # Note: this is commented out due to https://github.com/metagraph-dev/mlir-graphblas/issues/163
-            # Clean up previous score
-            # irb.util.del_sparse_tensor(prev_score)
+            # prev_score is released by graphblas-lower once new_score replaces it
 
             # Increment iteration count
             new_iter_count = irb.arith.addi(iter_count, c1)
@@ -762,6 +764,14 @@ random_walk = RandomWalk()
 
 
 class BFS(Algorithm):
+    def __init__(self, alpha=14.0, beta=24.0):
+        # Switch from push to pull once the frontier touches more than 1/alpha
+        # of the unexplored edges, and back to push once it shrinks below
+        # 1/beta of the vertices
+        self.alpha = alpha
+        self.beta = beta
+        super().__init__()
+
     def _build(self):
         irb = MLIRFunctionBuilder(
             "bfs",
@@ -779,6 +789,7 @@ class BFS(Algorithm):
         c1 = irb.arith.constant(1, "index")
         c1_i64 = irb.arith.constant(1, "i64")
         c0_f64 = irb.arith.constant(0, "f64")
+        c1_f64 = irb.arith.constant(1, "f64")
 
         num_rows = irb.graphblas.num_rows(A)
         source_i64 = irb.arith.index_cast(source, "i64")
@@ -823,29 +834,124 @@ class BFS(Algorithm):
         irb.memref.store(source_i64, levels_indices, c0)
         irb.memref.store(c0_f64, levels_values, c0)
 
-        with irb.while_loop(c0, frontier_ptr8) as while_loop:
+        # Direction-optimizing heuristics (Beamer et al.). Push (top-down) steps
+        # expand the frontier through AT; pull (bottom-up) steps let every
+        # unvisited vertex search A for a parent in the frontier.
+        ctrue = irb.arith.constant(1, "i1")
+        alpha = irb.arith.constant(self.alpha, "f64")
+        beta = irb.arith.constant(self.beta, "f64")
+        AT = irb.graphblas.transpose(A, "tensor<?x?xf64, #CSR64>")
+        degree = irb.graphblas.reduce_to_vector(AT, "count", axis=1)
+        degree = irb.graphblas.cast(degree, "tensor<?xf64, #CV64>")
+        num_rows_i64 = irb.arith.index_cast(num_rows, "i64")
+        num_rows_f64 = irb.arith.sitofp(num_rows_i64, "f64")
+        nnz = irb.graphblas.num_vals(A)
+        nnz_i64 = irb.arith.index_cast(nnz, "i64")
+        nnz_f64 = irb.arith.sitofp(nnz_i64, "f64")
+
+        with irb.while_loop(c0, frontier_ptr8, ctrue, nnz_f64) as while_loop:
             with while_loop.before as before_region:
                 level = before_region.arg_vars[0]
                 current_frontier_ptr8 = before_region.arg_vars[1]
+                push = before_region.arg_vars[2]
+                unexplored_edges = before_region.arg_vars[3]
                 current_frontier = irb.util.ptr8_to_tensor(
                     current_frontier_ptr8, "tensor<?xf64, #CV64>"
                 )
-                next_frontier = irb.graphblas.matrix_multiply(
-                    A,
+
+                # Choose the direction of this step
+                frontier_degree = irb.graphblas.intersect(
+                    current_frontier, degree, "second"
+                )
+                frontier_edges = irb.graphblas.reduce_to_scalar(
+                    frontier_degree, "plus"
+                )
+                frontier_size = irb.graphblas.num_vals(current_frontier)
+                frontier_size_i64 = irb.arith.index_cast(frontier_size, "i64")
+                frontier_size_f64 = irb.arith.sitofp(frontier_size_i64, "f64")
+                scaled_edges = irb.arith.mulf(frontier_edges, alpha)
+                few_edges = irb.arith.cmpf(scaled_edges, unexplored_edges, "ole")
+                scaled_size = irb.arith.mulf(frontier_size_f64, beta)
+                small_frontier = irb.arith.cmpf(scaled_size, num_rows_f64, "olt")
+                push_next = irb.select(push, few_edges, small_frontier)
+
+                next_frontier_ptr8 = irb.new_var("!llvm.ptr<i8>")
+                irb.add_statement(
+                    f"{next_frontier_ptr8.assign} = scf.if {push_next} -> ({next_frontier_ptr8.type}) {{"
+                )
+
+                # Push
+                # ----
+                pushed_frontier = irb.graphblas.matrix_multiply(
                     current_frontier,
+                    AT,
+                    "any_overlapi",
+                    mask=parents,
+                    mask_complement=True,
+                )
+                pushed_frontier_ptr8 = irb.util.tensor_to_ptr8(pushed_frontier)
+                irb.add_statement(
+                    f"scf.yield {pushed_frontier_ptr8} : {pushed_frontier_ptr8.type}"
+                )
+
+                irb.add_statement("} else {")
+
+                # Pull
+                # ----
+                # The frontier is probed once per edge of every unvisited
+                # vertex, so it is made a bitmap. Its values are parents, which
+                # may be 0, so they are replaced by ones first.
+                frontier_ones = irb.graphblas.apply(
+                    current_frontier, "second", right=c1_f64
+                )
+                frontier_bitmap = irb.sparse_tensor.convert(
+                    frontier_ones, "tensor<?xf64, #BV64>"
+                )
+                pulled_frontier = irb.graphblas.matrix_multiply(
+                    A,
+                    frontier_bitmap,
                     "any_overlapi",
                     mask=parents,
                     mask_complement=True,
+                    return_type="tensor<?xf64, #CV64>",
+                )
+                pulled_frontier_ptr8 = irb.util.tensor_to_ptr8(pulled_frontier)
+                irb.add_statement(
+                    f"scf.yield {pulled_frontier_ptr8} : {pulled_frontier_ptr8.type}"
+                )
+                irb.add_statement("}")
+
+                next_frontier = irb.util.ptr8_to_tensor(
+                    next_frontier_ptr8, "tensor<?xf64, #CV64>"
                 )
                 irb.graphblas.update(next_frontier, parents, "plus")
-                next_frontier_ptr8 = irb.util.tensor_to_ptr8(next_frontier)
+
+                # Edges of the newly visited vertices are no longer unexplored
+                next_frontier_degree = irb.graphblas.intersect(
+                    next_frontier, degree, "second"
+                )
+                next_frontier_edges = irb.graphblas.reduce_to_scalar(
+                    next_frontier_degree, "plus"
+                )
+                next_unexplored_edges = irb.arith.subf(
+                    unexplored_edges, next_frontier_edges
+                )
+
                 next_frontier_size = irb.graphblas.num_vals(next_frontier)
                 condition = irb.arith.cmpi(next_frontier_size, c0, "ne")
-                before_region.condition(condition, level, next_frontier_ptr8)
+                before_region.condition(
+                    condition,
+                    level,
+                    next_frontier_ptr8,
+                    push_next,
+                    next_unexplored_edges,
+                )
             with while_loop.after as after_region:
                 level = after_region.arg_vars[0]
                 next_level = irb.arith.addi(level, c1)
                 next_frontier_ptr8 = after_region.arg_vars[1]
+                push = after_region.arg_vars[2]
+                unexplored_edges = after_region.arg_vars[3]
 
                 # update levels
                 next_frontier = irb.util.ptr8_to_tensor(
@@ -858,7 +964,9 @@ class BFS(Algorithm):
                 )
                 irb.graphblas.update(next_frontier_levels, levels, "max")
 
-                after_region.yield_vars(next_level, next_frontier_ptr8)
+                after_region.yield_vars(
+                    next_level, next_frontier_ptr8, push, unexplored_edges
+                )
 
         irb.return_vars(parents, levels)
 
@@ -2304,6 +2412,7 @@ class GraphWave(Algorithm):
             irb.memref.store(c1_i64, row_selector_pointers, c1)
             row_selector_indices = irb.sparse_tensor.indices(row_selector, c0)
             row_selector_values = irb.sparse_tensor.values(row_selector)
+            irb.memref.store(c1_f64, row_selector_values, c0)
             with irb.for_loop(0, num_nodes) as node_for_vars:
                 node_idx = node_for_vars.iter_var_index
                 node_idx_i64 = irb.arith.index_cast(node_idx, "i64")
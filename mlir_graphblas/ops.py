@@ -653,10 +653,11 @@ class SparseTensorPointers(BaseOp):
     def call(cls, irbuilder, input, dim):
         cls.ensure_mlirvar(input, SparseTensorType)
         cls.ensure_mlirvar(dim, IndexType)
-        ret_val = irbuilder.new_var("memref<?xi64>")
+        bit_width = input.type.encoding.pointer_bit_width or 64
+        ret_val = irbuilder.new_var(f"memref<?xi{bit_width}>")
         return ret_val, (
             f"{ret_val.assign} = sparse_tensor.pointers {input}, {dim} : "
-            f"{input.type} to memref<?xi64>"
+            f"{input.type} to {ret_val.type}"
         )
 
 
@@ -668,10 +669,11 @@ class SparseTensorIndices(BaseOp):
     def call(cls, irbuilder, input, dim):
         cls.ensure_mlirvar(input, SparseTensorType)
         cls.ensure_mlirvar(dim, IndexType)
-        ret_val = irbuilder.new_var("memref<?xi64>")
+        bit_width = input.type.encoding.index_bit_width or 64
+        ret_val = irbuilder.new_var(f"memref<?xi{bit_width}>")
         return ret_val, (
             f"{ret_val.assign} = sparse_tensor.indices {input}, {dim} : "
-            f"{input.type} to memref<?xi64>"
+            f"{input.type} to {ret_val.type}"
         )
 
 
@@ -909,13 +911,6 @@ class GraphBLAS_Select(BaseOp):
             cls.ensure_mlirvar(thunk)
         if rng_context is not None:
             cls.ensure_mlirvar(rng_context)
-        if selector == "probability":
-            irbuilder.needed_function_table["random_double"] = (
-                f"func private @random_double(!llvm.ptr<i8>) -> (f64)",
-                ["!llvm.ptr<i8>"],
-                "",
-            )
-
         ret_val = irbuilder.new_var(input.type)
         text = [
             f"{ret_val.assign} = graphblas.select {input}",
@@ -1023,13 +1018,24 @@ class GraphBLAS_MatrixMultiply(BaseOp):
     name = "matrix_multiply"
 
     @classmethod
-    def call(cls, irbuilder, a, b, semiring, *, mask=None, mask_complement=False):
+    def call(
+        cls,
+        irbuilder,
+        a,
+        b,
+        semiring,
+        *,
+        mask=None,
+        mask_complement=False,
+        return_type=None,
+    ):
         cls.ensure_mlirvar(a, SparseTensorType)
         cls.ensure_mlirvar(b, SparseTensorType)
-        if len(b.type.shape) == 1:
-            return_type = b.type
-        else:
-            return_type = a.type
+        if return_type is None:
+            if len(b.type.shape) == 1:
+                return_type = b.type
+            else:
+                return_type = a.type
         # TODO: make the return type more robust; may depend on a, b, and/or semiring
         ret_val = irbuilder.new_var(return_type)
         if mask:
@@ -1106,7 +1112,9 @@ class GraphBLAS_FromCOO(BaseOp):
     name = "from_coo"
 
     @classmethod
-    def call(cls, irbuilder, indices, values, shape):
+    def call(
+        cls, irbuilder, indices, values, shape, *, sorted=False, accumulate=None
+    ):
         cls.ensure_mlirvar(indices, TensorType)
         cls.ensure_mlirvar(values, TensorType)
         if not hasattr(shape, "__len__"):
@@ -1118,8 +1126,15 @@ class GraphBLAS_FromCOO(BaseOp):
             ret_type = f"tensor<?x{values.type.value_type}, #CV64>"
         ret_val = irbuilder.new_var(ret_type)
         dimstr = ", ".join(map(str, shape))
+        attrs = []
+        if sorted:
+            attrs.append("sorted = true")
+        if accumulate:
+            attrs.append(f'accumulate_operator = "{accumulate}"')
+        attr_str = f" {{ {', '.join(attrs)} }}" if attrs else ""
         return ret_val, (
             f"{ret_val.assign} = graphblas.from_coo {indices}, {values} [{dimstr}]"
+            + attr_str
             + f" : {indices.type}, {values.type} to {ret_val.type}"
         )
 
@@ -1280,7 +1295,7 @@ class NewSparseTensor(BaseOp):
         ret_val_ptr, stmt = TensorToPtrOp.call(irbuilder, ret_val)
         statements.append(stmt)
         _, stmt = ResizeSparsePointers.call(
-            irbuilder, ret_val_ptr, dim_var, npointers_plus_1_var
+            irbuilder, ret_val_ptr, dim_var, npointers_plus_1_var, zero=True
         )
         statements.append(stmt)
 
@@ -1332,18 +1347,20 @@ class ResizeSparsePointers(BaseOp):
     name = "resize_sparse_pointers"
 
     @classmethod
-    def call(cls, irbuilder, input, dim, size):
+    def call(cls, irbuilder, input, dim, size, zero=False):
+        """Growing leaves the new elements uninitialized unless `zero` is set"""
         cls.ensure_mlirvar(input, LlvmPtrType)
         cls.ensure_mlirvar(dim, IndexType)
         cls.ensure_mlirvar(size, IndexType)
-        irbuilder.needed_function_table["resize_pointers"] = (
-            f"func private @resize_pointers(!llvm.ptr<i8>, index, index)",
+        func_name = "resize_pointers_zeroed" if zero else "resize_pointers"
+        irbuilder.needed_function_table[func_name] = (
+            f"func private @{func_name}(!llvm.ptr<i8>, index, index)",
             ["!llvm.ptr<i8>", "index", "index"],
             "",
         )
 
         return None, (
-            f"call @resize_pointers({input}, {dim}, {size}) : (!llvm.ptr<i8>, index, index) -> ()"
+            f"call @{func_name}({input}, {dim}, {size}) : (!llvm.ptr<i8>, index, index) -> ()"
         )
 
 
@@ -1352,18 +1369,20 @@ class ResizeSparseIndex(BaseOp):
     name = "resize_sparse_index"
 
     @classmethod
-    def call(cls, irbuilder, input, dim, size):
+    def call(cls, irbuilder, input, dim, size, zero=False):
+        """Growing leaves the new elements uninitialized unless `zero` is set"""
         cls.ensure_mlirvar(input, LlvmPtrType)
         cls.ensure_mlirvar(dim, IndexType)
         cls.ensure_mlirvar(size, IndexType)
-        irbuilder.needed_function_table["resize_index"] = (
-            f"func private @resize_index(!llvm.ptr<i8>, index, index)",
+        func_name = "resize_index_zeroed" if zero else "resize_index"
+        irbuilder.needed_function_table[func_name] = (
+            f"func private @{func_name}(!llvm.ptr<i8>, index, index)",
             ["!llvm.ptr<i8>", "index", "index"],
             "",
         )
 
         return None, (
-            f"call @resize_index({input}, {dim}, {size}) : (!llvm.ptr<i8>, index, index) -> ()"
+            f"call @{func_name}({input}, {dim}, {size}) : (!llvm.ptr<i8>, index, index) -> ()"
         )
 
 
@@ -1372,15 +1391,17 @@ class ResizeSparseValues(BaseOp):
     name = "resize_sparse_values"
 
     @classmethod
-    def call(cls, irbuilder, input, size):
+    def call(cls, irbuilder, input, size, zero=False):
+        """Growing leaves the new elements uninitialized unless `zero` is set"""
         cls.ensure_mlirvar(input, LlvmPtrType)
         cls.ensure_mlirvar(size, IndexType)
-        irbuilder.needed_function_table["resize_values"] = (
-            f"func private @resize_values(!llvm.ptr<i8>, index)",
+        func_name = "resize_values_zeroed" if zero else "resize_values"
+        irbuilder.needed_function_table[func_name] = (
+            f"func private @{func_name}(!llvm.ptr<i8>, index)",
             ["!llvm.ptr<i8>", "index"],
             "",
         )
 
         return None, (
-            f"call @resize_values({input}, {size}) : (!llvm.ptr<i8>, index) -> ()"
+            f"call @{func_name}({input}, {size}) : (!llvm.ptr<i8>, index) -> ()"
         )
@@ -1,6 +1,7 @@
 """ This wraps RandomUtils.cpp """
 cimport cython
 import random
+import numpy as np
 from libc.stdint cimport int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t, uintptr_t
 
 
@@ -53,4 +54,30 @@ cdef class ChooseWeightedContext:
     
     @property
     def __mlir_void_ptr__(self):
-        return <uintptr_t>self._data
\ No newline at end of file
+        return <uintptr_t>self._data
+
+
+
+def sample_uniform(ChooseUniformContext context, int64_t n, int64_t max_index):
+    """Indices sampled by "choose_uniform" from a row of `max_index` entries, in ascending order"""
+    out = np.zeros(max(min(n, max_index), 1), dtype=np.int64)
+    cdef int64_t[::1] out_view = out
+    cdef double weight = 0
+    if n > 0:
+        choose_uniform(context._data, n, max_index, &out_view[0], &out_view[0], 0,
+                       out_view.shape[0], 1, &weight, &weight, 0, 1, 1)
+    return out[: min(max(n, 0), max_index)]
+
+
+def sample_weighted(ChooseWeightedContext context, int64_t n, weights):
+    """Indices sampled by "choose_weighted" from a row with the given weights, in ascending order"""
+    weights = np.ascontiguousarray(weights, dtype=np.float64)
+    cdef int64_t max_index = weights.shape[0]
+    out = np.zeros(max(min(n, max_index), 1), dtype=np.int64)
+    cdef int64_t[::1] out_view = out
+    cdef double[::1] weights_view = weights
+    if n > 0 and max_index > 0:
+        choose_weighted(context._data, n, max_index, &out_view[0], &out_view[0], 0,
+                        out_view.shape[0], 1, &weights_view[0], &weights_view[0], 0,
+                        max_index, 1)
+    return out[: min(max(n, 0), max_index)]
@@ -1,10 +1,12 @@
 """ This wraps https://github.com/llvm/llvm-project/blob/main/mlir/lib/ExecutionEngine/SparseUtils.cpp """
 
 cimport cython
+import os
 import numpy as np
 cimport numpy as np
 from libc.stdint cimport int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t, uintptr_t
 from libc.stdlib cimport malloc, free
+from cpython.ref cimport Py_INCREF, Py_DECREF
 from libcpp cimport bool
 from libcpp.vector cimport vector
 from numpy cimport float32_t, float64_t, intp_t, ndarray, set_array_base
@@ -67,6 +69,10 @@ cdef extern from *:
     ctypedef int one "1"
 
 
+# Deleter that `adopt_sparse_tensor` calls once it releases the adopted arrays
+ctypedef void (*release_fn)(void *)
+
+
 cdef extern from "SparseUtils.cpp" nogil:
     cdef cppclass SparseTensorCOO[V]:
         SparseTensorCOO(vector[uint64_t], uint64_t) except +
@@ -138,9 +144,24 @@ cdef extern from "SparseUtils.cpp" nogil:
     void resize_pointers(void *tensor, uint64_t d, uint64_t size)
     void resize_index(void *tensor, uint64_t d, uint64_t size)
     void resize_values(void *tensor, uint64_t size)
+    void resize_pointers_zeroed(void *tensor, uint64_t d, uint64_t size)
+    void resize_index_zeroed(void *tensor, uint64_t d, uint64_t size)
+    void resize_values_zeroed(void *tensor, uint64_t size)
     void resize_dim(void *tensor, uint64_t d, uint64_t size)
 
     void *dup_tensor(void *tensor)
+    void *view_tensor(void *tensor)
+    void detach_tensor(void *tensor)
+    void save_sparse_tensor(void *tensor, char *filename)
+    void *load_sparse_tensor(char *filename, uint64_t *ptrTp, uint64_t *indTp, uint64_t *valTp)
+    void *read_sparse_tensor(char *filename, uint64_t rank)
+    bool _set_allocation_policy "set_allocation_policy"(char *spec)
+    uint32_t get_allocation_policy()
+    void get_allocation_report(uint64_t *report)
+    void get_memory_report(uint64_t *report)
+    void reset_memory_peak()
+    uint64_t get_memory_bytes(void *tensor)
+    void *adopt_sparse_tensor(uint64_t rank, uint64_t *sizes, uint64_t *rev, uint64_t ptrTp, uint64_t indTp, uint64_t valTp, void **pointers, uint64_t *pointerLengths, void **indices, uint64_t *indexLengths, void *values, uint64_t numValues, release_fn deleter, void *context, bool validate)
     # void *empty_like(void *tensor)
     # void *empty(void *tensor, uint64_t ndims)
 
@@ -177,6 +198,98 @@ cdef extern from "SparseUtils.cpp" nogil:
     void *ptr8_to_vector_i8_p64i64(void *tensor)
 
 
+# OverheadTypeEnum and PrimaryTypeEnum in SparseUtils.cpp
+_SNAPSHOT_OVERHEAD_DTYPES = {
+    1: np.dtype(np.uint64),
+    2: np.dtype(np.uint32),
+    3: np.dtype(np.uint16),
+    4: np.dtype(np.uint8),
+}
+_SNAPSHOT_VALUE_DTYPES = {
+    1: np.dtype(np.float64),
+    2: np.dtype(np.float32),
+    3: np.dtype(np.int64),
+    4: np.dtype(np.int32),
+    5: np.dtype(np.int16),
+    6: np.dtype(np.int8),
+}
+
+_SNAPSHOT_OVERHEAD_TYPES = {dtype: key for key, dtype in _SNAPSHOT_OVERHEAD_DTYPES.items()}
+_SNAPSHOT_VALUE_TYPES = {dtype: key for key, dtype in _SNAPSHOT_VALUE_DTYPES.items()}
+
+
+# Called by the runtime once it releases the last array adopted by `MLIRSparseTensor.from_arrays`
+cdef void _release_adopted_arrays(void *context) with gil:
+    Py_DECREF(<object>context)
+
+
+# AllocationPolicy and AllocationStat in SparseUtils.cpp
+_ALLOCATION_POLICY_FLAGS = {"interleave": 1, "first-touch": 2, "thp": 4, "hugetlb": 8}
+_ALLOCATION_STATS = (
+    "large_buffers",
+    "large_bytes",
+    "large_released",
+    "interleaved",
+    "first_touched",
+    "transparent_huge",
+    "explicit_huge",
+    "fallbacks",
+)
+
+
+def set_allocation_policy(policy):
+    """Select how large tensor buffers are placed, e.g. "interleave,thp" (also settable with GRAPHBLAS_ALLOC_POLICY)
+
+    Flags: "interleave" or "first-touch" for NUMA placement, and "thp" or "hugetlb" for huge pages.
+    With "default", every buffer comes from malloc. The policy applies to tensors created afterwards.
+    """
+    if not _set_allocation_policy(os.fsencode(policy)):
+        raise ValueError(f"Invalid allocation policy: {policy!r}")
+
+
+def allocation_report():
+    """The current allocation policy and counts of what it did so far"""
+    cdef uint64_t report[8]
+    get_allocation_report(report)
+    cdef uint32_t policy = get_allocation_policy()
+    rv = {"policy": ",".join(name for name, flag in _ALLOCATION_POLICY_FLAGS.items() if policy & flag) or "default"}
+    for i, name in enumerate(_ALLOCATION_STATS):
+        rv[name] = report[i]
+    return rv
+
+
+# MemoryStat in SparseUtils.cpp
+_MEMORY_STATS = (
+    "live_tensors",
+    "tensor_allocations",
+    "buffer_allocations",
+    "pointer_bytes",
+    "index_bytes",
+    "value_bytes",
+    "bytes",
+    "peak_bytes",
+)
+
+
+def memory_report(bint reset_peak=False):
+    """Memory held by live sparse tensors, with buffers shared by views counted once
+
+    With `reset_peak`, the high-water mark restarts from the current bytes after it is reported.
+    """
+    cdef uint64_t report[8]
+    get_memory_report(report)
+    if reset_peak:
+        reset_memory_peak()
+    return {name: report[i] for i, name in enumerate(_MEMORY_STATS)}
+
+
+def _adoptable_array(array, dtype):
+    array = np.ascontiguousarray(array, dtype=dtype)
+    if not array.flags.writeable or array.ctypes.data % dtype.itemsize:
+        array = array.copy()
+    return array
+
+
 # st for "sparse tensor"
 ctypedef fused st_index_t:
     uint8_t
@@ -517,6 +630,16 @@ cdef class MLIRSparseTensor:
     def sizes(self):
         return tuple([sparseDimSize(self._data, i) for i in range(self.ndim)])
 
+    @property
+    def nbytes(self):
+        """Bytes allocated for the pointers, indices and values, including any shared with views"""
+        return get_memory_bytes(self._data)
+
+    @staticmethod
+    def memory_report(bint reset_peak=False):
+        """Memory held by all live sparse tensors, see `sparse_utils.memory_report`"""
+        return memory_report(reset_peak)
+
     cpdef ndarray get_pointers(self, uint64_t d):
         cdef StridedMemRefType[uint8_t, one] ref8
         cdef StridedMemRefType[uint16_t, one] ref16
@@ -524,6 +647,8 @@ cdef class MLIRSparseTensor:
         cdef StridedMemRefType[uint64_t, one] ref64
         if d >= self.ndim:
             raise IndexError(f'Bad dimension index: {d} >= {self.ndim}')
+        # The returned array is writable, so stop sharing the pointers with views first
+        get_pointers_ptr(self._data)
         if self.pointer_dtype == np.uint8:
             _mlir_ciface_sparsePointers8(&ref8, self._data, d)
             return view_buffer(<uintptr_t>ref8.data, ref8.sizes[0], ref8.strides[0], self.pointer_dtype, self)
@@ -607,6 +732,8 @@ cdef class MLIRSparseTensor:
         cdef StridedMemRefType[uint64_t, one] ref64
         if d >= self.ndim:
             raise IndexError(f'Bad dimension index: {d} >= {self.ndim}')
+        # The returned array is writable, so stop sharing the indices with views first
+        get_indices_ptr(self._data)
         if self.index_dtype == np.uint8:
             _mlir_ciface_sparseIndices8(&ref8, self._data, d)
             return view_buffer(<uintptr_t>ref8.data, ref8.sizes[0], ref8.strides[0], self.index_dtype, self)
@@ -634,6 +761,8 @@ cdef class MLIRSparseTensor:
         cdef StridedMemRefType[int64_t, one] ref64i
         cdef StridedMemRefType[float32_t, one] ref32f
         cdef StridedMemRefType[float64_t, one] ref64f
+        # The returned array is writable, so stop sharing the values with views first
+        get_values_ptr(self._data)
         if self.value_dtype == np.int8:
             _mlir_ciface_sparseValuesI8(&ref8i, self._data)
             return view_buffer(<uintptr_t>ref8i.data, ref8i.sizes[0], ref8i.strides[0], self.value_dtype, self)
@@ -684,14 +813,24 @@ cdef class MLIRSparseTensor:
     cpdef swap_values(self, MLIRSparseTensor other):
         swap_values(self._data, get_values_ptr(other._data))
 
-    cpdef resize_pointers(self, uint64_t d, uint64_t size):
-        resize_pointers(self._data, d, size)
+    # Growing zeroes the new elements unless `zero` is False, which leaves them uninitialized
+    cpdef resize_pointers(self, uint64_t d, uint64_t size, bint zero=True):
+        if zero:
+            resize_pointers_zeroed(self._data, d, size)
+        else:
+            resize_pointers(self._data, d, size)
 
-    cpdef resize_index(self, uint64_t d, uint64_t size):
-        resize_index(self._data, d, size)
+    cpdef resize_index(self, uint64_t d, uint64_t size, bint zero=True):
+        if zero:
+            resize_index_zeroed(self._data, d, size)
+        else:
+            resize_index(self._data, d, size)
 
-    cpdef resize_values(self, uint64_t size):
-        resize_values(self._data, size)
+    cpdef resize_values(self, uint64_t size, bint zero=True):
+        if zero:
+            resize_values_zeroed(self._data, size)
+        else:
+            resize_values(self._data, size)
 
     cpdef resize_dim(self, uint64_t d, uint64_t size):
         resize_dim(self._data, d, size)
@@ -705,6 +844,121 @@ cdef class MLIRSparseTensor:
         rv.value_dtype = self.value_dtype
         return rv
 
+    cpdef MLIRSparseTensor view(self):
+        """New tensor sharing the pointers, indices, and values of this one"""
+        cdef MLIRSparseTensor rv = MLIRSparseTensor.__new__(MLIRSparseTensor)  # avoid __init__
+        rv._data = view_tensor(self._data)
+        rv.ndim = self.ndim
+        rv.pointer_dtype = self.pointer_dtype
+        rv.index_dtype = self.index_dtype
+        rv.value_dtype = self.value_dtype
+        return rv
+
+    cpdef detach(self):
+        """Copy any storage shared with views; the array accessors already do so for the arrays they return"""
+        detach_tensor(self._data)
+
+    cpdef save(self, filename):
+        """Write a binary snapshot that `MLIRSparseTensor.load` can map back"""
+        cdef bytes path = os.fsencode(filename)
+        save_sparse_tensor(self._data, path)
+
+    @classmethod
+    def load(cls, filename):
+        """Map a snapshot written by `save`; arrays are read on first use and copied on first write"""
+        cdef bytes path = os.fsencode(filename)
+        cdef uint64_t pointer_type, index_type, value_type
+        cdef MLIRSparseTensor rv = MLIRSparseTensor.__new__(MLIRSparseTensor)  # avoid __init__
+        rv._data = load_sparse_tensor(path, &pointer_type, &index_type, &value_type)
+        rv.ndim = get_rank(rv._data)
+        rv.pointer_dtype = _SNAPSHOT_OVERHEAD_DTYPES[pointer_type]
+        rv.index_dtype = _SNAPSHOT_OVERHEAD_DTYPES[index_type]
+        rv.value_dtype = _SNAPSHOT_VALUE_DTYPES[value_type]
+        return rv
+
+    @classmethod
+    def read(cls, filename, uint64_t rank=2):
+        """Read a Matrix Market (.mtx) or extended FROSTT (.tns) file into a float64 tensor with a dense outer dimension"""
+        cdef bytes path = os.fsencode(filename)
+        cdef MLIRSparseTensor rv = MLIRSparseTensor.__new__(MLIRSparseTensor)  # avoid __init__
+        rv._data = read_sparse_tensor(path, rank)
+        rv.ndim = rank
+        rv.pointer_dtype = np.dtype(np.uint64)
+        rv.index_dtype = np.dtype(np.uint64)
+        rv.value_dtype = np.dtype(np.float64)
+        return rv
+
+    @classmethod
+    def from_arrays(cls, sizes, pointers, indices, values, rev=None, pointer_type=None, index_type=None, bint validate=True):
+        """Build a tensor directly on arrays in storage order (e.g. `indptr`, `indices` and `data` of a CSR matrix)
+
+        `pointers` and `indices` have one entry per dimension, None where a dimension has none (e.g. dense ones).
+        Contiguous, writable arrays of a supported dtype are adopted without copying and may be modified in place
+        by the tensor, which keeps them alive.  Types default to those of the given arrays.
+        """
+        cdef uint64_t[:] sizes_array = np.ascontiguousarray(sizes, dtype=np.uint64)
+        cdef intp_t D = sizes_array.shape[0]
+        if rev is None:
+            rev = np.arange(D, dtype=np.uint64)
+        cdef uint64_t[:] rev_array = np.ascontiguousarray(rev, dtype=np.uint64)
+        if D == 0:
+            raise ValueError('Tensor must have at least one dimension')
+        if len(pointers) != D or len(indices) != D or rev_array.shape[0] != D:
+            raise ValueError(f'pointers, indices and rev must have one entry per dimension: {D}')
+        if pointer_type is None:
+            pointer_type = next((np.asarray(p).dtype for p in pointers if p is not None), np.uint64)
+        if index_type is None:
+            index_type = next((np.asarray(i).dtype for i in indices if i is not None), np.uint64)
+        pointer_dtype = np.dtype(pointer_type)
+        index_dtype = np.dtype(index_type)
+        values = np.asarray(values)
+        value_dtype = values.dtype
+        if pointer_dtype not in _SNAPSHOT_OVERHEAD_TYPES:
+            raise TypeError(f"pointer_type must be np.uint8, np.uint16, np.uint32 or np.uint64, not: {pointer_dtype}")
+        if index_dtype not in _SNAPSHOT_OVERHEAD_TYPES:
+            raise TypeError(f"index_type must be np.uint8, np.uint16, np.uint32 or np.uint64, not: {index_dtype}")
+        if value_dtype not in _SNAPSHOT_VALUE_TYPES:
+            raise TypeError(f"Bad dtype for values: {value_dtype}.  int{{8,16,32,64}} or float{{32,64}} expected.")
+
+        arrays = []
+        cdef vector[uintptr_t] pointer_ptrs = vector[uintptr_t](D)
+        cdef vector[uintptr_t] index_ptrs = vector[uintptr_t](D)
+        cdef vector[uint64_t] pointer_lengths = vector[uint64_t](D)
+        cdef vector[uint64_t] index_lengths = vector[uint64_t](D)
+        for i in range(D):
+            if pointers[i] is not None:
+                array = _adoptable_array(pointers[i], pointer_dtype)
+                arrays.append(array)
+                pointer_ptrs[i] = array.ctypes.data
+                pointer_lengths[i] = array.shape[0]
+            if indices[i] is not None:
+                array = _adoptable_array(indices[i], index_dtype)
+                arrays.append(array)
+                index_ptrs[i] = array.ctypes.data
+                index_lengths[i] = array.shape[0]
+        values = _adoptable_array(values, value_dtype)
+        arrays.append(values)
+
+        # The runtime owns this reference until it calls `_release_adopted_arrays`
+        context = tuple(arrays)
+        Py_INCREF(context)
+        cdef void *data = adopt_sparse_tensor(
+            D, &sizes_array[0], &rev_array[0],
+            _SNAPSHOT_OVERHEAD_TYPES[pointer_dtype], _SNAPSHOT_OVERHEAD_TYPES[index_dtype], _SNAPSHOT_VALUE_TYPES[value_dtype],
+            <void **>pointer_ptrs.data(), pointer_lengths.data(), <void **>index_ptrs.data(), index_lengths.data(),
+            <void *><uintptr_t>values.ctypes.data, values.shape[0],
+            <release_fn>_release_adopted_arrays, <void *>context, validate,
+        )
+        if data == NULL:
+            raise ValueError('Invalid sparse tensor arrays')
+        cdef MLIRSparseTensor rv = MLIRSparseTensor.__new__(MLIRSparseTensor)  # avoid __init__
+        rv._data = data
+        rv.ndim = D
+        rv.pointer_dtype = pointer_dtype
+        rv.index_dtype = index_dtype
+        rv.value_dtype = value_dtype
+        return rv
+
     # cpdef MLIRSparseTensor empty_like(self):
     #     cdef MLIRSparseTensor rv = MLIRSparseTensor.__new__(MLIRSparseTensor)  # avoid __init__
     #     rv._data = empty_like(self._data)
@@ -724,10 +978,6 @@ cdef class MLIRSparseTensor:
     #     return rv
 
 
-# Use this to create `vector[vector[uint64_t]*]`, which isn't supported syntax
-ctypedef vector[uint64_t]* v_ptr
-
-
 @cython.boundscheck(False)
 @cython.wraparound(False)
 def _build_sparse_tensor(
@@ -771,12 +1021,9 @@ def _build_sparse_tensor(
         sizes_vector[i] = sizes[i]
     cdef SparseTensorCOO[st_value_t] *tensor = new SparseTensorCOO[st_value_t](sizes_vector, N)
 
-    cdef vector[v_ptr] index_vectors = vector[v_ptr](N)
-    cdef v_ptr ind_ptr
-    cdef vector[uint64_t] ind
+    # The COO copies each coordinate into its per-dimension arrays
+    cdef vector[uint64_t] ind = vector[uint64_t](D)
     for i in range(N):
-        index_vectors[i] = new vector[uint64_t](D)
-        ind = index_vectors[i][0]
         for j in range(D):
             ind[j] = indices[i, j]
         tensor.add(ind, values[i])
@@ -799,8 +1046,6 @@ def _build_sparse_tensor(
 
     free(sparsity_array)
     del tensor
-    for i in range(N):
-        del index_vectors[i]
 
     if st_index_t is uint8_t:
         self.index_dtype = np.dtype(np.uint8)
@@ -18,21 +18,79 @@ enum EwiseBehavior {
   MASK_COMPLEMENT,
 };
 
-ValueRange buildMaskComplement(PatternRewriter &rewriter, Location loc,
-                               Value fullSize, Value maskIndices,
-                               Value maskStart, Value maskEnd);
+// Writes the indices in [0, fullSize) missing from the sorted
+// maskIndices[maskStart:maskEnd) to output[outputStart:] and returns their
+// count.
+Value writeMaskComplement(PatternRewriter &rewriter, Location loc,
+                          Value fullSize, Value maskIndices, Value maskStart,
+                          Value maskEnd, Value output, Value outputStart);
 
 ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
                                  Value size, Value pointers);
 
+// Keeps the indices of a whose bit is set in the bitmap mask
+ValueRange buildBitmapOverlap(PatternRewriter &rewriter, Location loc,
+                              Value aSize, Value a, Value bitmap,
+                              bool complement);
+
 ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
-                             Value aSize, Value a, Value bSize, Value b);
+                             Value aSize, Value a, Value bSize, Value b,
+                             bool difference = false);
+
+void computeRowBlocks(PatternRewriter &rewriter, Location loc, Value nrow,
+                      Value &blockSize, Value &numBlocks,
+                      Value maxBlocks = nullptr);
+
+void computeRowBlockBounds(PatternRewriter &rewriter, Location loc,
+                           Value block, Value blockSize, Value nrow,
+                           Value &rowStart, Value &rowEnd);
+
+// Splits [0, nrow) into blocks which each get a dense scratch array of
+// `width` entries, e.g. a count per output column.
+void computeScatterBlocks(PatternRewriter &rewriter, Location loc, Value nrow,
+                          Value nnz, Value width, Value &blockSize,
+                          Value &numBlocks);
+
+// Replaces values[0..size) with their exclusive prefix sum, stores the total
+// in values[size] and returns it.
+Value buildExclusiveScan(PatternRewriter &rewriter, Location loc,
+                         Value values, Value size);
+
+// Scratch space holding the fixed row of an inner product. Entries are tagged
+// with the fixed row index, so the workspace can be reused across rows
+// without being cleared. The values and hash buffers are optional.
+// A fixed row which is already a bitmap vector is probed in place instead:
+// only `bitmap`, the values of the vector, is set.
+struct RowWorkspace {
+  Value marker = nullptr;
+  Value values = nullptr;
+  Value hashTags = nullptr;
+  Value hashKeys = nullptr;
+  Value hashValues = nullptr;
+  Value bitmap = nullptr;
+};
+
+RowWorkspace allocRowWorkspace(PatternRewriter &rewriter, Location loc,
+                               Value size, Type valueType, bool withHash);
 
+void deallocRowWorkspace(PatternRewriter &rewriter, Location loc,
+                         const RowWorkspace &workspace);
+
+// When complementSize is given, the mask is complemented: the columns in
+// [0, complementSize) missing from the mask are visited instead, without
+// materializing them.
+// A bitmap mask is given as maskBitmap, the values of a bitmap vector, with
+// maskIndices set to nullptr and [maskStart, maskEnd) covering every column.
+// Columns are then skipped with a bit lookup, which complementSize flips.
 Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
-                         Value fixedIndices, Value fixedIndexStart,
-                         Value fixedIndexEnd, Value iterPointers,
-                         Value iterIndices, Value maskIndices, Value maskStart,
-                         Value maskEnd, Type valueType);
+                         Value fixedRowIndex, Value fixedIndices,
+                         Value fixedIndexStart, Value fixedIndexEnd,
+                         Value iterPointers, Value iterIndices,
+                         Value maskIndices, Value maskStart, Value maskEnd,
+                         Type valueType,
+                         const RowWorkspace *workspace = nullptr,
+                         Value complementSize = nullptr,
+                         Value maskBitmap = nullptr);
 
 void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
                          Value fixedRowIndex, Value fixedIndices,
@@ -42,7 +100,28 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
                          Value maskStart, Value maskEnd, Type valueType,
                          ExtensionBlocks extBlocks, Value outputIndices,
                          Value outputValues, Value indexOffset,
-                         bool swapMultOps);
+                         bool swapMultOps,
+                         const RowWorkspace *workspace = nullptr,
+                         Value complementSize = nullptr,
+                         Value maskBitmap = nullptr);
+
+void sortIndices(PatternRewriter &rewriter, Location loc, Value indices,
+                 Value start, Value end);
+
+Value computeSaxpyRowSize(PatternRewriter &rewriter, Location loc,
+                          Value fixedRowIndex, Value fixedIndices,
+                          Value fixedIndexStart, Value fixedIndexEnd,
+                          Value iterPointers, Value iterIndices, Value marker,
+                          Value maskIndices, Value maskStart, Value maskEnd);
+
+void computeSaxpyRow(PatternRewriter &rewriter, Location loc, Value ncol,
+                     Value fixedRowIndex, Value fixedIndices, Value fixedValues,
+                     Value fixedIndexStart, Value fixedIndexEnd,
+                     Value iterPointers, Value iterIndices, Value iterValues,
+                     Value marker, Value workspace, Value maskIndices,
+                     Value maskStart, Value maskEnd, Type valueType,
+                     ExtensionBlocks extBlocks, Value outputIndices,
+                     Value outputValues, Value outputStart, Value outputEnd);
 
 Value computeIndexOverlapSize(PatternRewriter &rewriter, Location loc,
                               bool intersect, Value aPosStart, Value aPosEnd,
@@ -65,4 +144,12 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
                               Value output, Block *binaryBlock,
                               EwiseBehavior behavior);
 
+// Updates `output` with `input` under the optional `mask` as graphblas.update
+// does, merging the current and new entries in a single pass. The merged
+// buffers are swapped into `output` rather than copied.
+void computeMaskedUpdate(PatternRewriter &rewriter, Location loc,
+                         ModuleOp module, Value input, Value mask, Value output,
+                         Block *accumulateBlock, bool maskComplement,
+                         bool replace);
+
 #endif // GRAPHBLAS_GRAPHBLASARRAYUTILS_H
@@ -6,6 +6,7 @@
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/PatternMatch.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/StringSet.h"
 #include <set>
@@ -86,9 +87,26 @@ static const llvm::StringSet<> supportedForApply{
 
 bool hasRowOrdering(mlir::Type inputType);
 bool hasColumnOrdering(mlir::Type inputType);
+bool isBitmapVector(mlir::Type inputType);
 mlir::MemRefType getMemrefPointerType(mlir::Type tensorType);
 mlir::MemRefType getMemrefIndexType(mlir::Type tensorType);
 mlir::MemRefType getMemrefValueType(mlir::Type tensorType);
+
+// Pointers and indices are stored at the bit width of the tensor encoding but
+// computed as i64. These widen on load, narrow on store and convert while
+// copying; for 64-bit memrefs they emit plain loads, stores and copies.
+// Narrowing truncates: values computed for a tensor are bounded by its own
+// sizes and number of values, so only copies between tensors of different bit
+// widths need assertFitsBitWidth first.
+mlir::Value loadI64(mlir::OpBuilder &builder, mlir::Location loc,
+                    mlir::Value memref, mlir::ValueRange indices);
+void storeI64(mlir::OpBuilder &builder, mlir::Location loc, mlir::Value value,
+              mlir::Value memref, mlir::ValueRange indices);
+void copyI64(mlir::OpBuilder &builder, mlir::Location loc, mlir::Value source,
+             mlir::Value dest);
+void assertFitsBitWidth(mlir::OpBuilder &builder, mlir::Location loc,
+                        mlir::Value bound, mlir::Value memref,
+                        llvm::StringRef message);
 mlir::RankedTensorType getCompressedVectorType(mlir::MLIRContext *context,
                                                mlir::ArrayRef<int64_t> shape,
                                                mlir::Type valueType,
@@ -134,21 +152,38 @@ mlir::Value callEmptyLike(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
 mlir::Value callDupTensor(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                           mlir::Location loc, mlir::Value tensor);
 
+// Returns a new tensor sharing the pointers, indices and values of `tensor`.
+// Lowerings that write into an existing tensor must detach it first.
+mlir::Value callViewTensor(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
+                           mlir::Location loc, mlir::Value tensor);
+mlir::CallOp callDetachTensor(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
+                              mlir::Location loc, mlir::Value tensor);
+
 mlir::CallOp callAssignRev(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                            mlir::Location loc, mlir::Value tensor,
                            mlir::Value d, mlir::Value newIndexValue);
 mlir::CallOp callResizeDim(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                            mlir::Location loc, mlir::Value tensor,
                            mlir::Value d, mlir::Value size);
+
+// Growing a buffer leaves the new elements uninitialized unless `zero` is set
 mlir::CallOp callResizePointers(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                                 mlir::Location loc, mlir::Value tensor,
-                                mlir::Value d, mlir::Value size);
+                                mlir::Value d, mlir::Value size,
+                                bool zero = false);
 mlir::CallOp callResizeIndex(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                              mlir::Location loc, mlir::Value tensor,
-                             mlir::Value d, mlir::Value size);
+                             mlir::Value d, mlir::Value size,
+                             bool zero = false);
 mlir::CallOp callResizeValues(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                               mlir::Location loc, mlir::Value tensor,
-                              mlir::Value size);
+                              mlir::Value size, bool zero = false);
+mlir::CallOp callSharePointers(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
+                               mlir::Location loc, mlir::Value tensor,
+                               mlir::Value other);
+mlir::CallOp callShareIndices(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
+                              mlir::Location loc, mlir::Value tensor,
+                              mlir::Value other);
 mlir::CallOp callSwapPointers(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                               mlir::Location loc, mlir::Value tensor,
                               mlir::Value other);
@@ -159,14 +194,24 @@ mlir::CallOp callSwapValues(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                             mlir::Location loc, mlir::Value tensor,
                             mlir::Value other);
 
+// Random numbers of an op come from a stream of the RandomUtils context that
+// is started once before the op's loops
+mlir::CallOp callStartRandomStream(mlir::OpBuilder &builder,
+                                   mlir::ModuleOp &mod, mlir::Location loc,
+                                   mlir::Value rngContext);
+mlir::Value callRandomDoubleAt(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
+                               mlir::Location loc, mlir::Value rngContext,
+                               mlir::Value row, mlir::Value col);
+
 void cleanupIntermediateTensor(mlir::OpBuilder &builder, mlir::ModuleOp &mod,
                                mlir::Location loc, mlir::Value tensor);
+void releaseIntermediatesAfterLastUse(mlir::ModuleOp mod);
 
 struct ExtensionBlocks {
-  mlir::Block *transformInA = nullptr; // not used
+  mlir::Block *transformInA = nullptr;
   mlir::Block *transformInB = nullptr; // not used
   mlir::Block *transformOut = nullptr;
-  mlir::Block *selectInA = nullptr; // not used
+  mlir::Block *selectInA = nullptr;
   mlir::Block *selectInB = nullptr; // not used
   mlir::Block *selectOut = nullptr;
   mlir::Block *addIdentity = nullptr;
@@ -183,6 +228,16 @@ struct ExtensionBlocks {
                 const std::set<mlir::graphblas::YieldKind> &optional);
 };
 
+// Inlines an extension block at the insertion point, passing it the leading
+// `args` it takes, and returns the value it yields
+mlir::Value inlineExtensionBlock(mlir::PatternRewriter &rewriter,
+                                 mlir::Block *block, mlir::ValueRange args);
+
+// Like inlineExtensionBlock, but clones the block's operations so that it
+// can be expanded more than once
+mlir::Value cloneExtensionBlock(mlir::PatternRewriter &rewriter,
+                                mlir::Block *block, mlir::ValueRange args);
+
 mlir::LogicalResult populateUnary(mlir::OpBuilder &builder, mlir::Location loc,
                                   mlir::StringRef unaryOp, mlir::Type valueType,
                                   mlir::RegionRange regions,
@@ -202,6 +257,7 @@ mlir::LogicalResult populateMonoid(mlir::OpBuilder &builder, mlir::Location loc,
                                    mlir::RegionRange regions,
                                    mlir::graphblas::YieldKind yieldIdentity,
                                    mlir::graphblas::YieldKind yieldKind);
+bool isAnyMonoidBlock(mlir::Block *block);
 
 mlir::LogicalResult populateSemiring(mlir::OpBuilder &builder,
                                      mlir::Location loc,
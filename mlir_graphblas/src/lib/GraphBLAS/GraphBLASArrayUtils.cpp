@@ -7,6 +7,7 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "GraphBLAS/GraphBLASArrayUtils.h"
@@ -15,108 +16,106 @@
 
 using namespace ::mlir;
 
-ValueRange buildMaskComplement(PatternRewriter &rewriter, Location loc,
-                               Value fullSize, Value maskIndices,
-                               Value maskStart, Value maskEnd) {
+// A complemented mask is iterated one gap at a time, where gap `pos` holds
+// the indices strictly between maskIndices[pos-1] and maskIndices[pos]. The
+// first gap starts at 0 and the last one, at pos == maskEnd, ends at fullSize.
+// Iterating over the gaps avoids materializing the complement.
+static void computeMaskGapBounds(PatternRewriter &rewriter, Location loc,
+                                 Value fullSize, Value maskIndices,
+                                 Value maskStart, Value maskEnd, Value pos,
+                                 Value &gapStart, Value &gapEnd) {
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  Value isFirst = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
+                                                 pos, maskStart);
+  scf::IfOp if_first =
+      rewriter.create<scf::IfOp>(loc, indexType, isFirst, true);
+  {
+    rewriter.setInsertionPointToStart(if_first.thenBlock());
+    rewriter.create<scf::YieldOp>(loc, c0);
+  }
+  {
+    rewriter.setInsertionPointToStart(if_first.elseBlock());
+    Value prevPos = rewriter.create<arith::SubIOp>(loc, pos, c1);
+    Value prevIndex64 = loadI64(rewriter, loc, maskIndices, prevPos);
+    Value prevIndex =
+        rewriter.create<arith::IndexCastOp>(loc, prevIndex64, indexType);
+    Value prevIndexPlus1 = rewriter.create<arith::AddIOp>(loc, prevIndex, c1);
+    rewriter.create<scf::YieldOp>(loc, prevIndexPlus1);
+  }
+  rewriter.setInsertionPointAfter(if_first);
+  gapStart = if_first.getResult(0);
+
+  Value isLast = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
+                                                pos, maskEnd);
+  scf::IfOp if_last = rewriter.create<scf::IfOp>(loc, indexType, isLast, true);
+  {
+    rewriter.setInsertionPointToStart(if_last.thenBlock());
+    rewriter.create<scf::YieldOp>(loc, fullSize);
+  }
+  {
+    rewriter.setInsertionPointToStart(if_last.elseBlock());
+    Value index64 = loadI64(rewriter, loc, maskIndices, pos);
+    Value index = rewriter.create<arith::IndexCastOp>(loc, index64, indexType);
+    rewriter.create<scf::YieldOp>(loc, index);
+  }
+  rewriter.setInsertionPointAfter(if_last);
+  gapEnd = if_last.getResult(0);
+}
+
+Value writeMaskComplement(PatternRewriter &rewriter, Location loc,
+                          Value fullSize, Value maskIndices, Value maskStart,
+                          Value maskEnd, Value output, Value outputStart) {
   // Operates on a vector or on a single row/column of a matrix
   //
-  // Returns:
-  // 1. a memref containing the indices of the mask complement
-  // 2. the size of the memref
+  // Writes the indices of the mask complement to output, starting at
+  // outputStart, and returns the number of indices written
 
   // Types used in this function
-  Type indexType = rewriter.getIndexType();
   Type int64Type = rewriter.getIntegerType(64);
-  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
 
   // Initial constants
-  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
   Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
 
   // Compute the size of the complemented mask
   Value maskSize = rewriter.create<arith::SubIOp>(loc, maskEnd, maskStart);
   Value compSize = rewriter.create<arith::SubIOp>(loc, fullSize, maskSize);
 
-  // Allocate memref
-  Value compIndices =
-      rewriter.create<memref::AllocOp>(loc, memref1DI64Type, compSize);
-
-  // Force firstMaskIndex to be unreachable for the case of empty row
-  // This will cause every idx in the loop to be included in the output
-  Value rowIsEmpty = rewriter.create<arith::CmpIOp>(
-      loc, arith::CmpIPredicate::eq, maskStart, maskEnd);
-
-  scf::IfOp if_empty_row =
-      rewriter.create<scf::IfOp>(loc, indexType, rowIsEmpty, true);
-  {
-    rewriter.setInsertionPointToStart(if_empty_row.thenBlock());
-    rewriter.create<scf::YieldOp>(loc, fullSize);
-  }
-  {
-    rewriter.setInsertionPointToStart(if_empty_row.elseBlock());
-    Value startIndex64 =
-        rewriter.create<memref::LoadOp>(loc, maskIndices, maskStart);
-    Value startIndex =
-        rewriter.create<arith::IndexCastOp>(loc, startIndex64, indexType);
-    rewriter.create<scf::YieldOp>(loc, startIndex);
-    rewriter.setInsertionPointAfter(if_empty_row);
-  }
-  Value firstMaskIndex = if_empty_row.getResult(0);
-
-  // Populate memref
-  scf::ForOp loop = rewriter.create<scf::ForOp>(
-      loc, c0, fullSize, c1, ValueRange{c0, maskStart, firstMaskIndex});
-  Value idx = loop.getInductionVar();
-  Value compPos = loop.getLoopBody().getArgument(1);
-  Value maskPos = loop.getLoopBody().getArgument(2);
-  Value maskIndex = loop.getLoopBody().getArgument(3);
+  Value maskEndPlus1 = rewriter.create<arith::AddIOp>(loc, maskEnd, c1);
+  scf::ForOp gapLoop = rewriter.create<scf::ForOp>(loc, maskStart, maskEndPlus1,
+                                                   c1, outputStart);
   {
-    rewriter.setInsertionPointToStart(loop.getBody());
-    Value maskMatch = rewriter.create<arith::CmpIOp>(
-        loc, arith::CmpIPredicate::eq, idx, maskIndex);
-    scf::IfOp if_match = rewriter.create<scf::IfOp>(
-        loc, TypeRange{indexType, indexType, indexType}, maskMatch, true);
+    rewriter.setInsertionPointToStart(gapLoop.getBody());
+    Value pos = gapLoop.getInductionVar();
+    Value outputPos = gapLoop.getLoopBody().getArgument(1);
+    Value gapStart, gapEnd;
+    computeMaskGapBounds(rewriter, loc, fullSize, maskIndices, maskStart,
+                         maskEnd, pos, gapStart, gapEnd);
+    // Gaps are disjoint, so their indices are written in parallel
+    Value gapSize = rewriter.create<arith::SubIOp>(loc, gapEnd, gapStart);
+    scf::ParallelOp idxLoop =
+        rewriter.create<scf::ParallelOp>(loc, gapStart, gapEnd, c1);
     {
-      rewriter.setInsertionPointToStart(if_match.thenBlock());
-      // Increment maskPos
-      Value nextMaskPos = rewriter.create<arith::AddIOp>(loc, maskPos, c1);
-      // Update maskIndex (unless we're at the end)
-      Value isAtEnd = rewriter.create<arith::CmpIOp>(
-          loc, arith::CmpIPredicate::uge, nextMaskPos, maskEnd);
-      scf::IfOp if_atEnd =
-          rewriter.create<scf::IfOp>(loc, indexType, isAtEnd, true);
-      {
-        rewriter.setInsertionPointToStart(if_atEnd.thenBlock());
-        rewriter.create<scf::YieldOp>(loc, maskIndex);
-      }
-      {
-        rewriter.setInsertionPointToStart(if_atEnd.elseBlock());
-        Value newMaskIndex64 =
-            rewriter.create<memref::LoadOp>(loc, maskIndices, nextMaskPos);
-        Value newMaskIndex =
-            rewriter.create<arith::IndexCastOp>(loc, newMaskIndex64, indexType);
-        rewriter.create<scf::YieldOp>(loc, newMaskIndex);
-      }
-      rewriter.setInsertionPointAfter(if_atEnd);
-      rewriter.create<scf::YieldOp>(
-          loc, ValueRange{compPos, nextMaskPos, if_atEnd.getResult(0)});
-    }
-    {
-      rewriter.setInsertionPointToStart(if_match.elseBlock());
-      // Add i to compIndices
+      rewriter.setInsertionPointToStart(idxLoop.getBody());
+      Value idx = idxLoop.getInductionVars().front();
+      Value gapOffset = rewriter.create<arith::SubIOp>(loc, idx, gapStart);
+      Value idxPos = rewriter.create<arith::AddIOp>(loc, outputPos, gapOffset);
       Value idx64 = rewriter.create<arith::IndexCastOp>(loc, idx, int64Type);
-      rewriter.create<memref::StoreOp>(loc, idx64, compIndices, compPos);
-      // Increment compPos
-      Value nextCompPos = rewriter.create<arith::AddIOp>(loc, compPos, c1);
-      rewriter.create<scf::YieldOp>(
-          loc, ValueRange{nextCompPos, maskPos, maskIndex});
+      storeI64(rewriter, loc, idx64, output, idxPos);
     }
-    rewriter.setInsertionPointAfter(if_match);
-    rewriter.create<scf::YieldOp>(loc, if_match.getResults());
-    rewriter.setInsertionPointAfter(loop);
+    rewriter.setInsertionPointAfter(idxLoop);
+    Value nextOutputPos =
+        rewriter.create<arith::AddIOp>(loc, outputPos, gapSize);
+    rewriter.create<scf::YieldOp>(loc, nextOutputPos);
   }
+  rewriter.setInsertionPointAfter(gapLoop);
 
-  return ValueRange{compIndices, compSize};
+  return compSize;
 }
 
 ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
@@ -143,9 +142,8 @@ ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
     Value count = nnzCountLoop.getLoopBody().getArgument(1);
     Value rowIndex = nnzCountLoop.getInductionVar();
     Value nextRowIndex = rewriter.create<arith::AddIOp>(loc, rowIndex, c1);
-    Value firstPtr64 = rewriter.create<memref::LoadOp>(loc, pointers, rowIndex);
-    Value secondPtr64 =
-        rewriter.create<memref::LoadOp>(loc, pointers, nextRowIndex);
+    Value firstPtr64 = loadI64(rewriter, loc, pointers, rowIndex);
+    Value secondPtr64 = loadI64(rewriter, loc, pointers, nextRowIndex);
     Value rowIsEmpty = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::eq, firstPtr64, secondPtr64);
     scf::IfOp ifRowIsEmptyBlock =
@@ -175,9 +173,8 @@ ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
     Value pos = nnzIdxLoop.getLoopBody().getArgument(1);
     Value rowIndex = nnzIdxLoop.getInductionVar();
     Value nextRowIndex = rewriter.create<arith::AddIOp>(loc, rowIndex, c1);
-    Value firstPtr64 = rewriter.create<memref::LoadOp>(loc, pointers, rowIndex);
-    Value secondPtr64 =
-        rewriter.create<memref::LoadOp>(loc, pointers, nextRowIndex);
+    Value firstPtr64 = loadI64(rewriter, loc, pointers, rowIndex);
+    Value secondPtr64 = loadI64(rewriter, loc, pointers, nextRowIndex);
     Value rowIsEmpty = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::eq, firstPtr64, secondPtr64);
     scf::IfOp ifRowIsEmptyBlock =
@@ -190,7 +187,7 @@ ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
       rewriter.setInsertionPointToStart(ifRowIsEmptyBlock.elseBlock());
       Value rowIndex64 =
           rewriter.create<arith::IndexCastOp>(loc, rowIndex, int64Type);
-      rewriter.create<memref::StoreOp>(loc, rowIndex64, indices, pos);
+      storeI64(rewriter, loc, rowIndex64, indices, pos);
       Value pos_plus1 = rewriter.create<arith::AddIOp>(loc, pos, c1);
       rewriter.create<scf::YieldOp>(loc, ValueRange{pos_plus1});
     }
@@ -203,9 +200,88 @@ ValueRange sparsifyDensePointers(PatternRewriter &rewriter, Location loc,
   return ValueRange{indices, nnz};
 }
 
+// Returns whether idx is in the bitmap, i.e. whether bitmap[idx] is nonzero,
+// flipped when the bitmap is a complemented mask. Bitmap masks hold integers;
+// the vector operand of a matrix-vector multiply may also hold floats.
+static Value loadBitmapBit(PatternRewriter &rewriter, Location loc,
+                           Value bitmap, Value idx, bool complement) {
+  Type boolType = rewriter.getI1Type();
+  Value bit = rewriter.create<memref::LoadOp>(loc, bitmap, idx);
+  Value isSet =
+      llvm::TypeSwitch<Type, Value>(bit.getType())
+          .Case<IntegerType>([&](IntegerType type) {
+            Value zero =
+                rewriter.create<arith::ConstantIntOp>(loc, 0, type.getWidth());
+            return rewriter.create<arith::CmpIOp>(
+                loc, arith::CmpIPredicate::ne, bit, zero);
+          })
+          .Case<FloatType>([&](FloatType type) {
+            Value zero = rewriter.create<arith::ConstantFloatOp>(
+                loc, APFloat(0.0), type);
+            return rewriter.create<arith::CmpFOp>(
+                loc, arith::CmpFPredicate::UNE, bit, zero);
+          })
+          .Default([&](Type type) -> Value {
+            llvm_unreachable("bitmap values must be integers or floats");
+          });
+  if (complement) {
+    Value ctrue = rewriter.create<arith::ConstantIntOp>(loc, 1, boolType);
+    isSet = rewriter.create<arith::XOrIOp>(loc, isSet, ctrue);
+  }
+  return isSet;
+}
+
+ValueRange buildBitmapOverlap(PatternRewriter &rewriter, Location loc,
+                              Value aSize, Value a, Value bitmap,
+                              bool complement) {
+  // Keeps the indices in a whose bit is set in the bitmap
+  // Returns:
+  // 1. a memref containing the kept indices
+  // 2. the size of the memref
+
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  Value output = rewriter.create<memref::AllocOp>(loc, memref1DI64Type, aSize);
+
+  scf::ForOp loop = rewriter.create<scf::ForOp>(loc, c0, aSize, c1, c0);
+  {
+    rewriter.setInsertionPointToStart(loop.getBody());
+    Value posA = loop.getInductionVar();
+    Value posO = loop.getLoopBody().getArgument(1);
+    Value idx64 = loadI64(rewriter, loc, a, posA);
+    Value idx = rewriter.create<arith::IndexCastOp>(loc, idx64, indexType);
+    Value keep = loadBitmapBit(rewriter, loc, bitmap, idx, complement);
+    scf::IfOp if_keep = rewriter.create<scf::IfOp>(loc, indexType, keep, true);
+    {
+      rewriter.setInsertionPointToStart(if_keep.thenBlock());
+      storeI64(rewriter, loc, idx64, output, posO);
+      Value posOplus1 = rewriter.create<arith::AddIOp>(loc, posO, c1);
+      rewriter.create<scf::YieldOp>(loc, posOplus1);
+    }
+    {
+      rewriter.setInsertionPointToStart(if_keep.elseBlock());
+      rewriter.create<scf::YieldOp>(loc, posO);
+    }
+    rewriter.setInsertionPointAfter(if_keep);
+    rewriter.create<scf::YieldOp>(loc, if_keep.getResult(0));
+  }
+  rewriter.setInsertionPointAfter(loop);
+
+  return ValueRange{output, loop.getResult(0)};
+}
+
 ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
-                             Value aSize, Value a, Value bSize, Value b) {
+                             Value aSize, Value a, Value bSize, Value b,
+                             bool difference) {
   // Takes two memrefs containing a list of indices and performs an intersection
+  // With `difference`, keeps the indices of a which are missing from b instead
   // Returns:
   // 1. a memref containing the overlapping indices
   // 2. the size of the memref
@@ -225,11 +301,14 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
 
   // Allocate a memref matching the smaller size
   // This will sacrifice memory for less computation
-  Value aIsSmaller = rewriter.create<arith::CmpIOp>(
-      loc, arith::CmpIPredicate::ult, aSize, bSize);
-  Value smallerSize = rewriter.create<SelectOp>(loc, aIsSmaller, aSize, bSize);
+  Value outputSize = aSize;
+  if (!difference) {
+    Value aIsSmaller = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ult, aSize, bSize);
+    outputSize = rewriter.create<SelectOp>(loc, aIsSmaller, aSize, bSize);
+  }
   Value output =
-      rewriter.create<memref::AllocOp>(loc, memref1DI64Type, smallerSize);
+      rewriter.create<memref::AllocOp>(loc, memref1DI64Type, outputSize);
 
   // Find matching indices
   // While Loop (exit when either array is exhausted)
@@ -273,7 +352,7 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
       rewriter.create<scf::IfOp>(loc, int64Type, needsUpdateA, true);
   {
     rewriter.setInsertionPointToStart(if_updateA.thenBlock());
-    Value updatedIdxA = rewriter.create<memref::LoadOp>(loc, a, posA);
+    Value updatedIdxA = loadI64(rewriter, loc, a, posA);
     rewriter.create<scf::YieldOp>(loc, updatedIdxA);
   }
   {
@@ -287,7 +366,7 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
       rewriter.create<scf::IfOp>(loc, int64Type, needsUpdateB, true);
   {
     rewriter.setInsertionPointToStart(if_updateB.thenBlock());
-    Value updatedIdxB = rewriter.create<memref::LoadOp>(loc, b, posB);
+    Value updatedIdxB = loadI64(rewriter, loc, b, posB);
     rewriter.create<scf::YieldOp>(loc, updatedIdxB);
   }
   {
@@ -312,8 +391,14 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
       idxA_lt_idxB, true);
   {
     rewriter.setInsertionPointToStart(if_onlyA.thenBlock());
-    rewriter.create<scf::YieldOp>(
-        loc, ValueRange{posAplus1, posB, posO, ctrue, cfalse});
+    if (difference) {
+      storeI64(rewriter, loc, newIdxA, output, posO);
+      rewriter.create<scf::YieldOp>(
+          loc, ValueRange{posAplus1, posB, posOplus1, ctrue, cfalse});
+    } else {
+      rewriter.create<scf::YieldOp>(
+          loc, ValueRange{posAplus1, posB, posO, ctrue, cfalse});
+    }
   }
   {
     rewriter.setInsertionPointToStart(if_onlyA.elseBlock());
@@ -328,9 +413,14 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
     {
       rewriter.setInsertionPointToStart(if_onlyB.elseBlock());
       // At this point, we know newIdxA == newIdxB
-      rewriter.create<memref::StoreOp>(loc, newIdxA, output, posO);
-      rewriter.create<scf::YieldOp>(
-          loc, ValueRange{posAplus1, posBplus1, posOplus1, ctrue, ctrue});
+      if (difference) {
+        rewriter.create<scf::YieldOp>(
+            loc, ValueRange{posAplus1, posBplus1, posO, ctrue, ctrue});
+      } else {
+        storeI64(rewriter, loc, newIdxA, output, posO);
+        rewriter.create<scf::YieldOp>(
+            loc, ValueRange{posAplus1, posBplus1, posOplus1, ctrue, ctrue});
+      }
     }
     rewriter.setInsertionPointAfter(if_onlyB);
     rewriter.create<scf::YieldOp>(loc, if_onlyB.getResults());
@@ -348,22 +438,478 @@ ValueRange buildIndexOverlap(PatternRewriter &rewriter, Location loc,
   rewriter.setInsertionPointAfter(whileLoop);
 
   Value finalPosO = whileLoop.getResult(2);
+
+  if (difference) {
+    // Indices in a past the end of b are all kept
+    Value finalPosA = whileLoop.getResult(0);
+    scf::ForOp tailLoop =
+        rewriter.create<scf::ForOp>(loc, finalPosA, aSize, c1, finalPosO);
+    {
+      rewriter.setInsertionPointToStart(tailLoop.getBody());
+      Value tailPosA = tailLoop.getInductionVar();
+      Value tailPosO = tailLoop.getLoopBody().getArgument(1);
+      Value tailIdxA = loadI64(rewriter, loc, a, tailPosA);
+      storeI64(rewriter, loc, tailIdxA, output, tailPosO);
+      Value tailPosOplus1 = rewriter.create<arith::AddIOp>(loc, tailPosO, c1);
+      rewriter.create<scf::YieldOp>(loc, tailPosOplus1);
+    }
+    rewriter.setInsertionPointAfter(tailLoop);
+    finalPosO = tailLoop.getResult(0);
+  }
+
   return ValueRange{output, finalPosO};
 }
 
+// Row-parallel lowerings split [0, nrow) into a fixed number of contiguous
+// row blocks. The blocks are processed in parallel and the rows of a block
+// serially, so scratch space is allocated and initialized once per block
+// rather than once per row.
+static const int64_t numRowBlocks = 256;
+
+void computeRowBlocks(PatternRewriter &rewriter, Location loc, Value nrow,
+                      Value &blockSize, Value &numBlocks, Value maxBlocks) {
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value cRowBlocks = rewriter.create<arith::ConstantIndexOp>(loc, numRowBlocks);
+
+  // Callers with per-block scratch space may ask for fewer blocks
+  if (maxBlocks) {
+    Value cmpMaxBlocks = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ult, maxBlocks, cRowBlocks);
+    cRowBlocks =
+        rewriter.create<SelectOp>(loc, cmpMaxBlocks, maxBlocks, cRowBlocks);
+  }
+
+  // blockSize = max(1, ceil(nrow / numRowBlocks))
+  Value nrowMinus1 = rewriter.create<arith::SubIOp>(loc, nrow, c1);
+  Value blockSizeNumer =
+      rewriter.create<arith::AddIOp>(loc, nrowMinus1, cRowBlocks);
+  Value blockSizeRaw =
+      rewriter.create<arith::DivUIOp>(loc, blockSizeNumer, cRowBlocks);
+  Value cmpBlockEmpty = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, blockSizeRaw, c0);
+  blockSize = rewriter.create<SelectOp>(loc, cmpBlockEmpty, c1, blockSizeRaw);
+
+  // numBlocks = ceil(nrow / blockSize)
+  Value blockSizeMinus1 = rewriter.create<arith::SubIOp>(loc, blockSize, c1);
+  Value numBlocksNumer =
+      rewriter.create<arith::AddIOp>(loc, nrow, blockSizeMinus1);
+  numBlocks = rewriter.create<arith::DivUIOp>(loc, numBlocksNumer, blockSize);
+}
+
+void computeRowBlockBounds(PatternRewriter &rewriter, Location loc,
+                           Value block, Value blockSize, Value nrow,
+                           Value &rowStart, Value &rowEnd) {
+  rowStart = rewriter.create<arith::MulIOp>(loc, block, blockSize);
+  Value rowEndFull = rewriter.create<arith::AddIOp>(loc, rowStart, blockSize);
+  Value cmpRowEnd = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, rowEndFull, nrow);
+  rowEnd = rewriter.create<SelectOp>(loc, cmpRowEnd, rowEndFull, nrow);
+}
+
+// Scatter lowerings always get a few blocks for parallelism, as long as
+// their scratch fits within scatterScratchEntries. Denser inputs may use
+// more blocks, with scratch up to nnz + width entries.
+static const int64_t minScatterBlocks = 64;
+static const int64_t scatterScratchEntries = 1 << 26;
+
+void computeScatterBlocks(PatternRewriter &rewriter, Location loc, Value nrow,
+                          Value nnz, Value width, Value &blockSize,
+                          Value &numBlocks) {
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value cMinBlocks =
+      rewriter.create<arith::ConstantIndexOp>(loc, minScatterBlocks);
+  Value cScratchEntries =
+      rewriter.create<arith::ConstantIndexOp>(loc, scatterScratchEntries);
+
+  Value cmpNoWidth =
+      rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq, width, c0);
+  Value widthNonZero = rewriter.create<SelectOp>(loc, cmpNoWidth, c1, width);
+
+  // minBlocks = min(minScatterBlocks, scatterScratchEntries / width)
+  Value budgetBlocks =
+      rewriter.create<arith::DivUIOp>(loc, cScratchEntries, widthNonZero);
+  Value cmpBudget = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, budgetBlocks, cMinBlocks);
+  Value minBlocks =
+      rewriter.create<SelectOp>(loc, cmpBudget, budgetBlocks, cMinBlocks);
+
+  // maxBlocks = max(1, minBlocks, nnz / width)
+  Value densityBlocks = rewriter.create<arith::DivUIOp>(loc, nnz, widthNonZero);
+  Value cmpDensity = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ugt, densityBlocks, minBlocks);
+  Value maxBlocksRaw =
+      rewriter.create<SelectOp>(loc, cmpDensity, densityBlocks, minBlocks);
+  Value cmpNoBlocks = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, maxBlocksRaw, c0);
+  Value maxBlocks =
+      rewriter.create<SelectOp>(loc, cmpNoBlocks, c1, maxBlocksRaw);
+
+  computeRowBlocks(rewriter, loc, nrow, blockSize, numBlocks, maxBlocks);
+}
+
+Value buildExclusiveScan(PatternRewriter &rewriter, Location loc,
+                         Value values, Value size) {
+  // Types used in this function
+  Type int64Type = rewriter.getIntegerType(64);
+  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
+
+  Value blockSize, numBlocks;
+  computeRowBlocks(rewriter, loc, size, blockSize, numBlocks);
+  Value blockTotals =
+      rewriter.create<memref::AllocOp>(loc, memref1DI64Type, numBlocks);
+
+  // 1st pass
+  //   Sum the values of each block
+  scf::ParallelOp blockLoop1 =
+      rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+  Value block = blockLoop1.getInductionVars().front();
+  rewriter.setInsertionPointToStart(blockLoop1.getBody());
+
+  Value start, end;
+  computeRowBlockBounds(rewriter, loc, block, blockSize, size, start, end);
+  scf::ForOp sumLoop =
+      rewriter.create<scf::ForOp>(loc, start, end, c1, ValueRange{ci0});
+  Value ii = sumLoop.getInductionVar();
+  Value partialSum = sumLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(sumLoop.getBody());
+  Value value = loadI64(rewriter, loc, values, ii);
+  Value nextPartialSum = rewriter.create<arith::AddIOp>(loc, partialSum, value);
+  rewriter.create<scf::YieldOp>(loc, nextPartialSum);
+  rewriter.setInsertionPointAfter(sumLoop);
+  rewriter.create<memref::StoreOp>(loc, sumLoop.getResult(0), blockTotals,
+                                   block);
+
+  // end block loop
+  rewriter.setInsertionPointAfter(blockLoop1);
+
+  // 2nd pass
+  //   Scan the block totals; there are few enough of them to do this serially
+  scf::ForOp blockScanLoop =
+      rewriter.create<scf::ForOp>(loc, c0, numBlocks, c1, ValueRange{ci0});
+  Value bb = blockScanLoop.getInductionVar();
+  Value blockBase = blockScanLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(blockScanLoop.getBody());
+  Value blockTotal = rewriter.create<memref::LoadOp>(loc, blockTotals, bb);
+  rewriter.create<memref::StoreOp>(loc, blockBase, blockTotals, bb);
+  Value nextBlockBase =
+      rewriter.create<arith::AddIOp>(loc, blockBase, blockTotal);
+  rewriter.create<scf::YieldOp>(loc, nextBlockBase);
+  rewriter.setInsertionPointAfter(blockScanLoop);
+  Value total = blockScanLoop.getResult(0);
+
+  // 3rd pass
+  //   Scan each block starting from the sum of the blocks before it
+  scf::ParallelOp blockLoop3 =
+      rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+  block = blockLoop3.getInductionVars().front();
+  rewriter.setInsertionPointToStart(blockLoop3.getBody());
+
+  computeRowBlockBounds(rewriter, loc, block, blockSize, size, start, end);
+  Value base = rewriter.create<memref::LoadOp>(loc, blockTotals, block);
+  scf::ForOp scanLoop =
+      rewriter.create<scf::ForOp>(loc, start, end, c1, ValueRange{base});
+  ii = scanLoop.getInductionVar();
+  Value cumsum = scanLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(scanLoop.getBody());
+  value = loadI64(rewriter, loc, values, ii);
+  storeI64(rewriter, loc, cumsum, values, ii);
+  Value nextCumsum = rewriter.create<arith::AddIOp>(loc, cumsum, value);
+  rewriter.create<scf::YieldOp>(loc, nextCumsum);
+
+  // end block loop
+  rewriter.setInsertionPointAfter(blockLoop3);
+
+  rewriter.create<memref::DeallocOp>(loc, blockTotals);
+  storeI64(rewriter, loc, total, values, size);
+
+  return total;
+}
+
+// A RowWorkspace holds the fixed row of an inner product in one of three
+// forms:
+//   - a dense accumulator: marker[k] == tag means values[k] holds entry k
+//   - an open-addressing hash table with linear probing, used when the fixed
+//     row is short relative to nk
+//   - a bitmap vector: bitmap[k] != 0 means bitmap[k] is entry k
+// Entries are tagged with the fixed row index instead of being cleared, so a
+// workspace can be reused for every row of a block without being reset.
+static const int64_t rowWorkspaceHashBits = 10;
+static const int64_t rowWorkspaceHashCapacity = 1 << rowWorkspaceHashBits;
+
+RowWorkspace allocRowWorkspace(PatternRewriter &rewriter, Location loc,
+                               Value size, Type valueType, bool withHash) {
+  // Types used in this function
+  Type int64Type = rewriter.getIntegerType(64);
+  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+
+  // Initial constants
+  Value cneg1 = rewriter.create<arith::ConstantIntOp>(loc, -1, int64Type);
+
+  RowWorkspace workspace;
+  workspace.marker =
+      rewriter.create<memref::AllocOp>(loc, memref1DI64Type, size);
+  rewriter.create<linalg::FillOp>(loc, cneg1, workspace.marker);
+  if (valueType) {
+    MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
+    workspace.values =
+        rewriter.create<memref::AllocOp>(loc, memref1DValueType, size);
+  }
+
+  if (withHash) {
+    Value cCapacity = rewriter.create<arith::ConstantIndexOp>(
+        loc, rowWorkspaceHashCapacity);
+    workspace.hashTags =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, cCapacity);
+    rewriter.create<linalg::FillOp>(loc, cneg1, workspace.hashTags);
+    workspace.hashKeys =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, cCapacity);
+    rewriter.create<linalg::FillOp>(loc, cneg1, workspace.hashKeys);
+    if (valueType) {
+      MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
+      workspace.hashValues =
+          rewriter.create<memref::AllocOp>(loc, memref1DValueType, cCapacity);
+    }
+  }
+
+  return workspace;
+}
+
+void deallocRowWorkspace(PatternRewriter &rewriter, Location loc,
+                         const RowWorkspace &workspace) {
+  Value buffers[] = {workspace.marker, workspace.values, workspace.hashTags,
+                     workspace.hashKeys, workspace.hashValues};
+  for (Value buffer : buffers) {
+    if (buffer)
+      rewriter.create<memref::DeallocOp>(loc, buffer);
+  }
+}
+
+// Decides at runtime whether the fixed row is stored in the hash table.
+// The table is kept at most half full so probe sequences stay short.
+// Returns nullptr if the workspace has no hash table.
+static Value useRowWorkspaceHash(PatternRewriter &rewriter, Location loc,
+                                 const RowWorkspace &workspace, Value nk,
+                                 Value fixedIndexStart, Value fixedIndexEnd) {
+  if (!workspace.hashTags)
+    return nullptr;
+
+  Value c2 = rewriter.create<arith::ConstantIndexOp>(loc, 2);
+  Value cCapacity =
+      rewriter.create<arith::ConstantIndexOp>(loc, rowWorkspaceHashCapacity);
+  Value rowSize =
+      rewriter.create<arith::SubIOp>(loc, fixedIndexEnd, fixedIndexStart);
+  Value rowSize2 = rewriter.create<arith::MulIOp>(loc, rowSize, c2);
+  Value cmpFits = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ule, rowSize2, cCapacity);
+  Value cmpSmaller = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, cCapacity, nk);
+  return rewriter.create<arith::AndIOp>(loc, cmpFits, cmpSmaller);
+}
+
+// Returns the slot holding key64, or the first free slot of its probe
+// sequence if key64 is not in the table
+static Value probeRowWorkspaceHash(PatternRewriter &rewriter, Location loc,
+                                   const RowWorkspace &workspace, Value tag,
+                                   Value key64) {
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+
+  // Initial constants
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value cSlotMask = rewriter.create<arith::ConstantIndexOp>(
+      loc, rowWorkspaceHashCapacity - 1);
+  // Fibonacci hashing: the top bits of key * 2^64 / phi
+  Value cHashMult = rewriter.create<arith::ConstantIntOp>(
+      loc, static_cast<int64_t>(0x9E3779B97F4A7C15ULL), int64Type);
+  Value cHashShift = rewriter.create<arith::ConstantIntOp>(
+      loc, 64 - rowWorkspaceHashBits, int64Type);
+
+  Value hash64 = rewriter.create<arith::MulIOp>(loc, key64, cHashMult);
+  hash64 = rewriter.create<arith::ShRUIOp>(loc, hash64, cHashShift);
+  Value firstSlot = rewriter.create<arith::IndexCastOp>(loc, hash64, indexType);
+
+  scf::WhileOp whileLoop =
+      rewriter.create<scf::WhileOp>(loc, indexType, firstSlot);
+  Block *before = rewriter.createBlock(&whileLoop.getBefore(), {}, indexType);
+  Block *after = rewriter.createBlock(&whileLoop.getAfter(), {}, indexType);
+  Value slot = before->getArgument(0);
+  rewriter.setInsertionPointToStart(&whileLoop.getBefore().front());
+  Value slotTag =
+      rewriter.create<memref::LoadOp>(loc, workspace.hashTags, slot);
+  Value slotKey =
+      rewriter.create<memref::LoadOp>(loc, workspace.hashKeys, slot);
+  Value cmpOccupied = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, slotTag, tag);
+  Value cmpOtherKey = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ne, slotKey, key64);
+  Value continueProbe =
+      rewriter.create<arith::AndIOp>(loc, cmpOccupied, cmpOtherKey);
+  rewriter.create<scf::ConditionOp>(loc, continueProbe, slot);
+  // "do" portion of while loop
+  rewriter.setInsertionPointToStart(&whileLoop.getAfter().front());
+  Value slotPrev = after->getArgument(0);
+  Value slotPlus1 = rewriter.create<arith::AddIOp>(loc, slotPrev, c1);
+  Value nextSlot = rewriter.create<arith::AndIOp>(loc, slotPlus1, cSlotMask);
+  rewriter.create<scf::YieldOp>(loc, nextSlot);
+  rewriter.setInsertionPointAfter(whileLoop);
+
+  return whileLoop.getResult(0);
+}
+
+// Stores the fixed row into the workspace. The indices of a row are unique,
+// so every insertion claims a new entry.
+static void fillRowWorkspace(PatternRewriter &rewriter, Location loc,
+                             const RowWorkspace &workspace, Value useHash,
+                             Value tag, Value fixedIndices, Value fixedValues,
+                             Value fixedIndexStart, Value fixedIndexEnd) {
+  // A bitmap already is the fixed row
+  if (workspace.bitmap)
+    return;
+
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+
+  // Initial constants
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  scf::ForOp colLoop =
+      rewriter.create<scf::ForOp>(loc, fixedIndexStart, fixedIndexEnd, c1);
+  Value jj = colLoop.getInductionVar();
+  rewriter.setInsertionPointToStart(colLoop.getBody());
+  Value col64 = loadI64(rewriter, loc, fixedIndices, jj);
+  Value val;
+  if (fixedValues)
+    val = rewriter.create<memref::LoadOp>(loc, fixedValues, jj);
+
+  scf::IfOp ifBlock_useHash;
+  if (useHash) {
+    ifBlock_useHash = rewriter.create<scf::IfOp>(loc, useHash, true);
+    // if useHash
+    rewriter.setInsertionPointToStart(ifBlock_useHash.thenBlock());
+    Value slot = probeRowWorkspaceHash(rewriter, loc, workspace, tag, col64);
+    rewriter.create<memref::StoreOp>(loc, tag, workspace.hashTags, slot);
+    rewriter.create<memref::StoreOp>(loc, col64, workspace.hashKeys, slot);
+    if (fixedValues)
+      rewriter.create<memref::StoreOp>(loc, val, workspace.hashValues, slot);
+    // else
+    rewriter.setInsertionPointToStart(ifBlock_useHash.elseBlock());
+  }
+  Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
+  rewriter.create<memref::StoreOp>(loc, tag, workspace.marker, col);
+  if (fixedValues)
+    rewriter.create<memref::StoreOp>(loc, val, workspace.values, col);
+  if (useHash) {
+    // end if useHash
+    rewriter.setInsertionPointAfter(ifBlock_useHash);
+  }
+
+  // end col loop
+  rewriter.setInsertionPointAfter(colLoop);
+}
+
+// Looks up kk in the workspace.
+// Returns:
+// 1. whether kk is in the fixed row
+// 2. the position of its value, to be passed to loadRowWorkspaceValue
+static std::pair<Value, Value>
+lookupRowWorkspace(PatternRewriter &rewriter, Location loc,
+                   const RowWorkspace &workspace, Value useHash, Value tag,
+                   Value kk, Value kk64) {
+  if (workspace.bitmap)
+    return std::make_pair(
+        loadBitmapBit(rewriter, loc, workspace.bitmap, kk, false), kk);
+
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type boolType = rewriter.getI1Type();
+
+  scf::IfOp ifBlock_useHash;
+  if (useHash) {
+    ifBlock_useHash = rewriter.create<scf::IfOp>(
+        loc, TypeRange{boolType, indexType}, useHash, true);
+    // if useHash
+    rewriter.setInsertionPointToStart(ifBlock_useHash.thenBlock());
+    Value slot = probeRowWorkspaceHash(rewriter, loc, workspace, tag, kk64);
+    Value slotTag =
+        rewriter.create<memref::LoadOp>(loc, workspace.hashTags, slot);
+    Value cmpFound = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, slotTag, tag);
+    rewriter.create<scf::YieldOp>(loc, ValueRange{cmpFound, slot});
+    // else
+    rewriter.setInsertionPointToStart(ifBlock_useHash.elseBlock());
+  }
+  Value kkTag = rewriter.create<memref::LoadOp>(loc, workspace.marker, kk);
+  Value cmpFound = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, kkTag, tag);
+  if (!useHash)
+    return std::make_pair(cmpFound, kk);
+  rewriter.create<scf::YieldOp>(loc, ValueRange{cmpFound, kk});
+  // end if useHash
+  rewriter.setInsertionPointAfter(ifBlock_useHash);
+
+  return std::make_pair(ifBlock_useHash.getResult(0),
+                        ifBlock_useHash.getResult(1));
+}
+
+static Value loadRowWorkspaceValue(PatternRewriter &rewriter, Location loc,
+                                   const RowWorkspace &workspace,
+                                   Value useHash, Value pos, Type valueType) {
+  if (workspace.bitmap)
+    return rewriter.create<memref::LoadOp>(loc, workspace.bitmap, pos);
+  if (!useHash)
+    return rewriter.create<memref::LoadOp>(loc, workspace.values, pos);
+
+  scf::IfOp ifBlock_useHash =
+      rewriter.create<scf::IfOp>(loc, valueType, useHash, true);
+  // if useHash
+  rewriter.setInsertionPointToStart(ifBlock_useHash.thenBlock());
+  Value val = rewriter.create<memref::LoadOp>(loc, workspace.hashValues, pos);
+  rewriter.create<scf::YieldOp>(loc, val);
+  // else
+  rewriter.setInsertionPointToStart(ifBlock_useHash.elseBlock());
+  val = rewriter.create<memref::LoadOp>(loc, workspace.values, pos);
+  rewriter.create<scf::YieldOp>(loc, val);
+  // end if useHash
+  rewriter.setInsertionPointAfter(ifBlock_useHash);
+
+  return ifBlock_useHash.getResult(0);
+}
+
+// Adds `value` into the enclosing scf.parallel reduction
+static void buildSumReduce(PatternRewriter &rewriter, Location loc,
+                           Value value) {
+  scf::ReduceOp reducer = rewriter.create<scf::ReduceOp>(loc, value);
+  Value lhs = reducer.getRegion().getArgument(0);
+  Value rhs = reducer.getRegion().getArgument(1);
+  rewriter.setInsertionPointToStart(&reducer.getRegion().front());
+  Value z = rewriter.create<arith::AddIOp>(loc, lhs, rhs);
+  rewriter.create<scf::ReduceReturnOp>(loc, z);
+  rewriter.setInsertionPointAfter(reducer);
+}
+
 Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
-                         Value fixedIndices, Value fixedIndexStart,
-                         Value fixedIndexEnd, Value iterPointers,
-                         Value iterIndices,
+                         Value fixedRowIndex, Value fixedIndices,
+                         Value fixedIndexStart, Value fixedIndexEnd,
+                         Value iterPointers, Value iterIndices,
                          // If no mask is used, set maskIndices to nullptr, and
                          // provide maskStart=c0 and maskEnd=len(iterPointers)-1
                          Value maskIndices, Value maskStart, Value maskEnd,
-                         Type valueType) {
+                         Type valueType, const RowWorkspace *workspace,
+                         Value complementSize, Value maskBitmap) {
   // Types used in this function
   Type indexType = rewriter.getIndexType();
   Type int64Type = rewriter.getIntegerType(64);
   Type boolType = rewriter.getI1Type();
-  MemRefType memref1DBoolType = MemRefType::get({-1}, boolType);
 
   // Initial constants
   Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
@@ -372,24 +918,43 @@ Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
   Value ctrue = rewriter.create<arith::ConstantIntOp>(loc, 1, boolType);
   Value cfalse = rewriter.create<arith::ConstantIntOp>(loc, 0, boolType);
 
-  // Construct a dense array indicating valid kk positions within fixed index
-  Value kvec_i1 = rewriter.create<memref::AllocOp>(loc, memref1DBoolType, nk);
-  rewriter.create<linalg::FillOp>(loc, cfalse, kvec_i1);
-  scf::ParallelOp colLoop1 =
-      rewriter.create<scf::ParallelOp>(loc, fixedIndexStart, fixedIndexEnd, c1);
-  Value jj = colLoop1.getInductionVars()[0];
-  rewriter.setInsertionPointToStart(colLoop1.getBody());
-  Value col64 = rewriter.create<memref::LoadOp>(loc, fixedIndices, jj);
-  Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
-  rewriter.create<memref::StoreOp>(loc, ctrue, kvec_i1, col);
-  rewriter.setInsertionPointAfter(colLoop1);
+  // Without a caller-provided workspace, use a single-use one
+  RowWorkspace localWorkspace;
+  if (!workspace) {
+    localWorkspace = allocRowWorkspace(rewriter, loc, nk, nullptr, false);
+    workspace = &localWorkspace;
+  }
+
+  // Mark valid kk positions within fixed index
+  Value tag =
+      rewriter.create<arith::IndexCastOp>(loc, fixedRowIndex, int64Type);
+  Value useHash = useRowWorkspaceHash(rewriter, loc, *workspace, nk,
+                                      fixedIndexStart, fixedIndexEnd);
+  fillRowWorkspace(rewriter, loc, *workspace, useHash, tag, fixedIndices,
+                   nullptr, fixedIndexStart, fixedIndexEnd);
+
   // Loop thru all columns; count number of resulting nonzeros in the row
-  if (maskIndices != nullptr) {
+  scf::ParallelOp gapLoop, colLoop1;
+  Value col;
+  if (complementSize && !maskBitmap) {
+    // Loop thru the gaps of the complemented mask, then thru their columns
+    Value maskEndPlus1 = rewriter.create<arith::AddIOp>(loc, maskEnd, c1);
+    gapLoop =
+        rewriter.create<scf::ParallelOp>(loc, maskStart, maskEndPlus1, c1, ci0);
+    rewriter.setInsertionPointToStart(gapLoop.getBody());
+    Value gapStart, gapEnd;
+    computeMaskGapBounds(rewriter, loc, complementSize, maskIndices, maskStart,
+                         maskEnd, gapLoop.getInductionVars()[0], gapStart,
+                         gapEnd);
+    colLoop1 = rewriter.create<scf::ParallelOp>(loc, gapStart, gapEnd, c1, ci0);
+    col = colLoop1.getInductionVars()[0];
+    rewriter.setInsertionPointToStart(colLoop1.getBody());
+  } else if (maskIndices != nullptr) {
     colLoop1 =
         rewriter.create<scf::ParallelOp>(loc, maskStart, maskEnd, c1, ci0);
     Value mm = colLoop1.getInductionVars()[0];
     rewriter.setInsertionPointToStart(colLoop1.getBody());
-    col64 = rewriter.create<memref::LoadOp>(loc, maskIndices, mm);
+    Value col64 = loadI64(rewriter, loc, maskIndices, mm);
     col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
   } else {
     colLoop1 =
@@ -398,11 +963,18 @@ Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
     rewriter.setInsertionPointToStart(colLoop1.getBody());
   }
   Value colPlus1 = rewriter.create<arith::AddIOp>(loc, col, c1);
-  Value rowStart64 = rewriter.create<memref::LoadOp>(loc, iterPointers, col);
-  Value rowEnd64 = rewriter.create<memref::LoadOp>(loc, iterPointers, colPlus1);
+  Value rowStart64 = loadI64(rewriter, loc, iterPointers, col);
+  Value rowEnd64 = loadI64(rewriter, loc, iterPointers, colPlus1);
   Value cmpRowSame = rewriter.create<arith::CmpIOp>(
       loc, arith::CmpIPredicate::eq, rowStart64, rowEnd64);
-  // Find overlap in column indices with kvec
+  if (maskBitmap) {
+    // Columns outside of the bitmap mask have nothing to count
+    Value keep = loadBitmapBit(rewriter, loc, maskBitmap, col,
+                               complementSize != nullptr);
+    Value skip = rewriter.create<arith::XOrIOp>(loc, keep, ctrue);
+    cmpRowSame = rewriter.create<arith::OrIOp>(loc, cmpRowSame, skip);
+  }
+  // Find overlap in column indices with the workspace
   scf::IfOp ifBlock_overlap =
       rewriter.create<scf::IfOp>(loc, int64Type, cmpRowSame, true);
   // if cmpRowSame
@@ -427,11 +999,13 @@ Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
   rewriter.create<scf::YieldOp>(loc, ValueRange{cfalse, ci0});
   // else
   rewriter.setInsertionPointToStart(ifBlock_continueSearch.elseBlock());
-  // Check if row has a match in kvec
+  // Check if row has a match in the workspace
   Value ii = rewriter.create<arith::IndexCastOp>(loc, ii64, indexType);
-  Value kk64 = rewriter.create<memref::LoadOp>(loc, iterIndices, ii);
+  Value kk64 = loadI64(rewriter, loc, iterIndices, ii);
   Value kk = rewriter.create<arith::IndexCastOp>(loc, kk64, indexType);
-  Value cmpPair = rewriter.create<memref::LoadOp>(loc, kvec_i1, kk);
+  Value cmpPair =
+      lookupRowWorkspace(rewriter, loc, *workspace, useHash, tag, kk, kk64)
+          .first;
   Value cmpResult0 = rewriter.create<SelectOp>(loc, cmpPair, cfalse, ctrue);
   Value cmpResult1 = rewriter.create<SelectOp>(loc, cmpPair, ci1, ii64);
   rewriter.create<scf::YieldOp>(loc, ValueRange{cmpResult0, cmpResult1});
@@ -451,16 +1025,18 @@ Value computeNumOverlaps(PatternRewriter &rewriter, Location loc, Value nk,
   // end if cmpRowSame
   rewriter.setInsertionPointAfter(ifBlock_overlap);
   Value overlap = ifBlock_overlap.getResult(0);
-  scf::ReduceOp reducer = rewriter.create<scf::ReduceOp>(loc, overlap);
-  Value lhs = reducer.getRegion().getArgument(0);
-  Value rhs = reducer.getRegion().getArgument(1);
-  rewriter.setInsertionPointToStart(&reducer.getRegion().front());
-  Value z = rewriter.create<arith::AddIOp>(loc, lhs, rhs);
-  rewriter.create<scf::ReduceReturnOp>(loc, z);
+  buildSumReduce(rewriter, loc, overlap);
   // end col loop
   rewriter.setInsertionPointAfter(colLoop1);
   Value total = colLoop1.getResult(0);
-  rewriter.create<memref::DeallocOp>(loc, kvec_i1);
+  if (gapLoop) {
+    buildSumReduce(rewriter, loc, total);
+    // end gap loop
+    rewriter.setInsertionPointAfter(gapLoop);
+    total = gapLoop.getResult(0);
+  }
+  if (workspace == &localWorkspace)
+    deallocRowWorkspace(rewriter, loc, localWorkspace);
   return total;
 }
 
@@ -474,13 +1050,13 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
                          Value maskIndices, Value maskStart, Value maskEnd,
                          Type valueType, ExtensionBlocks extBlocks,
                          Value outputIndices, Value outputValues,
-                         Value indexOffset, bool swapMultOps) {
+                         Value indexOffset, bool swapMultOps,
+                         const RowWorkspace *workspace, Value complementSize,
+                         Value maskBitmap) {
   // Types used in this function
   Type indexType = rewriter.getIndexType();
   Type int64Type = rewriter.getIntegerType(64);
   Type boolType = rewriter.getI1Type();
-  MemRefType memref1DBoolType = MemRefType::get({-1}, boolType);
-  MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
   // Initial constants
   Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
@@ -488,30 +1064,43 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
   Value ctrue = rewriter.create<arith::ConstantIntOp>(loc, 1, boolType);
   Value cfalse = rewriter.create<arith::ConstantIntOp>(loc, 0, boolType);
 
-  // Construct a dense array of row values
-  Value kvec = rewriter.create<memref::AllocOp>(loc, memref1DValueType, nk);
-  Value kvec_i1 = rewriter.create<memref::AllocOp>(loc, memref1DBoolType, nk);
-  rewriter.create<linalg::FillOp>(loc, cfalse, kvec_i1);
-  scf::ParallelOp colLoop3p =
-      rewriter.create<scf::ParallelOp>(loc, fixedIndexStart, fixedIndexEnd, c1);
-  Value jj = colLoop3p.getInductionVars()[0];
-  rewriter.setInsertionPointToStart(colLoop3p.getBody());
-  Value fixedJ64 = rewriter.create<memref::LoadOp>(loc, fixedIndices, jj);
-  Value fixedJ = rewriter.create<arith::IndexCastOp>(loc, fixedJ64, indexType);
-  rewriter.create<memref::StoreOp>(loc, ctrue, kvec_i1, fixedJ);
-  Value val = rewriter.create<memref::LoadOp>(loc, fixedValues, jj);
-  rewriter.create<memref::StoreOp>(loc, val, kvec, fixedJ);
-
-  // end col loop 3p
-  rewriter.setInsertionPointAfter(colLoop3p);
+  // Without a caller-provided workspace, use a single-use one
+  RowWorkspace localWorkspace;
+  if (!workspace) {
+    localWorkspace = allocRowWorkspace(rewriter, loc, nk, valueType, false);
+    workspace = &localWorkspace;
+  }
+
+  // Store the fixed row in the workspace
+  Value tag =
+      rewriter.create<arith::IndexCastOp>(loc, fixedRowIndex, int64Type);
+  Value useHash = useRowWorkspaceHash(rewriter, loc, *workspace, nk,
+                                      fixedIndexStart, fixedIndexEnd);
+  fillRowWorkspace(rewriter, loc, *workspace, useHash, tag, fixedIndices,
+                   fixedValues, fixedIndexStart, fixedIndexEnd);
 
   Value col64, col;
-  scf::ForOp colLoop3f;
-  if (maskIndices != nullptr) {
+  scf::ForOp gapLoop, colLoop3f;
+  if (complementSize && !maskBitmap) {
+    // Loop thru the gaps of the complemented mask, then thru their columns
+    Value maskEndPlus1 = rewriter.create<arith::AddIOp>(loc, maskEnd, c1);
+    gapLoop =
+        rewriter.create<scf::ForOp>(loc, maskStart, maskEndPlus1, c1, c0);
+    rewriter.setInsertionPointToStart(gapLoop.getBody());
+    Value gapStart, gapEnd;
+    computeMaskGapBounds(rewriter, loc, complementSize, maskIndices, maskStart,
+                         maskEnd, gapLoop.getInductionVar(), gapStart, gapEnd);
+    Value gapOffset = gapLoop.getLoopBody().getArgument(1);
+    colLoop3f =
+        rewriter.create<scf::ForOp>(loc, gapStart, gapEnd, c1, gapOffset);
+    col = colLoop3f.getInductionVar();
+    rewriter.setInsertionPointToStart(colLoop3f.getBody());
+    col64 = rewriter.create<arith::IndexCastOp>(loc, col, int64Type);
+  } else if (maskIndices != nullptr) {
     colLoop3f = rewriter.create<scf::ForOp>(loc, maskStart, maskEnd, c1, c0);
     Value mm = colLoop3f.getInductionVar();
     rewriter.setInsertionPointToStart(colLoop3f.getBody());
-    col64 = rewriter.create<memref::LoadOp>(loc, maskIndices, mm);
+    col64 = loadI64(rewriter, loc, maskIndices, mm);
     col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
   } else {
     colLoop3f = rewriter.create<scf::ForOp>(loc, maskStart, maskEnd, c1, c0);
@@ -522,10 +1111,16 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
 
   Value offset = colLoop3f.getLoopBody().getArgument(1);
   Value colPlus1 = rewriter.create<arith::AddIOp>(loc, col, c1);
-  Value iStart64 = rewriter.create<memref::LoadOp>(loc, iterPointers, col);
-  Value iEnd64 = rewriter.create<memref::LoadOp>(loc, iterPointers, colPlus1);
+  Value iStart64 = loadI64(rewriter, loc, iterPointers, col);
+  Value iEnd64 = loadI64(rewriter, loc, iterPointers, colPlus1);
   Value iStart = rewriter.create<arith::IndexCastOp>(loc, iStart64, indexType);
   Value iEnd = rewriter.create<arith::IndexCastOp>(loc, iEnd64, indexType);
+  if (maskBitmap) {
+    // Columns outside of the bitmap mask get an empty iter range
+    Value keep = loadBitmapBit(rewriter, loc, maskBitmap, col,
+                               complementSize != nullptr);
+    iEnd = rewriter.create<SelectOp>(loc, keep, iEnd, iStart);
+  }
 
   // insert add identity block
   rewriter.mergeBlocks(extBlocks.addIdentity, rewriter.getBlock(), {});
@@ -535,22 +1130,60 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
   Value addIdentity = addIdentityYield.values().front();
   rewriter.eraseOp(addIdentityYield);
 
-  scf::ForOp kLoop = rewriter.create<scf::ForOp>(
-      loc, iStart, iEnd, c1, ValueRange{addIdentity, cfalse});
-  Value ii = kLoop.getInductionVar();
-  Value curr = kLoop.getLoopBody().getArgument(1);
-  Value alive = kLoop.getLoopBody().getArgument(2);
-  rewriter.setInsertionPointToStart(kLoop.getBody());
+  // With the "any" monoid, the search over the iter row stops at the first
+  // overlap. It runs backwards so that it finds the same overlap as the full
+  // scan, whose "any" keeps the last one.
+  bool earlyExit = isAnyMonoidBlock(extBlocks.add);
+  scf::ForOp kLoop;
+  scf::WhileOp kWhileLoop;
+  Value ii, curr, alive;
+  if (earlyExit) {
+    kWhileLoop = rewriter.create<scf::WhileOp>(
+        loc, TypeRange{indexType, valueType, boolType},
+        ValueRange{iEnd, addIdentity, cfalse});
+    Block *before =
+        rewriter.createBlock(&kWhileLoop.getBefore(), {},
+                             TypeRange{indexType, valueType, boolType});
+    Block *after =
+        rewriter.createBlock(&kWhileLoop.getAfter(), {},
+                             TypeRange{indexType, valueType, boolType});
+    // "while" portion of the loop
+    rewriter.setInsertionPointToStart(before);
+    Value cmpStartReached = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ugt, before->getArgument(0), iStart);
+    Value notFound =
+        rewriter.create<arith::XOrIOp>(loc, before->getArgument(2), ctrue);
+    Value continueSearch =
+        rewriter.create<arith::AndIOp>(loc, cmpStartReached, notFound);
+    rewriter.create<scf::ConditionOp>(loc, continueSearch,
+                                      before->getArguments());
+    // "do" portion of the loop
+    rewriter.setInsertionPointToStart(after);
+    ii = rewriter.create<arith::SubIOp>(loc, after->getArgument(0), c1);
+    curr = after->getArgument(1);
+    alive = after->getArgument(2);
+  } else {
+    kLoop = rewriter.create<scf::ForOp>(loc, iStart, iEnd, c1,
+                                        ValueRange{addIdentity, cfalse});
+    ii = kLoop.getInductionVar();
+    curr = kLoop.getLoopBody().getArgument(1);
+    alive = kLoop.getLoopBody().getArgument(2);
+    rewriter.setInsertionPointToStart(kLoop.getBody());
+  }
 
-  Value kk64 = rewriter.create<memref::LoadOp>(loc, iterIndices, ii);
+  Value kk64 = loadI64(rewriter, loc, iterIndices, ii);
   Value kk = rewriter.create<arith::IndexCastOp>(loc, kk64, indexType);
-  Value cmpPair = rewriter.create<memref::LoadOp>(loc, kvec_i1, kk);
+  std::pair<Value, Value> lookup =
+      lookupRowWorkspace(rewriter, loc, *workspace, useHash, tag, kk, kk64);
+  Value cmpPair = lookup.first;
+  Value kkPos = lookup.second;
   scf::IfOp ifBlock_cmpPair = rewriter.create<scf::IfOp>(
       loc, TypeRange{valueType, boolType}, cmpPair, true);
   // if cmpPair
   rewriter.setInsertionPointToStart(ifBlock_cmpPair.thenBlock());
 
-  Value aVal = rewriter.create<memref::LoadOp>(loc, kvec, kk);
+  Value aVal = loadRowWorkspaceValue(rewriter, loc, *workspace, useHash, kkPos,
+                                     valueType);
   Value bVal = rewriter.create<memref::LoadOp>(loc, iterValues, ii);
 
   // insert multiply operation block
@@ -586,13 +1219,22 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
   rewriter.setInsertionPointAfter(ifBlock_cmpPair);
   Value newCurr = ifBlock_cmpPair.getResult(0);
   Value newAlive = ifBlock_cmpPair.getResult(1);
-  rewriter.create<scf::YieldOp>(loc, ValueRange{newCurr, newAlive});
-
-  // end k loop
-  rewriter.setInsertionPointAfter(kLoop);
+  Value total, notEmpty;
+  if (earlyExit) {
+    rewriter.create<scf::YieldOp>(loc, ValueRange{ii, newCurr, newAlive});
+
+    // end k loop
+    rewriter.setInsertionPointAfter(kWhileLoop);
+    total = kWhileLoop.getResult(1);
+    notEmpty = kWhileLoop.getResult(2);
+  } else {
+    rewriter.create<scf::YieldOp>(loc, ValueRange{newCurr, newAlive});
 
-  Value total = kLoop.getResult(0);
-  Value notEmpty = kLoop.getResult(1);
+    // end k loop
+    rewriter.setInsertionPointAfter(kLoop);
+    total = kLoop.getResult(0);
+    notEmpty = kLoop.getResult(1);
+  }
 
   scf::IfOp ifBlock_newOffset =
       rewriter.create<scf::IfOp>(loc, indexType, notEmpty, true);
@@ -601,7 +1243,7 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
 
   // Store total in Cx
   Value cjPos = rewriter.create<arith::AddIOp>(loc, indexOffset, offset);
-  rewriter.create<memref::StoreOp>(loc, col64, outputIndices, cjPos);
+  storeI64(rewriter, loc, col64, outputIndices, cjPos);
 
   // Does total need to be transformed?
   if (extBlocks.transformOut) {
@@ -633,8 +1275,371 @@ void computeInnerProduct(PatternRewriter &rewriter, Location loc, Value nk,
 
   // end col loop 3f
   rewriter.setInsertionPointAfter(colLoop3f);
-  rewriter.create<memref::DeallocOp>(loc, kvec);
-  rewriter.create<memref::DeallocOp>(loc, kvec_i1);
+  if (gapLoop) {
+    rewriter.create<scf::YieldOp>(loc, colLoop3f.getResult(0));
+    // end gap loop
+    rewriter.setInsertionPointAfter(gapLoop);
+  }
+  if (workspace == &localWorkspace)
+    deallocRowWorkspace(rewriter, loc, localWorkspace);
+}
+
+// Sorts indices[start:end] in place using insertion sort
+void sortIndices(PatternRewriter &rewriter, Location loc, Value indices,
+                 Value start, Value end) {
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type boolType = rewriter.getI1Type();
+
+  // Initial constants
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value cfalse = rewriter.create<arith::ConstantIntOp>(loc, 0, boolType);
+
+  Value startPlus1 = rewriter.create<arith::AddIOp>(loc, start, c1);
+  scf::ForOp sortLoop = rewriter.create<scf::ForOp>(loc, startPlus1, end, c1);
+  Value ii = sortLoop.getInductionVar();
+  rewriter.setInsertionPointToStart(sortLoop.getBody());
+  Value key = loadI64(rewriter, loc, indices, ii);
+
+  // Shift larger entries one position to the right
+  scf::WhileOp whileLoop = rewriter.create<scf::WhileOp>(loc, indexType, ii);
+  Block *before = rewriter.createBlock(&whileLoop.getBefore(), {}, indexType);
+  Block *after = rewriter.createBlock(&whileLoop.getAfter(), {}, indexType);
+  Value jj = before->getArgument(0);
+  rewriter.setInsertionPointToStart(&whileLoop.getBefore().front());
+  Value cmpStartReached = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ule, jj, start);
+  scf::IfOp ifBlock_continueShift =
+      rewriter.create<scf::IfOp>(loc, boolType, cmpStartReached, true);
+  // if cmpStartReached
+  rewriter.setInsertionPointToStart(ifBlock_continueShift.thenBlock());
+  rewriter.create<scf::YieldOp>(loc, cfalse);
+  // else
+  rewriter.setInsertionPointToStart(ifBlock_continueShift.elseBlock());
+  Value jjMinus1 = rewriter.create<arith::SubIOp>(loc, jj, c1);
+  Value prev = loadI64(rewriter, loc, indices, jjMinus1);
+  Value cmpPrev = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ugt, prev, key);
+  rewriter.create<scf::YieldOp>(loc, cmpPrev);
+  // end if cmpStartReached
+  rewriter.setInsertionPointAfter(ifBlock_continueShift);
+  Value continueShift = ifBlock_continueShift.getResult(0);
+  rewriter.create<scf::ConditionOp>(loc, continueShift, jj);
+  // "do" portion of while loop
+  rewriter.setInsertionPointToStart(&whileLoop.getAfter().front());
+  Value jjCurr = after->getArgument(0);
+  Value jjPrev = rewriter.create<arith::SubIOp>(loc, jjCurr, c1);
+  Value shifted = loadI64(rewriter, loc, indices, jjPrev);
+  storeI64(rewriter, loc, shifted, indices, jjCurr);
+  rewriter.create<scf::YieldOp>(loc, jjPrev);
+  rewriter.setInsertionPointAfter(whileLoop);
+
+  Value dest = whileLoop.getResult(0);
+  storeI64(rewriter, loc, key, indices, dest);
+
+  // end sort loop
+  rewriter.setInsertionPointAfter(sortLoop);
+}
+
+// The saxpy functions below compute a single row of a matrix-matrix product
+// using Gustavson's algorithm: the output row is the union of the rows of the
+// iter matrix selected by the indices of the fixed row.
+//
+// `marker` has one entry per output column and records which row last touched
+// the column. Rows within a block must be processed in increasing order, which
+// means the marker only needs to be filled with -1 once per block rather than
+// once per row. While computing row r, a marker of 2r indicates a column
+// excluded by the complemented mask and 2r+1 indicates a column which is
+// already part of the output row.
+static void markMaskedColumns(PatternRewriter &rewriter, Location loc,
+                              Value marker, Value maskIndices, Value maskStart,
+                              Value maskEnd, Value maskedStamp) {
+  Type indexType = rewriter.getIndexType();
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  scf::ForOp maskLoop =
+      rewriter.create<scf::ForOp>(loc, maskStart, maskEnd, c1);
+  Value mm = maskLoop.getInductionVar();
+  rewriter.setInsertionPointToStart(maskLoop.getBody());
+  Value col64 = loadI64(rewriter, loc, maskIndices, mm);
+  Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
+  rewriter.create<memref::StoreOp>(loc, maskedStamp, marker, col);
+  rewriter.setInsertionPointAfter(maskLoop);
+}
+
+Value computeSaxpyRowSize(PatternRewriter &rewriter, Location loc,
+                          Value fixedRowIndex, Value fixedIndices,
+                          Value fixedIndexStart, Value fixedIndexEnd,
+                          Value iterPointers, Value iterIndices, Value marker,
+                          // If no mask is used, set maskIndices to nullptr
+                          // The mask is always treated as complemented
+                          Value maskIndices, Value maskStart, Value maskEnd) {
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+
+  // Initial constants
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
+  Value ci1 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
+  Value ci2 = rewriter.create<arith::ConstantIntOp>(loc, 2, int64Type);
+
+  Value row64 =
+      rewriter.create<arith::IndexCastOp>(loc, fixedRowIndex, int64Type);
+  Value maskedStamp = rewriter.create<arith::MulIOp>(loc, row64, ci2);
+  Value activeStamp = rewriter.create<arith::AddIOp>(loc, maskedStamp, ci1);
+
+  if (maskIndices != nullptr)
+    markMaskedColumns(rewriter, loc, marker, maskIndices, maskStart, maskEnd,
+                      maskedStamp);
+
+  scf::ForOp kLoop = rewriter.create<scf::ForOp>(loc, fixedIndexStart,
+                                                 fixedIndexEnd, c1, ci0);
+  Value jj = kLoop.getInductionVar();
+  Value kTotal = kLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(kLoop.getBody());
+
+  Value kk64 = loadI64(rewriter, loc, fixedIndices, jj);
+  Value kk = rewriter.create<arith::IndexCastOp>(loc, kk64, indexType);
+  Value kkPlus1 = rewriter.create<arith::AddIOp>(loc, kk, c1);
+  Value iStart64 = loadI64(rewriter, loc, iterPointers, kk);
+  Value iEnd64 = loadI64(rewriter, loc, iterPointers, kkPlus1);
+  Value iStart = rewriter.create<arith::IndexCastOp>(loc, iStart64, indexType);
+  Value iEnd = rewriter.create<arith::IndexCastOp>(loc, iEnd64, indexType);
+
+  scf::ForOp colLoop =
+      rewriter.create<scf::ForOp>(loc, iStart, iEnd, c1, kTotal);
+  Value ii = colLoop.getInductionVar();
+  Value colTotal = colLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(colLoop.getBody());
+
+  Value col64 = loadI64(rewriter, loc, iterIndices, ii);
+  Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
+  Value stamp = rewriter.create<memref::LoadOp>(loc, marker, col);
+  Value isNew = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::slt,
+                                               stamp, maskedStamp);
+  Value newStamp = rewriter.create<SelectOp>(loc, isNew, activeStamp, stamp);
+  rewriter.create<memref::StoreOp>(loc, newStamp, marker, col);
+  Value colTotalPlus1 = rewriter.create<arith::AddIOp>(loc, colTotal, ci1);
+  Value newColTotal =
+      rewriter.create<SelectOp>(loc, isNew, colTotalPlus1, colTotal);
+  rewriter.create<scf::YieldOp>(loc, newColTotal);
+
+  // end col loop
+  rewriter.setInsertionPointAfter(colLoop);
+  rewriter.create<scf::YieldOp>(loc, colLoop.getResult(0));
+
+  // end k loop
+  rewriter.setInsertionPointAfter(kLoop);
+  return kLoop.getResult(0);
+}
+
+void computeSaxpyRow(PatternRewriter &rewriter, Location loc, Value ncol,
+                     Value fixedRowIndex, Value fixedIndices, Value fixedValues,
+                     Value fixedIndexStart, Value fixedIndexEnd,
+                     Value iterPointers, Value iterIndices, Value iterValues,
+                     Value marker, Value workspace,
+                     // If no mask is used, set maskIndices to nullptr
+                     // The mask is always treated as complemented
+                     Value maskIndices, Value maskStart, Value maskEnd,
+                     Type valueType, ExtensionBlocks extBlocks,
+                     Value outputIndices, Value outputValues,
+                     Value outputStart, Value outputEnd) {
+  // Types used in this function
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value ci1 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
+  Value ci2 = rewriter.create<arith::ConstantIntOp>(loc, 2, int64Type);
+
+  Value row64 =
+      rewriter.create<arith::IndexCastOp>(loc, fixedRowIndex, int64Type);
+  Value maskedStamp = rewriter.create<arith::MulIOp>(loc, row64, ci2);
+  Value activeStamp = rewriter.create<arith::AddIOp>(loc, maskedStamp, ci1);
+
+  if (maskIndices != nullptr)
+    markMaskedColumns(rewriter, loc, marker, maskIndices, maskStart, maskEnd,
+                      maskedStamp);
+
+  // 1st pass
+  //   Scatter the products into the dense workspace.
+  //   Newly touched columns are appended, unordered, to outputIndices
+  scf::ForOp kLoop = rewriter.create<scf::ForOp>(
+      loc, fixedIndexStart, fixedIndexEnd, c1, outputStart);
+  Value jj = kLoop.getInductionVar();
+  Value kPos = kLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(kLoop.getBody());
+
+  // insert add identity block
+  rewriter.mergeBlocks(extBlocks.addIdentity, rewriter.getBlock(), {});
+  graphblas::YieldOp addIdentityYield =
+      llvm::dyn_cast_or_null<graphblas::YieldOp>(
+          rewriter.getBlock()->getTerminator());
+  Value addIdentity = addIdentityYield.values().front();
+  rewriter.eraseOp(addIdentityYield);
+
+  Value kk64 = loadI64(rewriter, loc, fixedIndices, jj);
+  Value kk = rewriter.create<arith::IndexCastOp>(loc, kk64, indexType);
+  Value kkPlus1 = rewriter.create<arith::AddIOp>(loc, kk, c1);
+  Value aVal = rewriter.create<memref::LoadOp>(loc, fixedValues, jj);
+  Value iStart64 = loadI64(rewriter, loc, iterPointers, kk);
+  Value iEnd64 = loadI64(rewriter, loc, iterPointers, kkPlus1);
+  Value iStart = rewriter.create<arith::IndexCastOp>(loc, iStart64, indexType);
+  Value iEnd = rewriter.create<arith::IndexCastOp>(loc, iEnd64, indexType);
+
+  scf::ForOp colLoop = rewriter.create<scf::ForOp>(loc, iStart, iEnd, c1, kPos);
+  Value ii = colLoop.getInductionVar();
+  Value pos = colLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(colLoop.getBody());
+
+  Value col64 = loadI64(rewriter, loc, iterIndices, ii);
+  Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
+  Value stamp = rewriter.create<memref::LoadOp>(loc, marker, col);
+
+  scf::IfOp ifBlock_masked;
+  if (maskIndices != nullptr) {
+    Value isMasked = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, stamp, maskedStamp);
+    ifBlock_masked = rewriter.create<scf::IfOp>(loc, indexType, isMasked, true);
+    // if isMasked
+    rewriter.setInsertionPointToStart(ifBlock_masked.thenBlock());
+    rewriter.create<scf::YieldOp>(loc, pos);
+    // else
+    rewriter.setInsertionPointToStart(ifBlock_masked.elseBlock());
+  }
+
+  Value bVal = rewriter.create<memref::LoadOp>(loc, iterValues, ii);
+
+  // insert multiply operation block
+  Value injectVals[] = {aVal, bVal, fixedRowIndex, col, kk};
+  rewriter.mergeBlocks(
+      extBlocks.mult, rewriter.getBlock(),
+      ValueRange(injectVals).slice(0, extBlocks.mult->getArguments().size()));
+  // NOTE: Need to do this after merge, in case the yield is one of the block
+  // arguments, as is the case with "first" and "second" binops
+  graphblas::YieldOp multYield = llvm::dyn_cast_or_null<graphblas::YieldOp>(
+      rewriter.getBlock()->getTerminator());
+  Value multResult = multYield.values().front();
+  rewriter.eraseOp(multYield);
+
+  Value isNew = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::slt,
+                                               stamp, maskedStamp);
+  scf::IfOp ifBlock_isNew = rewriter.create<scf::IfOp>(
+      loc, TypeRange{valueType, indexType}, isNew, true);
+  // if isNew
+  rewriter.setInsertionPointToStart(ifBlock_isNew.thenBlock());
+  rewriter.create<memref::StoreOp>(loc, activeStamp, marker, col);
+  storeI64(rewriter, loc, col64, outputIndices, pos);
+  Value posPlus1 = rewriter.create<arith::AddIOp>(loc, pos, c1);
+  rewriter.create<scf::YieldOp>(loc, ValueRange{addIdentity, posPlus1});
+  // else
+  rewriter.setInsertionPointToStart(ifBlock_isNew.elseBlock());
+  Value prevVal = rewriter.create<memref::LoadOp>(loc, workspace, col);
+  rewriter.create<scf::YieldOp>(loc, ValueRange{prevVal, pos});
+  // end if isNew
+  rewriter.setInsertionPointAfter(ifBlock_isNew);
+  Value curr = ifBlock_isNew.getResult(0);
+  Value newPos = ifBlock_isNew.getResult(1);
+
+  // insert add operation block
+  rewriter.mergeBlocks(extBlocks.add, rewriter.getBlock(), {curr, multResult});
+  graphblas::YieldOp addYield = llvm::dyn_cast_or_null<graphblas::YieldOp>(
+      rewriter.getBlock()->getTerminator());
+  Value addResult = addYield.values().front();
+  rewriter.eraseOp(addYield);
+
+  rewriter.create<memref::StoreOp>(loc, addResult, workspace, col);
+
+  if (maskIndices != nullptr) {
+    rewriter.create<scf::YieldOp>(loc, newPos);
+    // end if isMasked
+    rewriter.setInsertionPointAfter(ifBlock_masked);
+    newPos = ifBlock_masked.getResult(0);
+  }
+  rewriter.create<scf::YieldOp>(loc, newPos);
+
+  // end col loop
+  rewriter.setInsertionPointAfter(colLoop);
+  rewriter.create<scf::YieldOp>(loc, colLoop.getResult(0));
+
+  // end k loop
+  rewriter.setInsertionPointAfter(kLoop);
+
+  // 2nd pass
+  //   Order the output indices.
+  //   Short rows are sorted in place. Once sorting would cost more than
+  //   scanning the whole marker, the active columns are collected in order
+  //   from the marker instead.
+  Value rowSize = rewriter.create<arith::SubIOp>(loc, outputEnd, outputStart);
+  Value rowSizeSq = rewriter.create<arith::MulIOp>(loc, rowSize, rowSize);
+  Value cmpScan = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ugt, rowSizeSq, ncol);
+  scf::IfOp ifBlock_scan = rewriter.create<scf::IfOp>(loc, cmpScan, true);
+  // if cmpScan
+  rewriter.setInsertionPointToStart(ifBlock_scan.thenBlock());
+  scf::ForOp scanLoop =
+      rewriter.create<scf::ForOp>(loc, c0, ncol, c1, outputStart);
+  Value scanCol = scanLoop.getInductionVar();
+  Value scanPos = scanLoop.getLoopBody().getArgument(1);
+  rewriter.setInsertionPointToStart(scanLoop.getBody());
+  Value scanStamp = rewriter.create<memref::LoadOp>(loc, marker, scanCol);
+  Value isActive = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::eq, scanStamp, activeStamp);
+  scf::IfOp ifBlock_isActive =
+      rewriter.create<scf::IfOp>(loc, indexType, isActive, true);
+  // if isActive
+  rewriter.setInsertionPointToStart(ifBlock_isActive.thenBlock());
+  Value scanCol64 =
+      rewriter.create<arith::IndexCastOp>(loc, scanCol, int64Type);
+  storeI64(rewriter, loc, scanCol64, outputIndices, scanPos);
+  Value scanPosPlus1 = rewriter.create<arith::AddIOp>(loc, scanPos, c1);
+  rewriter.create<scf::YieldOp>(loc, scanPosPlus1);
+  // else
+  rewriter.setInsertionPointToStart(ifBlock_isActive.elseBlock());
+  rewriter.create<scf::YieldOp>(loc, scanPos);
+  // end if isActive
+  rewriter.setInsertionPointAfter(ifBlock_isActive);
+  rewriter.create<scf::YieldOp>(loc, ifBlock_isActive.getResult(0));
+  // end scan loop
+  rewriter.setInsertionPointAfter(scanLoop);
+  // else
+  rewriter.setInsertionPointToStart(ifBlock_scan.elseBlock());
+  sortIndices(rewriter, loc, outputIndices, outputStart, outputEnd);
+  // end if cmpScan
+  rewriter.setInsertionPointAfter(ifBlock_scan);
+
+  // 3rd pass
+  //   Gather the values from the workspace in index order
+  scf::ForOp gatherLoop =
+      rewriter.create<scf::ForOp>(loc, outputStart, outputEnd, c1);
+  Value pp = gatherLoop.getInductionVar();
+  rewriter.setInsertionPointToStart(gatherLoop.getBody());
+  Value outCol64 = loadI64(rewriter, loc, outputIndices, pp);
+  Value outCol = rewriter.create<arith::IndexCastOp>(loc, outCol64, indexType);
+  Value total = rewriter.create<memref::LoadOp>(loc, workspace, outCol);
+
+  // Does total need to be transformed?
+  if (extBlocks.transformOut) {
+    // scf::ForOp automatically gets an empty scf.yield at the end which we
+    // need to insert before
+    Operation *scfYield = gatherLoop.getBody()->getTerminator();
+    graphblas::YieldOp transformOutYield =
+        llvm::dyn_cast_or_null<graphblas::YieldOp>(
+            extBlocks.transformOut->getTerminator());
+    rewriter.mergeBlockBefore(extBlocks.transformOut, scfYield, {total});
+    Value transformResult = transformOutYield.values().front();
+    rewriter.eraseOp(transformOutYield);
+    rewriter.create<memref::StoreOp>(loc, transformResult, outputValues, pp);
+  } else {
+    // write total as-is
+    rewriter.create<memref::StoreOp>(loc, total, outputValues, pp);
+  }
+
+  // end gather loop
+  rewriter.setInsertionPointAfter(gatherLoop);
 }
 
 // Given two index arrays and positions within those arrays,
@@ -697,7 +1702,7 @@ Value computeIndexOverlapSize(PatternRewriter &rewriter, Location loc,
       rewriter.create<scf::IfOp>(loc, indexType, needsUpdateA, true);
   // if updateA
   rewriter.setInsertionPointToStart(if_updateA.thenBlock());
-  Value updatedIdxA64 = rewriter.create<memref::LoadOp>(loc, Ai, posA);
+  Value updatedIdxA64 = loadI64(rewriter, loc, Ai, posA);
   Value updatedIdxA =
       rewriter.create<arith::IndexCastOp>(loc, updatedIdxA64, indexType);
   rewriter.create<scf::YieldOp>(loc, updatedIdxA);
@@ -711,7 +1716,7 @@ Value computeIndexOverlapSize(PatternRewriter &rewriter, Location loc,
       rewriter.create<scf::IfOp>(loc, indexType, needsUpdateB, true);
   // if updateB
   rewriter.setInsertionPointToStart(if_updateB.thenBlock());
-  Value updatedIdxB64 = rewriter.create<memref::LoadOp>(loc, Bi, posB);
+  Value updatedIdxB64 = loadI64(rewriter, loc, Bi, posB);
   Value updatedIdxB =
       rewriter.create<arith::IndexCastOp>(loc, updatedIdxB64, indexType);
   rewriter.create<scf::YieldOp>(loc, updatedIdxB);
@@ -889,7 +1894,7 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
       loc, TypeRange{int64Type, valueType}, needsUpdateA, true);
   // if updateA
   rewriter.setInsertionPointToStart(if_updateA.thenBlock());
-  Value updatedIdxA = rewriter.create<memref::LoadOp>(loc, Ai, posA);
+  Value updatedIdxA = loadI64(rewriter, loc, Ai, posA);
   Value updatedValA = rewriter.create<memref::LoadOp>(loc, Ax, posA);
   rewriter.create<scf::YieldOp>(loc, ValueRange{updatedIdxA, updatedValA});
   // else
@@ -902,7 +1907,7 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
       loc, TypeRange{int64Type, valueType}, needsUpdateB, true);
   // if updateB
   rewriter.setInsertionPointToStart(if_updateB.thenBlock());
-  Value updatedIdxB = rewriter.create<memref::LoadOp>(loc, Bi, posB);
+  Value updatedIdxB = loadI64(rewriter, loc, Bi, posB);
   Value updatedValB = rewriter.create<memref::LoadOp>(loc, Bx, posB);
   rewriter.create<scf::YieldOp>(loc, ValueRange{updatedIdxB, updatedValB});
   // else
@@ -935,7 +1940,7 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
   // if onlyA
   rewriter.setInsertionPointToStart(if_onlyA.thenBlock());
   if (!intersect) {
-    rewriter.create<memref::StoreOp>(loc, newIdxA, Oi, posO);
+    storeI64(rewriter, loc, newIdxA, Oi, posO);
     rewriter.create<memref::StoreOp>(loc, newValA, Ox, posO);
   }
   rewriter.create<scf::YieldOp>(
@@ -948,7 +1953,7 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
   // if onlyB
   rewriter.setInsertionPointToStart(if_onlyB.thenBlock());
   if (!intersect) {
-    rewriter.create<memref::StoreOp>(loc, newIdxB, Oi, posO);
+    storeI64(rewriter, loc, newIdxB, Oi, posO);
     rewriter.create<memref::StoreOp>(loc, newValB, Ox, posO);
   }
   rewriter.create<scf::YieldOp>(
@@ -956,7 +1961,7 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
   // else
   rewriter.setInsertionPointToStart(if_onlyB.elseBlock());
   // At this point, we know newIdxA == newIdxB
-  rewriter.create<memref::StoreOp>(loc, newIdxA, Oi, posO);
+  storeI64(rewriter, loc, newIdxA, Oi, posO);
 
   if (binaryBlock) {
     // Insert binary block
@@ -1010,9 +2015,9 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
     Value aa = forLoop.getInductionVar();
     Value currPosO = forLoop.getLoopBody().getArgument(1);
     rewriter.setInsertionPointToStart(forLoop.getBody());
-    idxA = rewriter.create<memref::LoadOp>(loc, Ai, aa);
+    idxA = loadI64(rewriter, loc, Ai, aa);
     valA = rewriter.create<memref::LoadOp>(loc, Ax, aa);
-    rewriter.create<memref::StoreOp>(loc, idxA, Oi, currPosO);
+    storeI64(rewriter, loc, idxA, Oi, currPosO);
     rewriter.create<memref::StoreOp>(loc, valA, Ox, currPosO);
     Value newPosO = rewriter.create<arith::AddIOp>(loc, currPosO, c1);
     rewriter.create<scf::YieldOp>(loc, newPosO);
@@ -1031,9 +2036,9 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
     Value bb = forLoop.getInductionVar();
     currPosO = forLoop.getLoopBody().getArgument(1);
     rewriter.setInsertionPointToStart(forLoop.getBody());
-    idxB = rewriter.create<memref::LoadOp>(loc, Bi, bb);
+    idxB = loadI64(rewriter, loc, Bi, bb);
     valB = rewriter.create<memref::LoadOp>(loc, Bx, bb);
-    rewriter.create<memref::StoreOp>(loc, idxB, Oi, currPosO);
+    storeI64(rewriter, loc, idxB, Oi, currPosO);
     rewriter.create<memref::StoreOp>(loc, valB, Ox, currPosO);
     newPosO = rewriter.create<arith::AddIOp>(loc, currPosO, c1);
     rewriter.create<scf::YieldOp>(loc, newPosO);
@@ -1057,11 +2062,12 @@ Value computeUnionAggregation(PatternRewriter &rewriter, Location loc,
 
 // Updates Oi and Ox with indices and values
 // Value in A which not not overlap the mask M are not included in O
+// With `complement`, only the values in A which do not overlap M are included
 // Returns the final position in Oi (one more than the last value inserted)
 Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
                 Value aPosStart, Value aPosEnd, Value Ai, Value Ax,
                 Value mPosStart, Value mPosEnd, Value Mi, Value oPosStart,
-                Value Oi, Value Ox) {
+                Value Oi, Value Ox, bool complement = false) {
   // Types used in this function
   Type boolType = rewriter.getI1Type();
   Type int64Type = rewriter.getI64Type();
@@ -1124,7 +2130,7 @@ Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
       loc, TypeRange{int64Type, valueType}, needsUpdateA, true);
   // if updateA
   rewriter.setInsertionPointToStart(if_updateA.thenBlock());
-  Value updatedIdxA = rewriter.create<memref::LoadOp>(loc, Ai, posA);
+  Value updatedIdxA = loadI64(rewriter, loc, Ai, posA);
   Value updatedValA = rewriter.create<memref::LoadOp>(loc, Ax, posA);
   rewriter.create<scf::YieldOp>(loc, ValueRange{updatedIdxA, updatedValA});
   // else
@@ -1137,7 +2143,7 @@ Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
       rewriter.create<scf::IfOp>(loc, int64Type, needsUpdateM, true);
   // if updateM
   rewriter.setInsertionPointToStart(if_updateM.thenBlock());
-  Value updatedIdxM = rewriter.create<memref::LoadOp>(loc, Mi, posM);
+  Value updatedIdxM = loadI64(rewriter, loc, Mi, posM);
   rewriter.create<scf::YieldOp>(loc, updatedIdxM);
   // else
   rewriter.setInsertionPointToStart(if_updateM.elseBlock());
@@ -1161,8 +2167,15 @@ Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
       idxA_lt_idxM, true);
   // if onlyA
   rewriter.setInsertionPointToStart(if_onlyA.thenBlock());
-  rewriter.create<scf::YieldOp>(
-      loc, ValueRange{posAplus1, posM, posO, ctrue, cfalse});
+  if (complement) {
+    storeI64(rewriter, loc, newIdxA, Oi, posO);
+    rewriter.create<memref::StoreOp>(loc, newValA, Ox, posO);
+    rewriter.create<scf::YieldOp>(
+        loc, ValueRange{posAplus1, posM, posOplus1, ctrue, cfalse});
+  } else {
+    rewriter.create<scf::YieldOp>(
+        loc, ValueRange{posAplus1, posM, posO, ctrue, cfalse});
+  }
   // else
   rewriter.setInsertionPointToStart(if_onlyA.elseBlock());
   scf::IfOp if_onlyM = rewriter.create<scf::IfOp>(
@@ -1175,10 +2188,15 @@ Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
   // else
   rewriter.setInsertionPointToStart(if_onlyM.elseBlock());
   // At this point, we know newIdxA == newIdxM
-  rewriter.create<memref::StoreOp>(loc, newIdxA, Oi, posO);
-  rewriter.create<memref::StoreOp>(loc, newValA, Ox, posO);
-  rewriter.create<scf::YieldOp>(
-      loc, ValueRange{posAplus1, posMplus1, posOplus1, ctrue, ctrue});
+  if (complement) {
+    rewriter.create<scf::YieldOp>(
+        loc, ValueRange{posAplus1, posMplus1, posO, ctrue, ctrue});
+  } else {
+    storeI64(rewriter, loc, newIdxA, Oi, posO);
+    rewriter.create<memref::StoreOp>(loc, newValA, Ox, posO);
+    rewriter.create<scf::YieldOp>(
+        loc, ValueRange{posAplus1, posMplus1, posOplus1, ctrue, ctrue});
+  }
   // end onlyM
   rewriter.setInsertionPointAfter(if_onlyM);
   rewriter.create<scf::YieldOp>(loc, if_onlyM.getResults());
@@ -1197,15 +2215,127 @@ Value applyMask(PatternRewriter &rewriter, Location loc, Type valueType,
 
   Value finalPosO = whileLoop.getResult(2);
 
+  if (complement) {
+    // Values in A past the end of the mask are all kept
+    Value finalPosA = whileLoop.getResult(0);
+    scf::ForOp tailLoop =
+        rewriter.create<scf::ForOp>(loc, finalPosA, aPosEnd, c1, finalPosO);
+    {
+      rewriter.setInsertionPointToStart(tailLoop.getBody());
+      Value tailPosA = tailLoop.getInductionVar();
+      Value tailPosO = tailLoop.getLoopBody().getArgument(1);
+      Value tailIdxA = loadI64(rewriter, loc, Ai, tailPosA);
+      Value tailValA = rewriter.create<memref::LoadOp>(loc, Ax, tailPosA);
+      storeI64(rewriter, loc, tailIdxA, Oi, tailPosO);
+      rewriter.create<memref::StoreOp>(loc, tailValA, Ox, tailPosO);
+      Value tailPosOplus1 = rewriter.create<arith::AddIOp>(loc, tailPosO, c1);
+      rewriter.create<scf::YieldOp>(loc, tailPosOplus1);
+    }
+    rewriter.setInsertionPointAfter(tailLoop);
+    finalPosO = tailLoop.getResult(0);
+  }
+
   return finalPosO;
 }
 
+// Keeps the lhs values whose bit is set in the bitmap mask. Each membership
+// test is a single lookup, so both passes are linear in the lhs.
+static void computeVectorBitmapMask(PatternRewriter &rewriter, Location loc,
+                                    ModuleOp module, Value lhs, Value bitmap,
+                                    Value output, bool complement) {
+  // Types
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+  MemRefType memrefIValueType = getMemrefValueType(lhs.getType());
+  MemRefType memrefMValueType = getMemrefValueType(bitmap.getType());
+  MemRefType memrefOValueType = getMemrefValueType(output.getType());
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
+  Value ci1 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
+
+  // Get sparse tensor info
+  Value lhsNnz = rewriter.create<graphblas::NumValsOp>(loc, lhs);
+  Value Li = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(lhs.getType()), lhs, c0);
+  Value Lx =
+      rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType, lhs);
+  Value Mx =
+      rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefMValueType, bitmap);
+
+  // 1st pass
+  //   Count the lhs values in the mask
+  scf::ParallelOp countLoop =
+      rewriter.create<scf::ParallelOp>(loc, c0, lhsNnz, c1, ci0);
+  {
+    rewriter.setInsertionPointToStart(countLoop.getBody());
+    Value pos = countLoop.getInductionVars().front();
+    Value idx64 = loadI64(rewriter, loc, Li, pos);
+    Value idx = rewriter.create<arith::IndexCastOp>(loc, idx64, indexType);
+    Value keep = loadBitmapBit(rewriter, loc, Mx, idx, complement);
+    Value count = rewriter.create<SelectOp>(loc, keep, ci1, ci0);
+    buildSumReduce(rewriter, loc, count);
+  }
+  rewriter.setInsertionPointAfter(countLoop);
+  Value ewiseSize64 = countLoop.getResult(0);
+  Value ewiseSize =
+      rewriter.create<arith::IndexCastOp>(loc, ewiseSize64, indexType);
+
+  callResizeIndex(rewriter, module, loc, output, c0, ewiseSize);
+  callResizeValues(rewriter, module, loc, output, ewiseSize);
+
+  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(output.getType()), output, c0);
+  storeI64(rewriter, loc, ewiseSize64, Op, c1);
+  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(output.getType()), output, c0);
+  Value Ox =
+      rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefOValueType, output);
+
+  // 2nd pass
+  //   Copy the lhs values in the mask
+  scf::ForOp copyLoop = rewriter.create<scf::ForOp>(loc, c0, lhsNnz, c1, c0);
+  {
+    rewriter.setInsertionPointToStart(copyLoop.getBody());
+    Value pos = copyLoop.getInductionVar();
+    Value posO = copyLoop.getLoopBody().getArgument(1);
+    Value idx64 = loadI64(rewriter, loc, Li, pos);
+    Value idx = rewriter.create<arith::IndexCastOp>(loc, idx64, indexType);
+    Value keep = loadBitmapBit(rewriter, loc, Mx, idx, complement);
+    scf::IfOp if_keep = rewriter.create<scf::IfOp>(loc, indexType, keep, true);
+    {
+      rewriter.setInsertionPointToStart(if_keep.thenBlock());
+      Value val = rewriter.create<memref::LoadOp>(loc, Lx, pos);
+      storeI64(rewriter, loc, idx64, Oi, posO);
+      rewriter.create<memref::StoreOp>(loc, val, Ox, posO);
+      Value posOplus1 = rewriter.create<arith::AddIOp>(loc, posO, c1);
+      rewriter.create<scf::YieldOp>(loc, posOplus1);
+    }
+    {
+      rewriter.setInsertionPointToStart(if_keep.elseBlock());
+      rewriter.create<scf::YieldOp>(loc, posO);
+    }
+    rewriter.setInsertionPointAfter(if_keep);
+    rewriter.create<scf::YieldOp>(loc, if_keep.getResult(0));
+  }
+  rewriter.setInsertionPointAfter(copyLoop);
+}
+
 void computeVectorElementWise(PatternRewriter &rewriter, Location loc,
                               ModuleOp module, Value lhs, Value rhs,
                               Value output, Block *binaryBlock,
                               EwiseBehavior behavior) {
   // aggBlock is ignored if behavior is MASK or MASK_COMPLEMENT
 
+  // Only masks may be bitmaps
+  if (isBitmapVector(rhs.getType())) {
+    computeVectorBitmapMask(rewriter, loc, module, lhs, rhs, output,
+                            behavior == MASK_COMPLEMENT);
+    return;
+  }
+
   bool intersect = behavior != UNION;
 
   // Types
@@ -1213,7 +2343,6 @@ void computeVectorElementWise(PatternRewriter &rewriter, Location loc,
   Type int64Type = rewriter.getIntegerType(64);
   Type inputElementType =
       lhs.getType().cast<RankedTensorType>().getElementType();
-  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
   MemRefType memrefIValueType = getMemrefValueType(lhs.getType());
   MemRefType memrefOValueType = getMemrefValueType(outputType);
 
@@ -1222,27 +2351,23 @@ void computeVectorElementWise(PatternRewriter &rewriter, Location loc,
   Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
 
   // Get sparse tensor info
-  Value size = rewriter.create<graphblas::SizeOp>(loc, output);
   Value lhsNnz = rewriter.create<graphblas::NumValsOp>(loc, lhs);
   Value rhsNnz = rewriter.create<graphblas::NumValsOp>(loc, rhs);
-  Value Li = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         lhs, c0);
+  Value Li = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(lhs.getType()), lhs, c0);
   Value Lx =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType, lhs);
-  Value Ri = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         rhs, c0);
+  Value Ri = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(rhs.getType()), rhs, c0);
   Value Rx =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType, rhs);
 
-  // Special handling for complemented mask
-  Value ewiseSize, maskComplement, maskComplementSize;
+  // A complemented mask keeps the lhs values which miss the mask
+  Value ewiseSize;
   if (behavior == MASK_COMPLEMENT) {
-    ValueRange results =
-        buildMaskComplement(rewriter, loc, size, Ri, c0, rhsNnz);
-    maskComplement = results[0];
-    maskComplementSize = results[1];
-    ewiseSize = computeIndexOverlapSize(rewriter, loc, true, c0, lhsNnz, Li, c0,
-                                        maskComplementSize, maskComplement);
+    Value maskedSize = computeIndexOverlapSize(rewriter, loc, true, c0, lhsNnz,
+                                               Li, c0, rhsNnz, Ri);
+    ewiseSize = rewriter.create<arith::SubIOp>(loc, lhsNnz, maskedSize);
   } else {
     ewiseSize = computeIndexOverlapSize(rewriter, loc, intersect, c0, lhsNnz,
                                         Li, c0, rhsNnz, Ri);
@@ -1254,11 +2379,11 @@ void computeVectorElementWise(PatternRewriter &rewriter, Location loc,
   callResizeIndex(rewriter, module, loc, output, c0, ewiseSize);
   callResizeValues(rewriter, module, loc, output, ewiseSize);
 
-  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                          output, c0);
-  rewriter.create<memref::StoreOp>(loc, ewiseSize64, Op, c1);
-  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         output, c0);
+  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(output.getType()), output, c0);
+  storeI64(rewriter, loc, ewiseSize64, Op, c1);
+  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(output.getType()), output, c0);
   Value Ox =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefOValueType, output);
 
@@ -1266,9 +2391,8 @@ void computeVectorElementWise(PatternRewriter &rewriter, Location loc,
     applyMask(rewriter, loc, inputElementType, c0, lhsNnz, Li, Lx, c0, rhsNnz,
               Ri, c0, Oi, Ox);
   } else if (behavior == MASK_COMPLEMENT) {
-    applyMask(rewriter, loc, inputElementType, c0, lhsNnz, Li, Lx, c0,
-              maskComplementSize, maskComplement, c0, Oi, Ox);
-    rewriter.create<memref::DeallocOp>(loc, maskComplement);
+    applyMask(rewriter, loc, inputElementType, c0, lhsNnz, Li, Lx, c0, rhsNnz,
+              Ri, c0, Oi, Ox, true);
   } else {
     computeUnionAggregation(rewriter, loc, intersect, binaryBlock,
                             inputElementType, c0, lhsNnz, Li, Lx, c0, rhsNnz,
@@ -1287,45 +2411,40 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   // Types
   RankedTensorType outputType = output.getType().cast<RankedTensorType>();
   Type indexType = rewriter.getIndexType();
-  Type boolType = rewriter.getI1Type();
   Type int64Type = rewriter.getIntegerType(64);
   Type inputElementType =
       lhs.getType().cast<RankedTensorType>().getElementType();
-  MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
   MemRefType memrefIValueType = getMemrefValueType(lhs.getType());
   MemRefType memrefOValueType = getMemrefValueType(outputType);
 
   // Initial constants
-  Value cfalse = rewriter.create<arith::ConstantIntOp>(loc, 0, boolType);
   Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
   Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
   Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
 
-  Value nrows, ncols;
+  Value nrows;
   if (hasRowOrdering(outputType)) {
     nrows = rewriter.create<graphblas::NumRowsOp>(loc, output);
-    ncols = rewriter.create<graphblas::NumColsOp>(loc, output);
   } else {
     // Swap nrows and ncols so logic works
-    ncols = rewriter.create<graphblas::NumRowsOp>(loc, output);
     nrows = rewriter.create<graphblas::NumColsOp>(loc, output);
   }
 
   // Get sparse tensor info
-  Value Lp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                          lhs, c1);
-  Value Li = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         lhs, c1);
+  Value Lp = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(lhs.getType()), lhs, c1);
+  Value Li = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(lhs.getType()), lhs, c1);
   Value Lx =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType, lhs);
-  Value Rp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                          rhs, c1);
-  Value Ri = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         rhs, c1);
+  Value Rp = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(rhs.getType()), rhs, c1);
+  Value Ri = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(rhs.getType()), rhs, c1);
   Value Rx =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType, rhs);
-  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                          output, c1);
+  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(output.getType()), output, c1);
 
   // 1st pass
   //   Compute overlap size for each row
@@ -1336,17 +2455,17 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   rewriter.setInsertionPointToStart(rowLoop1.getBody());
 
   Value rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-  Value lhsColStart64 = rewriter.create<memref::LoadOp>(loc, Lp, row);
-  Value lhsColEnd64 = rewriter.create<memref::LoadOp>(loc, Lp, rowPlus1);
-  Value rhsColStart64 = rewriter.create<memref::LoadOp>(loc, Rp, row);
-  Value rhsColEnd64 = rewriter.create<memref::LoadOp>(loc, Rp, rowPlus1);
+  Value lhsColStart64 = loadI64(rewriter, loc, Lp, row);
+  Value lhsColEnd64 = loadI64(rewriter, loc, Lp, rowPlus1);
+  Value rhsColStart64 = loadI64(rewriter, loc, Rp, row);
+  Value rhsColEnd64 = loadI64(rewriter, loc, Rp, rowPlus1);
   Value LcmpColSame = rewriter.create<arith::CmpIOp>(
       loc, arith::CmpIPredicate::eq, lhsColStart64, lhsColEnd64);
   Value RcmpColSame = rewriter.create<arith::CmpIOp>(
       loc, arith::CmpIPredicate::eq, rhsColStart64, rhsColEnd64);
   Value emptyRow;
   if (behavior == MASK_COMPLEMENT) {
-    emptyRow = cfalse;
+    emptyRow = LcmpColSame;
   } else if (intersect) {
     emptyRow = rewriter.create<arith::OrIOp>(loc, LcmpColSame, RcmpColSame);
   } else {
@@ -1370,17 +2489,14 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   Value rhsColEnd =
       rewriter.create<arith::IndexCastOp>(loc, rhsColEnd64, indexType);
 
-  // Special handling for complemented mask
+  // A complemented mask keeps the lhs values which miss the mask
   Value unionSize;
   if (behavior == MASK_COMPLEMENT) {
-    ValueRange results =
-        buildMaskComplement(rewriter, loc, ncols, Ri, rhsColStart, rhsColEnd);
-    Value maskComplement = results[0];
-    Value maskComplementSize = results[1];
-    unionSize =
-        computeIndexOverlapSize(rewriter, loc, true, lhsColStart, lhsColEnd, Li,
-                                c0, maskComplementSize, maskComplement);
-    rewriter.create<memref::DeallocOp>(loc, maskComplement);
+    Value maskedSize =
+        computeIndexOverlapSize(rewriter, loc, true, lhsColStart, lhsColEnd,
+                                Li, rhsColStart, rhsColEnd, Ri);
+    Value lhsSize = rewriter.create<arith::SubIOp>(loc, lhsColEnd, lhsColStart);
+    unionSize = rewriter.create<arith::SubIOp>(loc, lhsSize, maskedSize);
   } else {
     unionSize =
         computeIndexOverlapSize(rewriter, loc, intersect, lhsColStart,
@@ -1394,7 +2510,7 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   // end if cmpColSame
   rewriter.setInsertionPointAfter(ifBlock_rowTotal);
   Value rowSize = ifBlock_rowTotal.getResult(0);
-  rewriter.create<memref::StoreOp>(loc, rowSize, Op, row);
+  storeI64(rewriter, loc, rowSize, Op, row);
 
   // end row loop
   rewriter.setInsertionPointAfter(rowLoop1);
@@ -1402,26 +2518,14 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   // 2nd pass
   //   Compute the cumsum of values in Op to build the final Op
   //   Then resize output indices and values
-  rewriter.create<memref::StoreOp>(loc, ci0, Op, nrows);
-  scf::ForOp rowLoop2 = rewriter.create<scf::ForOp>(loc, c0, nrows, c1);
-  Value cs_i = rowLoop2.getInductionVar();
-  rewriter.setInsertionPointToStart(rowLoop2.getBody());
-
-  Value csTemp = rewriter.create<memref::LoadOp>(loc, Op, cs_i);
-  Value cumsum = rewriter.create<memref::LoadOp>(loc, Op, nrows);
-  rewriter.create<memref::StoreOp>(loc, cumsum, Op, cs_i);
-  Value cumsum2 = rewriter.create<arith::AddIOp>(loc, cumsum, csTemp);
-  rewriter.create<memref::StoreOp>(loc, cumsum2, Op, nrows);
-
-  // end row loop
-  rewriter.setInsertionPointAfter(rowLoop2);
+  buildExclusiveScan(rewriter, loc, Op, nrows);
 
   Value nnz = rewriter.create<graphblas::NumValsOp>(loc, output);
   callResizeIndex(rewriter, module, loc, output, c1, nnz);
   callResizeValues(rewriter, module, loc, output, nnz);
 
-  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                         output, c1);
+  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(output.getType()), output, c1);
   Value Ox =
       rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefOValueType, output);
 
@@ -1434,24 +2538,24 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   rewriter.setInsertionPointToStart(rowLoop3.getBody());
 
   rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-  Value opStart64 = rewriter.create<memref::LoadOp>(loc, Op, row);
-  Value opEnd64 = rewriter.create<memref::LoadOp>(loc, Op, rowPlus1);
+  Value opStart64 = loadI64(rewriter, loc, Op, row);
+  Value opEnd64 = loadI64(rewriter, loc, Op, rowPlus1);
   Value cmp_opDifferent = rewriter.create<arith::CmpIOp>(
       loc, arith::CmpIPredicate::ne, opStart64, opEnd64);
   scf::IfOp ifBlock_cmpDiff = rewriter.create<scf::IfOp>(loc, cmp_opDifferent);
   rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
 
-  Value OcolStart64 = rewriter.create<memref::LoadOp>(loc, Op, row);
+  Value OcolStart64 = loadI64(rewriter, loc, Op, row);
   Value OcolStart =
       rewriter.create<arith::IndexCastOp>(loc, OcolStart64, indexType);
 
-  lhsColStart64 = rewriter.create<memref::LoadOp>(loc, Lp, row);
-  lhsColEnd64 = rewriter.create<memref::LoadOp>(loc, Lp, rowPlus1);
+  lhsColStart64 = loadI64(rewriter, loc, Lp, row);
+  lhsColEnd64 = loadI64(rewriter, loc, Lp, rowPlus1);
   lhsColStart =
       rewriter.create<arith::IndexCastOp>(loc, lhsColStart64, indexType);
   lhsColEnd = rewriter.create<arith::IndexCastOp>(loc, lhsColEnd64, indexType);
-  rhsColStart64 = rewriter.create<memref::LoadOp>(loc, Rp, row);
-  rhsColEnd64 = rewriter.create<memref::LoadOp>(loc, Rp, rowPlus1);
+  rhsColStart64 = loadI64(rewriter, loc, Rp, row);
+  rhsColEnd64 = loadI64(rewriter, loc, Rp, rowPlus1);
   rhsColStart =
       rewriter.create<arith::IndexCastOp>(loc, rhsColStart64, indexType);
   rhsColEnd = rewriter.create<arith::IndexCastOp>(loc, rhsColEnd64, indexType);
@@ -1460,15 +2564,8 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
     applyMask(rewriter, loc, inputElementType, lhsColStart, lhsColEnd, Li, Lx,
               rhsColStart, rhsColEnd, Ri, OcolStart, Oi, Ox);
   } else if (behavior == MASK_COMPLEMENT) {
-    // Need to recompute maskComplement because previous use was inside a
-    // different loop
-    ValueRange results =
-        buildMaskComplement(rewriter, loc, ncols, Ri, rhsColStart, rhsColEnd);
-    Value maskComplement = results[0];
-    Value maskComplementSize = results[1];
     applyMask(rewriter, loc, inputElementType, lhsColStart, lhsColEnd, Li, Lx,
-              c0, maskComplementSize, maskComplement, OcolStart, Oi, Ox);
-    rewriter.create<memref::DeallocOp>(loc, maskComplement);
+              rhsColStart, rhsColEnd, Ri, OcolStart, Oi, Ox, true);
   } else {
     computeUnionAggregation(rewriter, loc, intersect, binaryBlock,
                             inputElementType, lhsColStart, lhsColEnd, Li, Lx,
@@ -1481,3 +2578,367 @@ void computeMatrixElementWise(PatternRewriter &rewriter, Location loc,
   // end row loop
   rewriter.setInsertionPointAfter(rowLoop3);
 }
+
+// Loads indices[pos], or `past` once pos reaches end
+static Value loadIndexOrPast(PatternRewriter &rewriter, Location loc,
+                             Value indices, Value pos, Value end, Value past) {
+  Type int64Type = rewriter.getI64Type();
+
+  Value validPos =
+      rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::ult, pos, end);
+  scf::IfOp if_valid =
+      rewriter.create<scf::IfOp>(loc, int64Type, validPos, true);
+  {
+    rewriter.setInsertionPointToStart(if_valid.thenBlock());
+    Value idx = loadI64(rewriter, loc, indices, pos);
+    rewriter.create<scf::YieldOp>(loc, idx);
+  }
+  {
+    rewriter.setInsertionPointToStart(if_valid.elseBlock());
+    rewriter.create<scf::YieldOp>(loc, past);
+  }
+  rewriter.setInsertionPointAfter(if_valid);
+  return if_valid.getResult(0);
+}
+
+// Merges the current entries C with the input entries I under the mask M in
+// a single pass over all three. Inside the mask the input entries are taken,
+// combined with the current ones by `accumulateBlock` when given. Without an
+// accumulator, current entries missing from the input are dropped there.
+// Outside the mask the current entries are kept unless `replace` is set.
+// A null Mi means there is no mask. A null Oi only counts the entries.
+// Returns the final position in Oi (one more than the last value inserted)
+static Value computeMaskedMerge(PatternRewriter &rewriter, Location loc,
+                               Type valueType, Value cPosStart, Value cPosEnd,
+                               Value Ci, Value Cx, Value iPosStart,
+                               Value iPosEnd, Value Ii, Value Ix,
+                               Value mPosStart, Value mPosEnd, Value Mi,
+                               Value oPosStart, Value Oi, Value Ox,
+                               Block *accumulateBlock, bool complement,
+                               bool replace) {
+  // Types used in this function
+  Type boolType = rewriter.getI1Type();
+  Type int64Type = rewriter.getI64Type();
+  Type indexType = rewriter.getIndexType();
+  SmallVector<Type, 4> posTypes(4, indexType);
+
+  // Initial constants
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+  Value cfalse = rewriter.create<arith::ConstantIntOp>(loc, 0, boolType);
+  Value ctrue = rewriter.create<arith::ConstantIntOp>(loc, 1, boolType);
+  // Sorts after every index, so an exhausted array never matches
+  Value ciPast = rewriter.create<arith::ConstantIntOp>(loc, -1, int64Type);
+  // Without a mask its position is carried along unused
+  if (!Mi)
+    mPosStart = oPosStart;
+
+  // While Loop (exit when both C and I are exhausted)
+  scf::WhileOp whileLoop = rewriter.create<scf::WhileOp>(
+      loc, posTypes, ValueRange{cPosStart, iPosStart, mPosStart, oPosStart});
+  Block *before = rewriter.createBlock(&whileLoop.getBefore(), {}, posTypes);
+  Block *after = rewriter.createBlock(&whileLoop.getAfter(), {}, posTypes);
+  // "while" portion of the loop
+  rewriter.setInsertionPointToStart(before);
+  Value posC = before->getArgument(0);
+  Value posI = before->getArgument(1);
+  Value validPosC = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, posC, cPosEnd);
+  Value validPosI = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, posI, iPosEnd);
+  Value continueLoop = rewriter.create<arith::OrIOp>(loc, validPosC, validPosI);
+  rewriter.create<scf::ConditionOp>(loc, continueLoop, before->getArguments());
+
+  // "do" portion of while loop
+  rewriter.setInsertionPointToStart(after);
+  posC = after->getArgument(0);
+  posI = after->getArgument(1);
+  Value posM = after->getArgument(2);
+  Value posO = after->getArgument(3);
+
+  Value idxC = loadIndexOrPast(rewriter, loc, Ci, posC, cPosEnd, ciPast);
+  Value idxI = loadIndexOrPast(rewriter, loc, Ii, posI, iPosEnd, ciPast);
+  Value idxC_lt_idxI = rewriter.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::ult, idxC, idxI);
+  Value idx = rewriter.create<SelectOp>(loc, idxC_lt_idxI, idxC, idxI);
+  Value hasC = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
+                                              idxC, idx);
+  Value hasI = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
+                                              idxI, idx);
+
+  // Mask indices before idx are skipped one per iteration, during which
+  // nothing else moves
+  Value ready = ctrue;
+  Value inMask = ctrue;
+  Value newPosM = posM;
+  if (Mi) {
+    Value idxM = loadIndexOrPast(rewriter, loc, Mi, posM, mPosEnd, ciPast);
+    Value maskBehind = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ult, idxM, idx);
+    ready = rewriter.create<arith::XOrIOp>(loc, maskBehind, ctrue);
+    inMask = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
+                                            idxM, idx);
+    Value advanceM = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ule, idxM, idx);
+    Value posMplus1 = rewriter.create<arith::AddIOp>(loc, posM, c1);
+    newPosM = rewriter.create<SelectOp>(loc, advanceM, posMplus1, posM);
+  }
+  if (complement)
+    inMask = rewriter.create<arith::XOrIOp>(loc, inMask, ctrue);
+  Value outsideMask = rewriter.create<arith::XOrIOp>(loc, inMask, ctrue);
+
+  Value takeI = rewriter.create<arith::AndIOp>(loc, hasI, inMask);
+  Value keepC = cfalse;
+  if (accumulateBlock)
+    keepC = rewriter.create<arith::AndIOp>(loc, hasC, inMask);
+  if (!replace) {
+    Value keepOutside = rewriter.create<arith::AndIOp>(loc, hasC, outsideMask);
+    keepC = rewriter.create<arith::OrIOp>(loc, keepC, keepOutside);
+  }
+  Value write = rewriter.create<arith::OrIOp>(loc, takeI, keepC);
+  write = rewriter.create<arith::AndIOp>(loc, write, ready);
+
+  if (Oi) {
+    scf::IfOp if_write = rewriter.create<scf::IfOp>(loc, write, false);
+    rewriter.setInsertionPointToStart(if_write.thenBlock());
+    storeI64(rewriter, loc, idx, Oi, posO);
+
+    scf::IfOp if_takeI =
+        rewriter.create<scf::IfOp>(loc, valueType, takeI, true);
+    // if takeI
+    rewriter.setInsertionPointToStart(if_takeI.thenBlock());
+    Value valI = rewriter.create<memref::LoadOp>(loc, Ix, posI);
+    if (accumulateBlock) {
+      scf::IfOp if_keepC =
+          rewriter.create<scf::IfOp>(loc, valueType, keepC, true);
+      // if keepC
+      rewriter.setInsertionPointToStart(if_keepC.thenBlock());
+      Value valC = rewriter.create<memref::LoadOp>(loc, Cx, posC);
+      Value accumulated = inlineExtensionBlock(rewriter, accumulateBlock,
+                                               ValueRange{valC, valI});
+      rewriter.create<scf::YieldOp>(loc, accumulated);
+      // else
+      rewriter.setInsertionPointToStart(if_keepC.elseBlock());
+      rewriter.create<scf::YieldOp>(loc, valI);
+      rewriter.setInsertionPointAfter(if_keepC);
+      valI = if_keepC.getResult(0);
+    }
+    rewriter.create<scf::YieldOp>(loc, valI);
+    // else
+    rewriter.setInsertionPointToStart(if_takeI.elseBlock());
+    Value valC = rewriter.create<memref::LoadOp>(loc, Cx, posC);
+    rewriter.create<scf::YieldOp>(loc, valC);
+    rewriter.setInsertionPointAfter(if_takeI);
+
+    rewriter.create<memref::StoreOp>(loc, if_takeI.getResult(0), Ox, posO);
+    rewriter.setInsertionPointAfter(if_write);
+  }
+
+  Value advanceC = rewriter.create<arith::AndIOp>(loc, hasC, ready);
+  Value advanceI = rewriter.create<arith::AndIOp>(loc, hasI, ready);
+  Value posCplus1 = rewriter.create<arith::AddIOp>(loc, posC, c1);
+  Value posIplus1 = rewriter.create<arith::AddIOp>(loc, posI, c1);
+  Value posOplus1 = rewriter.create<arith::AddIOp>(loc, posO, c1);
+  Value newPosC = rewriter.create<SelectOp>(loc, advanceC, posCplus1, posC);
+  Value newPosI = rewriter.create<SelectOp>(loc, advanceI, posIplus1, posI);
+  Value newPosO = rewriter.create<SelectOp>(loc, write, posOplus1, posO);
+  rewriter.create<scf::YieldOp>(
+      loc, ValueRange{newPosC, newPosI, newPosM, newPosO});
+  rewriter.setInsertionPointAfter(whileLoop);
+
+  return whileLoop.getResult(3);
+}
+
+static void computeVectorMaskedUpdate(PatternRewriter &rewriter, Location loc,
+                                      ModuleOp module, Value current,
+                                      Value input, Value mask, Value output,
+                                      Block *accumulateBlock,
+                                      bool maskComplement, bool replace) {
+  // Types
+  Type int64Type = rewriter.getIntegerType(64);
+  Type valueType =
+      output.getType().cast<RankedTensorType>().getElementType();
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  // Get sparse tensor info
+  Value currentNnz = rewriter.create<graphblas::NumValsOp>(loc, current);
+  Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(current.getType()), current, c0);
+  Value Cx = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(current.getType()), current);
+  Value inputNnz = rewriter.create<graphblas::NumValsOp>(loc, input);
+  Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(input.getType()), input, c0);
+  Value Ix = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(input.getType()), input);
+  Value maskNnz, Mi;
+  if (mask) {
+    maskNnz = rewriter.create<graphblas::NumValsOp>(loc, mask);
+    Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(mask.getType()), mask, c0);
+  }
+
+  // 1st pass
+  //   Count the merged entries
+  Value mergedSize = computeMaskedMerge(
+      rewriter, loc, valueType, c0, currentNnz, Ci, Cx, c0, inputNnz, Ii, Ix,
+      c0, maskNnz, Mi, c0, nullptr, nullptr, accumulateBlock, maskComplement,
+      replace);
+  Value mergedSize64 =
+      rewriter.create<arith::IndexCastOp>(loc, mergedSize, int64Type);
+
+  callResizeIndex(rewriter, module, loc, output, c0, mergedSize);
+  callResizeValues(rewriter, module, loc, output, mergedSize);
+
+  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(output.getType()), output, c0);
+  storeI64(rewriter, loc, mergedSize64, Op, c1);
+  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(output.getType()), output, c0);
+  Value Ox = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(output.getType()), output);
+
+  // 2nd pass
+  //   Write the merged entries
+  computeMaskedMerge(rewriter, loc, valueType, c0, currentNnz, Ci, Cx, c0,
+                     inputNnz, Ii, Ix, c0, maskNnz, Mi, c0, Oi, Ox,
+                     accumulateBlock, maskComplement, replace);
+}
+
+static void computeMatrixMaskedUpdate(PatternRewriter &rewriter, Location loc,
+                                      ModuleOp module, Value current,
+                                      Value input, Value mask, Value output,
+                                      Block *accumulateBlock,
+                                      bool maskComplement, bool replace) {
+  // Types
+  RankedTensorType outputType = output.getType().cast<RankedTensorType>();
+  Type indexType = rewriter.getIndexType();
+  Type int64Type = rewriter.getIntegerType(64);
+  Type valueType = outputType.getElementType();
+
+  // Initial constants
+  Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
+  Value nrows;
+  if (hasRowOrdering(outputType)) {
+    nrows = rewriter.create<graphblas::NumRowsOp>(loc, output);
+  } else {
+    // Swap nrows and ncols so logic works
+    nrows = rewriter.create<graphblas::NumColsOp>(loc, output);
+  }
+
+  // Get sparse tensor info
+  Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(current.getType()), current, c1);
+  Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(current.getType()), current, c1);
+  Value Cx = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(current.getType()), current);
+  Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(input.getType()), input, c1);
+  Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(input.getType()), input, c1);
+  Value Ix = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(input.getType()), input);
+  Value Mp, Mi;
+  if (mask) {
+    Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(mask.getType()), mask, c1);
+    Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(mask.getType()), mask, c1);
+  }
+  Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+      loc, getMemrefPointerType(output.getType()), output, c1);
+
+  auto rowBounds = [&](Value pointers, Value row, Value &start, Value &end) {
+    Value rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
+    Value start64 = loadI64(rewriter, loc, pointers, row);
+    Value end64 = loadI64(rewriter, loc, pointers, rowPlus1);
+    start = rewriter.create<arith::IndexCastOp>(loc, start64, indexType);
+    end = rewriter.create<arith::IndexCastOp>(loc, end64, indexType);
+  };
+
+  // 1st pass
+  //   Count the merged entries of each row
+  //   Store results in Op
+  scf::ParallelOp rowLoop1 =
+      rewriter.create<scf::ParallelOp>(loc, c0, nrows, c1);
+  {
+    rewriter.setInsertionPointToStart(rowLoop1.getBody());
+    Value row = rowLoop1.getInductionVars().front();
+    Value cStart, cEnd, iStart, iEnd, mStart, mEnd;
+    rowBounds(Cp, row, cStart, cEnd);
+    rowBounds(Ip, row, iStart, iEnd);
+    if (mask)
+      rowBounds(Mp, row, mStart, mEnd);
+    Value rowSize = computeMaskedMerge(
+        rewriter, loc, valueType, cStart, cEnd, Ci, Cx, iStart, iEnd, Ii, Ix,
+        mStart, mEnd, Mi, c0, nullptr, nullptr, accumulateBlock,
+        maskComplement, replace);
+    Value rowSize64 =
+        rewriter.create<arith::IndexCastOp>(loc, rowSize, int64Type);
+    storeI64(rewriter, loc, rowSize64, Op, row);
+  }
+  rewriter.setInsertionPointAfter(rowLoop1);
+
+  // 2nd pass
+  //   Compute the cumsum of values in Op to build the final Op
+  //   Then resize output indices and values
+  buildExclusiveScan(rewriter, loc, Op, nrows);
+
+  Value nnz = rewriter.create<graphblas::NumValsOp>(loc, output);
+  callResizeIndex(rewriter, module, loc, output, c1, nnz);
+  callResizeValues(rewriter, module, loc, output, nnz);
+
+  Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+      loc, getMemrefIndexType(output.getType()), output, c1);
+  Value Ox = rewriter.create<sparse_tensor::ToValuesOp>(
+      loc, getMemrefValueType(output.getType()), output);
+
+  // 3rd pass
+  //   In parallel over the rows, write the merged entries
+  //   Store in Oi and Ox
+  scf::ParallelOp rowLoop3 =
+      rewriter.create<scf::ParallelOp>(loc, c0, nrows, c1);
+  {
+    rewriter.setInsertionPointToStart(rowLoop3.getBody());
+    Value row = rowLoop3.getInductionVars().front();
+    Value cStart, cEnd, iStart, iEnd, mStart, mEnd;
+    rowBounds(Cp, row, cStart, cEnd);
+    rowBounds(Ip, row, iStart, iEnd);
+    if (mask)
+      rowBounds(Mp, row, mStart, mEnd);
+    Value oStart64 = loadI64(rewriter, loc, Op, row);
+    Value oStart =
+        rewriter.create<arith::IndexCastOp>(loc, oStart64, indexType);
+    computeMaskedMerge(rewriter, loc, valueType, cStart, cEnd, Ci, Cx, iStart,
+                       iEnd, Ii, Ix, mStart, mEnd, Mi, oStart, Oi, Ox,
+                       accumulateBlock, maskComplement, replace);
+  }
+  rewriter.setInsertionPointAfter(rowLoop3);
+}
+
+void computeMaskedUpdate(PatternRewriter &rewriter, Location loc,
+                         ModuleOp module, Value input, Value mask, Value output,
+                         Block *accumulateBlock, bool maskComplement,
+                         bool replace) {
+  // The current entries are read from `output`, so the merge is written to a
+  // new tensor and its buffers are swapped in afterwards
+  Value merged = callEmptyLike(rewriter, module, loc, output);
+
+  unsigned rank = output.getType().cast<RankedTensorType>().getRank();
+  auto computeMerge =
+      rank == 2 ? computeMatrixMaskedUpdate : computeVectorMaskedUpdate;
+  computeMerge(rewriter, loc, module, output, input, mask, merged,
+               accumulateBlock, maskComplement, replace);
+
+  // Swapping into `output` gives it fresh buffers first if its old ones are
+  // shared with a view, so nothing is copied and the view is left intact
+  callSwapPointers(rewriter, module, loc, output, merged);
+  callSwapIndices(rewriter, module, loc, output, merged);
+  callSwapValues(rewriter, module, loc, output, merged);
+  rewriter.create<sparse_tensor::ReleaseOp>(loc, merged);
+}
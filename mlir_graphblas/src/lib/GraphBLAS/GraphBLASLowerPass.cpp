@@ -93,19 +93,15 @@ public:
     Value inputTensor = op.input();
     Type inputType = inputTensor.getType();
 
-    sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
-        sparse_tensor::getSparseTensorEncoding(inputType);
-    unsigned pointerBitWidth = sparseEncoding.getPointerBitWidth();
-    Type pointerType = rewriter.getIntegerType(pointerBitWidth);
     Type indexType = rewriter.getIndexType();
 
     // Access the pointers
-    Type memref1DPointerType = MemRefType::get({-1}, pointerType);
     unsigned rank = inputType.dyn_cast<RankedTensorType>().getRank();
     Value c_rank_minus_1 =
         rewriter.create<arith::ConstantIndexOp>(loc, rank - 1);
     Value ptrs = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DPointerType, inputTensor, c_rank_minus_1);
+        loc, getMemrefPointerType(inputTensor.getType()), inputTensor,
+        c_rank_minus_1);
 
     // Find length of pointer array
     Value npointers;
@@ -123,7 +119,7 @@ public:
     }
 
     // The last value from the pointers is the number of nonzero values
-    Value nnz_ptype = rewriter.create<memref::LoadOp>(loc, ptrs, npointers);
+    Value nnz_ptype = loadI64(rewriter, loc, ptrs, npointers);
     Value nnz = rewriter.create<arith::IndexCastOp>(loc, nnz_ptype, indexType);
 
     rewriter.replaceOp(op, nnz);
@@ -184,13 +180,12 @@ public:
     Value c1_64 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
 
     // Get sparse tensor info
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
     Type memref1DValueType = MemRefType::get({-1}, valueType);
 
     Value inputPtrs = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, inputTensor, c1);
+        loc, getMemrefPointerType(inputTensor.getType()), inputTensor, c1);
     Value inputIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, inputTensor, c1);
+        loc, getMemrefIndexType(inputTensor.getType()), inputTensor, c1);
     Value inputValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, inputTensor);
     Value nrow = rewriter.create<graphblas::NumRowsOp>(loc, inputTensor);
@@ -235,100 +230,146 @@ public:
     output = castToTensor(rewriter, module, loc, output, flippedType);
 
     Value outputPtrs = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, output, c1);
+        loc, getMemrefPointerType(output.getType()), output, c1);
     Value outputIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, output, c1);
+        loc, getMemrefIndexType(output.getType()), output, c1);
     Value outputValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, output);
 
-    // compute number of non-zero entries per column of A
+    // The rows of A are split into blocks which are transposed in parallel.
+    // Each block keeps its own count per column of B.
+    Value blockSize, numBlocks;
+    computeScatterBlocks(rewriter, loc, nrow, nnz, ncol, blockSize, numBlocks);
 
-    // init B.pointers to zero
-    scf::ForOp initLoop = rewriter.create<scf::ForOp>(loc, c0, ncol, c1);
-    Value initLoopIdx = initLoop.getInductionVar();
-    rewriter.setInsertionPointToStart(initLoop.getBody());
-    rewriter.create<memref::StoreOp>(loc, c0_64, outputPtrs, initLoopIdx);
-    rewriter.setInsertionPointAfter(initLoop);
+    Value countsSize = rewriter.create<arith::MulIOp>(loc, numBlocks, ncol);
+    Value counts = rewriter.create<memref::AllocOp>(
+        loc, MemRefType::get({-1}, int64Type), countsSize);
 
-    // store pointers
-    scf::ForOp ptrLoop = rewriter.create<scf::ForOp>(loc, c0, nnz, c1);
-    Value ptrLoopIdx = ptrLoop.getInductionVar();
+    // 1st pass
+    //   Count the non-zero entries per column of A within each block.
+    //   Store results in counts[block * ncol + col]
+    scf::ParallelOp countLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    Value block = countLoop.getInductionVars().front();
+    {
+      rewriter.setInsertionPointToStart(countLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, ncol);
+      Value blockOffsetEnd =
+          rewriter.create<arith::AddIOp>(loc, blockOffset, ncol);
+      scf::ForOp initLoop =
+          rewriter.create<scf::ForOp>(loc, blockOffset, blockOffsetEnd, c1);
+      rewriter.setInsertionPointToStart(initLoop.getBody());
+      rewriter.create<memref::StoreOp>(loc, c0_64, counts,
+                                       initLoop.getInductionVar());
+      rewriter.setInsertionPointAfter(initLoop);
+
+      Value rowStart, rowEnd;
+      computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                            rowEnd);
+      scf::ForOp rowLoop =
+          rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+      Value row = rowLoop.getInductionVar();
+      rewriter.setInsertionPointToStart(rowLoop.getBody());
+      Value j_start_64 = loadI64(rewriter, loc, inputPtrs, row);
+      Value j_start =
+          rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
+      Value row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
+      Value j_end_64 = loadI64(rewriter, loc, inputPtrs, row_plus1);
+      Value j_end =
+          rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
 
-    rewriter.setInsertionPointToStart(ptrLoop.getBody());
-    Value colA64 =
-        rewriter.create<memref::LoadOp>(loc, inputIndices, ptrLoopIdx);
-    Value colA = rewriter.create<arith::IndexCastOp>(loc, colA64, indexType);
-    Value colB = rewriter.create<memref::LoadOp>(loc, outputPtrs, colA);
-    Value colB1 = rewriter.create<arith::AddIOp>(loc, colB, c1_64);
-    rewriter.create<memref::StoreOp>(loc, colB1, outputPtrs, colA);
+      scf::ForOp ptrLoop = rewriter.create<scf::ForOp>(loc, j_start, j_end, c1);
+      Value jj = ptrLoop.getInductionVar();
+      rewriter.setInsertionPointToStart(ptrLoop.getBody());
+      Value colA64 = loadI64(rewriter, loc, inputIndices, jj);
+      Value colA = rewriter.create<arith::IndexCastOp>(loc, colA64, indexType);
+      Value countPos = rewriter.create<arith::AddIOp>(loc, blockOffset, colA);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, countPos);
+      Value count1 = rewriter.create<arith::AddIOp>(loc, count, c1_64);
+      rewriter.create<memref::StoreOp>(loc, count1, counts, countPos);
+    }
+    rewriter.setInsertionPointAfter(countLoop);
 
-    rewriter.setInsertionPointAfter(ptrLoop);
+    // 2nd pass
+    //   Replace each count with the offset of the block within its column
+    //   and store the column totals in Bp
+    scf::ParallelOp colLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, ncol, c1);
+    Value colIdx = colLoop.getInductionVars().front();
+    {
+      rewriter.setInsertionPointToStart(colLoop.getBody());
+      scf::ForOp blockLoop = rewriter.create<scf::ForOp>(
+          loc, c0, numBlocks, c1, ValueRange{c0_64});
+      Value blockIdx = blockLoop.getInductionVar();
+      Value colOffset = blockLoop.getLoopBody().getArgument(1);
+      rewriter.setInsertionPointToStart(blockLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, blockIdx, ncol);
+      Value countPos = rewriter.create<arith::AddIOp>(loc, blockOffset, colIdx);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, countPos);
+      rewriter.create<memref::StoreOp>(loc, colOffset, counts, countPos);
+      Value nextColOffset =
+          rewriter.create<arith::AddIOp>(loc, colOffset, count);
+      rewriter.create<scf::YieldOp>(loc, nextColOffset);
+      rewriter.setInsertionPointAfter(blockLoop);
+      storeI64(rewriter, loc, blockLoop.getResult(0), outputPtrs, colIdx);
+    }
+    rewriter.setInsertionPointAfter(colLoop);
 
     // cumsum the nnz per column to get Bp
-    rewriter.create<memref::StoreOp>(loc, c0_64, outputPtrs, ncol);
-
-    scf::ForOp colAccLoop = rewriter.create<scf::ForOp>(loc, c0, ncol, c1);
-    Value colAccLoopIdx = colAccLoop.getInductionVar();
-
-    rewriter.setInsertionPointToStart(colAccLoop.getBody());
-    Value temp =
-        rewriter.create<memref::LoadOp>(loc, outputPtrs, colAccLoopIdx);
-    Value cumsum = rewriter.create<memref::LoadOp>(loc, outputPtrs, ncol);
-    rewriter.create<memref::StoreOp>(loc, cumsum, outputPtrs, colAccLoopIdx);
-    Value cumsum2 = rewriter.create<arith::AddIOp>(loc, cumsum, temp);
-    rewriter.create<memref::StoreOp>(loc, cumsum2, outputPtrs, ncol);
-
-    rewriter.setInsertionPointAfter(colAccLoop);
-
-    // copy values
-    scf::ForOp outerLoop = rewriter.create<scf::ForOp>(loc, c0, nrow, c1);
-    Value rowIdx = outerLoop.getInductionVar();
-
-    rewriter.setInsertionPointToStart(outerLoop.getBody());
-    Value row_64 = rewriter.create<arith::IndexCastOp>(loc, rowIdx, int64Type);
-    Value j_start_64 = rewriter.create<memref::LoadOp>(loc, inputPtrs, rowIdx);
-    Value j_start =
-        rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
-    Value row_plus1 = rewriter.create<arith::AddIOp>(loc, rowIdx, c1);
-    Value j_end_64 = rewriter.create<memref::LoadOp>(loc, inputPtrs, row_plus1);
-    Value j_end = rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
-
-    scf::ForOp innerLoop = rewriter.create<scf::ForOp>(loc, j_start, j_end, c1);
-    Value jj = innerLoop.getInductionVar();
-
-    rewriter.setInsertionPointToStart(innerLoop.getBody());
-
-    Value col_64 = rewriter.create<memref::LoadOp>(loc, inputIndices, jj);
-    Value col = rewriter.create<arith::IndexCastOp>(loc, col_64, indexType);
-    Value dest_64 = rewriter.create<memref::LoadOp>(loc, outputPtrs, col);
-    Value dest = rewriter.create<arith::IndexCastOp>(loc, dest_64, indexType);
-    rewriter.create<memref::StoreOp>(loc, row_64, outputIndices, dest);
-    Value axjj = rewriter.create<memref::LoadOp>(loc, inputValues, jj);
-    rewriter.create<memref::StoreOp>(loc, axjj, outputValues, dest);
+    buildExclusiveScan(rewriter, loc, outputPtrs, ncol);
 
-    // Bp[col]++
-    Value bp_inc = rewriter.create<memref::LoadOp>(loc, outputPtrs, col);
-    Value bp_inc1 = rewriter.create<arith::AddIOp>(loc, bp_inc, c1_64);
-    rewriter.create<memref::StoreOp>(loc, bp_inc1, outputPtrs, col);
-
-    rewriter.setInsertionPointAfter(outerLoop);
-
-    Value last_last = rewriter.create<memref::LoadOp>(loc, outputPtrs, ncol);
-    rewriter.create<memref::StoreOp>(loc, c0_64, outputPtrs, ncol);
-
-    scf::ForOp finalLoop = rewriter.create<scf::ForOp>(loc, c0, ncol, c1);
-    Value iCol = finalLoop.getInductionVar();
+    // 3rd pass
+    //   Copy values. Each block writes to its own slice of every column, in
+    //   row order, so the output matches a serial transpose exactly.
+    scf::ParallelOp copyLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    block = copyLoop.getInductionVars().front();
+    {
+      rewriter.setInsertionPointToStart(copyLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, ncol);
+      Value rowStart, rowEnd;
+      computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                            rowEnd);
+      scf::ForOp outerLoop =
+          rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+      Value rowIdx = outerLoop.getInductionVar();
 
-    rewriter.setInsertionPointToStart(finalLoop.getBody());
+      rewriter.setInsertionPointToStart(outerLoop.getBody());
+      Value row_64 =
+          rewriter.create<arith::IndexCastOp>(loc, rowIdx, int64Type);
+      Value j_start_64 = loadI64(rewriter, loc, inputPtrs, rowIdx);
+      Value j_start =
+          rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
+      Value row_plus1 = rewriter.create<arith::AddIOp>(loc, rowIdx, c1);
+      Value j_end_64 = loadI64(rewriter, loc, inputPtrs, row_plus1);
+      Value j_end =
+          rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
 
-    Value swapTemp = rewriter.create<memref::LoadOp>(loc, outputPtrs, iCol);
-    Value last = rewriter.create<memref::LoadOp>(loc, outputPtrs, ncol);
-    rewriter.create<memref::StoreOp>(loc, last, outputPtrs, iCol);
-    rewriter.create<memref::StoreOp>(loc, swapTemp, outputPtrs, ncol);
+      scf::ForOp innerLoop =
+          rewriter.create<scf::ForOp>(loc, j_start, j_end, c1);
+      Value jj = innerLoop.getInductionVar();
 
-    rewriter.setInsertionPointAfter(finalLoop);
+      rewriter.setInsertionPointToStart(innerLoop.getBody());
+      Value col_64 = loadI64(rewriter, loc, inputIndices, jj);
+      Value col = rewriter.create<arith::IndexCastOp>(loc, col_64, indexType);
+      Value countPos = rewriter.create<arith::AddIOp>(loc, blockOffset, col);
+      Value colStart_64 = loadI64(rewriter, loc, outputPtrs, col);
+      Value blockPos_64 =
+          rewriter.create<memref::LoadOp>(loc, counts, countPos);
+      Value dest_64 =
+          rewriter.create<arith::AddIOp>(loc, colStart_64, blockPos_64);
+      Value dest = rewriter.create<arith::IndexCastOp>(loc, dest_64, indexType);
+      storeI64(rewriter, loc, row_64, outputIndices, dest);
+      Value axjj = rewriter.create<memref::LoadOp>(loc, inputValues, jj);
+      rewriter.create<memref::StoreOp>(loc, axjj, outputValues, dest);
+
+      // counts[block * ncol + col]++
+      Value blockPos1 = rewriter.create<arith::AddIOp>(loc, blockPos_64, c1_64);
+      rewriter.create<memref::StoreOp>(loc, blockPos1, counts, countPos);
+    }
+    rewriter.setInsertionPointAfter(copyLoop);
 
-    rewriter.create<memref::StoreOp>(loc, last_last, outputPtrs, ncol);
+    rewriter.create<memref::DeallocOp>(loc, counts);
 
     rewriter.replaceOp(op, output);
 
@@ -358,17 +399,9 @@ public:
     }
 
     RankedTensorType inputTensorType = inputType.cast<RankedTensorType>();
-    // sparse_tensor::SparseTensorEncodingAttr inputSparseEncoding =
-    //    sparse_tensor::getSparseTensorEncoding(inputTensorType);
-    // unsigned inputPtrBitWidth = inputSparseEncoding.getPointerBitWidth();
-    // unsigned inputIdxBitWidth = inputSparseEncoding.getIndexBitWidth();
     Type inputValueType = inputTensorType.getElementType();
 
     RankedTensorType outputTensorType = outputType.cast<RankedTensorType>();
-    // sparse_tensor::SparseTensorEncodingAttr outputSparseEncoding =
-    //    sparse_tensor::getSparseTensorEncoding(outputTensorType);
-    // unsigned outputPtrBitWidth = outputSparseEncoding.getPointerBitWidth();
-    // unsigned outputIdxBitWidth = outputSparseEncoding.getIndexBitWidth();
     Type outputValueType = outputTensorType.getElementType();
 
     unsigned rank = inputTensorType.getRank();
@@ -381,27 +414,62 @@ public:
 
     // Get the shape as a ValueRange
     ValueRange shape;
+    Value compressedSize;
     if (rank == 1) {
       Value size = rewriter.create<graphblas::SizeOp>(loc, input);
       shape = ValueRange{size};
+      compressedSize = size;
     } else {
       Value nrows = rewriter.create<graphblas::NumRowsOp>(loc, input);
       Value ncols = rewriter.create<graphblas::NumColsOp>(loc, input);
       shape = ValueRange{nrows, ncols};
+      compressedSize = hasRowOrdering(inputType) ? ncols : nrows;
     }
 
     // Create a new tensor with the correct output value type
     Value output =
         rewriter.create<sparse_tensor::InitOp>(loc, outputType, shape);
 
-    // Make a copy of the input so we can swap the pointers and indices
-    Value duplicate = callDupTensor(rewriter, module, loc, input);
-    callSwapPointers(rewriter, module, loc, duplicate, output);
-    callSwapIndices(rewriter, module, loc, duplicate, output);
-    rewriter.create<sparse_tensor::ReleaseOp>(loc, duplicate);
+    // Pointers and indices are unchanged, so share them with the input unless
+    // the output stores them at another bit width
+    Value nnz = rewriter.create<graphblas::NumValsOp>(loc, input);
+    Value dimIndex = (rank == 2 ? c1 : c0);
+    MemRefType memrefIPointerType = getMemrefPointerType(inputType);
+    MemRefType memrefOPointerType = getMemrefPointerType(outputType);
+    if (memrefIPointerType == memrefOPointerType) {
+      callSharePointers(rewriter, module, loc, output, input);
+    } else {
+      Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, memrefIPointerType, input, dimIndex);
+      Value npointers = rewriter.create<memref::DimOp>(loc, Ip, c0);
+      callResizePointers(rewriter, module, loc, output, dimIndex, npointers);
+      Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, memrefOPointerType, output, dimIndex);
+      // Pointers never exceed the number of values
+      Value nnzPlus1 = rewriter.create<arith::AddIOp>(loc, nnz, c1);
+      assertFitsBitWidth(rewriter, loc, nnzPlus1, Op,
+                         "graphblas.cast: too many values for the pointer "
+                         "bit width");
+      copyI64(rewriter, loc, Ip, Op);
+    }
+    MemRefType memrefIIndexType = getMemrefIndexType(inputType);
+    MemRefType memrefOIndexType = getMemrefIndexType(outputType);
+    if (memrefIIndexType == memrefOIndexType) {
+      callShareIndices(rewriter, module, loc, output, input);
+    } else {
+      callResizeIndex(rewriter, module, loc, output, dimIndex, nnz);
+      Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, memrefIIndexType, input, dimIndex);
+      Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, memrefOIndexType, output, dimIndex);
+      // Indices are below the size of the compressed dimension
+      assertFitsBitWidth(rewriter, loc, compressedSize, Oi,
+                         "graphblas.cast: dimension too large for the index "
+                         "bit width");
+      copyI64(rewriter, loc, Ii, Oi);
+    }
 
     // Cast values to new dtype
-    Value nnz = rewriter.create<graphblas::NumValsOp>(loc, input);
     callResizeValues(rewriter, module, loc, output, nnz);
     Value inputValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DIValueType, input);
@@ -542,8 +610,9 @@ public:
     RankedTensorType flippedInputType =
         op.getResult().getType().cast<RankedTensorType>();
 
-    // Cast types
-    Value output = callDupTensor(rewriter, module, loc, inputTensor);
+    // Cast types; the view shares the input's storage, so only the
+    // dimension labels are copied
+    Value output = callViewTensor(rewriter, module, loc, inputTensor);
     Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
     if (inputTypeIsCSR) {
@@ -574,8 +643,10 @@ public:
     OperandRange thunks = op.thunks();
 
     if (selector == "probability") {
+      ModuleOp module = op->getParentOfType<ModuleOp>();
       Value thunk = thunks[0];
       Value rngContext = thunks[1];
+      callStartRandomStream(rewriter, module, op->getLoc(), rngContext);
       auto probBlock = std::bind(probabilityBlock, _1, _2, _3, _4, _5, _6, _7,
                                  thunk, rngContext);
       return buildAlgorithm<graphblas::SelectOp>(op, rewriter, probBlock);
@@ -623,11 +694,13 @@ public:
     return success();
   };
 
+  // `func` decides whether to keep each element and may replace `val` with
+  // the value to be stored for it
   template <class T>
   static LogicalResult
   buildAlgorithm(T op, PatternRewriter &rewriter,
                  std::function<LogicalResult(T, PatternRewriter &, Location,
-                                             Value &, Value, Value, Value)>
+                                             Value &, Value &, Value, Value)>
                      func) {
     ModuleOp module = op->template getParentOfType<ModuleOp>();
     Location loc = op->getLoc();
@@ -637,73 +710,79 @@ public:
     Type valueType = inputType.getElementType();
     Type int64Type = rewriter.getIntegerType(64);
     Type indexType = rewriter.getIndexType();
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
     Type memref1DValueType = MemRefType::get({-1}, valueType);
+    MemRefType memref1DBoolType =
+        MemRefType::get({-1}, rewriter.getI1Type());
 
     // Initial constants
     Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
-    Value c1_64 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
 
     // Get sparse tensor info
     unsigned rank = inputType.getRank();
-    Value nrow;
+    bool colWise = false;
     if (rank == 2)
-      nrow = rewriter.create<graphblas::NumRowsOp>(loc, input);
-    else
+      colWise = hasColumnOrdering(inputType);
+    Value nrow;
+    if (rank == 1)
       // Vectors are stored as a 1xn matrix
       // so the code works correctly if we assume a single row
       nrow = c1;
+    else if (colWise)
+      nrow = rewriter.create<graphblas::NumColsOp>(loc, input);
+    else
+      nrow = rewriter.create<graphblas::NumRowsOp>(loc, input);
 
     Value indexPos = (rank == 2 ? c1 : c0);
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, input, indexPos);
-    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           input, indexPos);
+        loc, getMemrefPointerType(input.getType()), input, indexPos);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, indexPos);
     Value Ax = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, input);
+    Value inputNnz = rewriter.create<graphblas::NumValsOp>(loc, input);
 
     // Create output
-    Value output = rewriter.create<graphblas::DupOp>(loc, input);
-    bool colWise = false;
-    if (rank == 2)
-      colWise = hasColumnOrdering(inputType);
-
+    Value output = callEmptyLike(rewriter, module, loc, input);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, output, indexPos);
-    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           output, indexPos);
-    Value Bx = rewriter.create<sparse_tensor::ToValuesOp>(
-        loc, memref1DValueType, output);
+        loc, getMemrefPointerType(output.getType()), output, indexPos);
+
+    // `func` can only be inlined once, so the 1st pass records its decision
+    // for every input element, along with the value to keep if it replaced it
+    Value keepFlags =
+        rewriter.create<memref::AllocOp>(loc, memref1DBoolType, inputNnz);
+    Value keptValues = nullptr;
 
-    // Loop
-    scf::ForOp outerLoop = rewriter.create<scf::ForOp>(loc, c0, nrow, c1);
-    Value row = outerLoop.getInductionVar();
+    // 1st pass
+    //   Count the kept elements of each row
+    //   Store results in Bp
+    scf::ParallelOp rowLoop1 =
+        rewriter.create<scf::ParallelOp>(loc, c0, nrow, c1);
+    Value row = rowLoop1.getInductionVars()[0];
     {
-      rewriter.setInsertionPointToStart(outerLoop.getBody());
+      rewriter.setInsertionPointToStart(rowLoop1.getBody());
       Value row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
 
-      Value bp_curr_count = rewriter.create<memref::LoadOp>(loc, Bp, row);
-      rewriter.create<memref::StoreOp>(loc, bp_curr_count, Bp, row_plus1);
-
-      Value j_start_64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
-      Value j_end_64 = rewriter.create<memref::LoadOp>(loc, Ap, row_plus1);
+      Value j_start_64 = loadI64(rewriter, loc, Ap, row);
+      Value j_end_64 = loadI64(rewriter, loc, Ap, row_plus1);
       Value j_start =
           rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
       Value j_end =
           rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
 
       scf::ForOp innerLoop =
-          rewriter.create<scf::ForOp>(loc, j_start, j_end, c1);
+          rewriter.create<scf::ForOp>(loc, j_start, j_end, c1, ValueRange{c0});
       Value jj = innerLoop.getInductionVar();
+      Value count = innerLoop.getLoopBody().getArgument(1);
       {
         rewriter.setInsertionPointToStart(innerLoop.getBody());
-        Value col_64 = rewriter.create<memref::LoadOp>(loc, Aj, jj);
+        Value col_64 = loadI64(rewriter, loc, Aj, jj);
         Value col = rewriter.create<arith::IndexCastOp>(loc, col_64, indexType);
         Value val = rewriter.create<memref::LoadOp>(loc, Ax, jj);
 
         // Inject code from func
         Value keep = nullptr;
+        Value origVal = val;
         LogicalResult funcResult = failure();
         if (rank == 1)
           funcResult = func(op, rewriter, loc, keep, val, col, col);
@@ -715,34 +794,95 @@ public:
           return funcResult;
         }
 
+        rewriter.create<memref::StoreOp>(loc, keep, keepFlags, jj);
+        if (val != origVal) {
+          {
+            OpBuilder::InsertionGuard guard(rewriter);
+            rewriter.setInsertionPoint(rowLoop1);
+            keptValues = rewriter.create<memref::AllocOp>(
+                loc, MemRefType::get({-1}, val.getType()), inputNnz);
+          }
+          rewriter.create<memref::StoreOp>(loc, val, keptValues, jj);
+        }
+
+        Value increment = rewriter.create<SelectOp>(loc, keep, c1, c0);
+        Value nextCount = rewriter.create<arith::AddIOp>(loc, count, increment);
+        rewriter.create<scf::YieldOp>(loc, nextCount);
+      }
+
+      rewriter.setInsertionPointAfter(innerLoop);
+      Value rowSize_64 = rewriter.create<arith::IndexCastOp>(
+          loc, innerLoop.getResult(0), int64Type);
+      storeI64(rewriter, loc, rowSize_64, Bp, row);
+
+      rewriter.setInsertionPointAfter(rowLoop1);
+    }
+
+    // 2nd pass
+    //   Compute the cumsum of values in Bp to build the final Bp
+    //   Then resize output indices and values
+    Value nnz_64 = buildExclusiveScan(rewriter, loc, Bp, nrow);
+    Value nnz = rewriter.create<arith::IndexCastOp>(loc, nnz_64, indexType);
+    callResizeIndex(rewriter, module, loc, output, indexPos, nnz);
+    callResizeValues(rewriter, module, loc, output, nnz);
+
+    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(output.getType()), output, indexPos);
+    Value Bx = rewriter.create<sparse_tensor::ToValuesOp>(
+        loc, memref1DValueType, output);
+
+    // 3rd pass
+    //   Scatter the kept elements of each row starting at Bp[row]
+    scf::ParallelOp rowLoop3 =
+        rewriter.create<scf::ParallelOp>(loc, c0, nrow, c1);
+    row = rowLoop3.getInductionVars()[0];
+    {
+      rewriter.setInsertionPointToStart(rowLoop3.getBody());
+      Value row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
+
+      Value j_start_64 = loadI64(rewriter, loc, Ap, row);
+      Value j_end_64 = loadI64(rewriter, loc, Ap, row_plus1);
+      Value j_start =
+          rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
+      Value j_end =
+          rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
+      Value bj_start_64 = loadI64(rewriter, loc, Bp, row);
+      Value bj_start =
+          rewriter.create<arith::IndexCastOp>(loc, bj_start_64, indexType);
+
+      scf::ForOp innerLoop = rewriter.create<scf::ForOp>(
+          loc, j_start, j_end, c1, ValueRange{bj_start});
+      Value jj = innerLoop.getInductionVar();
+      Value bj_pos = innerLoop.getLoopBody().getArgument(1);
+      {
+        rewriter.setInsertionPointToStart(innerLoop.getBody());
+        Value keep = rewriter.create<memref::LoadOp>(loc, keepFlags, jj);
+
         scf::IfOp ifKeep =
             rewriter.create<scf::IfOp>(loc, keep, false /* no else region */);
         {
           rewriter.setInsertionPointToStart(ifKeep.thenBlock());
 
-          Value bj_pos_64 = rewriter.create<memref::LoadOp>(loc, Bp, row_plus1);
-          Value bj_pos =
-              rewriter.create<arith::IndexCastOp>(loc, bj_pos_64, indexType);
-
-          rewriter.create<memref::StoreOp>(loc, col_64, Bj, bj_pos);
+          Value col_64 = loadI64(rewriter, loc, Aj, jj);
+          Value val = rewriter.create<memref::LoadOp>(
+              loc, keptValues ? keptValues : Ax, jj);
+          storeI64(rewriter, loc, col_64, Bj, bj_pos);
           rewriter.create<memref::StoreOp>(loc, val, Bx, bj_pos);
 
-          Value bj_pos_plus1 =
-              rewriter.create<arith::AddIOp>(loc, bj_pos_64, c1_64);
-          rewriter.create<memref::StoreOp>(loc, bj_pos_plus1, Bp, row_plus1);
-
           rewriter.setInsertionPointAfter(ifKeep);
         }
-        // rewriter.setInsertionPointAfter(innerLoop);
+
+        Value increment = rewriter.create<SelectOp>(loc, keep, c1, c0);
+        Value bj_next = rewriter.create<arith::AddIOp>(loc, bj_pos, increment);
+        rewriter.create<scf::YieldOp>(loc, bj_next);
       }
 
-      rewriter.setInsertionPointAfter(outerLoop);
+      rewriter.setInsertionPointAfter(rowLoop3);
     }
 
-    // trim excess values
-    Value nnz = rewriter.create<graphblas::NumValsOp>(loc, output);
-    callResizeIndex(rewriter, module, loc, output, indexPos, nnz);
-    callResizeValues(rewriter, module, loc, output, nnz);
+    rewriter.create<memref::DeallocOp>(loc, keepFlags);
+    if (keptValues)
+      rewriter.create<memref::DeallocOp>(loc, keptValues);
 
     rewriter.replaceOp(op, output);
 
@@ -754,17 +894,15 @@ public:
 private:
   static LogicalResult
   probabilityBlock(graphblas::SelectOp op, PatternRewriter &rewriter,
-                   Location loc, Value &keep, Value val, Value row, Value col,
+                   Location loc, Value &keep, Value &val, Value row, Value col,
                    // These are not part of the standard signature
                    // and will be passed using `bind`
                    Value thunk, Value rngContext) {
-    Type f64Type = rewriter.getF64Type();
-    SymbolRefAttr random_double =
-        SymbolRefAttr::get(rewriter.getContext(), "random_double");
-    // Get a random double between [0, 1)
-    CallOp randCall = rewriter.create<mlir::CallOp>(
-        loc, random_double, TypeRange{f64Type}, ArrayRef<Value>({rngContext}));
-    Value rand = randCall.getResult(0);
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+    // Get a random double between [0, 1), drawn for this element so that it
+    // does not depend on the order in which elements are visited
+    Value rand =
+        callRandomDoubleAt(rewriter, module, loc, rngContext, row, col);
     keep = rewriter.create<arith::CmpFOp>(loc, arith::CmpFPredicate::OLT, rand,
                                           thunk);
 
@@ -791,35 +929,29 @@ public:
 private:
   static LogicalResult genericBlock(graphblas::SelectGenericOp op,
                                     PatternRewriter &rewriter, Location loc,
-                                    Value &keep, Value val, Value row,
+                                    Value &keep, Value &val, Value row,
                                     Value col) {
     // Required blocks
     RegionRange extensions = op.extensions();
     ExtensionBlocks extBlocks;
     std::set<graphblas::YieldKind> required = {
         graphblas::YieldKind::SELECT_OUT};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::TRANSFORM_OUT};
     LogicalResult extractResult =
-        extBlocks.extractBlocks(op, extensions, required, {});
+        extBlocks.extractBlocks(op, extensions, required, optional);
 
     if (extractResult.failed()) {
       return extractResult;
     }
 
-    int numArguments = extBlocks.selectOut->getArguments().size();
-
-    // scf::ForOp automatically gets an empty scf.yield at the end which
-    // we need to insert before
-    Operation *scfYield = rewriter.getBlock()->getTerminator();
+    // A transform_out block computes the value which is both tested and kept
+    if (extBlocks.transformOut)
+      val = inlineExtensionBlock(rewriter, extBlocks.transformOut,
+                                 {val, row, col});
 
     // insert selectOut block
-    graphblas::YieldOp selectOutYield =
-        llvm::dyn_cast_or_null<graphblas::YieldOp>(
-            extBlocks.selectOut->getTerminator());
-
-    ValueRange subVals = ValueRange{val, row, col}.slice(0, numArguments);
-    rewriter.mergeBlockBefore(extBlocks.selectOut, scfYield, subVals);
-    keep = selectOutYield.values().front();
-    rewriter.eraseOp(selectOutYield);
+    keep = inlineExtensionBlock(rewriter, extBlocks.selectOut, {val, row, col});
 
     return success();
   };
@@ -830,12 +962,22 @@ class ReduceToVectorDWIMRewrite
 public:
   using OpRewritePattern<graphblas::ReduceToVectorOp>::OpRewritePattern;
 
-  static bool needsDWIM(graphblas::ReduceToVectorOp op) {
+  // Whether `op` reduces across the compressed dimension of its input, e.g.
+  // the columns of a CSR matrix
+  template <class T> static bool isCrossAxis(T op) {
     int axis = op.axis();
     bool isCSR = hasRowOrdering(op.input().getType());
     return ((axis == 0 && isCSR) || (axis == 1 && !isCSR));
   };
 
+  // Other aggregators are scattered across the axis directly, but argmin and
+  // argmax need the index along with the value, so their input is converted
+  static bool needsDWIM(graphblas::ReduceToVectorOp op) {
+    StringRef aggregator = op.aggregator();
+    return isCrossAxis(op) &&
+           (aggregator == "argmin" || aggregator == "argmax");
+  };
+
   LogicalResult matchAndRewrite(graphblas::ReduceToVectorOp op,
                                 PatternRewriter &rewriter) const override {
     if (!needsDWIM(op))
@@ -872,12 +1014,25 @@ public:
     Type elementType = inputType.getElementType();
     Type i64Type = rewriter.getI64Type();
 
-    if (aggregator == "count") {
+    bool crossAxis = ReduceToVectorDWIMRewrite::isCrossAxis(op);
+
+    if (aggregator == "count" && crossAxis) {
+      return buildCrossAxisAlgorithm<graphblas::ReduceToVectorOp>(
+          op, rewriter, i64Type, nullptr);
+    } else if (aggregator == "count") {
       return buildAlgorithm<graphblas::ReduceToVectorOp>(op, rewriter, i64Type,
                                                          countBlock);
     } else if (aggregator == "argmin" or aggregator == "argmax") {
       return buildAlgorithm<graphblas::ReduceToVectorOp>(op, rewriter, i64Type,
                                                          argminmaxBlock);
+    } else if ((aggregator == "first" or aggregator == "last") && crossAxis) {
+      // Blocks are combined in order, so the entries of each output index are
+      // seen in the order of the compressed dimension
+      bool keepFirst = aggregator == "first";
+      auto firstLast = [keepFirst](PatternRewriter &, Location, Value acc,
+                                   Value x) { return keepFirst ? acc : x; };
+      return buildCrossAxisAlgorithm<graphblas::ReduceToVectorOp>(
+          op, rewriter, elementType, firstLast);
     } else if (aggregator == "first" or aggregator == "last") {
       return buildAlgorithm<graphblas::ReduceToVectorOp>(
           op, rewriter, elementType, firstLastBlock);
@@ -891,7 +1046,8 @@ public:
                         rewriter.getBoolAttr(op.mask_complement()));
       graphblas::ReduceToVectorGenericOp newReduceOp =
           rewriter.create<graphblas::ReduceToVectorGenericOp>(
-              loc, op->getResultTypes(), input, attributes.getAttrs(), 2);
+              loc, op->getResultTypes(), op->getOperands(),
+              attributes.getAttrs(), 2);
 
       if (failed(populateMonoid(rewriter, loc, op.aggregator(), elementType,
                                 newReduceOp.getRegions().slice(0, 2),
@@ -912,34 +1068,25 @@ public:
       std::function<LogicalResult(T, PatternRewriter &, Location, Value &,
                                   Value, Value, Value, Value)>
           func) {
-    MLIRContext *context = op.getContext();
     ModuleOp module = op->template getParentOfType<ModuleOp>();
     Location loc = op->getLoc();
 
     // Inputs
     Value input = op.input();
-    Value mask = op.mask();
     int axis = op.axis();
-    bool maskComplement = op.mask_complement();
 
     // Types
-    Type indexType = rewriter.getIndexType();
-    Type i64Type = rewriter.getIntegerType(64);
     RankedTensorType inputType = input.getType().dyn_cast<RankedTensorType>();
-    Type memrefPointerType = getMemrefPointerType(inputType);
-    Type memrefIndexType = getMemrefIndexType(inputType);
     Type memrefIValueType = getMemrefValueType(inputType);
-    Type memrefOValueType = MemRefType::get({-1}, outputType);
 
     // Constants
-    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
 
     // Sparse pointers
     Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memrefPointerType, input, c1);
-    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefIndexType,
-                                                           input, c1);
+        loc, getMemrefPointerType(input.getType()), input, c1);
+    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, c1);
     Value Ix = rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType,
                                                           input);
 
@@ -950,61 +1097,349 @@ public:
     else
       size = rewriter.create<graphblas::NumColsOp>(loc, input);
 
+    Value output;
+    LogicalResult outputResult = buildOutput(
+        op, rewriter, outputType, Ip, size, output,
+        [&](Value &aggVal, Value index, Value ptr, Value nextPtr) {
+          return func(op, rewriter, loc, aggVal, ptr, nextPtr, Ii, Ix);
+        });
+    if (outputResult.failed())
+      return outputResult;
+
+    rewriter.replaceOp(op, output);
+
+    cleanupIntermediateTensor(rewriter, module, loc, output);
+
+    return success();
+  };
+
+  // Combines the aggregate `acc` with the next value `x`
+  using CombineFunc =
+      std::function<Value(PatternRewriter &, Location, Value acc, Value x)>;
+
+  // Reduces across the compressed dimension of the input, e.g. the columns of
+  // a CSR matrix, without converting its layout. The compressed dimension is
+  // split into blocks which scatter their entries into their own dense
+  // accumulators; the accumulators are then combined per output index in
+  // block order. Without `combine` only the entries are counted.
+  template <class T>
+  static LogicalResult
+  buildCrossAxisAlgorithm(T op, PatternRewriter &rewriter, Type outputType,
+                          CombineFunc combine,
+                          Block *transformBlock = nullptr) {
+    ModuleOp module = op->template getParentOfType<ModuleOp>();
+    Location loc = op->getLoc();
+
+    // Inputs
+    Value input = op.input();
+
+    // Types
+    Type indexType = rewriter.getIndexType();
+    Type i64Type = rewriter.getIntegerType(64);
+    RankedTensorType inputType = input.getType().dyn_cast<RankedTensorType>();
+    Type memrefIValueType = getMemrefValueType(inputType);
+    MemRefType memref1DI64Type = MemRefType::get({-1}, i64Type);
+    MemRefType memrefOValueType = MemRefType::get({-1}, outputType);
+
+    // Constants
+    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    Value c0_64 = rewriter.create<arith::ConstantIntOp>(loc, 0, i64Type);
+    Value c1_64 = rewriter.create<arith::ConstantIntOp>(loc, 1, i64Type);
+
+    // Sparse pointers
+    Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(input.getType()), input, c1);
+    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, c1);
+    Value Ix = rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefIValueType,
+                                                          input);
+    Value nnz = rewriter.create<graphblas::NumValsOp>(loc, input);
+
+    // The compressed dimension is iterated, the output runs along the other
+    Value nouter, size;
+    if (hasRowOrdering(inputType)) {
+      nouter = rewriter.create<graphblas::NumRowsOp>(loc, input);
+      size = rewriter.create<graphblas::NumColsOp>(loc, input);
+    } else {
+      nouter = rewriter.create<graphblas::NumColsOp>(loc, input);
+      size = rewriter.create<graphblas::NumRowsOp>(loc, input);
+    }
+
+    // Each block keeps its own accumulators per output index
+    Value blockSize, numBlocks;
+    computeScatterBlocks(rewriter, loc, nouter, nnz, size, blockSize,
+                         numBlocks);
+
+    Value accSize = rewriter.create<arith::MulIOp>(loc, numBlocks, size);
+    Value counts =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, accSize);
+    Value accs = nullptr;
+    if (combine)
+      accs = rewriter.create<memref::AllocOp>(loc, memrefOValueType, accSize);
+
+    // 1st pass
+    //   Scatter the entries of each block into its accumulators.
+    //   Store results in counts[block * size + index] and accs[...]
+    scf::ParallelOp scatterLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    Value block = scatterLoop.getInductionVars().front();
+    {
+      rewriter.setInsertionPointToStart(scatterLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, size);
+      Value blockOffsetEnd =
+          rewriter.create<arith::AddIOp>(loc, blockOffset, size);
+      scf::ForOp initLoop =
+          rewriter.create<scf::ForOp>(loc, blockOffset, blockOffsetEnd, c1);
+      rewriter.setInsertionPointToStart(initLoop.getBody());
+      rewriter.create<memref::StoreOp>(loc, c0_64, counts,
+                                       initLoop.getInductionVar());
+      rewriter.setInsertionPointAfter(initLoop);
+
+      Value outerStart, outerEnd;
+      computeRowBlockBounds(rewriter, loc, block, blockSize, nouter,
+                            outerStart, outerEnd);
+      scf::ForOp outerLoop =
+          rewriter.create<scf::ForOp>(loc, outerStart, outerEnd, c1);
+      Value outer = outerLoop.getInductionVar();
+      rewriter.setInsertionPointToStart(outerLoop.getBody());
+      Value j_start_64 = loadI64(rewriter, loc, Ip, outer);
+      Value j_start =
+          rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
+      Value outer_plus1 = rewriter.create<arith::AddIOp>(loc, outer, c1);
+      Value j_end_64 = loadI64(rewriter, loc, Ip, outer_plus1);
+      Value j_end =
+          rewriter.create<arith::IndexCastOp>(loc, j_end_64, indexType);
+
+      scf::ForOp ptrLoop = rewriter.create<scf::ForOp>(loc, j_start, j_end, c1);
+      Value jj = ptrLoop.getInductionVar();
+      rewriter.setInsertionPointToStart(ptrLoop.getBody());
+      Value index64 = loadI64(rewriter, loc, Ii, jj);
+      Value index =
+          rewriter.create<arith::IndexCastOp>(loc, index64, indexType);
+      Value accPos = rewriter.create<arith::AddIOp>(loc, blockOffset, index);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, accPos);
+
+      if (combine) {
+        Value x = rewriter.create<memref::LoadOp>(loc, Ix, jj);
+        if (transformBlock)
+          x = inlineExtensionBlock(rewriter, transformBlock, x);
+
+        Value isFirst = rewriter.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::eq, count, c0_64);
+        scf::IfOp ifFirst =
+            rewriter.create<scf::IfOp>(loc, outputType, isFirst, true);
+        rewriter.setInsertionPointToStart(ifFirst.thenBlock());
+        rewriter.create<scf::YieldOp>(loc, x);
+        rewriter.setInsertionPointToStart(ifFirst.elseBlock());
+        Value acc = rewriter.create<memref::LoadOp>(loc, accs, accPos);
+        rewriter.create<scf::YieldOp>(loc, combine(rewriter, loc, acc, x));
+        rewriter.setInsertionPointAfter(ifFirst);
+        rewriter.create<memref::StoreOp>(loc, ifFirst.getResult(0), accs,
+                                         accPos);
+      }
+
+      Value count1 = rewriter.create<arith::AddIOp>(loc, count, c1_64);
+      rewriter.create<memref::StoreOp>(loc, count1, counts, accPos);
+    }
+    rewriter.setInsertionPointAfter(scatterLoop);
+
+    // 2nd pass
+    //   Combine the accumulators of each output index in block order.
+    //   Store the totals in Kp and the aggregates in aggs
+    Value sizePlus1 = rewriter.create<arith::AddIOp>(loc, size, c1);
+    Value Kp =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, sizePlus1);
+    Value aggs = nullptr;
+    if (combine)
+      aggs = rewriter.create<memref::AllocOp>(loc, memrefOValueType, size);
+    scf::ParallelOp combineLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, size, c1);
+    Value outIdx = combineLoop.getInductionVars().front();
+    {
+      rewriter.setInsertionPointToStart(combineLoop.getBody());
+      SmallVector<Value, 2> initArgs = {c0_64};
+      if (combine) {
+        // Only read once a block has entries for this index
+        Value typedPlaceholder =
+            llvm::TypeSwitch<Type, Value>(outputType)
+                .Case<IntegerType>([&](IntegerType type) {
+                  return rewriter.create<arith::ConstantIntOp>(
+                      loc, 0, type.getWidth());
+                })
+                .Case<FloatType>([&](FloatType type) {
+                  return rewriter.create<arith::ConstantFloatOp>(
+                      loc, APFloat(0.0), type);
+                });
+        initArgs.push_back(typedPlaceholder);
+      }
+      scf::ForOp blockLoop =
+          rewriter.create<scf::ForOp>(loc, c0, numBlocks, c1, initArgs);
+      Value blockIdx = blockLoop.getInductionVar();
+      Value total = blockLoop.getLoopBody().getArgument(1);
+      rewriter.setInsertionPointToStart(blockLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, blockIdx, size);
+      Value accPos = rewriter.create<arith::AddIOp>(loc, blockOffset, outIdx);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, accPos);
+      Value nextTotal = rewriter.create<arith::AddIOp>(loc, total, count);
+      SmallVector<Value, 2> nextArgs = {nextTotal};
+
+      if (combine) {
+        // Blocks without entries for this index leave the aggregate as is,
+        // and the first block with entries starts it
+        Value acc = blockLoop.getLoopBody().getArgument(2);
+        Value blockIsEmpty = rewriter.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::eq, count, c0_64);
+        Value isFirst = rewriter.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::eq, total, c0_64);
+        scf::IfOp ifEmpty =
+            rewriter.create<scf::IfOp>(loc, outputType, blockIsEmpty, true);
+        rewriter.setInsertionPointToStart(ifEmpty.thenBlock());
+        rewriter.create<scf::YieldOp>(loc, acc);
+        rewriter.setInsertionPointToStart(ifEmpty.elseBlock());
+        Value blockAcc = rewriter.create<memref::LoadOp>(loc, accs, accPos);
+        scf::IfOp ifFirst =
+            rewriter.create<scf::IfOp>(loc, outputType, isFirst, true);
+        rewriter.setInsertionPointToStart(ifFirst.thenBlock());
+        rewriter.create<scf::YieldOp>(loc, blockAcc);
+        rewriter.setInsertionPointToStart(ifFirst.elseBlock());
+        rewriter.create<scf::YieldOp>(loc,
+                                      combine(rewriter, loc, acc, blockAcc));
+        rewriter.setInsertionPointAfter(ifFirst);
+        rewriter.create<scf::YieldOp>(loc, ifFirst.getResult(0));
+        rewriter.setInsertionPointAfter(ifEmpty);
+        nextArgs.push_back(ifEmpty.getResult(0));
+      }
+
+      rewriter.create<scf::YieldOp>(loc, nextArgs);
+      rewriter.setInsertionPointAfter(blockLoop);
+      rewriter.create<memref::StoreOp>(loc, blockLoop.getResult(0), Kp,
+                                       outIdx);
+      if (combine)
+        rewriter.create<memref::StoreOp>(loc, blockLoop.getResult(1), aggs,
+                                         outIdx);
+    }
+    rewriter.setInsertionPointAfter(combineLoop);
+    rewriter.create<memref::DeallocOp>(loc, counts);
+    if (combine)
+      rewriter.create<memref::DeallocOp>(loc, accs);
+
+    // cumsum the totals so Kp can be read like the pointers of a compressed
+    // dimension
+    buildExclusiveScan(rewriter, loc, Kp, size);
+
+    Value output;
+    LogicalResult outputResult = buildOutput(
+        op, rewriter, outputType, Kp, size, output,
+        [&](Value &aggVal, Value index, Value ptr, Value nextPtr) {
+          if (combine) {
+            aggVal = rewriter.create<memref::LoadOp>(loc, aggs, index);
+          } else {
+            Value diff = rewriter.create<arith::SubIOp>(loc, nextPtr, ptr);
+            aggVal = rewriter.create<arith::IndexCastOp>(loc, diff, i64Type);
+          }
+          return success();
+        });
+    if (outputResult.failed())
+      return outputResult;
+
+    rewriter.create<memref::DeallocOp>(loc, Kp);
+    if (combine)
+      rewriter.create<memref::DeallocOp>(loc, aggs);
+
+    rewriter.replaceOp(op, output);
+
+    cleanupIntermediateTensor(rewriter, module, loc, output);
+
+    return success();
+  };
+
+private:
+  // Builds the output vector of `op` with an entry for each index i < size
+  // whose range [Ip[i], Ip[i+1]) is not empty and which passes the mask.
+  // `func` computes the value of index i from its range.
+  template <class T>
+  static LogicalResult buildOutput(
+      T op, PatternRewriter &rewriter, Type outputType, Value Ip, Value size,
+      Value &output,
+      llvm::function_ref<LogicalResult(Value &, Value, Value, Value)> func) {
+    MLIRContext *context = op.getContext();
+    ModuleOp module = op->template getParentOfType<ModuleOp>();
+    Location loc = op->getLoc();
+
+    // Inputs
+    Value mask = op.mask();
+    bool maskComplement = op.mask_complement();
+
+    // Types
+    Type indexType = rewriter.getIndexType();
+    Type i64Type = rewriter.getIntegerType(64);
+    Type memrefOValueType = MemRefType::get({-1}, outputType);
+
+    // Constants
+    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+
     // Compute sparse array of valid output indices
     ValueRange sdpRet = sparsifyDensePointers(rewriter, loc, size, Ip);
     Value sparsePointers = sdpRet[0];
     Value nnz = sdpRet[1];
-    if (mask) {
+    if (mask && isBitmapVector(mask.getType())) {
+      Value Mx = rewriter.create<sparse_tensor::ToValuesOp>(
+          loc, getMemrefValueType(mask.getType()), mask);
+      Value prevSparsePointers = sparsePointers;
+      ValueRange bboRet = buildBitmapOverlap(
+          rewriter, loc, nnz, prevSparsePointers, Mx, maskComplement);
+      sparsePointers = bboRet[0];
+      nnz = bboRet[1];
+      rewriter.create<memref::DeallocOp>(loc, prevSparsePointers);
+    } else if (mask) {
       Value Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
-          loc, memrefIndexType, mask, c0);
+          loc, getMemrefIndexType(mask.getType()), mask, c0);
       Value mNnz = rewriter.create<graphblas::NumValsOp>(loc, mask);
-      if (maskComplement) {
-        ValueRange bmcRet =
-            buildMaskComplement(rewriter, loc, size, Mi, c0, mNnz);
-        Mi = bmcRet[0];
-        mNnz = bmcRet[1];
-      }
+      // A complemented mask drops the indices present in the mask
       Value prevSparsePointers = sparsePointers;
-      ValueRange bioRet =
-          buildIndexOverlap(rewriter, loc, nnz, prevSparsePointers, mNnz, Mi);
+      ValueRange bioRet = buildIndexOverlap(
+          rewriter, loc, nnz, prevSparsePointers, mNnz, Mi, maskComplement);
       sparsePointers = bioRet[0];
       nnz = bioRet[1];
-      if (maskComplement)
-        rewriter.create<memref::DeallocOp>(loc, Mi);
       rewriter.create<memref::DeallocOp>(loc, prevSparsePointers);
     }
     Value nnz64 = rewriter.create<arith::IndexCastOp>(loc, nnz, i64Type);
 
     // Build output vector
-    Value output = callNewTensor(rewriter, module, loc, ValueRange{size},
-                                 getCompressedVectorType(context, outputType));
+    output = callNewTensor(rewriter, module, loc, ValueRange{size},
+                           getCompressedVectorType(context, outputType));
 
     callResizeIndex(rewriter, module, loc, output, c0, nnz);
     callResizeValues(rewriter, module, loc, output, nnz);
 
     Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memrefPointerType, output, c0);
-    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefIndexType,
-                                                           output, c0);
+        loc, getMemrefPointerType(output.getType()), output, c0);
+    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(output.getType()), output, c0);
     Value Ox = rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefOValueType,
                                                           output);
 
     // Populate output
-    rewriter.create<memref::StoreOp>(loc, nnz64, Op, c1);
+    storeI64(rewriter, loc, nnz64, Op, c1);
 
-    // Loop over sparse array of valid output indices
-    scf::ForOp reduceLoop = rewriter.create<scf::ForOp>(loc, c0, nnz, c1);
+    // Loop over sparse array of valid output indices. Each position is
+    // written by exactly one iteration, so the indices are reduced in
+    // parallel.
+    scf::ParallelOp reduceLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nnz, c1);
     {
       rewriter.setInsertionPointToStart(reduceLoop.getBody());
-      Value outputPos = reduceLoop.getInductionVar();
+      Value outputPos = reduceLoop.getInductionVars().front();
       Value rowIndex64 =
           rewriter.create<memref::LoadOp>(loc, sparsePointers, outputPos);
       Value rowIndex =
           rewriter.create<arith::IndexCastOp>(loc, rowIndex64, indexType);
       Value nextRowIndex =
           rewriter.create<arith::AddIOp>(loc, rowIndex, c1).getResult();
-      Value ptr64 = rewriter.create<memref::LoadOp>(loc, Ip, rowIndex);
-      Value nextPtr64 = rewriter.create<memref::LoadOp>(loc, Ip, nextRowIndex);
+      Value ptr64 = loadI64(rewriter, loc, Ip, rowIndex);
+      Value nextPtr64 = loadI64(rewriter, loc, Ip, nextRowIndex);
 
       // At this point, we know the row is not empty, so nextPtr64 > ptr64
       Value ptr = rewriter.create<arith::IndexCastOp>(loc, ptr64, indexType);
@@ -1013,25 +1448,20 @@ public:
 
       // Inject code from func
       Value aggVal = nullptr;
-      LogicalResult funcResult =
-          func(op, rewriter, loc, aggVal, ptr, nextPtr, Ii, Ix);
+      LogicalResult funcResult = func(aggVal, rowIndex, ptr, nextPtr);
       if (funcResult.failed()) {
         return funcResult;
       }
 
       rewriter.create<memref::StoreOp>(loc, aggVal, Ox, outputPos);
-      rewriter.create<memref::StoreOp>(loc, rowIndex64, Oi, outputPos);
+      storeI64(rewriter, loc, rowIndex64, Oi, outputPos);
     }
     rewriter.setInsertionPointAfter(reduceLoop);
     rewriter.create<memref::DeallocOp>(loc, sparsePointers);
-    rewriter.replaceOp(op, output);
-
-    cleanupIntermediateTensor(rewriter, module, loc, output);
 
     return success();
   };
 
-private:
   static LogicalResult countBlock(graphblas::ReduceToVectorOp op,
                                   PatternRewriter &rewriter, Location loc,
                                   Value &aggVal, Value ptr, Value nextPtr,
@@ -1055,7 +1485,7 @@ private:
     Type i64Type = rewriter.getI64Type();
 
     Value initVal = rewriter.create<memref::LoadOp>(loc, Ix, ptr);
-    Value initIdx = rewriter.create<memref::LoadOp>(loc, Ii, ptr);
+    Value initIdx = loadI64(rewriter, loc, Ii, ptr);
     Value ptrPlusOne = rewriter.create<arith::AddIOp>(loc, ptr, c1);
     scf::ForOp loop = rewriter.create<scf::ForOp>(loc, ptrPlusOne, nextPtr, c1,
                                                   ValueRange{initVal, initIdx});
@@ -1087,7 +1517,7 @@ private:
           loc, TypeRange{elementType, i64Type}, mustUpdate, true);
       {
         rewriter.setInsertionPointToStart(ifMustUpdateBlock.thenBlock());
-        Value newIdx = rewriter.create<memref::LoadOp>(loc, Ii, curPtr);
+        Value newIdx = loadI64(rewriter, loc, Ii, curPtr);
         rewriter.create<scf::YieldOp>(loc, ValueRange{rowValue, newIdx});
       }
       {
@@ -1129,8 +1559,36 @@ public:
   using OpRewritePattern<graphblas::ReduceToVectorGenericOp>::OpRewritePattern;
   LogicalResult matchAndRewrite(graphblas::ReduceToVectorGenericOp op,
                                 PatternRewriter &rewriter) const override {
+    // A transform_in_a block may change the element type
     Type elementType =
-        op.input().getType().cast<RankedTensorType>().getElementType();
+        op.getResult().getType().cast<RankedTensorType>().getElementType();
+
+    if (ReduceToVectorDWIMRewrite::isCrossAxis(op)) {
+      RegionRange extensions = op.extensions();
+      ExtensionBlocks extBlocks;
+      std::set<graphblas::YieldKind> required = {
+          graphblas::YieldKind::AGG_IDENTITY, graphblas::YieldKind::AGG};
+      std::set<graphblas::YieldKind> optional = {
+          graphblas::YieldKind::TRANSFORM_IN_A};
+      LogicalResult extractResult =
+          extBlocks.extractBlocks(op, extensions, required, optional);
+
+      if (extractResult.failed()) {
+        return extractResult;
+      }
+
+      // The agg block both accumulates entries and combines the blocks'
+      // accumulators, so it is cloned rather than inlined
+      Block *aggBlock = extBlocks.agg;
+      auto combine = [aggBlock](PatternRewriter &rewriter, Location loc,
+                                Value acc, Value x) {
+        return cloneExtensionBlock(rewriter, aggBlock, {acc, x});
+      };
+      return LowerReduceToVectorRewrite::buildCrossAxisAlgorithm<
+          graphblas::ReduceToVectorGenericOp>(op, rewriter, elementType,
+                                              combine, extBlocks.transformInA);
+    }
+
     LogicalResult callResult = LowerReduceToVectorRewrite::buildAlgorithm<
         graphblas::ReduceToVectorGenericOp>(op, rewriter, elementType,
                                             genericBlock);
@@ -1151,8 +1609,10 @@ private:
     ExtensionBlocks extBlocks;
     std::set<graphblas::YieldKind> required = {
         graphblas::YieldKind::AGG_IDENTITY, graphblas::YieldKind::AGG};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::TRANSFORM_IN_A};
     LogicalResult extractResult =
-        extBlocks.extractBlocks(op, extensions, required, {});
+        extBlocks.extractBlocks(op, extensions, required, optional);
 
     if (extractResult.failed()) {
       return extractResult;
@@ -1176,6 +1636,8 @@ private:
 
     rewriter.setInsertionPointToStart(aggLoop.getBody());
     Value x = rewriter.create<memref::LoadOp>(loc, Ix, aggIdx);
+    if (extBlocks.transformInA)
+      x = inlineExtensionBlock(rewriter, extBlocks.transformInA, x);
 
     scf::ReduceOp reducer = rewriter.create<scf::ReduceOp>(loc, x);
     BlockArgument lhs = reducer.getRegion().getArgument(0);
@@ -1244,12 +1706,10 @@ private:
     Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
     Type indexType = rewriter.getIndexType();
-    Type int64Type = rewriter.getIntegerType(64);
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
 
     Value pointers = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, input, c0);
-    Value endPosition64 = rewriter.create<memref::LoadOp>(loc, pointers, c1);
+        loc, getMemrefPointerType(input.getType()), input, c0);
+    Value endPosition64 = loadI64(rewriter, loc, pointers, c1);
     Value endPosition =
         rewriter.create<arith::IndexCastOp>(loc, endPosition64, indexType);
 
@@ -1301,9 +1761,8 @@ private:
 
     Value finalExtremumPosition = loop.getResult(1);
     Value indices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, input, c0);
-    Value argExtremum =
-        rewriter.create<memref::LoadOp>(loc, indices, finalExtremumPosition);
+        loc, getMemrefIndexType(input.getType()), input, c0);
+    Value argExtremum = loadI64(rewriter, loc, indices, finalExtremumPosition);
     rewriter.replaceOp(op, argExtremum);
 
     return success();
@@ -1350,8 +1809,11 @@ public:
     ExtensionBlocks extBlocks;
     std::set<graphblas::YieldKind> required = {
         graphblas::YieldKind::AGG_IDENTITY, graphblas::YieldKind::AGG};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::TRANSFORM_IN_A,
+        graphblas::YieldKind::SELECT_IN_A};
     LogicalResult extractResult =
-        extBlocks.extractBlocks(op, extensions, required, {});
+        extBlocks.extractBlocks(op, extensions, required, optional);
 
     if (extractResult.failed()) {
       return extractResult;
@@ -1384,8 +1846,16 @@ public:
     ValueRange valueLoopIdx = valueLoop.getInductionVars();
 
     rewriter.setInsertionPointToStart(valueLoop.getBody());
-    memref::LoadOp y =
-        rewriter.create<memref::LoadOp>(loc, inputValues, valueLoopIdx);
+    Value y = rewriter.create<memref::LoadOp>(loc, inputValues, valueLoopIdx);
+
+    // Values are transformed, then those not selected are replaced by the
+    // identity, which leaves the aggregate unchanged
+    if (extBlocks.transformInA)
+      y = inlineExtensionBlock(rewriter, extBlocks.transformInA, y);
+    if (extBlocks.selectInA) {
+      Value keep = inlineExtensionBlock(rewriter, extBlocks.selectInA, y);
+      y = rewriter.create<SelectOp>(loc, keep, y, c0Accumulator);
+    }
 
     scf::ReduceOp reducer = rewriter.create<scf::ReduceOp>(loc, y);
     BlockArgument lhs = reducer.getRegion().getArgument(0);
@@ -1485,8 +1955,6 @@ public:
     unsigned rank = inputTensorType.getRank();
 
     Type indexType = rewriter.getIndexType();
-    Type memrefPointerType = getMemrefPointerType(inputTensorType);
-    Type memrefIndexType = getMemrefIndexType(inputTensorType);
     Type memrefIValueType = getMemrefValueType(inputTensorType);
     Type memrefOValueType = getMemrefValueType(outputTensorType);
 
@@ -1526,9 +1994,9 @@ public:
       // - vector -> passes in (val, index, index)
       // - CSR or CSC -> passes in (val, row, col)
       Value inputPointers = rewriter.create<sparse_tensor::ToPointersOp>(
-          loc, memrefPointerType, inputTensor);
+          loc, getMemrefPointerType(inputTensor.getType()), inputTensor);
       Value inputIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-          loc, memrefIndexType, inputTensor);
+          loc, getMemrefIndexType(inputTensor.getType()), inputTensor);
       bool byCols = false;
       Value npointers;
       if (rank == 1) {
@@ -1547,10 +2015,9 @@ public:
       Value pointerIdx_plus1 =
           rewriter.create<arith::AddIOp>(loc, pointerIdx, c1);
 
-      Value indexStart_64 =
-          rewriter.create<memref::LoadOp>(loc, inputPointers, pointerIdx);
+      Value indexStart_64 = loadI64(rewriter, loc, inputPointers, pointerIdx);
       Value indexEnd_64 =
-          rewriter.create<memref::LoadOp>(loc, inputPointers, pointerIdx_plus1);
+          loadI64(rewriter, loc, inputPointers, pointerIdx_plus1);
       Value indexStart =
           rewriter.create<arith::IndexCastOp>(loc, indexStart_64, indexType);
       Value indexEnd =
@@ -1561,7 +2028,7 @@ public:
       Value jj = innerLoop.getInductionVar();
       {
         rewriter.setInsertionPointToStart(innerLoop.getBody());
-        Value col_64 = rewriter.create<memref::LoadOp>(loc, inputIndices, jj);
+        Value col_64 = loadI64(rewriter, loc, inputIndices, jj);
         Value col = rewriter.create<arith::IndexCastOp>(loc, col_64, indexType);
         Value val = rewriter.create<memref::LoadOp>(loc, inputValues, jj);
 
@@ -1669,6 +2136,21 @@ public:
   };
 };
 
+// Matrix-matrix products are computed row-wise (Gustavson's algorithm) when B
+// is CSR, unless a non-complemented mask limits the output. The masked inner
+// product formulation only visits the entries of the mask, so it is kept for
+// that case.
+static bool useGustavsonMatrixMultiply(graphblas::MatrixMultiplyGenericOp op) {
+  if (getRank(op.b()) != 2)
+    return false;
+  if (op.mask() && !op.mask_complement())
+    return false;
+  // Bitmap masks go through the inner product lowering
+  if (op.mask() && isBitmapVector(op.mask().getType()))
+    return false;
+  return hasRowOrdering(op.b().getType());
+}
+
 class MatrixMultiplyGenericDWIMFirstArgRewrite
     : public OpRewritePattern<graphblas::MatrixMultiplyGenericOp> {
 public:
@@ -1709,6 +2191,12 @@ public:
     return hasRowOrdering(op.b().getType());
   };
 
+  static bool needsDWIM(graphblas::MatrixMultiplyGenericOp op) {
+    if (useGustavsonMatrixMultiply(op))
+      return false;
+    return hasRowOrdering(op.b().getType());
+  };
+
   LogicalResult matchAndRewrite(graphblas::MatrixMultiplyGenericOp op,
                                 PatternRewriter &rewriter) const override {
     if (!needsDWIM(op))
@@ -1812,6 +2300,10 @@ private:
   rewriteMatrixMatrixMultiplication(graphblas::MatrixMultiplyGenericOp op,
                                     PatternRewriter &rewriter,
                                     ExtensionBlocks extBlocks) const {
+    if (useGustavsonMatrixMultiply(op))
+      return rewriteMatrixMatrixMultiplicationGustavson(op, rewriter,
+                                                        extBlocks);
+
     ModuleOp module = op->getParentOfType<ModuleOp>();
     Location loc = op->getLoc();
 
@@ -1827,7 +2319,6 @@ private:
     Type valueType =
         op.getResult().getType().dyn_cast<RankedTensorType>().getElementType();
 
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
     // Initial constants
@@ -1847,40 +2338,56 @@ private:
     callResizePointers(rewriter, module, loc, C, c1, nrow_plus_one);
 
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, A, c1);
-    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, c1);
+        loc, getMemrefPointerType(A.getType()), A, c1);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c1);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, B, c1);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, c1);
+        loc, getMemrefPointerType(B.getType()), B, c1);
+    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c1);
     Value Bx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
     Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, C, c1);
+        loc, getMemrefPointerType(C.getType()), C, c1);
     Value Mp, Mj;
     if (mask) {
-      Mp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                        mask, c1);
-      Mj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                       mask, c1);
+      Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c1);
+      Mj = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c1);
     }
 
+    // Rows are processed in blocks so each block reuses a single workspace
+    // holding the current row of A
+    Value blockSize, numBlocks;
+    computeRowBlocks(rewriter, loc, nrow, blockSize, numBlocks);
+
     // 1st pass
     //   Compute the number of nonzero entries per row.
     //   Store results in Cp
     //   The rows in A are the fixed elements, while the columns of B are the
     //   iteration element
-    scf::ParallelOp rowLoop1 =
-        rewriter.create<scf::ParallelOp>(loc, c0, nrow, c1);
-    Value row = rowLoop1.getInductionVars().front();
+    scf::ParallelOp blockLoop1 =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    Value block = blockLoop1.getInductionVars().front();
+    rewriter.setInsertionPointToStart(blockLoop1.getBody());
+
+    Value rowStart, rowEnd;
+    computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                          rowEnd);
+    RowWorkspace workspace =
+        allocRowWorkspace(rewriter, loc, nk, nullptr, true);
+
+    scf::ForOp rowLoop1 =
+        rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+    Value row = rowLoop1.getInductionVar();
     rewriter.setInsertionPointToStart(rowLoop1.getBody());
 
-    Value colStart64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
+    Value colStart64 = loadI64(rewriter, loc, Ap, row);
     Value rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-    Value colEnd64 = rewriter.create<memref::LoadOp>(loc, Ap, rowPlus1);
+    Value colEnd64 = loadI64(rewriter, loc, Ap, rowPlus1);
     Value cmpColSame = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::eq, colStart64, colEnd64);
 
@@ -1898,123 +2405,303 @@ private:
         rewriter.create<arith::IndexCastOp>(loc, colEnd64, indexType);
     Value total;
     if (mask) {
-      Value mcolStart64 = rewriter.create<memref::LoadOp>(loc, Mp, row);
-      Value mcolEnd64 = rewriter.create<memref::LoadOp>(loc, Mp, rowPlus1);
+      Value mcolStart64 = loadI64(rewriter, loc, Mp, row);
+      Value mcolEnd64 = loadI64(rewriter, loc, Mp, rowPlus1);
       Value mcolStart =
           rewriter.create<arith::IndexCastOp>(loc, mcolStart64, indexType);
       Value mcolEnd =
           rewriter.create<arith::IndexCastOp>(loc, mcolEnd64, indexType);
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, ncol, Mj, mcolStart, mcolEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        total = computeNumOverlaps(rewriter, loc, nk, Aj, colStart, colEnd, Bp,
-                                   Bi, maskComplement, c0, mcSize, valueType);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        total = computeNumOverlaps(rewriter, loc, nk, Aj, colStart, colEnd, Bp,
-                                   Bi, Mj, mcolStart, mcolEnd, valueType);
-      }
+      Value complementSize = isMaskComplement ? ncol : Value();
+      total = computeNumOverlaps(rewriter, loc, nk, row, Aj, colStart, colEnd,
+                                 Bp, Bi, Mj, mcolStart, mcolEnd, valueType,
+                                 &workspace, complementSize);
     } else {
-      total = computeNumOverlaps(rewriter, loc, nk, Aj, colStart, colEnd, Bp,
-                                 Bi, nullptr, c0, ncol, valueType);
+      total = computeNumOverlaps(rewriter, loc, nk, row, Aj, colStart, colEnd,
+                                 Bp, Bi, nullptr, c0, ncol, valueType,
+                                 &workspace);
     }
     rewriter.create<scf::YieldOp>(loc, total);
 
     // end if cmpColSame
     rewriter.setInsertionPointAfter(ifBlock_rowTotal);
     Value rowTotal = ifBlock_rowTotal.getResult(0);
-    rewriter.create<memref::StoreOp>(loc, rowTotal, Cp, row);
+    storeI64(rewriter, loc, rowTotal, Cp, row);
 
     // end row loop
     rewriter.setInsertionPointAfter(rowLoop1);
+    deallocRowWorkspace(rewriter, loc, workspace);
+
+    // end block loop
+    rewriter.setInsertionPointAfter(blockLoop1);
 
     // 2nd pass
     //   Compute the cumsum of values in Cp to build the final Cp
     //   Then resize C's indices and values
-    scf::ForOp rowLoop2 = rewriter.create<scf::ForOp>(loc, c0, nrow, c1);
-    Value cs_i = rowLoop2.getInductionVar();
-    rewriter.setInsertionPointToStart(rowLoop2.getBody());
-
-    Value csTemp = rewriter.create<memref::LoadOp>(loc, Cp, cs_i);
-    Value cumsum = rewriter.create<memref::LoadOp>(loc, Cp, nrow);
-    rewriter.create<memref::StoreOp>(loc, cumsum, Cp, cs_i);
-    Value cumsum2 = rewriter.create<arith::AddIOp>(loc, cumsum, csTemp);
-    rewriter.create<memref::StoreOp>(loc, cumsum2, Cp, nrow);
-
-    // end row loop
-    rewriter.setInsertionPointAfter(rowLoop2);
+    buildExclusiveScan(rewriter, loc, Cp, nrow);
 
     Value nnz = rewriter.create<graphblas::NumValsOp>(loc, C);
     callResizeIndex(rewriter, module, loc, C, c1, nnz);
     callResizeValues(rewriter, module, loc, C, nnz);
-    Value Cj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           C, c1);
+    Value Cj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c1);
     Value Cx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
 
     // 3rd pass
-    //   In parallel over the rows,
+    //   In parallel over the row blocks,
     //   compute the nonzero columns and associated values.
     //   Store in Cj and Cx
     //   The rows in A are the fixed elements, while the columns of B are the
     //   iteration element
-    scf::ParallelOp rowLoop3 =
-        rewriter.create<scf::ParallelOp>(loc, c0, nrow, c1);
-    row = rowLoop3.getInductionVars().front();
+    scf::ParallelOp blockLoop3 =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    block = blockLoop3.getInductionVars().front();
+    rewriter.setInsertionPointToStart(blockLoop3.getBody());
+
+    computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                          rowEnd);
+    workspace = allocRowWorkspace(rewriter, loc, nk, valueType, true);
+
+    scf::ForOp rowLoop3 =
+        rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+    row = rowLoop3.getInductionVar();
+    rewriter.setInsertionPointToStart(rowLoop3.getBody());
+
+    rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
+    Value cpStart64 = loadI64(rewriter, loc, Cp, row);
+    Value cpEnd64 = loadI64(rewriter, loc, Cp, rowPlus1);
+    Value cmp_cpDifferent = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::ne, cpStart64, cpEnd64);
+    scf::IfOp ifBlock_cmpDiff =
+        rewriter.create<scf::IfOp>(loc, cmp_cpDifferent);
+    rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
+
+    Value baseIndex64 = loadI64(rewriter, loc, Cp, row);
+    Value baseIndex =
+        rewriter.create<arith::IndexCastOp>(loc, baseIndex64, indexType);
+
+    colStart64 = loadI64(rewriter, loc, Ap, row);
+    colEnd64 = loadI64(rewriter, loc, Ap, rowPlus1);
+    colStart = rewriter.create<arith::IndexCastOp>(loc, colStart64, indexType);
+    colEnd = rewriter.create<arith::IndexCastOp>(loc, colEnd64, indexType);
+
+    if (mask) {
+      Value mcolStart64 = loadI64(rewriter, loc, Mp, row);
+      Value mcolEnd64 = loadI64(rewriter, loc, Mp, rowPlus1);
+      Value mcolStart =
+          rewriter.create<arith::IndexCastOp>(loc, mcolStart64, indexType);
+      Value mcolEnd =
+          rewriter.create<arith::IndexCastOp>(loc, mcolEnd64, indexType);
+      Value complementSize = isMaskComplement ? ncol : Value();
+      computeInnerProduct(rewriter, loc, nk, row, Aj, Ax, colStart, colEnd, Bp,
+                          Bi, Bx, Mj, mcolStart, mcolEnd, valueType, extBlocks,
+                          Cj, Cx, baseIndex, false, &workspace, complementSize);
+    } else {
+      computeInnerProduct(rewriter, loc, nk, row, Aj, Ax, colStart, colEnd, Bp,
+                          Bi, Bx, nullptr, c0, ncol, valueType, extBlocks, Cj,
+                          Cx, baseIndex, false, &workspace);
+    }
+
+    // end if cmpDiff
+    rewriter.setInsertionPointAfter(ifBlock_cmpDiff);
+
+    // end row loop
+    rewriter.setInsertionPointAfter(rowLoop3);
+    deallocRowWorkspace(rewriter, loc, workspace);
+
+    // end block loop
+    rewriter.setInsertionPointAfter(blockLoop3);
+
+    rewriter.replaceOp(op, C);
+
+    cleanupIntermediateTensor(rewriter, module, loc, C);
+
+    return success();
+  }
+
+  LogicalResult rewriteMatrixMatrixMultiplicationGustavson(
+      graphblas::MatrixMultiplyGenericOp op, PatternRewriter &rewriter,
+      ExtensionBlocks extBlocks) const {
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+    Location loc = op->getLoc();
+
+    // Inputs
+    Value A = op.a();
+    Value B = op.b();
+    Value mask = op.mask(); // always complemented if present
+
+    // Types
+    Type indexType = rewriter.getIndexType();
+    Type int64Type = rewriter.getIntegerType(64);
+    Type valueType =
+        op.getResult().getType().dyn_cast<RankedTensorType>().getElementType();
+
+    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
+
+    // Initial constants
+    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    Value cneg1 = rewriter.create<arith::ConstantIntOp>(loc, -1, int64Type);
+
+    Value nrow = rewriter.create<graphblas::NumRowsOp>(loc, A);
+    Value ncol = rewriter.create<graphblas::NumColsOp>(loc, B);
+    Value nrow_plus_one = rewriter.create<arith::AddIOp>(loc, nrow, c1);
+
+    Value C = callEmptyLike(rewriter, module, loc, A);
+    callResizeDim(rewriter, module, loc, C, c0, nrow);
+    callResizeDim(rewriter, module, loc, C, c1, ncol);
+    callResizePointers(rewriter, module, loc, C, c1, nrow_plus_one);
+
+    Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(A.getType()), A, c1);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c1);
+    Value Ax =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
+    Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(B.getType()), B, c1);
+    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c1);
+    Value Bx =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
+    Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(C.getType()), C, c1);
+    Value Mp, Mj;
+    if (mask) {
+      Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c1);
+      Mj = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c1);
+    }
+
+    // Rows are processed in a fixed number of contiguous blocks. Each block
+    // allocates and initializes its dense workspaces once, so the cost of
+    // the workspaces is O(ncol) per block rather than per row.
+    Value blockSize, numBlocks;
+    computeRowBlocks(rewriter, loc, nrow, blockSize, numBlocks);
+
+    // 1st pass
+    //   Compute the number of nonzero entries per row.
+    //   Store results in Cp
+    //   The rows in A are the fixed elements, while the rows of B are the
+    //   iteration element
+    scf::ParallelOp blockLoop1 =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    Value block = blockLoop1.getInductionVars().front();
+    rewriter.setInsertionPointToStart(blockLoop1.getBody());
+
+    Value rowStart, rowEnd;
+    computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                          rowEnd);
+
+    Value marker = rewriter.create<memref::AllocOp>(loc, memref1DI64Type, ncol);
+    rewriter.create<linalg::FillOp>(loc, cneg1, marker);
+
+    scf::ForOp rowLoop1 =
+        rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+    Value row = rowLoop1.getInductionVar();
+    rewriter.setInsertionPointToStart(rowLoop1.getBody());
+
+    Value rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
+    Value colStart64 = loadI64(rewriter, loc, Ap, row);
+    Value colEnd64 = loadI64(rewriter, loc, Ap, rowPlus1);
+    Value colStart =
+        rewriter.create<arith::IndexCastOp>(loc, colStart64, indexType);
+    Value colEnd =
+        rewriter.create<arith::IndexCastOp>(loc, colEnd64, indexType);
+    Value mcolStart = c0, mcolEnd = c0;
+    if (mask) {
+      Value mcolStart64 = loadI64(rewriter, loc, Mp, row);
+      Value mcolEnd64 = loadI64(rewriter, loc, Mp, rowPlus1);
+      mcolStart =
+          rewriter.create<arith::IndexCastOp>(loc, mcolStart64, indexType);
+      mcolEnd = rewriter.create<arith::IndexCastOp>(loc, mcolEnd64, indexType);
+    }
+    Value rowTotal =
+        computeSaxpyRowSize(rewriter, loc, row, Aj, colStart, colEnd, Bp, Bj,
+                            marker, Mj, mcolStart, mcolEnd);
+    storeI64(rewriter, loc, rowTotal, Cp, row);
+
+    // end row loop
+    rewriter.setInsertionPointAfter(rowLoop1);
+    rewriter.create<memref::DeallocOp>(loc, marker);
+
+    // end block loop
+    rewriter.setInsertionPointAfter(blockLoop1);
+
+    // 2nd pass
+    //   Compute the cumsum of values in Cp to build the final Cp
+    //   Then resize C's indices and values
+    buildExclusiveScan(rewriter, loc, Cp, nrow);
+
+    Value nnz = rewriter.create<graphblas::NumValsOp>(loc, C);
+    callResizeIndex(rewriter, module, loc, C, c1, nnz);
+    callResizeValues(rewriter, module, loc, C, nnz);
+    Value Cj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c1);
+    Value Cx =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
+
+    // 3rd pass
+    //   In parallel over the row blocks,
+    //   compute the nonzero columns and associated values.
+    //   Store in Cj and Cx
+    scf::ParallelOp blockLoop3 =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    block = blockLoop3.getInductionVars().front();
+    rewriter.setInsertionPointToStart(blockLoop3.getBody());
+
+    computeRowBlockBounds(rewriter, loc, block, blockSize, nrow, rowStart,
+                          rowEnd);
+
+    marker = rewriter.create<memref::AllocOp>(loc, memref1DI64Type, ncol);
+    rewriter.create<linalg::FillOp>(loc, cneg1, marker);
+    Value workspace =
+        rewriter.create<memref::AllocOp>(loc, memref1DValueType, ncol);
+
+    scf::ForOp rowLoop3 =
+        rewriter.create<scf::ForOp>(loc, rowStart, rowEnd, c1);
+    row = rowLoop3.getInductionVar();
     rewriter.setInsertionPointToStart(rowLoop3.getBody());
 
     rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-    Value cpStart64 = rewriter.create<memref::LoadOp>(loc, Cp, row);
-    Value cpEnd64 = rewriter.create<memref::LoadOp>(loc, Cp, rowPlus1);
+    Value cpStart64 = loadI64(rewriter, loc, Cp, row);
+    Value cpEnd64 = loadI64(rewriter, loc, Cp, rowPlus1);
     Value cmp_cpDifferent = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::ne, cpStart64, cpEnd64);
     scf::IfOp ifBlock_cmpDiff =
         rewriter.create<scf::IfOp>(loc, cmp_cpDifferent);
     rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
 
-    Value baseIndex64 = rewriter.create<memref::LoadOp>(loc, Cp, row);
-    Value baseIndex =
-        rewriter.create<arith::IndexCastOp>(loc, baseIndex64, indexType);
-
-    colStart64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
-    colEnd64 = rewriter.create<memref::LoadOp>(loc, Ap, rowPlus1);
+    Value cpStart =
+        rewriter.create<arith::IndexCastOp>(loc, cpStart64, indexType);
+    Value cpEnd = rewriter.create<arith::IndexCastOp>(loc, cpEnd64, indexType);
+    colStart64 = loadI64(rewriter, loc, Ap, row);
+    colEnd64 = loadI64(rewriter, loc, Ap, rowPlus1);
     colStart = rewriter.create<arith::IndexCastOp>(loc, colStart64, indexType);
     colEnd = rewriter.create<arith::IndexCastOp>(loc, colEnd64, indexType);
-
     if (mask) {
-      Value mcolStart64 = rewriter.create<memref::LoadOp>(loc, Mp, row);
-      Value mcolEnd64 = rewriter.create<memref::LoadOp>(loc, Mp, rowPlus1);
-      Value mcolStart =
+      Value mcolStart64 = loadI64(rewriter, loc, Mp, row);
+      Value mcolEnd64 = loadI64(rewriter, loc, Mp, rowPlus1);
+      mcolStart =
           rewriter.create<arith::IndexCastOp>(loc, mcolStart64, indexType);
-      Value mcolEnd =
-          rewriter.create<arith::IndexCastOp>(loc, mcolEnd64, indexType);
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, ncol, Mj, mcolStart, mcolEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        computeInnerProduct(rewriter, loc, nk, row, Aj, Ax, colStart, colEnd,
-                            Bp, Bi, Bx, maskComplement, c0, mcSize, valueType,
-                            extBlocks, Cj, Cx, baseIndex, false);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        computeInnerProduct(rewriter, loc, nk, row, Aj, Ax, colStart, colEnd,
-                            Bp, Bi, Bx, Mj, mcolStart, mcolEnd, valueType,
-                            extBlocks, Cj, Cx, baseIndex, false);
-      }
-    } else {
-      computeInnerProduct(rewriter, loc, nk, row, Aj, Ax, colStart, colEnd, Bp,
-                          Bi, Bx, nullptr, c0, ncol, valueType, extBlocks, Cj,
-                          Cx, baseIndex, false);
+      mcolEnd = rewriter.create<arith::IndexCastOp>(loc, mcolEnd64, indexType);
     }
+    computeSaxpyRow(rewriter, loc, ncol, row, Aj, Ax, colStart, colEnd, Bp, Bj,
+                    Bx, marker, workspace, Mj, mcolStart, mcolEnd, valueType,
+                    extBlocks, Cj, Cx, cpStart, cpEnd);
 
     // end if cmpDiff
     rewriter.setInsertionPointAfter(ifBlock_cmpDiff);
 
     // end row loop
     rewriter.setInsertionPointAfter(rowLoop3);
+    rewriter.create<memref::DeallocOp>(loc, marker);
+    rewriter.create<memref::DeallocOp>(loc, workspace);
+
+    // end block loop
+    rewriter.setInsertionPointAfter(blockLoop3);
 
     rewriter.replaceOp(op, C);
 
@@ -2042,7 +2729,6 @@ private:
     Type valueType =
         op.getResult().getType().dyn_cast<RankedTensorType>().getElementType();
 
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
     // Initial constants
@@ -2056,32 +2742,59 @@ private:
     // TODO: how do I check nk == nk_check and raise an exception if they don't
     // match? Value nk_check = rewriter.create<graphblas::NumColsOp>(loc, A);
 
-    Value C = callEmptyLike(rewriter, module, loc, B);
+    // A bitmap B, e.g. the frontier of a pull traversal, is probed in place
+    // for each entry of A instead of being scattered into a workspace
+    bool isBitmapB = isBitmapVector(B.getType());
+
+    Value C;
+    if (isBitmapB)
+      C = callNewTensor(rewriter, module, loc, ValueRange{size},
+                        op.getResult().getType().cast<RankedTensorType>());
+    else
+      C = callEmptyLike(rewriter, module, loc, B);
     callResizeDim(rewriter, module, loc, C, c0, size);
     callResizePointers(rewriter, module, loc, C, c0, c2);
 
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, A, c1);
-    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, c1);
+        loc, getMemrefPointerType(A.getType()), A, c1);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c1);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
-    Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, B, c0);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, c0);
     Value Bx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
+    Value Bi, fixedIndexEnd;
+    RowWorkspace bitmapWorkspace;
+    const RowWorkspace *workspace = nullptr;
+    if (isBitmapB) {
+      bitmapWorkspace.bitmap = Bx;
+      workspace = &bitmapWorkspace;
+      fixedIndexEnd = nk;
+    } else {
+      Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(B.getType()), B, c0);
+      Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(B.getType()), B, c0);
+      Value fixedIndexEnd64 = loadI64(rewriter, loc, Bp, c1);
+      fixedIndexEnd =
+          rewriter.create<arith::IndexCastOp>(loc, fixedIndexEnd64, indexType);
+    }
     Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, C, c0);
-    Value Mp, Mi, maskStart, maskEnd;
-    if (mask) {
-      Mp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                        mask, c0);
-      Mi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                       mask, c0);
-      Value maskStart64 = rewriter.create<memref::LoadOp>(loc, Mp, c0);
-      Value maskEnd64 = rewriter.create<memref::LoadOp>(loc, Mp, c1);
+        loc, getMemrefPointerType(C.getType()), C, c0);
+    Value Mp, Mi, Mx, maskStart, maskEnd;
+    if (mask && isBitmapVector(mask.getType())) {
+      // Bitmap masks are tested one output index at a time
+      Mx = rewriter.create<sparse_tensor::ToValuesOp>(
+          loc, getMemrefValueType(mask.getType()), mask);
+      maskStart = c0;
+      maskEnd = size;
+    } else if (mask) {
+      Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c0);
+      Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c0);
+      Value maskStart64 = loadI64(rewriter, loc, Mp, c0);
+      Value maskEnd64 = loadI64(rewriter, loc, Mp, c1);
       maskStart =
           rewriter.create<arith::IndexCastOp>(loc, maskStart64, indexType);
       maskEnd = rewriter.create<arith::IndexCastOp>(loc, maskEnd64, indexType);
@@ -2092,9 +2805,6 @@ private:
     //   Store results in Cp
     //   The vector B is the fixed element, while the rows of A are the
     //   iteration element
-    Value fixedIndexEnd64 = rewriter.create<memref::LoadOp>(loc, Bp, c1);
-    Value fixedIndexEnd =
-        rewriter.create<arith::IndexCastOp>(loc, fixedIndexEnd64, indexType);
     Value cmpColSame = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::eq, c0, fixedIndexEnd);
 
@@ -2108,21 +2818,14 @@ private:
     rewriter.setInsertionPointToStart(ifBlock_rowTotal.elseBlock());
     Value total;
     if (mask) {
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, size, Mi, maskStart, maskEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        total = computeNumOverlaps(rewriter, loc, nk, Bi, c0, fixedIndexEnd, Ap,
-                                   Aj, maskComplement, c0, mcSize, valueType);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        total = computeNumOverlaps(rewriter, loc, nk, Bi, c0, fixedIndexEnd, Ap,
-                                   Aj, Mi, maskStart, maskEnd, valueType);
-      }
+      Value complementSize = isMaskComplement ? size : Value();
+      total = computeNumOverlaps(rewriter, loc, nk, c0, Bi, c0, fixedIndexEnd,
+                                 Ap, Aj, Mi, maskStart, maskEnd, valueType,
+                                 workspace, complementSize, Mx);
     } else {
-      total = computeNumOverlaps(rewriter, loc, nk, Bi, c0, fixedIndexEnd, Ap,
-                                 Aj, nullptr, c0, size, valueType);
+      total = computeNumOverlaps(rewriter, loc, nk, c0, Bi, c0, fixedIndexEnd,
+                                 Ap, Aj, nullptr, c0, size, valueType,
+                                 workspace);
     }
     rewriter.create<scf::YieldOp>(loc, total);
 
@@ -2130,12 +2833,12 @@ private:
     rewriter.setInsertionPointAfter(ifBlock_rowTotal);
     Value nnzTotal = ifBlock_rowTotal.getResult(0);
     Value nnz = rewriter.create<arith::IndexCastOp>(loc, nnzTotal, indexType);
-    rewriter.create<memref::StoreOp>(loc, nnzTotal, Cp, c1);
+    storeI64(rewriter, loc, nnzTotal, Cp, c1);
 
     callResizeIndex(rewriter, module, loc, C, c0, nnz);
     callResizeValues(rewriter, module, loc, C, nnz);
-    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           C, c0);
+    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c0);
     Value Cx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
 
@@ -2151,24 +2854,15 @@ private:
     rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
 
     if (mask) {
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, size, Mi, maskStart, maskEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        computeInnerProduct(rewriter, loc, nk, c0, Bi, Bx, c0, fixedIndexEnd,
-                            Ap, Aj, Ax, maskComplement, c0, mcSize, valueType,
-                            extBlocks, Ci, Cx, c0, true);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        computeInnerProduct(rewriter, loc, nk, c0, Bi, Bx, c0, fixedIndexEnd,
-                            Ap, Aj, Ax, Mi, maskStart, maskEnd, valueType,
-                            extBlocks, Ci, Cx, c0, true);
-      }
+      Value complementSize = isMaskComplement ? size : Value();
+      computeInnerProduct(rewriter, loc, nk, c0, Bi, Bx, c0, fixedIndexEnd,
+                          Ap, Aj, Ax, Mi, maskStart, maskEnd, valueType,
+                          extBlocks, Ci, Cx, c0, true, workspace,
+                          complementSize, Mx);
     } else {
       computeInnerProduct(rewriter, loc, nk, c0, Bi, Bx, c0, fixedIndexEnd, Ap,
                           Aj, Ax, nullptr, c0, size, valueType, extBlocks, Ci,
-                          Cx, c0, true);
+                          Cx, c0, true, workspace);
     }
 
     // end if cmpDiff
@@ -2185,6 +2879,10 @@ private:
   rewriteVectorMatrixMultiplication(graphblas::MatrixMultiplyGenericOp op,
                                     PatternRewriter &rewriter,
                                     ExtensionBlocks extBlocks) const {
+    if (useGustavsonMatrixMultiply(op))
+      return rewriteVectorMatrixMultiplicationGustavson(op, rewriter,
+                                                        extBlocks);
+
     ModuleOp module = op->getParentOfType<ModuleOp>();
     Location loc = op->getLoc();
 
@@ -2200,7 +2898,6 @@ private:
     Type valueType =
         op.getResult().getType().dyn_cast<RankedTensorType>().getElementType();
 
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
     // Initial constants
@@ -2218,27 +2915,33 @@ private:
     callResizePointers(rewriter, module, loc, C, c0, c2);
 
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, A, c0);
-    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, c0);
+        loc, getMemrefPointerType(A.getType()), A, c0);
+    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c0);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, B, c1);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, c1);
+        loc, getMemrefPointerType(B.getType()), B, c1);
+    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c1);
     Value Bx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
     Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, C, c0);
-    Value Mp, Mi, maskStart, maskEnd;
-    if (mask) {
-      Mp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                        mask, c0);
-      Mi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                       mask, c0);
-      Value maskStart64 = rewriter.create<memref::LoadOp>(loc, Mp, c0);
-      Value maskEnd64 = rewriter.create<memref::LoadOp>(loc, Mp, c1);
+        loc, getMemrefPointerType(C.getType()), C, c0);
+    Value Mp, Mi, Mx, maskStart, maskEnd;
+    if (mask && isBitmapVector(mask.getType())) {
+      // Bitmap masks are tested one output index at a time
+      Mx = rewriter.create<sparse_tensor::ToValuesOp>(
+          loc, getMemrefValueType(mask.getType()), mask);
+      maskStart = c0;
+      maskEnd = size;
+    } else if (mask) {
+      Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c0);
+      Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c0);
+      Value maskStart64 = loadI64(rewriter, loc, Mp, c0);
+      Value maskEnd64 = loadI64(rewriter, loc, Mp, c1);
       maskStart =
           rewriter.create<arith::IndexCastOp>(loc, maskStart64, indexType);
       maskEnd = rewriter.create<arith::IndexCastOp>(loc, maskEnd64, indexType);
@@ -2249,7 +2952,7 @@ private:
     //   Store results in Cp
     //   The vector A is the fixed element, while the columns of B are the
     //   iteration element
-    Value fixedIndexEnd64 = rewriter.create<memref::LoadOp>(loc, Ap, c1);
+    Value fixedIndexEnd64 = loadI64(rewriter, loc, Ap, c1);
     Value fixedIndexEnd =
         rewriter.create<arith::IndexCastOp>(loc, fixedIndexEnd64, indexType);
     Value cmpColSame = rewriter.create<arith::CmpIOp>(
@@ -2265,21 +2968,13 @@ private:
     rewriter.setInsertionPointToStart(ifBlock_rowTotal.elseBlock());
     Value total;
     if (mask) {
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, size, Mi, maskStart, maskEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        total = computeNumOverlaps(rewriter, loc, nk, Ai, c0, fixedIndexEnd, Bp,
-                                   Bi, maskComplement, c0, mcSize, valueType);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        total = computeNumOverlaps(rewriter, loc, nk, Ai, c0, fixedIndexEnd, Bp,
-                                   Bi, Mi, maskStart, maskEnd, valueType);
-      }
+      Value complementSize = isMaskComplement ? size : Value();
+      total = computeNumOverlaps(rewriter, loc, nk, c0, Ai, c0, fixedIndexEnd,
+                                 Bp, Bi, Mi, maskStart, maskEnd, valueType,
+                                 nullptr, complementSize, Mx);
     } else {
-      total = computeNumOverlaps(rewriter, loc, nk, Ai, c0, fixedIndexEnd, Bp,
-                                 Bi, nullptr, c0, size, valueType);
+      total = computeNumOverlaps(rewriter, loc, nk, c0, Ai, c0, fixedIndexEnd,
+                                 Bp, Bi, nullptr, c0, size, valueType);
     }
     rewriter.create<scf::YieldOp>(loc, total);
 
@@ -2287,12 +2982,12 @@ private:
     rewriter.setInsertionPointAfter(ifBlock_rowTotal);
     Value nnzTotal = ifBlock_rowTotal.getResult(0);
     Value nnz = rewriter.create<arith::IndexCastOp>(loc, nnzTotal, indexType);
-    rewriter.create<memref::StoreOp>(loc, nnzTotal, Cp, c1);
+    storeI64(rewriter, loc, nnzTotal, Cp, c1);
 
     callResizeIndex(rewriter, module, loc, C, c0, nnz);
     callResizeValues(rewriter, module, loc, C, nnz);
-    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           C, c0);
+    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c0);
     Value Cx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
 
@@ -2308,20 +3003,11 @@ private:
     rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
 
     if (mask) {
-      if (isMaskComplement) {
-        ValueRange mcResult =
-            buildMaskComplement(rewriter, loc, size, Mi, maskStart, maskEnd);
-        Value maskComplement = mcResult[0];
-        Value mcSize = mcResult[1];
-        computeInnerProduct(rewriter, loc, nk, c0, Ai, Ax, c0, fixedIndexEnd,
-                            Bp, Bi, Bx, maskComplement, c0, mcSize, valueType,
-                            extBlocks, Ci, Cx, c0, false);
-        rewriter.create<memref::DeallocOp>(loc, maskComplement);
-      } else {
-        computeInnerProduct(rewriter, loc, nk, c0, Ai, Ax, c0, fixedIndexEnd,
-                            Bp, Bi, Bx, Mi, maskStart, maskEnd, valueType,
-                            extBlocks, Ci, Cx, c0, false);
-      }
+      Value complementSize = isMaskComplement ? size : Value();
+      computeInnerProduct(rewriter, loc, nk, c0, Ai, Ax, c0, fixedIndexEnd,
+                          Bp, Bi, Bx, Mi, maskStart, maskEnd, valueType,
+                          extBlocks, Ci, Cx, c0, false, nullptr,
+                          complementSize, Mx);
     } else {
       computeInnerProduct(rewriter, loc, nk, c0, Ai, Ax, c0, fixedIndexEnd, Bp,
                           Bi, Bx, nullptr, c0, size, valueType, extBlocks, Ci,
@@ -2338,6 +3024,122 @@ private:
     return success();
   }
 
+  // Computes A x B as the single-row case of Gustavson's algorithm, only
+  // visiting the rows of B selected by A. This is the "push" (top-down)
+  // direction of a traversal, where the cost depends on the number of edges
+  // leaving the frontier A rather than on the size of B. A complemented mask
+  // is stamped into the marker rather than materialized.
+  LogicalResult rewriteVectorMatrixMultiplicationGustavson(
+      graphblas::MatrixMultiplyGenericOp op, PatternRewriter &rewriter,
+      ExtensionBlocks extBlocks) const {
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+    Location loc = op->getLoc();
+
+    // Inputs
+    Value A = op.a();
+    Value B = op.b();
+    Value mask = op.mask(); // always complemented if present
+
+    // Types
+    Type indexType = rewriter.getIndexType();
+    Type int64Type = rewriter.getIntegerType(64);
+    Type valueType =
+        op.getResult().getType().dyn_cast<RankedTensorType>().getElementType();
+
+    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
+
+    // Initial constants
+    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    Value c2 = rewriter.create<arith::ConstantIndexOp>(loc, 2);
+    Value cneg1 = rewriter.create<arith::ConstantIntOp>(loc, -1, int64Type);
+
+    Value size = rewriter.create<graphblas::NumColsOp>(loc, B);
+
+    Value C = callEmptyLike(rewriter, module, loc, A);
+    callResizeDim(rewriter, module, loc, C, c0, size);
+    callResizePointers(rewriter, module, loc, C, c0, c2);
+
+    Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(A.getType()), A, c0);
+    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c0);
+    Value Ax =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
+    Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(B.getType()), B, c1);
+    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c1);
+    Value Bx =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
+    Value Cp = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(C.getType()), C, c0);
+    Value Mi, maskStart = c0, maskEnd = c0;
+    if (mask) {
+      Value Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c0);
+      Mi = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c0);
+      Value maskStart64 = loadI64(rewriter, loc, Mp, c0);
+      Value maskEnd64 = loadI64(rewriter, loc, Mp, c1);
+      maskStart =
+          rewriter.create<arith::IndexCastOp>(loc, maskStart64, indexType);
+      maskEnd = rewriter.create<arith::IndexCastOp>(loc, maskEnd64, indexType);
+    }
+
+    Value fixedIndexEnd64 = loadI64(rewriter, loc, Ap, c1);
+    Value fixedIndexEnd =
+        rewriter.create<arith::IndexCastOp>(loc, fixedIndexEnd64, indexType);
+
+    Value marker = rewriter.create<memref::AllocOp>(loc, memref1DI64Type, size);
+    rewriter.create<linalg::FillOp>(loc, cneg1, marker);
+
+    // 1st pass
+    //   Compute the number of nonzero entries in the result
+    //   Store results in Cp
+    Value nnzTotal =
+        computeSaxpyRowSize(rewriter, loc, c0, Ai, c0, fixedIndexEnd, Bp, Bj,
+                            marker, Mi, maskStart, maskEnd);
+    Value nnz = rewriter.create<arith::IndexCastOp>(loc, nnzTotal, indexType);
+    storeI64(rewriter, loc, nnzTotal, Cp, c1);
+
+    callResizeIndex(rewriter, module, loc, C, c0, nnz);
+    callResizeValues(rewriter, module, loc, C, nnz);
+    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c0);
+    Value Cx =
+        rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
+
+    // 2nd pass
+    //   Compute the nonzero values.
+    //   Store in Ci and Cx
+    Value cmp_cpDifferent =
+        rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::ne, c0, nnz);
+    scf::IfOp ifBlock_cmpDiff =
+        rewriter.create<scf::IfOp>(loc, cmp_cpDifferent);
+    rewriter.setInsertionPointToStart(ifBlock_cmpDiff.thenBlock());
+
+    // The 1st pass used the same stamps, so the marker must be reset
+    rewriter.create<linalg::FillOp>(loc, cneg1, marker);
+    Value workspace =
+        rewriter.create<memref::AllocOp>(loc, memref1DValueType, size);
+    computeSaxpyRow(rewriter, loc, size, c0, Ai, Ax, c0, fixedIndexEnd, Bp, Bj,
+                    Bx, marker, workspace, Mi, maskStart, maskEnd, valueType,
+                    extBlocks, Ci, Cx, c0, nnz);
+    rewriter.create<memref::DeallocOp>(loc, workspace);
+
+    // end if cmpDiff
+    rewriter.setInsertionPointAfter(ifBlock_cmpDiff);
+    rewriter.create<memref::DeallocOp>(loc, marker);
+
+    rewriter.replaceOp(op, C);
+
+    cleanupIntermediateTensor(rewriter, module, loc, C);
+
+    return success();
+  }
+
   LogicalResult
   rewriteVectorVectorMultiplication(graphblas::MatrixMultiplyGenericOp op,
                                     PatternRewriter &rewriter,
@@ -2351,10 +3153,8 @@ private:
 
     // Types
     Type indexType = rewriter.getIndexType();
-    Type int64Type = rewriter.getIntegerType(64);
     Type valueType = A.getType().dyn_cast<RankedTensorType>().getElementType();
 
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
     // Initial constants
@@ -2373,19 +3173,19 @@ private:
     callResizeValues(rewriter, module, loc, C, c1);
 
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, A, c0);
-    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, c0);
+        loc, getMemrefPointerType(A.getType()), A, c0);
+    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c0);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, B, c0);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, c0);
+        loc, getMemrefPointerType(B.getType()), B, c0);
+    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c0);
     Value Bx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
-    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           C, c0);
+    Value Ci = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(C.getType()), C, c0);
     Value Cx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, C);
 
@@ -2394,7 +3194,7 @@ private:
     //   Store in Ci and Cx (single-element vector representing a scalar)
     //   The vector A is the fixed element, while the vector B is treated as the
     //   iteration element
-    Value fixedIndexEnd64 = rewriter.create<memref::LoadOp>(loc, Ap, c1);
+    Value fixedIndexEnd64 = loadI64(rewriter, loc, Ap, c1);
     Value fixedIndexEnd =
         rewriter.create<arith::IndexCastOp>(loc, fixedIndexEnd64, indexType);
 
@@ -2530,7 +3330,8 @@ public:
         graphblas::YieldKind::ADD_IDENTITY, graphblas::YieldKind::ADD,
         graphblas::YieldKind::MULT, graphblas::YieldKind::AGG_IDENTITY,
         graphblas::YieldKind::AGG};
-    std::set<graphblas::YieldKind> optional = {};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::TRANSFORM_OUT};
     LogicalResult extractResult =
         extBlocks.extractBlocks(op, extensions, required, optional);
 
@@ -2544,7 +3345,6 @@ public:
     Type boolType = rewriter.getI1Type();
     Type valueType = A.getType().dyn_cast<RankedTensorType>().getElementType();
 
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DBoolType = MemRefType::get({-1}, boolType);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
@@ -2566,15 +3366,15 @@ public:
 
     // Get sparse tensor info
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, A, c1);
-    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, c1);
+        loc, getMemrefPointerType(A.getType()), A, c1);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, c1);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, B, c1);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, c1);
+        loc, getMemrefPointerType(B.getType()), B, c1);
+    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, c1);
     Value Bx =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, B);
 
@@ -2585,10 +3385,10 @@ public:
 
     Value Mp, Mj;
     if (mask) {
-      Mp = rewriter.create<sparse_tensor::ToPointersOp>(loc, memref1DI64Type,
-                                                        mask, c1);
-      Mj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                       mask, c1);
+      Mp = rewriter.create<sparse_tensor::ToPointersOp>(
+          loc, getMemrefPointerType(mask.getType()), mask, c1);
+      Mj = rewriter.create<sparse_tensor::ToIndicesOp>(
+          loc, getMemrefIndexType(mask.getType()), mask, c1);
     }
 
     // In parallel over the rows and columns,
@@ -2599,8 +3399,8 @@ public:
     rewriter.setInsertionPointToStart(rowLoop.getBody());
 
     Value rowPlus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-    Value apStart64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
-    Value apEnd64 = rewriter.create<memref::LoadOp>(loc, Ap, rowPlus1);
+    Value apStart64 = loadI64(rewriter, loc, Ap, row);
+    Value apEnd64 = loadI64(rewriter, loc, Ap, rowPlus1);
     Value cmp_cpSame = rewriter.create<arith::CmpIOp>(
         loc, arith::CmpIPredicate::eq, apStart64, apEnd64);
 
@@ -2625,7 +3425,7 @@ public:
         rewriter.create<scf::ParallelOp>(loc, colStart, colEnd, c1);
     Value jj = colLoop1.getInductionVars().front();
     rewriter.setInsertionPointToStart(colLoop1.getBody());
-    Value col64 = rewriter.create<memref::LoadOp>(loc, Aj, jj);
+    Value col64 = loadI64(rewriter, loc, Aj, jj);
     Value col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
     rewriter.create<memref::StoreOp>(loc, ctrue, kvec_i1, col);
     Value val = rewriter.create<memref::LoadOp>(loc, Ax, jj);
@@ -2637,8 +3437,8 @@ public:
     // Loop thru all columns of B; accumulate values
     scf::ParallelOp colLoop2;
     if (mask) {
-      Value mcolStart64 = rewriter.create<memref::LoadOp>(loc, Mp, row);
-      Value mcolEnd64 = rewriter.create<memref::LoadOp>(loc, Mp, rowPlus1);
+      Value mcolStart64 = loadI64(rewriter, loc, Mp, row);
+      Value mcolEnd64 = loadI64(rewriter, loc, Mp, rowPlus1);
       Value mcolStart =
           rewriter.create<arith::IndexCastOp>(loc, mcolStart64, indexType);
       Value mcolEnd =
@@ -2648,7 +3448,7 @@ public:
           rewriter.create<scf::ParallelOp>(loc, mcolStart, mcolEnd, c1, cf0);
       Value mm = colLoop2.getInductionVars().front();
       rewriter.setInsertionPointToStart(colLoop2.getBody());
-      col64 = rewriter.create<memref::LoadOp>(loc, Mj, mm);
+      col64 = loadI64(rewriter, loc, Mj, mm);
       col = rewriter.create<arith::IndexCastOp>(loc, col64, indexType);
     } else {
       colLoop2 = rewriter.create<scf::ParallelOp>(loc, c0, ncol, c1, cf0);
@@ -2658,8 +3458,8 @@ public:
     }
 
     Value colPlus1 = rewriter.create<arith::AddIOp>(loc, col, c1);
-    Value iStart64 = rewriter.create<memref::LoadOp>(loc, Bp, col);
-    Value iEnd64 = rewriter.create<memref::LoadOp>(loc, Bp, colPlus1);
+    Value iStart64 = loadI64(rewriter, loc, Bp, col);
+    Value iEnd64 = loadI64(rewriter, loc, Bp, colPlus1);
     Value iStart =
         rewriter.create<arith::IndexCastOp>(loc, iStart64, indexType);
     Value iEnd = rewriter.create<arith::IndexCastOp>(loc, iEnd64, indexType);
@@ -2672,17 +3472,25 @@ public:
     Value addIdentity = addIdentityYield.values().front();
     rewriter.eraseOp(addIdentityYield);
 
+    // A transform_out block only applies to the entries of the product, so
+    // track whether each one has any overlapping pair
+    SmallVector<Value, 2> kInit = {addIdentity};
+    SmallVector<Type, 2> kTypes = {valueType};
+    if (extBlocks.transformOut) {
+      kInit.push_back(cfalse);
+      kTypes.push_back(boolType);
+    }
     scf::ForOp kLoop =
-        rewriter.create<scf::ForOp>(loc, iStart, iEnd, c1, addIdentity);
+        rewriter.create<scf::ForOp>(loc, iStart, iEnd, c1, kInit);
     Value ii = kLoop.getInductionVar();
-    Value curr = kLoop.getLoopBody().getArgument(1);
+    ValueRange curr = kLoop.getRegionIterArgs();
     rewriter.setInsertionPointToStart(kLoop.getBody());
 
-    Value kk64 = rewriter.create<memref::LoadOp>(loc, Bi, ii);
+    Value kk64 = loadI64(rewriter, loc, Bi, ii);
     Value kk = rewriter.create<arith::IndexCastOp>(loc, kk64, indexType);
     Value cmpPair = rewriter.create<memref::LoadOp>(loc, kvec_i1, kk);
     scf::IfOp ifBlock_cmpPair =
-        rewriter.create<scf::IfOp>(loc, valueType, cmpPair, true);
+        rewriter.create<scf::IfOp>(loc, kTypes, cmpPair, true);
     // if cmpPair
     rewriter.setInsertionPointToStart(ifBlock_cmpPair.thenBlock());
 
@@ -2701,13 +3509,16 @@ public:
 
     // insert add operation block
     rewriter.mergeBlocks(extBlocks.add, rewriter.getBlock(),
-                         {curr, multResult});
+                         {curr[0], multResult});
     graphblas::YieldOp addYield = llvm::dyn_cast_or_null<graphblas::YieldOp>(
         rewriter.getBlock()->getTerminator());
     Value addResult = addYield.values().front();
     rewriter.eraseOp(addYield);
 
-    rewriter.create<scf::YieldOp>(loc, addResult);
+    if (extBlocks.transformOut)
+      rewriter.create<scf::YieldOp>(loc, ValueRange{addResult, ctrue});
+    else
+      rewriter.create<scf::YieldOp>(loc, addResult);
 
     // else
     rewriter.setInsertionPointToStart(ifBlock_cmpPair.elseBlock());
@@ -2715,15 +3526,20 @@ public:
 
     // end if cmpPair
     rewriter.setInsertionPointAfter(ifBlock_cmpPair);
-    Value newCurr = ifBlock_cmpPair.getResult(0);
-    rewriter.create<scf::YieldOp>(loc, newCurr);
+    rewriter.create<scf::YieldOp>(loc, ifBlock_cmpPair.getResults());
 
     // end k loop
     rewriter.setInsertionPointAfter(kLoop);
 
     Value colVal = kLoop.getResult(0);
 
-    // FIXME: this is where transform_out goes
+    // Missing entries of the product contribute nothing to the aggregate
+    if (extBlocks.transformOut) {
+      Value transformed =
+          inlineExtensionBlock(rewriter, extBlocks.transformOut, colVal);
+      colVal = rewriter.create<SelectOp>(loc, kLoop.getResult(1), transformed,
+                                         cf0);
+    }
 
     scf::ReduceOp colReducer = rewriter.create<scf::ReduceOp>(loc, colVal);
     BlockArgument lhs = colReducer.getRegion().getArgument(0);
@@ -2845,8 +3661,10 @@ public:
     RegionRange extensions = op.extensions();
     ExtensionBlocks extBlocks;
     std::set<graphblas::YieldKind> required = {graphblas::YieldKind::MULT};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::TRANSFORM_OUT};
     LogicalResult extractResult =
-        extBlocks.extractBlocks(op, extensions, required, {});
+        extBlocks.extractBlocks(op, extensions, required, optional);
 
     if (extractResult.failed()) {
       return extractResult;
@@ -2868,6 +3686,25 @@ public:
                                extBlocks.mult, UNION);
     }
 
+    // Values copied from either side bypass the mult block, so the
+    // transform_out block is applied in a pass over the output values
+    if (extBlocks.transformOut) {
+      Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+      Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+      Value nnz = rewriter.create<graphblas::NumValsOp>(loc, output);
+      Value outputValues = rewriter.create<sparse_tensor::ToValuesOp>(
+          loc, getMemrefValueType(output.getType()), output);
+      scf::ParallelOp valueLoop =
+          rewriter.create<scf::ParallelOp>(loc, c0, nnz, c1);
+      Value valueIdx = valueLoop.getInductionVars().front();
+      rewriter.setInsertionPointToStart(valueLoop.getBody());
+      Value val = rewriter.create<memref::LoadOp>(loc, outputValues, valueIdx);
+      Value result =
+          inlineExtensionBlock(rewriter, extBlocks.transformOut, val);
+      rewriter.create<memref::StoreOp>(loc, result, outputValues, valueIdx);
+      rewriter.setInsertionPointAfter(valueLoop);
+    }
+
     rewriter.replaceOp(op, output);
 
     cleanupIntermediateTensor(rewriter, module, loc, output);
@@ -2979,6 +3816,22 @@ public:
   };
 };
 
+// Whether the buffers of the input of `op` may be moved into its output. The
+// input must be a tensor produced just before by a graphblas op and read by
+// nothing else. Ops whose lowering may return their operand are ruled out,
+// as that operand can be owned elsewhere.
+static bool canMoveInput(graphblas::UpdateOp op) {
+  Value input = op.input();
+  if (input.getType() != op.output().getType() || !input.hasOneUse())
+    return false;
+  Operation *producer = input.getDefiningOp();
+  if (producer == nullptr || producer->getBlock() != op->getBlock() ||
+      !isa_and_nonnull<graphblas::GraphBLASDialect>(producer->getDialect()))
+    return false;
+  return !isa<graphblas::ConvertLayoutOp, graphblas::CastOp,
+              graphblas::ApplyOp>(producer);
+}
+
 class LowerUpdateRewrite : public OpRewritePattern<graphblas::UpdateOp> {
 public:
   using OpRewritePattern<graphblas::UpdateOp>::OpRewritePattern;
@@ -3035,11 +3888,17 @@ public:
       if (replace) {
         // input -> output(mask) { replace }
 
+        callDetachTensor(rewriter, module, loc, output);
         computeEwise(rewriter, loc, module, input, mask, output, nullptr,
                      maskBehavior);
-      } else {
+      } else if (!isBitmapVector(mask.getType())) {
         // input -> output(mask)
 
+        computeMaskedUpdate(rewriter, loc, module, input, mask, output,
+                            nullptr, maskComplement, replace);
+      } else {
+        // input -> output(bitmap mask)
+
         // Step 1: apply the mask inverse to the output
         EwiseBehavior maskInverseBehavior =
             (maskComplement ? MASK : MASK_COMPLEMENT);
@@ -3053,6 +3912,7 @@ public:
         // Step 3: union the two masked results
         // Note that there should be zero overlaps, so we do not provide
         //      an accumulation block
+        callDetachTensor(rewriter, module, loc, output);
         computeEwise(rewriter, loc, module, maskedInput, maskedOutput, output,
                      nullptr, UNION);
         rewriter.create<sparse_tensor::ReleaseOp>(loc, maskedOutput);
@@ -3061,11 +3921,20 @@ public:
     } else {
       // input -> output { replace? }
 
-      Value inputCopy = callDupTensor(rewriter, module, loc, input);
-      callSwapPointers(rewriter, module, loc, inputCopy, output);
-      callSwapIndices(rewriter, module, loc, inputCopy, output);
-      callSwapValues(rewriter, module, loc, inputCopy, output);
-      rewriter.create<sparse_tensor::ReleaseOp>(loc, inputCopy);
+      if (canMoveInput(op)) {
+        // The buffers of the input are taken over, and its tensor is left
+        // holding the old buffers of the output. The input is released by
+        // its producer's lowering like any other intermediate.
+        callSwapPointers(rewriter, module, loc, output, input);
+        callSwapIndices(rewriter, module, loc, output, input);
+        callSwapValues(rewriter, module, loc, output, input);
+      } else {
+        Value inputCopy = callDupTensor(rewriter, module, loc, input);
+        callSwapPointers(rewriter, module, loc, inputCopy, output);
+        callSwapIndices(rewriter, module, loc, inputCopy, output);
+        callSwapValues(rewriter, module, loc, inputCopy, output);
+        rewriter.create<sparse_tensor::ReleaseOp>(loc, inputCopy);
+      }
     }
 
     rewriter.eraseOp(op);
@@ -3109,7 +3978,8 @@ public:
     auto computeEwise =
         rank == 2 ? computeMatrixElementWise : computeVectorElementWise;
 
-    if (mask) {
+    if (mask && isBitmapVector(mask.getType())) {
+      // Bitmap masks are applied as separate element-wise steps
       EwiseBehavior maskBehavior = (maskComplement ? MASK_COMPLEMENT : MASK);
       if (replace) {
         // input -> output(mask) { accumulate, replace }
@@ -3124,6 +3994,7 @@ public:
         computeEwise(rewriter, loc, module, input, mask, maskedInput, nullptr,
                      maskBehavior);
         // Step 3: union the two masked results
+        callDetachTensor(rewriter, module, loc, output);
         computeEwise(rewriter, loc, module, maskedOutput, maskedInput, output,
                      extBlocks.accumulate, UNION);
         rewriter.create<sparse_tensor::ReleaseOp>(loc, maskedOutput);
@@ -3137,20 +4008,20 @@ public:
         computeEwise(rewriter, loc, module, input, mask, maskedInput, nullptr,
                      maskBehavior);
         // Step 2: union the two masked results
-        Value outputCopy = callDupTensor(rewriter, module, loc, output);
+        // Writing to the output detaches it from the view of its old contents
+        Value outputCopy = callViewTensor(rewriter, module, loc, output);
+        callDetachTensor(rewriter, module, loc, output);
         computeEwise(rewriter, loc, module, outputCopy, maskedInput, output,
                      extBlocks.accumulate, UNION);
         rewriter.create<sparse_tensor::ReleaseOp>(loc, outputCopy);
         rewriter.create<sparse_tensor::ReleaseOp>(loc, maskedInput);
       }
     } else {
-      // input -> output { accumulate, replace? }
-      // Must think of this as `output << input` so ordering is correct
+      // input -> output(mask?) { accumulate, replace? }
+      // Must think of this as `output(mask?) << input` so ordering is correct
 
-      Value outputCopy = callDupTensor(rewriter, module, loc, output);
-      computeEwise(rewriter, loc, module, outputCopy, input, output,
-                   extBlocks.accumulate, UNION);
-      rewriter.create<sparse_tensor::ReleaseOp>(loc, outputCopy);
+      computeMaskedUpdate(rewriter, loc, module, input, mask, output,
+                          extBlocks.accumulate, maskComplement, replace);
     }
 
     rewriter.eraseOp(op);
@@ -3176,9 +4047,7 @@ public:
     // Need to use a standard word size in AND-reduction for OpenMP
     // This could be i8, i32, or i64, but we pick i32
     Type intReduceType = rewriter.getIntegerType(32);
-    Type int64Type = rewriter.getIntegerType(64);
     Type valueType = aType.getElementType();
-    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memref1DValueType = MemRefType::get({-1}, valueType);
 
     // Initial constants
@@ -3229,10 +4098,10 @@ public:
     rewriter.setInsertionPointToStart(ifNnz.thenBlock());
 
     // Check index positions and values
-    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           A, dimIndex);
-    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           B, dimIndex);
+    Value Ai = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(A.getType()), A, dimIndex);
+    Value Bi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(B.getType()), B, dimIndex);
     Value Ax =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memref1DValueType, A);
     Value Bx =
@@ -3243,8 +4112,8 @@ public:
     Value loopIdx = indexLoop.getInductionVars().front();
     rewriter.setInsertionPointToStart(indexLoop.getBody());
 
-    Value aIndex = rewriter.create<memref::LoadOp>(loc, Ai, loopIdx);
-    Value bIndex = rewriter.create<memref::LoadOp>(loc, Bi, loopIdx);
+    Value aIndex = loadI64(rewriter, loc, Ai, loopIdx);
+    Value bIndex = loadI64(rewriter, loc, Bi, loopIdx);
     Value aValue = rewriter.create<memref::LoadOp>(loc, Ax, loopIdx);
     Value bValue = rewriter.create<memref::LoadOp>(loc, Bx, loopIdx);
     Value cmpIndex = rewriter.create<arith::CmpIOp>(
@@ -3353,8 +4222,6 @@ public:
     Type outputElementType = outputTensorType.getElementType();
     Type indexType = rewriter.getIndexType();
     Type i64Type = rewriter.getI64Type();
-    Type memrefPointerType = getMemrefPointerType(inputTensorType);
-    Type memrefIndexType = getMemrefIndexType(inputTensorType);
     Type memrefOValueType = getMemrefValueType(outputTensorType);
     unsigned rank = inputTensorType.getRank();
 
@@ -3392,13 +4259,13 @@ public:
 
     // Get sparse tensor info
     Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memrefPointerType, input, dimIndex);
-    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefIndexType,
-                                                           input, dimIndex);
+        loc, getMemrefPointerType(input.getType()), input, dimIndex);
+    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, dimIndex);
     Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memrefPointerType, output, dimIndex);
-    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefIndexType,
-                                                           output, dimIndex);
+        loc, getMemrefPointerType(output.getType()), output, dimIndex);
+    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(output.getType()), output, dimIndex);
     Value Ox = rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefOValueType,
                                                           output);
 
@@ -3410,43 +4277,30 @@ public:
       Value rowIndex = loop.getInductionVar();
 
       Value row_plus1 = rewriter.create<arith::AddIOp>(loc, rowIndex, c1);
-      Value idxStart_64 = rewriter.create<memref::LoadOp>(loc, Ip, rowIndex);
-      Value idxEnd_64 = rewriter.create<memref::LoadOp>(loc, Ip, row_plus1);
+      Value idxStart_64 = loadI64(rewriter, loc, Ip, rowIndex);
+      Value idxEnd_64 = loadI64(rewriter, loc, Ip, row_plus1);
       Value idxStart =
           rewriter.create<arith::IndexCastOp>(loc, idxStart_64, indexType);
       Value idxEnd =
           rewriter.create<arith::IndexCastOp>(loc, idxEnd_64, indexType);
 
-      ValueRange mcResults =
-          buildMaskComplement(rewriter, loc, compSize, Ii, idxStart, idxEnd);
-      Value maskComplement = mcResults[0];
-      Value maskComplementSize = mcResults[1];
+      // The complement is written straight into the output indices
+      Value maskComplementSize = writeMaskComplement(
+          rewriter, loc, compSize, Ii, idxStart, idxEnd, Oi, rowCount);
 
       Value newCount =
           rewriter.create<arith::AddIOp>(loc, rowCount, maskComplementSize);
       Value newCount_64 =
           rewriter.create<arith::IndexCastOp>(loc, newCount, i64Type);
-      rewriter.create<memref::StoreOp>(loc, newCount_64, Op, row_plus1);
-
-      scf::ForOp innerLoop =
-          rewriter.create<scf::ForOp>(loc, c0, maskComplementSize, c1);
-      {
-        rewriter.setInsertionPointToStart(innerLoop.getBody());
-        Value mcIndex = innerLoop.getInductionVar();
-        Value colIndex = rewriter.create<arith::AddIOp>(loc, mcIndex, rowCount);
-
-        Value innerIdx =
-            rewriter.create<memref::LoadOp>(loc, maskComplement, mcIndex);
-        rewriter.create<memref::StoreOp>(loc, innerIdx, Oi, colIndex);
-        rewriter.create<memref::StoreOp>(loc, value, Ox, colIndex);
-
-        rewriter.setInsertionPointAfter(innerLoop);
-      }
+      storeI64(rewriter, loc, newCount_64, Op, row_plus1);
 
       rewriter.create<scf::YieldOp>(loc, ValueRange{newCount});
       rewriter.setInsertionPointAfter(loop);
     }
 
+    // Every output value is the same
+    rewriter.create<linalg::FillOp>(loc, value, Ox);
+
     rewriter.replaceOp(op, output);
 
     return success();
@@ -3485,7 +4339,6 @@ private:
 
     Type indexType = rewriter.getIndexType();
     Type int64Type = rewriter.getIntegerType(64);
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
     Type memref1DValueType = MemRefType::get({-1}, valueType);
 
     Value c0_i64 =
@@ -3498,7 +4351,7 @@ private:
 
     Value vectorLength = rewriter.create<graphblas::SizeOp>(loc, vector);
     Value vectorIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, vector, c0);
+        loc, getMemrefIndexType(vector.getType()), vector, c0);
     Value vectorValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, vector);
 
@@ -3516,7 +4369,7 @@ private:
       callResizeValues(rewriter, module, loc, output, outputNNZ);
 
       Value outputIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-          loc, memref1DI64Type, output, c1);
+          loc, getMemrefIndexType(output.getType()), output, c1);
       Value outputValues = rewriter.create<sparse_tensor::ToValuesOp>(
           loc, memref1DValueType, output);
 
@@ -3526,9 +4379,8 @@ private:
         rewriter.setInsertionPointToStart(copyValuesAndIndicesLoop.getBody());
         Value outputPosition = copyValuesAndIndicesLoop.getInductionVar();
         Value vectorIndex =
-            rewriter.create<memref::LoadOp>(loc, vectorIndices, outputPosition);
-        rewriter.create<memref::StoreOp>(loc, vectorIndex, outputIndices,
-                                         outputPosition);
+            loadI64(rewriter, loc, vectorIndices, outputPosition);
+        storeI64(rewriter, loc, vectorIndex, outputIndices, outputPosition);
         Value vectorValue =
             rewriter.create<memref::LoadOp>(loc, vectorValues, outputPosition);
         rewriter.create<memref::StoreOp>(loc, vectorValue, outputValues,
@@ -3537,9 +4389,9 @@ private:
       }
 
       Value outputPointers = rewriter.create<sparse_tensor::ToPointersOp>(
-          loc, memref1DI64Type, output, c1);
+          loc, getMemrefPointerType(output.getType()), output, c1);
       Value initialVectorIndicesValue =
-          rewriter.create<memref::LoadOp>(loc, vectorIndices, c0);
+          loadI64(rewriter, loc, vectorIndices, c0);
       Value vectorLengthMinusOne =
           rewriter.create<arith::SubIOp>(loc, vectorLength, c1);
       scf::ForOp pointersUpdateLoop = rewriter.create<scf::ForOp>(
@@ -3554,8 +4406,7 @@ private:
         Value vectorIndicesValue =
             pointersUpdateLoop.getLoopBody().getArgument(3);
 
-        rewriter.create<memref::StoreOp>(loc, ptr_i64, outputPointers,
-                                         pointersPosition);
+        storeI64(rewriter, loc, ptr_i64, outputPointers, pointersPosition);
         Value pointersPosition_i64 = rewriter.create<arith::IndexCastOp>(
             loc, pointersPosition, int64Type);
         Value rowHasValue = rewriter.create<arith::CmpIOp>(
@@ -3575,8 +4426,8 @@ private:
               rewriter.create<arith::AddIOp>(loc, ptr_i64, c1_i64);
           Value nextVectorIndicesPosition =
               rewriter.create<arith::AddIOp>(loc, vectorIndicesPosition, c1);
-          Value nextUpdatedVectorIndicesValue = rewriter.create<memref::LoadOp>(
-              loc, vectorIndices, nextVectorIndicesPosition);
+          Value nextUpdatedVectorIndicesValue =
+              loadI64(rewriter, loc, vectorIndices, nextVectorIndicesPosition);
 
           rewriter.create<scf::YieldOp>(
               loc, ValueRange{nextPtr_i64, nextVectorIndicesPosition,
@@ -3603,8 +4454,7 @@ private:
 
       Value outputNNZ_i64 =
           rewriter.create<arith::IndexCastOp>(loc, outputNNZ, int64Type);
-      rewriter.create<memref::StoreOp>(loc, outputNNZ_i64, outputPointers,
-                                       vectorLength);
+      storeI64(rewriter, loc, outputNNZ_i64, outputPointers, vectorLength);
       rewriter.setInsertionPointAfter(ifHasValues);
     }
 
@@ -3632,7 +4482,6 @@ private:
     Type indexType = rewriter.getIndexType();
     Type int64Type = rewriter.getIntegerType(64);
     Type int1Type = rewriter.getIntegerType(1);
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
     Type memref1DValueType = MemRefType::get({-1}, valueType);
 
     Value c1_i1 =
@@ -3653,9 +4502,9 @@ private:
     Value nrows = rewriter.create<graphblas::NumRowsOp>(loc, matrix);
 
     Value matrixPointers = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, matrix, c1);
+        loc, getMemrefPointerType(matrix.getType()), matrix, c1);
     Value matrixIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, matrix, c1);
+        loc, getMemrefIndexType(matrix.getType()), matrix, c1);
     Value matrixValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, matrix);
 
@@ -3692,9 +4541,9 @@ private:
           rewriter.create<arith::AddIOp>(loc, matrixRowIndex, c1);
 
       Value firstPtr_i64 =
-          rewriter.create<memref::LoadOp>(loc, matrixPointers, matrixRowIndex);
-      Value secondPtr_i64 = rewriter.create<memref::LoadOp>(loc, matrixPointers,
-                                                            nextMatrixRowIndex);
+          loadI64(rewriter, loc, matrixPointers, matrixRowIndex);
+      Value secondPtr_i64 =
+          loadI64(rewriter, loc, matrixPointers, nextMatrixRowIndex);
 
       Value firstPtr =
           rewriter.create<arith::IndexCastOp>(loc, firstPtr_i64, indexType);
@@ -3731,7 +4580,7 @@ private:
             &findDiagonalWhileLoop.getAfter().front());
         Value currentPtr = findDiagonalWhileLoopAfter->getArgument(0);
         Value elementColumnIndex_i64 =
-            rewriter.create<memref::LoadOp>(loc, matrixIndices, currentPtr);
+            loadI64(rewriter, loc, matrixIndices, currentPtr);
         Value isNotDiagonalPosition = rewriter.create<arith::CmpIOp>(
             op.getLoc(), arith::CmpIPredicate::ne, elementColumnIndex_i64,
             matrixRowIndex_i64);
@@ -3770,13 +4619,13 @@ private:
     callResizeValues(rewriter, module, loc, output, outputNNZ);
 
     Value outputPointers = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, output, c0);
+        loc, getMemrefPointerType(output.getType()), output, c0);
     Value outputNNZ_i64 =
         rewriter.create<arith::IndexCastOp>(loc, outputNNZ, int64Type);
-    rewriter.create<memref::StoreOp>(loc, outputNNZ_i64, outputPointers, c1);
+    storeI64(rewriter, loc, outputNNZ_i64, outputPointers, c1);
 
     Value outputIndices = rewriter.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, output, c0);
+        loc, getMemrefIndexType(output.getType()), output, c0);
     Value outputValues = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, output);
 
@@ -3790,10 +4639,9 @@ private:
           outputValueAndIndicesFillingLoop.getBody());
 
       Value nextRowIndex = rewriter.create<arith::AddIOp>(loc, rowIndex, c1);
-      Value firstPtr_i64 =
-          rewriter.create<memref::LoadOp>(loc, matrixPointers, rowIndex);
+      Value firstPtr_i64 = loadI64(rewriter, loc, matrixPointers, rowIndex);
       Value secondPtr_i64 =
-          rewriter.create<memref::LoadOp>(loc, matrixPointers, nextRowIndex);
+          loadI64(rewriter, loc, matrixPointers, nextRowIndex);
 
       Value firstPtr =
           rewriter.create<arith::IndexCastOp>(loc, firstPtr_i64, indexType);
@@ -3846,7 +4694,7 @@ private:
         Value previousDiagonalValue =
             findDiagonalWhileLoopAfter->getArgument(2);
         Value elementColumnIndex_i64 =
-            rewriter.create<memref::LoadOp>(loc, matrixIndices, currentPtr);
+            loadI64(rewriter, loc, matrixIndices, currentPtr);
         Value isNotDiagonalPosition = rewriter.create<arith::CmpIOp>(
             op.getLoc(), arith::CmpIPredicate::ne, elementColumnIndex_i64,
             rowIndex_i64);
@@ -3888,8 +4736,8 @@ private:
 
         rewriter.create<memref::StoreOp>(loc, diagonalValue, outputValues,
                                          outputValuesPosition);
-        rewriter.create<memref::StoreOp>(loc, rowIndex_i64, outputIndices,
-                                         outputValuesPosition);
+        storeI64(rewriter, loc, rowIndex_i64, outputIndices,
+                 outputValuesPosition);
 
         Value nextOutputValuesPosition =
             rewriter.create<arith::AddIOp>(loc, outputValuesPosition, c1);
@@ -3993,41 +4841,43 @@ public:
     Type valueType = input.getType().dyn_cast<TensorType>().getElementType();
     Type int64Type = rewriter.getIntegerType(64);
     Type indexType = rewriter.getIndexType();
-    Type memref1DI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
     Type memref1DValueType = MemRefType::get({-1}, valueType);
+    bool narrowIndices = getMemrefIndexType(input.getType()).getElementType() !=
+                         int64Type;
 
     // Initial constants
     Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
-    Value c0_64 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
 
     // Get sparse tensor info
     Value nrow = rewriter.create<graphblas::NumRowsOp>(loc, input);
     Value Ap = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, input, c1);
-    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           input, c1);
+        loc, getMemrefPointerType(input.getType()), input, c1);
+    Value Aj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, c1);
     Value Ax = rewriter.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, input);
 
     // Create output tensor
-    Value output = rewriter.create<graphblas::DupOp>(loc, input);
+    Value output = callEmptyLike(rewriter, module, loc, input);
     Value Bp = rewriter.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DI64Type, output, c1);
-    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memref1DI64Type,
-                                                           output, c1);
-    Value Bx = rewriter.create<sparse_tensor::ToValuesOp>(
-        loc, memref1DValueType, output);
-    rewriter.create<memref::StoreOp>(loc, c0_64, Bp, c0);
+        loc, getMemrefPointerType(output.getType()), output, c1);
+
+    // Rows are sampled in parallel from streams of the runtime's contexts;
+    // other contexts (e.g. the integer one of `choose_first`) are opaque
+    if (rngContext.getType().isa<LLVM::LLVMPointerType>())
+      callStartRandomStream(rewriter, module, loc, rngContext);
 
     // Pass 1: Scan input tensor to compute offsets
-    scf::ForOp scanLoop = rewriter.create<scf::ForOp>(loc, c0, nrow, c1);
-    Value row = scanLoop.getInductionVar();
+    scf::ParallelOp sizeLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nrow, c1);
+    Value row = sizeLoop.getInductionVars()[0];
 
-    rewriter.setInsertionPointToStart(scanLoop.getBody());
+    rewriter.setInsertionPointToStart(sizeLoop.getBody());
     Value row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-    Value Aj_start_64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
-    Value Aj_end_64 = rewriter.create<memref::LoadOp>(loc, Ap, row_plus1);
+    Value Aj_start_64 = loadI64(rewriter, loc, Ap, row);
+    Value Aj_end_64 = loadI64(rewriter, loc, Ap, row_plus1);
 
     // Limit number of row values in output to n
     Value Aj_size_64 =
@@ -4036,13 +4886,20 @@ public:
         loc, arith::CmpIPredicate::ule, Aj_size_64, n);
     Value Bj_size_64 =
         rewriter.create<SelectOp>(loc, isRowSmall, Aj_size_64, n);
+    storeI64(rewriter, loc, Bj_size_64, Bp, row);
 
-    Value Bj_start_64 = rewriter.create<memref::LoadOp>(loc, Bp, row);
-    Value Bj_end_64 =
-        rewriter.create<arith::AddIOp>(loc, Bj_start_64, Bj_size_64);
-    rewriter.create<memref::StoreOp>(loc, Bj_end_64, Bp, row_plus1);
+    rewriter.setInsertionPointAfter(sizeLoop);
+    Value outputNNZ_64 = buildExclusiveScan(rewriter, loc, Bp, nrow);
 
-    rewriter.setInsertionPointAfter(scanLoop);
+    // Size output index and values to match total number of elements
+    Value outputNNZ =
+        rewriter.create<arith::IndexCastOp>(loc, outputNNZ_64, indexType);
+    callResizeIndex(rewriter, module, loc, output, c1, outputNNZ);
+    callResizeValues(rewriter, module, loc, output, outputNNZ);
+    Value Bj = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(output.getType()), output, c1);
+    Value Bx = rewriter.create<sparse_tensor::ToValuesOp>(
+        loc, memref1DValueType, output);
 
     // Pass 2: Parallel select and compute output
     scf::ParallelOp rowLoop =
@@ -4052,16 +4909,16 @@ public:
     rewriter.setInsertionPointToStart(rowLoop.getBody());
 
     row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
-    Aj_start_64 = rewriter.create<memref::LoadOp>(loc, Ap, row);
+    Aj_start_64 = loadI64(rewriter, loc, Ap, row);
     Value Aj_start =
         rewriter.create<arith::IndexCastOp>(loc, Aj_start_64, indexType);
-    Aj_end_64 = rewriter.create<memref::LoadOp>(loc, Ap, row_plus1);
+    Aj_end_64 = loadI64(rewriter, loc, Ap, row_plus1);
     Value Aj_end =
         rewriter.create<arith::IndexCastOp>(loc, Aj_end_64, indexType);
-    Bj_start_64 = rewriter.create<memref::LoadOp>(loc, Bp, row);
+    Value Bj_start_64 = loadI64(rewriter, loc, Bp, row);
     Value Bj_start =
         rewriter.create<arith::IndexCastOp>(loc, Bj_start_64, indexType);
-    Bj_end_64 = rewriter.create<memref::LoadOp>(loc, Bp, row_plus1);
+    Value Bj_end_64 = loadI64(rewriter, loc, Bp, row_plus1);
     Value Bj_end =
         rewriter.create<arith::IndexCastOp>(loc, Bj_end_64, indexType);
 
@@ -4088,7 +4945,7 @@ public:
     rewriter.setInsertionPointToStart(ifCopy.thenBlock());
 
     // copy contents
-    rewriter.create<memref::CopyOp>(loc, Aj_view, Bj_view);
+    copyI64(rewriter, loc, Aj_view, Bj_view);
     rewriter.create<memref::CopyOp>(loc, Ax_view, Bx_view);
 
     // Else, fill output row with random selection from input row
@@ -4100,11 +4957,18 @@ public:
 
     // TODO: Verify signature of this function is what we expect
 
-    // Call function using output Bj row as temporary storage
+    // Call function using output Bj row as temporary storage. The offsets are
+    // written as i64, so narrower indices need a scratch row instead.
+    Value offsets = Bj_view, scratch;
+    if (narrowIndices) {
+      scratch = rewriter.create<memref::AllocOp>(loc, memref1DI64Type, Bj_size);
+      offsets =
+          rewriter.create<memref::SubViewOp>(loc, scratch, c0, Bj_size, c1);
+    }
     rewriter.create<mlir::CallOp>(
         loc, chooseNSymbol, TypeRange(),
         ArrayRef<Value>(
-            {rngContext, Bj_size_64, Aj_size_64, Bj_view, Ax_view}));
+            {rngContext, Bj_size_64, Aj_size_64, offsets, Ax_view}));
 
     // Loop over randomly selected offsets
     scf::ParallelOp colLoop =
@@ -4114,30 +4978,26 @@ public:
     rewriter.setInsertionPointToStart(colLoop.getBody());
 
     Value sourceOffset_64 =
-        rewriter.create<memref::LoadOp>(loc, Bj_view, offset);
+        rewriter.create<memref::LoadOp>(loc, offsets, offset);
     Value sourceOffset =
         rewriter.create<arith::IndexCastOp>(loc, sourceOffset_64, indexType);
-    Value colIndex =
-        rewriter.create<memref::LoadOp>(loc, Aj_view, sourceOffset);
+    Value colIndex = loadI64(rewriter, loc, Aj_view, sourceOffset);
     Value colValue =
         rewriter.create<memref::LoadOp>(loc, Ax_view, sourceOffset);
     // overwrite the randomly selected offset with the actual column index
-    rewriter.create<memref::StoreOp>(loc, colIndex, Bj_view, offset);
+    storeI64(rewriter, loc, colIndex, Bj_view, offset);
     // write the corresponding value from source matrix
     rewriter.create<memref::StoreOp>(loc, colValue, Bx_view, offset);
 
     // end loop over columns
+    rewriter.setInsertionPointAfter(colLoop);
+    if (narrowIndices)
+      rewriter.create<memref::DeallocOp>(loc, scratch);
 
     // end loop over rows
 
     // Output array is populated
     rewriter.setInsertionPointAfter(rowLoop);
-    // Resize output index and values to match total number of elements
-    Value outputNNZ_64 = rewriter.create<memref::LoadOp>(loc, Bp, nrow);
-    Value outputNNZ =
-        rewriter.create<arith::IndexCastOp>(loc, outputNNZ_64, indexType);
-    callResizeIndex(rewriter, module, loc, output, c1, outputNNZ);
-    callResizeValues(rewriter, module, loc, output, outputNNZ);
 
     rewriter.replaceOp(op, output);
 
@@ -4157,11 +5017,49 @@ public:
     Value values = op.values();
     ValueRange sizes = op.sizes();
 
+    // Replace a named accumulator with the equivalent block
+    llvm::Optional<llvm::StringRef> accumulateOperator =
+        op.accumulate_operator();
+    if (accumulateOperator) {
+      NamedAttrList attributes = {};
+      attributes.append(StringRef("sorted"), rewriter.getBoolAttr(op.sorted()));
+      graphblas::FromCoordinatesOp newOp =
+          rewriter.create<graphblas::FromCoordinatesOp>(
+              loc, op->getResultTypes(), op.getOperands(),
+              attributes.getAttrs(), 1);
+
+      Type valueType =
+          values.getType().cast<RankedTensorType>().getElementType();
+      if (failed(populateBinary(rewriter, loc, accumulateOperator->str(),
+                                valueType, newOp.getRegions().slice(0, 1),
+                                graphblas::YieldKind::ACCUMULATE)))
+        return failure();
+
+      rewriter.replaceOp(op, newOp.getResult());
+      return success();
+    }
+
+    // Optional block
+    RegionRange extensions = op.extensions();
+    ExtensionBlocks extBlocks;
+    std::set<graphblas::YieldKind> required = {};
+    std::set<graphblas::YieldKind> optional = {
+        graphblas::YieldKind::ACCUMULATE};
+    LogicalResult extractResult =
+        extBlocks.extractBlocks(op, extensions, required, optional);
+
+    if (extractResult.failed()) {
+      return extractResult;
+    }
+
     // Types
     RankedTensorType resultType =
         op.getResult().getType().cast<RankedTensorType>();
+    Type indexType = rewriter.getIndexType();
+    Type int1Type = rewriter.getI1Type();
     Type int64Type = rewriter.getIntegerType(64);
-    MemRefType memrefI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DIndexType = MemRefType::get({-1}, indexType);
     MemRefType memrefValueType =
         MemRefType::get({-1}, resultType.getElementType());
 
@@ -4171,7 +5069,112 @@ public:
     Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
     Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
-    Value ci1 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
+    Value ctrue = rewriter.create<arith::ConstantIntOp>(loc, 1, int1Type);
+
+    Value nnz = rewriter.create<tensor::DimOp>(loc, indices, c0);
+    Value nnzPlus1 = rewriter.create<arith::AddIOp>(loc, nnz, c1);
+
+    // Sort with one stable counting sort pass per dimension, last dimension
+    // first. perm[k] is the input position of the k-th sorted entry and
+    // rowStarts[row] is the sorted position of the first entry in each row.
+    Value perm = nullptr;
+    Value rowStarts = nullptr;
+    if (!op.sorted()) {
+      for (unsigned dim = rank; dim-- > 0;) {
+        Value dimIndex = rewriter.create<arith::ConstantIndexOp>(loc, dim);
+        Value keyStarts;
+        Value sortedPerm =
+            buildCountingSortPass(rewriter, loc, indices, dimIndex, sizes[dim],
+                                  nnz, perm, keyStarts, /* scatter */ true);
+        if (perm)
+          rewriter.create<memref::DeallocOp>(loc, perm);
+        perm = sortedPerm;
+        if (dim == 0 && rank == 2)
+          rowStarts = keyStarts;
+        else
+          rewriter.create<memref::DeallocOp>(loc, keyStarts);
+      }
+    } else if (rank == 2) {
+      buildCountingSortPass(rewriter, loc, indices, c0, sizes[0], nnz, nullptr,
+                            rowStarts, /* scatter */ false);
+    }
+
+    auto sortedPos = [&](Value k) -> Value {
+      if (!perm)
+        return k;
+      return rewriter.create<memref::LoadOp>(loc, perm, k);
+    };
+
+    // Mark the first entry of each run of equal coordinates, then scan the
+    // marks so that uniqueBefore[k] counts the distinct coordinates before
+    // sorted position k
+    Value uniqueBefore =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, nnzPlus1);
+    scf::ParallelOp markLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nnz, c1);
+    {
+      rewriter.setInsertionPointToStart(markLoop.getBody());
+      Value k = markLoop.getInductionVars().front();
+      Value isFirst =
+          rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq, k, c0);
+      scf::IfOp ifFirst =
+          rewriter.create<scf::IfOp>(loc, int1Type, isFirst, true);
+      rewriter.setInsertionPointToStart(ifFirst.thenBlock());
+      rewriter.create<scf::YieldOp>(loc, ctrue);
+      rewriter.setInsertionPointToStart(ifFirst.elseBlock());
+      Value pos = sortedPos(k);
+      Value kMinus1 = rewriter.create<arith::SubIOp>(loc, k, c1);
+      Value prevPos = sortedPos(kMinus1);
+      Value differs = nullptr;
+      for (unsigned dim = 0; dim < rank; dim++) {
+        Value dimIndex = rewriter.create<arith::ConstantIndexOp>(loc, dim);
+        Value idx = rewriter.create<tensor::ExtractOp>(
+            loc, indices, ValueRange{pos, dimIndex});
+        Value prevIdx = rewriter.create<tensor::ExtractOp>(
+            loc, indices, ValueRange{prevPos, dimIndex});
+        Value cmpIdx = rewriter.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::ne, idx, prevIdx);
+        if (differs)
+          differs = rewriter.create<arith::OrIOp>(loc, differs, cmpIdx);
+        else
+          differs = cmpIdx;
+      }
+      rewriter.create<scf::YieldOp>(loc, differs);
+      rewriter.setInsertionPointAfter(ifFirst);
+
+      Value mark =
+          rewriter.create<arith::ExtUIOp>(loc, int64Type, ifFirst.getResult(0));
+      rewriter.create<memref::StoreOp>(loc, mark, uniqueBefore, k);
+    }
+    rewriter.setInsertionPointAfter(markLoop);
+
+    Value nunique64 = buildExclusiveScan(rewriter, loc, uniqueBefore, nnz);
+    Value nunique =
+        rewriter.create<arith::IndexCastOp>(loc, nunique64, indexType);
+    Value nuniquePlus1 = rewriter.create<arith::AddIOp>(loc, nunique, c1);
+
+    // runStarts[u] is the sorted position of the first entry of the u-th
+    // distinct coordinate, followed by nnz
+    Value runStarts =
+        rewriter.create<memref::AllocOp>(loc, memref1DIndexType, nuniquePlus1);
+    scf::ParallelOp runLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nnz, c1);
+    {
+      rewriter.setInsertionPointToStart(runLoop.getBody());
+      Value k = runLoop.getInductionVars().front();
+      Value kPlus1 = rewriter.create<arith::AddIOp>(loc, k, c1);
+      Value before = rewriter.create<memref::LoadOp>(loc, uniqueBefore, k);
+      Value after = rewriter.create<memref::LoadOp>(loc, uniqueBefore, kPlus1);
+      Value isFirst = rewriter.create<arith::CmpIOp>(
+          loc, arith::CmpIPredicate::ne, before, after);
+      scf::IfOp ifFirst =
+          rewriter.create<scf::IfOp>(loc, isFirst, false /* no else region */);
+      rewriter.setInsertionPointToStart(ifFirst.thenBlock());
+      Value u = rewriter.create<arith::IndexCastOp>(loc, before, indexType);
+      rewriter.create<memref::StoreOp>(loc, k, runStarts, u);
+    }
+    rewriter.setInsertionPointAfter(runLoop);
+    rewriter.create<memref::StoreOp>(loc, nnz, runStarts, nunique);
 
     Value output =
         rewriter.create<sparse_tensor::InitOp>(loc, resultType, sizes);
@@ -4187,71 +5190,229 @@ public:
     }
 
     // Size sparse arrays
-    Value nnz = rewriter.create<tensor::DimOp>(loc, indices, c0);
     Value npointers_plus1 = rewriter.create<arith::AddIOp>(loc, npointers, c1);
     callResizePointers(rewriter, module, loc, output, dimIndex,
                        npointers_plus1);
-    callResizeIndex(rewriter, module, loc, output, dimIndex, nnz);
-    callResizeValues(rewriter, module, loc, output, nnz);
+    callResizeIndex(rewriter, module, loc, output, dimIndex, nunique);
+    callResizeValues(rewriter, module, loc, output, nunique);
 
-    Value Op = rewriter.create<sparse_tensor::ToPointersOp>(loc, memrefI64Type,
-                                                            output, dimIndex);
-    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefI64Type,
-                                                           output, dimIndex);
+    Value Op = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(output.getType()), output, dimIndex);
+    Value Oi = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(output.getType()), output, dimIndex);
     Value Ox = rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefValueType,
                                                           output);
 
-    // Populate from indices and values
-    // We assume everything is in the correct order
-    // Increment the pointer count and fill in the index and value
-    scf::ForOp loop = rewriter.create<scf::ForOp>(loc, c0, nnz, c1);
+    // Fill in the index and value of each distinct coordinate, combining the
+    // values of its run in their original order
+    scf::ParallelOp fillLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nunique, c1);
     {
-      rewriter.setInsertionPointToStart(loop.getBody());
-      Value pos = loop.getInductionVar();
-
-      if (rank == 2) {
-        Value row = rewriter.create<tensor::ExtractOp>(loc, indices,
-                                                       ValueRange{pos, c0});
-        Value currRowCount = rewriter.create<memref::LoadOp>(loc, Op, row);
-        Value rowCount_plus1 =
-            rewriter.create<arith::AddIOp>(loc, currRowCount, ci1);
-        rewriter.create<memref::StoreOp>(loc, rowCount_plus1, Op, row);
-      }
+      rewriter.setInsertionPointToStart(fillLoop.getBody());
+      Value u = fillLoop.getInductionVars().front();
+      Value uPlus1 = rewriter.create<arith::AddIOp>(loc, u, c1);
+      Value start = rewriter.create<memref::LoadOp>(loc, runStarts, u);
+      Value end = rewriter.create<memref::LoadOp>(loc, runStarts, uPlus1);
+      Value pos = sortedPos(start);
+
       Value idx = rewriter.create<tensor::ExtractOp>(loc, indices,
                                                      ValueRange{pos, dimIndex});
       Value idx64 = rewriter.create<arith::IndexCastOp>(loc, idx, int64Type);
-      Value val = rewriter.create<tensor::ExtractOp>(loc, values, pos);
-      rewriter.create<memref::StoreOp>(loc, idx64, Oi, pos);
-      rewriter.create<memref::StoreOp>(loc, val, Ox, pos);
-
-      rewriter.setInsertionPointAfter(loop);
+      storeI64(rewriter, loc, idx64, Oi, u);
+
+      Value val;
+      if (extBlocks.accumulate) {
+        Value first = rewriter.create<tensor::ExtractOp>(loc, values, pos);
+        Value startPlus1 = rewriter.create<arith::AddIOp>(loc, start, c1);
+        scf::ForOp combineLoop = rewriter.create<scf::ForOp>(
+            loc, startPlus1, end, c1, ValueRange{first});
+        Value kk = combineLoop.getInductionVar();
+        Value acc = combineLoop.getLoopBody().getArgument(1);
+        rewriter.setInsertionPointToStart(combineLoop.getBody());
+        Value x =
+            rewriter.create<tensor::ExtractOp>(loc, values, sortedPos(kk));
+        Value combined = inlineExtensionBlock(
+            rewriter, extBlocks.accumulate, ValueRange{acc, x});
+        rewriter.create<scf::YieldOp>(loc, combined);
+        rewriter.setInsertionPointAfter(combineLoop);
+        val = combineLoop.getResult(0);
+      } else {
+        Value last = rewriter.create<arith::SubIOp>(loc, end, c1);
+        val = rewriter.create<tensor::ExtractOp>(loc, values, sortedPos(last));
+      }
+      rewriter.create<memref::StoreOp>(loc, val, Ox, u);
     }
+    rewriter.setInsertionPointAfter(fillLoop);
 
     if (rank == 2) {
-      // Update pointers using cumsum
-      scf::ForOp cumSumLoop =
-          rewriter.create<scf::ForOp>(loc, c0, npointers, c1, ValueRange{ci0});
+      // rowStarts is the exclusive scan of the row counts, so the distinct
+      // coordinates before each row are counted by uniqueBefore[rowStarts[row]]
+      scf::ParallelOp ptrLoop =
+          rewriter.create<scf::ParallelOp>(loc, c0, npointers_plus1, c1);
       {
-        rewriter.setInsertionPointToStart(cumSumLoop.getBody());
-        Value pos = cumSumLoop.getInductionVar();
-        Value base = cumSumLoop.getLoopBody().getArgument(1);
-
-        Value numEntries = rewriter.create<memref::LoadOp>(loc, Op, pos);
-        rewriter.create<memref::StoreOp>(loc, base, Op, pos);
-        Value nextBase = rewriter.create<arith::AddIOp>(loc, base, numEntries);
-        rewriter.create<scf::YieldOp>(loc, nextBase);
-
-        rewriter.setInsertionPointAfter(cumSumLoop);
+        rewriter.setInsertionPointToStart(ptrLoop.getBody());
+        Value row = ptrLoop.getInductionVars().front();
+        Value rowStart64 = rewriter.create<memref::LoadOp>(loc, rowStarts, row);
+        Value rowStart =
+            rewriter.create<arith::IndexCastOp>(loc, rowStart64, indexType);
+        Value ptr =
+            rewriter.create<memref::LoadOp>(loc, uniqueBefore, rowStart);
+        storeI64(rewriter, loc, ptr, Op, row);
       }
+      rewriter.setInsertionPointAfter(ptrLoop);
+      rewriter.create<memref::DeallocOp>(loc, rowStarts);
+    } else {
+      storeI64(rewriter, loc, ci0, Op, c0);
+      storeI64(rewriter, loc, nunique64, Op, c1);
     }
-    // Update last pointer with nnz
-    Value nnz64 = rewriter.create<arith::IndexCastOp>(loc, nnz, int64Type);
-    rewriter.create<memref::StoreOp>(loc, nnz64, Op, npointers);
+
+    if (perm)
+      rewriter.create<memref::DeallocOp>(loc, perm);
+    rewriter.create<memref::DeallocOp>(loc, uniqueBefore);
+    rewriter.create<memref::DeallocOp>(loc, runStarts);
 
     rewriter.replaceOp(op, output);
 
     return success();
   };
+
+private:
+  // One pass of a stable, block-parallel counting sort of the coordinates by
+  // their index in dimension `dim`, which lies in [0, nkeys). Entries are read
+  // in the order given by `permIn`, or in input order if it is null.
+  // keyStarts is set to a new buffer holding the sorted position of the first
+  // entry of each key, followed by nnz. If `scatter` is set, returns a new
+  // permutation ordering the entries by this dimension.
+  static Value buildCountingSortPass(PatternRewriter &rewriter, Location loc,
+                                     Value indices, Value dim, Value nkeys,
+                                     Value nnz, Value permIn, Value &keyStarts,
+                                     bool scatter) {
+    // Types used in this function
+    Type indexType = rewriter.getIndexType();
+    Type int64Type = rewriter.getIntegerType(64);
+    MemRefType memref1DI64Type = MemRefType::get({-1}, int64Type);
+    MemRefType memref1DIndexType = MemRefType::get({-1}, indexType);
+
+    // Initial constants
+    Value c0 = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    Value ci0 = rewriter.create<arith::ConstantIntOp>(loc, 0, int64Type);
+    Value ci1 = rewriter.create<arith::ConstantIntOp>(loc, 1, int64Type);
+
+    auto sourcePos = [&](Value k) -> Value {
+      if (!permIn)
+        return k;
+      return rewriter.create<memref::LoadOp>(loc, permIn, k);
+    };
+
+    // Each block keeps its own count per key
+    Value blockSize, numBlocks;
+    computeScatterBlocks(rewriter, loc, nnz, nnz, nkeys, blockSize, numBlocks);
+
+    Value countsSize = rewriter.create<arith::MulIOp>(loc, numBlocks, nkeys);
+    Value counts =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, countsSize);
+
+    // 1st pass
+    //   Count the keys of each block in counts[block * nkeys + key]
+    scf::ParallelOp countLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    {
+      rewriter.setInsertionPointToStart(countLoop.getBody());
+      Value block = countLoop.getInductionVars().front();
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, nkeys);
+      Value blockOffsetEnd =
+          rewriter.create<arith::AddIOp>(loc, blockOffset, nkeys);
+      scf::ForOp initLoop =
+          rewriter.create<scf::ForOp>(loc, blockOffset, blockOffsetEnd, c1);
+      rewriter.setInsertionPointToStart(initLoop.getBody());
+      rewriter.create<memref::StoreOp>(loc, ci0, counts,
+                                       initLoop.getInductionVar());
+      rewriter.setInsertionPointAfter(initLoop);
+
+      Value start, end;
+      computeRowBlockBounds(rewriter, loc, block, blockSize, nnz, start, end);
+      scf::ForOp entryLoop = rewriter.create<scf::ForOp>(loc, start, end, c1);
+      rewriter.setInsertionPointToStart(entryLoop.getBody());
+      Value pos = sourcePos(entryLoop.getInductionVar());
+      Value key = rewriter.create<tensor::ExtractOp>(loc, indices,
+                                                     ValueRange{pos, dim});
+      Value slot = rewriter.create<arith::AddIOp>(loc, blockOffset, key);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, slot);
+      Value countPlus1 = rewriter.create<arith::AddIOp>(loc, count, ci1);
+      rewriter.create<memref::StoreOp>(loc, countPlus1, counts, slot);
+    }
+    rewriter.setInsertionPointAfter(countLoop);
+
+    // 2nd pass
+    //   Replace each count with the number of entries of the same key in
+    //   earlier blocks and total the counts of each key
+    Value nkeysPlus1 = rewriter.create<arith::AddIOp>(loc, nkeys, c1);
+    keyStarts =
+        rewriter.create<memref::AllocOp>(loc, memref1DI64Type, nkeysPlus1);
+    scf::ParallelOp keyLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, nkeys, c1);
+    {
+      rewriter.setInsertionPointToStart(keyLoop.getBody());
+      Value key = keyLoop.getInductionVars().front();
+      scf::ForOp blockLoop =
+          rewriter.create<scf::ForOp>(loc, c0, numBlocks, c1, ValueRange{ci0});
+      Value block = blockLoop.getInductionVar();
+      Value total = blockLoop.getLoopBody().getArgument(1);
+      rewriter.setInsertionPointToStart(blockLoop.getBody());
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, nkeys);
+      Value slot = rewriter.create<arith::AddIOp>(loc, blockOffset, key);
+      Value count = rewriter.create<memref::LoadOp>(loc, counts, slot);
+      rewriter.create<memref::StoreOp>(loc, total, counts, slot);
+      Value nextTotal = rewriter.create<arith::AddIOp>(loc, total, count);
+      rewriter.create<scf::YieldOp>(loc, nextTotal);
+      rewriter.setInsertionPointAfter(blockLoop);
+      rewriter.create<memref::StoreOp>(loc, blockLoop.getResult(0), keyStarts,
+                                       key);
+    }
+    rewriter.setInsertionPointAfter(keyLoop);
+
+    buildExclusiveScan(rewriter, loc, keyStarts, nkeys);
+
+    if (!scatter) {
+      rewriter.create<memref::DeallocOp>(loc, counts);
+      return nullptr;
+    }
+
+    // 3rd pass
+    //   Scatter the entries of each block, in order, after those of the same
+    //   key in earlier blocks
+    Value permOut =
+        rewriter.create<memref::AllocOp>(loc, memref1DIndexType, nnz);
+    scf::ParallelOp scatterLoop =
+        rewriter.create<scf::ParallelOp>(loc, c0, numBlocks, c1);
+    {
+      rewriter.setInsertionPointToStart(scatterLoop.getBody());
+      Value block = scatterLoop.getInductionVars().front();
+      Value blockOffset = rewriter.create<arith::MulIOp>(loc, block, nkeys);
+
+      Value start, end;
+      computeRowBlockBounds(rewriter, loc, block, blockSize, nnz, start, end);
+      scf::ForOp entryLoop = rewriter.create<scf::ForOp>(loc, start, end, c1);
+      rewriter.setInsertionPointToStart(entryLoop.getBody());
+      Value pos = sourcePos(entryLoop.getInductionVar());
+      Value key = rewriter.create<tensor::ExtractOp>(loc, indices,
+                                                     ValueRange{pos, dim});
+      Value slot = rewriter.create<arith::AddIOp>(loc, blockOffset, key);
+      Value offset = rewriter.create<memref::LoadOp>(loc, counts, slot);
+      Value keyStart = rewriter.create<memref::LoadOp>(loc, keyStarts, key);
+      Value dest64 = rewriter.create<arith::AddIOp>(loc, keyStart, offset);
+      Value dest = rewriter.create<arith::IndexCastOp>(loc, dest64, indexType);
+      rewriter.create<memref::StoreOp>(loc, pos, permOut, dest);
+      Value offsetPlus1 = rewriter.create<arith::AddIOp>(loc, offset, ci1);
+      rewriter.create<memref::StoreOp>(loc, offsetPlus1, counts, slot);
+    }
+    rewriter.setInsertionPointAfter(scatterLoop);
+
+    rewriter.create<memref::DeallocOp>(loc, counts);
+
+    return permOut;
+  }
 };
 
 class LowerToCoordinatesRewrite
@@ -4271,8 +5432,6 @@ public:
     Value nrank = rewriter.create<arith::ConstantIndexOp>(loc, rank);
 
     Type indexType = rewriter.getIndexType();
-    Type int64Type = rewriter.getIntegerType(64);
-    MemRefType memrefI64Type = MemRefType::get({-1}, int64Type);
     MemRefType memrefIndicesType = MemRefType::get({-1, -1}, indexType);
     MemRefType memrefValueType =
         MemRefType::get({-1}, valuesType.getElementType());
@@ -4296,10 +5455,10 @@ public:
       dimIndex = c1;
     }
 
-    Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(loc, memrefI64Type,
-                                                            input, dimIndex);
-    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(loc, memrefI64Type,
-                                                           input, dimIndex);
+    Value Ip = rewriter.create<sparse_tensor::ToPointersOp>(
+        loc, getMemrefPointerType(input.getType()), input, dimIndex);
+    Value Ii = rewriter.create<sparse_tensor::ToIndicesOp>(
+        loc, getMemrefIndexType(input.getType()), input, dimIndex);
     Value Ix =
         rewriter.create<sparse_tensor::ToValuesOp>(loc, memrefValueType, input);
 
@@ -4310,8 +5469,8 @@ public:
       Value row = rowLoop.getInductionVar();
       Value row_plus1 = rewriter.create<arith::AddIOp>(loc, row, c1);
 
-      Value j_start_64 = rewriter.create<memref::LoadOp>(loc, Ip, row);
-      Value j_end_64 = rewriter.create<memref::LoadOp>(loc, Ip, row_plus1);
+      Value j_start_64 = loadI64(rewriter, loc, Ip, row);
+      Value j_end_64 = loadI64(rewriter, loc, Ip, row_plus1);
       Value j_start =
           rewriter.create<arith::IndexCastOp>(loc, j_start_64, indexType);
       Value j_end =
@@ -4322,7 +5481,7 @@ public:
         rewriter.setInsertionPointToStart(colLoop.getBody());
         Value jj = colLoop.getInductionVar();
 
-        Value col_64 = rewriter.create<memref::LoadOp>(loc, Ii, jj);
+        Value col_64 = loadI64(rewriter, loc, Ii, jj);
         Value col = rewriter.create<arith::IndexCastOp>(loc, col_64, indexType);
         Value val = rewriter.create<memref::LoadOp>(loc, Ix, jj);
 
@@ -4380,6 +5539,10 @@ struct GraphBLASLoweringPass
     populateGraphBLASLoweringPatterns(patterns);
     (void)applyPatternsAndFoldGreedily(getOperation(), std::move(patterns));
     target.addIllegalDialect<graphblas::GraphBLASDialect>();
+
+    // Free intermediate tensors as soon as they are dead rather than at the
+    // end of their block
+    releaseIntermediatesAfterLastUse(getOperation());
   }
 };
 
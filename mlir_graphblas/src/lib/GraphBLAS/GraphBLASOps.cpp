@@ -129,6 +129,18 @@ checkVectorEncoding(RankedTensorType tensorType) {
   return llvm::None;
 }
 
+static llvm::Optional<std::string>
+checkVectorMaskEncoding(RankedTensorType tensorType) {
+  // Vector masks may also be bitmaps, whose integer values are presence flags
+  if (isBitmapVector(tensorType)) {
+    if (!tensorType.getElementType().isa<IntegerType>())
+      return std::string("must have an integer element type when it is a "
+                         "bitmap, i.e. has dimLevelType = [ \"dense\" ].");
+    return llvm::None;
+  }
+  return checkVectorEncoding(tensorType);
+}
+
 static llvm::Optional<std::string> checkBitWidthMatch(RankedTensorType a,
                                                       RankedTensorType b) {
   sparse_tensor::SparseTensorEncodingAttr aEncoding =
@@ -416,9 +428,12 @@ static LogicalResult verifyMatrixMultiplyArgs(T op,
     if (errMsg)
       return op.emitError("1st operand " + errMsg.getValue());
 
-    errMsg = checkVectorEncoding(bType);
-    if (errMsg)
-      return op.emitError("2nd operand " + errMsg.getValue());
+    // The vector may be a bitmap, which is probed in place for every row
+    if (!isBitmapVector(bType)) {
+      errMsg = checkVectorEncoding(bType);
+      if (errMsg)
+        return op.emitError("2nd operand " + errMsg.getValue());
+    }
 
     if (checkResultTensorType) {
       errMsg = checkVectorEncoding(resultType);
@@ -479,7 +494,7 @@ static LogicalResult verifyMatrixMultiplyArgs(T op,
           return op.emitError(
               "Mask shape must match shape of matrix multiply result.");
       } else if (resultRank == 1) {
-        errMsg = checkVectorEncoding(maskType);
+        errMsg = checkVectorMaskEncoding(maskType);
         if (errMsg)
           return op.emitError("3rd operand (mask) " + errMsg.getValue());
 
@@ -592,7 +607,8 @@ static LogicalResult verify(DiagOp op) {
 
 template <class T>
 static LogicalResult verifyEwise(T op, Value a, Value b, std::string aName,
-                                 std::string bName, bool verifyType) {
+                                 std::string bName, bool verifyType,
+                                 bool bIsMask = false) {
   Type aOrigType = a.getType();
   Type bOrigType = b.getType();
 
@@ -610,7 +626,8 @@ static LogicalResult verifyEwise(T op, Value a, Value b, std::string aName,
     errMsg = checkVectorEncoding(aType);
     if (errMsg)
       return op.emitError("\"" + aName + "\" " + errMsg.getValue());
-    errMsg = checkVectorEncoding(bType);
+    errMsg =
+        bIsMask ? checkVectorMaskEncoding(bType) : checkVectorEncoding(bType);
     if (errMsg)
       return op.emitError("\"" + bName + "\" " + errMsg.getValue());
   } else if (aRank == 2) {
@@ -648,7 +665,8 @@ static LogicalResult verify(UpdateOp op) {
   Value mask = op.mask();
   if (mask &&
       failed(verifyEwise<UpdateOp>(op, op.output(), mask, "output", "mask",
-                                   /* verifyType */ false)))
+                                   /* verifyType */ false,
+                                   /* bIsMask */ true)))
     return failure();
 
   return success();
@@ -667,7 +685,8 @@ static LogicalResult verify(UpdateGenericOp op) {
   Value mask = op.mask();
   if (mask && failed(verifyEwise<UpdateGenericOp>(op, op.output(), mask,
                                                   "output", "mask",
-                                                  /* verifyType */ false)))
+                                                  /* verifyType */ false,
+                                                  /* bIsMask */ true)))
     return failure();
 
   return success();
@@ -680,7 +699,8 @@ static LogicalResult verify(SelectMaskOp op) {
 
   if (failed(verifyEwise<SelectMaskOp>(op, op.output(), op.mask(), "output",
                                        "mask",
-                                       /* verifyType */ false)))
+                                       /* verifyType */ false,
+                                       /* bIsMask */ true)))
     return failure();
 
   return success();
@@ -803,7 +823,7 @@ static LogicalResult verifyReduceToVectorArgs(T op) {
   RankedTensorType maskTensorType;
   if (mask) {
     maskTensorType = mask.getType().cast<RankedTensorType>();
-    errMsg = checkVectorEncoding(maskTensorType);
+    errMsg = checkVectorMaskEncoding(maskTensorType);
     if (errMsg)
       return op.emitError("mask " + errMsg.getValue());
   }
@@ -882,14 +902,6 @@ static LogicalResult verify(ReduceToVectorGenericOp op) {
     return op.emitError("Must have at least 2 regions: agg_identity, agg.");
   }
 
-  // Enforce reasonable iteration direction for axis
-  bool isCSR = hasRowOrdering(op.input().getType());
-  int axis = op.axis();
-  if (axis == 0 && isCSR)
-    return op.emitError("Reducing with axis=0 requires CSC matrix.");
-  if (axis == 1 && !isCSR)
-    return op.emitError("Reducing with axis=1 requires CSR matrix.");
-
   return success();
 }
 
@@ -1105,13 +1117,6 @@ static LogicalResult verify(CastOp op) {
       return op.emitError("operand " + errMsg.getValue());
   }
 
-  // TODO: remove this check once we support bit width changes
-  errMsg = checkBitWidthMatch(inputType, resultType);
-  if (errMsg)
-    return op.emitError(
-        "Changing bit width is not yet supported. Input and output " +
-        errMsg.getValue());
-
   return success();
 }
 
@@ -1301,6 +1306,37 @@ static LogicalResult verify(FromCoordinatesOp op) {
   if (rvalType != valueType)
     return op.emitError("Value type must match return type");
 
+  RegionRange extensions = op.extensions();
+  if (extensions.size() > 1)
+    return op.emitError("Must have at most 1 region: accumulate.");
+
+  llvm::Optional<llvm::StringRef> accumulateOperator = op.accumulate_operator();
+  if (accumulateOperator) {
+    if (!extensions.empty())
+      return op.emitError(
+          "Cannot have both an accumulate_operator and an accumulate block.");
+    if (!supportedForUpdate.contains(accumulateOperator->str()))
+      return op.emitError("\"" + accumulateOperator->str() +
+                          "\" is not a supported accumulate operator.");
+  }
+
+  if (extensions.size() == 1) {
+    Block &block = extensions[0]->front();
+    if (block.getNumArguments() != 2 ||
+        block.getArgument(0).getType() != valueType ||
+        block.getArgument(1).getType() != valueType)
+      return op.emitError(
+          "accumulate block must take two arguments of the value type.");
+
+    YieldOp yield = dyn_cast<YieldOp>(block.getTerminator());
+    if (!yield || yield.kind() != YieldKind::ACCUMULATE)
+      return op.emitError("accumulate block must end in yield accumulate.");
+    if (yield.values().size() != 1 ||
+        yield.values().front().getType() != valueType)
+      return op.emitError(
+          "accumulate block must yield one value of the value type.");
+  }
+
   return success();
 }
 
@@ -4,12 +4,16 @@
 //
 //===--------------------------------------------------------------------===//
 
+#include "mlir/Dialect/Arithmetic/IR/Arithmetic.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/SCF/SCF.h"
 #include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
 #include "mlir/IR/Region.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "mlir/Transforms/RegionUtils.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/TypeSwitch.h"
@@ -33,6 +37,72 @@ namespace {
 // Passes implementation.
 //===----------------------------------------------------------------------===//
 
+// Returns the extension block which yields `kind`, or nullptr if there is none
+static Block *findExtensionBlock(RegionRange extensions,
+                                 graphblas::YieldKind kind) {
+  for (Region *ext : extensions) {
+    graphblas::YieldOp yield =
+        dyn_cast<graphblas::YieldOp>(ext->front().getTerminator());
+    if (yield && yield.kind() == kind)
+      return &ext->front();
+  }
+  return nullptr;
+}
+
+// Moves `block` into the empty `region`, changing the kind it yields
+static void moveExtensionBlock(PatternRewriter &rewriter, Region &region,
+                               Block *block, graphblas::YieldKind kind) {
+  region.takeBody(*block->getParent());
+  graphblas::YieldOp yield =
+      cast<graphblas::YieldOp>(region.front().getTerminator());
+  if (yield.kind() == kind)
+    return;
+  OpBuilder::InsertionGuard guard(rewriter);
+  rewriter.setInsertionPoint(yield);
+  rewriter.create<graphblas::YieldOp>(yield.getLoc(), kind, yield.values());
+  rewriter.eraseOp(yield);
+}
+
+// Arguments for a block standing in for both `first` and `second`, which
+// take (val) or (val, row, col) or similar with a shared leading argument
+static SmallVector<Type, 4> mergedArgumentTypes(Block *first, Block *second) {
+  SmallVector<Type, 4> types = llvm::to_vector<4>(first->getArgumentTypes());
+  for (unsigned i = types.size(); i < second->getNumArguments(); i++)
+    types.push_back(second->getArgument(i).getType());
+  return types;
+}
+
+// Builds a block in the empty `region` which feeds the value yielded by
+// `first` to `second` in place of its leading argument. Any other arguments
+// are shared. The new block yields the result of `second` as `kind`.
+static void chainExtensionBlocks(PatternRewriter &rewriter, Location loc,
+                                 Region &region, Block *first, Block *second,
+                                 graphblas::YieldKind kind) {
+  OpBuilder::InsertionGuard guard(rewriter);
+  Block *block = rewriter.createBlock(&region, {},
+                                      mergedArgumentTypes(first, second));
+  SmallVector<Value, 4> args(block->getArguments().begin(),
+                             block->getArguments().end());
+  args[0] = inlineExtensionBlock(rewriter, first, args);
+  Value result = inlineExtensionBlock(rewriter, second, args);
+  rewriter.create<graphblas::YieldOp>(loc, kind, result);
+}
+
+// Builds a block in the empty `region` which selects an element only when
+// both `first` and `second` select it
+static void conjoinExtensionBlocks(PatternRewriter &rewriter, Location loc,
+                                   Region &region, Block *first, Block *second,
+                                   graphblas::YieldKind kind) {
+  OpBuilder::InsertionGuard guard(rewriter);
+  Block *block = rewriter.createBlock(&region, {},
+                                      mergedArgumentTypes(first, second));
+  ValueRange args = block->getArguments();
+  Value keepFirst = inlineExtensionBlock(rewriter, first, args);
+  Value keepSecond = inlineExtensionBlock(rewriter, second, args);
+  Value keep = rewriter.create<arith::AndIOp>(loc, keepFirst, keepSecond);
+  rewriter.create<graphblas::YieldOp>(loc, kind, keep);
+}
+
 class FuseMatrixMultiplyReduceRewrite
     : public OpRewritePattern<graphblas::ReduceToScalarGenericOp> {
 public:
@@ -48,6 +118,17 @@ public:
       if (getRank(predecessor.a()) < 2 || getRank(predecessor.b()) < 2)
         return failure();
 
+      // The fused op only aggregates, so a reduce which also transforms or
+      // selects its input is left alone
+      RegionRange reduceExtensions = op.extensions();
+      Block *aggIdentity = findExtensionBlock(
+          reduceExtensions, graphblas::YieldKind::AGG_IDENTITY);
+      Block *agg =
+          findExtensionBlock(reduceExtensions, graphblas::YieldKind::AGG);
+      if (reduceExtensions.size() != 2 || aggIdentity == nullptr ||
+          agg == nullptr)
+        return failure();
+
       // Build new MatrixMultiplyReduceToScalarGeneric op with the operands and
       // regions of the multiply, then add in the aggregator from the reduce
       ValueRange operands = predecessor.getOperands();
@@ -67,11 +148,17 @@ public:
         return result;
       }
 
+      // The transformed entries are aggregated alongside the untransformed
+      // identity, so the transform must keep the element type
       if (multiplyBlocks.transformOut) {
-        return failure(); // FIXME: cannot fuse with existing transform for now
-      } else {
-        newRegions += 2; // adding new agg and agg identity block
+        Block *transformOut = multiplyBlocks.transformOut;
+        graphblas::YieldOp yield =
+            cast<graphblas::YieldOp>(transformOut->getTerminator());
+        if (yield.values().front().getType() !=
+            transformOut->getArgument(0).getType())
+          return failure();
       }
+      newRegions += 2; // adding new agg and agg identity block
 
       graphblas::MatrixMultiplyReduceToScalarGenericOp newMultOp =
           rewriter.create<graphblas::MatrixMultiplyReduceToScalarGenericOp>(
@@ -82,11 +169,10 @@ public:
         newMultOp.getRegion(i).takeBody(*multiplyExtensions[i]);
       }
 
-      RegionRange reduceExtensions = op.extensions();
-      Region &aggRegion0 = newMultOp.getRegion(newRegions - 2);
-      aggRegion0.takeBody(*reduceExtensions[0]);
-      Region &aggRegion1 = newMultOp.getRegion(newRegions - 1);
-      aggRegion1.takeBody(*reduceExtensions[1]);
+      moveExtensionBlock(rewriter, newMultOp.getRegion(newRegions - 2),
+                         aggIdentity, graphblas::YieldKind::AGG_IDENTITY);
+      moveExtensionBlock(rewriter, newMultOp.getRegion(newRegions - 1), agg,
+                         graphblas::YieldKind::AGG);
 
       rewriter.replaceOp(op, newMultOp.getResult());
       rewriter.eraseOp(predecessor);
@@ -106,6 +192,12 @@ public:
     graphblas::MatrixMultiplyGenericOp predecessor =
         input.getDefiningOp<graphblas::MatrixMultiplyGenericOp>();
 
+    // The multiply passes only the value of each entry to transform_out
+    Block *applyBlock = findExtensionBlock(op.extensions(),
+                                           graphblas::YieldKind::TRANSFORM_OUT);
+    if (applyBlock == nullptr || applyBlock->getNumArguments() != 1)
+      return failure();
+
     if (predecessor != nullptr && predecessor->hasOneUse()) {
       Location loc = op->getLoc();
 
@@ -128,27 +220,32 @@ public:
         return result;
       }
 
-      if (multiplyBlocks.transformOut) {
-        return failure(); // FIXME: cannot fuse with existing transform for now
-      } else {
+      if (!multiplyBlocks.transformOut)
         newRegions += 1; // adding new transformOut block
-      }
-
-      RegionRange applyExtensions = op.extensions();
 
       graphblas::MatrixMultiplyGenericOp newMultOp =
           rewriter.create<graphblas::MatrixMultiplyGenericOp>(
               loc, op->getResultTypes(), operands, attributes.getAttrs(),
               newRegions);
 
-      for (unsigned i = 0; i < newRegions - 1; i++) {
-        newMultOp.getRegion(i).takeBody(*multiplyExtensions[i]);
+      for (unsigned i = 0; i < multiplyExtensions.size(); i++) {
+        Region &region = newMultOp.getRegion(i);
+        if (&multiplyExtensions[i]->front() == multiplyBlocks.transformOut)
+          // Apply after the existing transform
+          chainExtensionBlocks(rewriter, loc, region,
+                               multiplyBlocks.transformOut, applyBlock,
+                               graphblas::YieldKind::TRANSFORM_OUT);
+        else
+          region.takeBody(*multiplyExtensions[i]);
       }
 
-      Region &transformOutRegion = newMultOp.getRegion(newRegions - 1);
-      transformOutRegion.takeBody(*applyExtensions[0]);
+      if (!multiplyBlocks.transformOut) {
+        Region &transformOutRegion = newMultOp.getRegion(newRegions - 1);
+        transformOutRegion.takeBody(*applyBlock->getParent());
+      }
 
       rewriter.replaceOp(op, newMultOp.getResult());
+      rewriter.eraseOp(predecessor);
 
       return success();
     }
@@ -156,9 +253,505 @@ public:
   };
 };
 
+class FuseApplyApplyRewrite
+    : public OpRewritePattern<graphblas::ApplyGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ApplyGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ApplyGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::ApplyGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::ApplyGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    Block *first = findExtensionBlock(predecessor.extensions(),
+                                      graphblas::YieldKind::TRANSFORM_OUT);
+    Block *second = findExtensionBlock(op.extensions(),
+                                       graphblas::YieldKind::TRANSFORM_OUT);
+    if (first == nullptr || second == nullptr)
+      return failure();
+
+    Location loc = op->getLoc();
+    graphblas::ApplyGenericOp newApplyOp =
+        rewriter.create<graphblas::ApplyGenericOp>(loc, op->getResultTypes(),
+                                                   predecessor.input(), 1);
+    chainExtensionBlocks(rewriter, loc, newApplyOp.getRegion(0), first, second,
+                         graphblas::YieldKind::TRANSFORM_OUT);
+
+    rewriter.replaceOp(op, newApplyOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseSelectApplyRewrite
+    : public OpRewritePattern<graphblas::SelectGenericOp> {
+public:
+  using OpRewritePattern<graphblas::SelectGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::SelectGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::ApplyGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::ApplyGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // The selected values are stored in a copy of the input
+    if (predecessor.input().getType() != op.getResult().getType())
+      return failure();
+
+    Block *transformOut = findExtensionBlock(
+        predecessor.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *selectOut =
+        findExtensionBlock(op.extensions(), graphblas::YieldKind::SELECT_OUT);
+    if (transformOut == nullptr || selectOut == nullptr ||
+        findExtensionBlock(op.extensions(),
+                           graphblas::YieldKind::TRANSFORM_OUT))
+      return failure();
+
+    // The select tests the transformed values, as it did before
+    Location loc = op->getLoc();
+    graphblas::SelectGenericOp newSelectOp =
+        rewriter.create<graphblas::SelectGenericOp>(loc, op->getResultTypes(),
+                                                    predecessor.input(), 2);
+    moveExtensionBlock(rewriter, newSelectOp.getRegion(0), transformOut,
+                       graphblas::YieldKind::TRANSFORM_OUT);
+    moveExtensionBlock(rewriter, newSelectOp.getRegion(1), selectOut,
+                       graphblas::YieldKind::SELECT_OUT);
+
+    rewriter.replaceOp(op, newSelectOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseSelectSelectRewrite
+    : public OpRewritePattern<graphblas::SelectGenericOp> {
+public:
+  using OpRewritePattern<graphblas::SelectGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::SelectGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::SelectGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::SelectGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // A transform here would have to happen after the first selection
+    if (findExtensionBlock(op.extensions(),
+                           graphblas::YieldKind::TRANSFORM_OUT))
+      return failure();
+
+    Block *first = findExtensionBlock(predecessor.extensions(),
+                                      graphblas::YieldKind::SELECT_OUT);
+    Block *second =
+        findExtensionBlock(op.extensions(), graphblas::YieldKind::SELECT_OUT);
+    if (first == nullptr || second == nullptr)
+      return failure();
+    Block *transformOut = findExtensionBlock(
+        predecessor.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+
+    Location loc = op->getLoc();
+    graphblas::SelectGenericOp newSelectOp =
+        rewriter.create<graphblas::SelectGenericOp>(
+            loc, op->getResultTypes(), predecessor.input(),
+            transformOut ? 2 : 1);
+    conjoinExtensionBlocks(rewriter, loc, newSelectOp.getRegion(0), first,
+                           second, graphblas::YieldKind::SELECT_OUT);
+    if (transformOut)
+      moveExtensionBlock(rewriter, newSelectOp.getRegion(1), transformOut,
+                         graphblas::YieldKind::TRANSFORM_OUT);
+
+    rewriter.replaceOp(op, newSelectOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseIntersectApplyRewrite
+    : public OpRewritePattern<graphblas::ApplyGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ApplyGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ApplyGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::IntersectGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::IntersectGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // Every output value comes from the mult block, which knows only values
+    Block *transformOut = findExtensionBlock(
+        op.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *mult = findExtensionBlock(predecessor.extensions(),
+                                     graphblas::YieldKind::MULT);
+    if (transformOut == nullptr || transformOut->getNumArguments() != 1 ||
+        mult == nullptr)
+      return failure();
+
+    Location loc = op->getLoc();
+    graphblas::IntersectGenericOp newIntersectOp =
+        rewriter.create<graphblas::IntersectGenericOp>(
+            loc, op->getResultTypes(), predecessor->getOperands(),
+            predecessor->getAttrs(), 1);
+    chainExtensionBlocks(rewriter, loc, newIntersectOp.getRegion(0), mult,
+                         transformOut, graphblas::YieldKind::MULT);
+
+    rewriter.replaceOp(op, newIntersectOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseUnionApplyRewrite
+    : public OpRewritePattern<graphblas::ApplyGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ApplyGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ApplyGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::UnionGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::UnionGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // The transform runs over the output values in place
+    if (predecessor.getResult().getType() != op.getResult().getType())
+      return failure();
+
+    Block *transformOut = findExtensionBlock(
+        op.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *mult = findExtensionBlock(predecessor.extensions(),
+                                     graphblas::YieldKind::MULT);
+    if (transformOut == nullptr || transformOut->getNumArguments() != 1 ||
+        mult == nullptr)
+      return failure();
+    Block *existing = findExtensionBlock(predecessor.extensions(),
+                                         graphblas::YieldKind::TRANSFORM_OUT);
+
+    Location loc = op->getLoc();
+    graphblas::UnionGenericOp newUnionOp =
+        rewriter.create<graphblas::UnionGenericOp>(
+            loc, op->getResultTypes(), predecessor->getOperands(),
+            predecessor->getAttrs(), 2);
+    moveExtensionBlock(rewriter, newUnionOp.getRegion(0), mult,
+                       graphblas::YieldKind::MULT);
+    if (existing)
+      chainExtensionBlocks(rewriter, loc, newUnionOp.getRegion(1), existing,
+                           transformOut, graphblas::YieldKind::TRANSFORM_OUT);
+    else
+      moveExtensionBlock(rewriter, newUnionOp.getRegion(1), transformOut,
+                         graphblas::YieldKind::TRANSFORM_OUT);
+
+    rewriter.replaceOp(op, newUnionOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseReduceToScalarApplyRewrite
+    : public OpRewritePattern<graphblas::ReduceToScalarGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ReduceToScalarGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ReduceToScalarGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::ApplyGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::ApplyGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // The reduction visits only the values
+    RegionRange extensions = op.extensions();
+    Block *transformOut = findExtensionBlock(
+        predecessor.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *aggIdentity =
+        findExtensionBlock(extensions, graphblas::YieldKind::AGG_IDENTITY);
+    Block *agg = findExtensionBlock(extensions, graphblas::YieldKind::AGG);
+    if (transformOut == nullptr || transformOut->getNumArguments() != 1 ||
+        aggIdentity == nullptr || agg == nullptr)
+      return failure();
+    Block *transformIn =
+        findExtensionBlock(extensions, graphblas::YieldKind::TRANSFORM_IN_A);
+    Block *selectIn =
+        findExtensionBlock(extensions, graphblas::YieldKind::SELECT_IN_A);
+
+    Location loc = op->getLoc();
+    graphblas::ReduceToScalarGenericOp newReduceOp =
+        rewriter.create<graphblas::ReduceToScalarGenericOp>(
+            loc, op->getResultTypes(), predecessor.input(),
+            selectIn ? 4 : 3);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(0), aggIdentity,
+                       graphblas::YieldKind::AGG_IDENTITY);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(1), agg,
+                       graphblas::YieldKind::AGG);
+    if (transformIn)
+      chainExtensionBlocks(rewriter, loc, newReduceOp.getRegion(2),
+                           transformOut, transformIn,
+                           graphblas::YieldKind::TRANSFORM_IN_A);
+    else
+      moveExtensionBlock(rewriter, newReduceOp.getRegion(2), transformOut,
+                         graphblas::YieldKind::TRANSFORM_IN_A);
+    if (selectIn)
+      moveExtensionBlock(rewriter, newReduceOp.getRegion(3), selectIn,
+                         graphblas::YieldKind::SELECT_IN_A);
+
+    rewriter.replaceOp(op, newReduceOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseReduceToScalarSelectRewrite
+    : public OpRewritePattern<graphblas::ReduceToScalarGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ReduceToScalarGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ReduceToScalarGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::SelectGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::SelectGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // A transform here would have to happen after the selection
+    RegionRange extensions = op.extensions();
+    if (findExtensionBlock(extensions, graphblas::YieldKind::TRANSFORM_IN_A))
+      return failure();
+
+    // The reduction visits only the values
+    Block *selectOut = findExtensionBlock(predecessor.extensions(),
+                                          graphblas::YieldKind::SELECT_OUT);
+    Block *transformOut = findExtensionBlock(
+        predecessor.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *aggIdentity =
+        findExtensionBlock(extensions, graphblas::YieldKind::AGG_IDENTITY);
+    Block *agg = findExtensionBlock(extensions, graphblas::YieldKind::AGG);
+    if (selectOut == nullptr || selectOut->getNumArguments() != 1 ||
+        (transformOut && transformOut->getNumArguments() != 1) ||
+        aggIdentity == nullptr || agg == nullptr)
+      return failure();
+    Block *selectIn =
+        findExtensionBlock(extensions, graphblas::YieldKind::SELECT_IN_A);
+
+    Location loc = op->getLoc();
+    graphblas::ReduceToScalarGenericOp newReduceOp =
+        rewriter.create<graphblas::ReduceToScalarGenericOp>(
+            loc, op->getResultTypes(), predecessor.input(),
+            transformOut ? 4 : 3);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(0), aggIdentity,
+                       graphblas::YieldKind::AGG_IDENTITY);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(1), agg,
+                       graphblas::YieldKind::AGG);
+    if (selectIn)
+      conjoinExtensionBlocks(rewriter, loc, newReduceOp.getRegion(2),
+                             selectOut, selectIn,
+                             graphblas::YieldKind::SELECT_IN_A);
+    else
+      moveExtensionBlock(rewriter, newReduceOp.getRegion(2), selectOut,
+                         graphblas::YieldKind::SELECT_IN_A);
+    if (transformOut)
+      moveExtensionBlock(rewriter, newReduceOp.getRegion(3), transformOut,
+                         graphblas::YieldKind::TRANSFORM_IN_A);
+
+    rewriter.replaceOp(op, newReduceOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+class FuseReduceToVectorApplyRewrite
+    : public OpRewritePattern<graphblas::ReduceToVectorGenericOp> {
+public:
+  using OpRewritePattern<graphblas::ReduceToVectorGenericOp>::OpRewritePattern;
+  LogicalResult matchAndRewrite(graphblas::ReduceToVectorGenericOp op,
+                                PatternRewriter &rewriter) const override {
+    graphblas::ApplyGenericOp predecessor =
+        op.input().getDefiningOp<graphblas::ApplyGenericOp>();
+    if (predecessor == nullptr || !predecessor->hasOneUse())
+      return failure();
+
+    // The reduction visits only the values
+    RegionRange extensions = op.extensions();
+    Block *transformOut = findExtensionBlock(
+        predecessor.extensions(), graphblas::YieldKind::TRANSFORM_OUT);
+    Block *aggIdentity =
+        findExtensionBlock(extensions, graphblas::YieldKind::AGG_IDENTITY);
+    Block *agg = findExtensionBlock(extensions, graphblas::YieldKind::AGG);
+    if (transformOut == nullptr || transformOut->getNumArguments() != 1 ||
+        aggIdentity == nullptr || agg == nullptr)
+      return failure();
+    Block *transformIn =
+        findExtensionBlock(extensions, graphblas::YieldKind::TRANSFORM_IN_A);
+
+    SmallVector<Value, 2> operands(op->getOperands());
+    operands[0] = predecessor.input();
+
+    Location loc = op->getLoc();
+    graphblas::ReduceToVectorGenericOp newReduceOp =
+        rewriter.create<graphblas::ReduceToVectorGenericOp>(
+            loc, op->getResultTypes(), operands, op->getAttrs(), 3);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(0), aggIdentity,
+                       graphblas::YieldKind::AGG_IDENTITY);
+    moveExtensionBlock(rewriter, newReduceOp.getRegion(1), agg,
+                       graphblas::YieldKind::AGG);
+    if (transformIn)
+      chainExtensionBlocks(rewriter, loc, newReduceOp.getRegion(2),
+                           transformOut, transformIn,
+                           graphblas::YieldKind::TRANSFORM_IN_A);
+    else
+      moveExtensionBlock(rewriter, newReduceOp.getRegion(2), transformOut,
+                         graphblas::YieldKind::TRANSFORM_IN_A);
+
+    rewriter.replaceOp(op, newReduceOp.getResult());
+    rewriter.eraseOp(predecessor);
+    return success();
+  };
+};
+
+//===----------------------------------------------------------------------===//
+// Loop-invariant code motion.
+//===----------------------------------------------------------------------===//
+
+// Returns true if `op` and everything nested in it can be executed
+// speculatively.
+static bool isSideEffectFree(Operation *op) {
+  WalkResult result = op->walk([](Operation *nested) {
+    if (nested->hasTrait<OpTrait::IsTerminator>() ||
+        MemoryEffectOpInterface::hasNoEffect(nested))
+      return WalkResult::advance();
+    return WalkResult::interrupt();
+  });
+  return !result.wasInterrupted();
+}
+
+// Returns true if the contents of the sparse tensor `value` are only read
+// inside `loop`. Passing the tensor through a terminator counts as a write,
+// as it may be modified under another name.
+static bool isUnmodifiedInLoop(Value value, Operation *loop) {
+  for (Operation *user : value.getUsers()) {
+    if (!loop->isProperAncestor(user))
+      continue;
+    if (user->hasTrait<OpTrait::IsTerminator>())
+      return false;
+    if (isSideEffectFree(user))
+      continue;
+    // graphblas.update only writes to its output
+    graphblas::UpdateOp update = dyn_cast<graphblas::UpdateOp>(user);
+    if (update && update.output() != value)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+static bool isLoopInvariant(Operation *op, Operation *loop) {
+  if (!isSideEffectFree(op))
+    return false;
+
+  SmallVector<Value, 4> usedValues(op->getOperands());
+  visitUsedValuesDefinedAbove(op->getRegions(), [&](OpOperand *operand) {
+    usedValues.push_back(operand->get());
+  });
+  for (Value value : usedValues) {
+    if (loop->isAncestor(value.getParentRegion()->getParentOp()))
+      return false;
+    if (value.getType().isa<TensorType>() && !isUnmodifiedInLoop(value, loop))
+      return false;
+  }
+
+  // Every iteration will now see the same result tensor
+  for (Value result : op->getResults()) {
+    if (result.getType().isa<TensorType>() &&
+        !isUnmodifiedInLoop(result, loop))
+      return false;
+  }
+  return true;
+}
+
+// Collects the graphblas ops at the top level of `block` in program order.
+// Ops nested in an scf.if or any other region may not run on every iteration,
+// so they are never hoisted.
+static void collectGraphBLASOps(Block &block,
+                                SmallVectorImpl<Operation *> &ops) {
+  for (Operation &op : block) {
+    if (isa_and_nonnull<graphblas::GraphBLASDialect>(op.getDialect()))
+      ops.push_back(&op);
+  }
+}
+
+// Returns true if `loop` is known to run at least once
+static bool hasNonZeroTripCount(scf::ForOp loop) {
+  arith::ConstantIndexOp lowerBound =
+      loop.getLowerBound().getDefiningOp<arith::ConstantIndexOp>();
+  arith::ConstantIndexOp upperBound =
+      loop.getUpperBound().getDefiningOp<arith::ConstantIndexOp>();
+  return lowerBound && upperBound && lowerBound.value() < upperBound.value();
+}
+
+// Wraps `loop` in an scf.if which skips it when it has no iterations. Ops
+// hoisted in front of the loop then only run if its body would have.
+static void guardTripCount(scf::ForOp loop) {
+  OpBuilder builder(loop);
+  Location loc = loop.getLoc();
+
+  Value nonEmpty = builder.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::slt, loop.getLowerBound(),
+      loop.getUpperBound());
+  scf::IfOp guard = builder.create<scf::IfOp>(loc, loop->getResultTypes(),
+                                              nonEmpty, true);
+  loop->replaceAllUsesWith(guard.getResults());
+
+  // if nonEmpty
+  Block *thenBlock = guard.thenBlock();
+  if (thenBlock->empty()) {
+    builder.setInsertionPointToEnd(thenBlock);
+    builder.create<scf::YieldOp>(loc, loop->getResults());
+  }
+  loop->moveBefore(thenBlock->getTerminator());
+
+  // else, a loop without iterations returns its initial values
+  Block *elseBlock = guard.elseBlock();
+  if (elseBlock->empty()) {
+    builder.setInsertionPointToEnd(elseBlock);
+    builder.create<scf::YieldOp>(loc, loop.getIterOperands());
+  }
+}
+
+// Moves graphblas ops which compute the same result on every iteration of
+// `loop` in front of it. Only ops at the top level of the body are moved,
+// and the loop is put behind a trip count check unless it is known to run.
+static void hoistLoopInvariantOps(scf::ForOp loop) {
+  SmallVector<Operation *, 8> candidates;
+  collectGraphBLASOps(*loop.getBody(), candidates);
+
+  // Candidates are in program order, so an op whose operands were just
+  // hoisted is seen after them
+  bool guarded = hasNonZeroTripCount(loop);
+  for (Operation *op : candidates) {
+    if (!isLoopInvariant(op, loop))
+      continue;
+    if (!guarded) {
+      guardTripCount(loop);
+      guarded = true;
+    }
+    op->moveBefore(loop);
+  }
+}
+
+// The "before" region of an scf.while runs at least once, so its top level
+// ops are hoisted without a guard. The "after" region may never run.
+static void hoistLoopInvariantOps(scf::WhileOp loop) {
+  SmallVector<Operation *, 8> candidates;
+  collectGraphBLASOps(loop.getBefore().front(), candidates);
+
+  for (Operation *op : candidates) {
+    if (isLoopInvariant(op, loop))
+      op->moveBefore(loop);
+  }
+}
+
 void populateGraphBLASOptimizePatterns(RewritePatternSet &patterns) {
-  patterns.add<FuseMatrixMultiplyApplyRewrite, FuseMatrixMultiplyReduceRewrite>(
-      patterns.getContext());
+  patterns.add<FuseMatrixMultiplyApplyRewrite, FuseMatrixMultiplyReduceRewrite,
+               FuseApplyApplyRewrite, FuseSelectApplyRewrite,
+               FuseSelectSelectRewrite, FuseIntersectApplyRewrite,
+               FuseUnionApplyRewrite, FuseReduceToScalarApplyRewrite,
+               FuseReduceToScalarSelectRewrite,
+               FuseReduceToVectorApplyRewrite>(patterns.getContext());
 }
 
 struct GraphBLASOptimizePass
@@ -169,6 +762,23 @@ struct GraphBLASOptimizePass
     ConversionTarget target(*ctx);
     populateGraphBLASOptimizePatterns(patterns);
     (void)applyPatternsAndFoldGreedily(getOperation(), std::move(patterns));
+
+    // Inner loops are visited first, so an op hoisted out of an inner loop
+    // with a known trip count can then move out of the enclosing loop too.
+    // An op hoisted into the guard of an inner loop stays in that guard, as
+    // it must only run when the inner loop does. Loops are collected up
+    // front, as guarding a loop moves it.
+    SmallVector<Operation *, 8> loops;
+    getOperation().walk([&](Operation *op) {
+      if (isa<scf::ForOp, scf::WhileOp>(op))
+        loops.push_back(op);
+    });
+    for (Operation *loop : loops) {
+      if (scf::ForOp forOp = dyn_cast<scf::ForOp>(loop))
+        hoistLoopInvariantOps(forOp);
+      else
+        hoistLoopInvariantOps(cast<scf::WhileOp>(loop));
+    }
   }
 };
 
@@ -6,10 +6,16 @@
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/BlockAndValueMapping.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 #include "GraphBLAS/GraphBLASOps.h"
@@ -47,6 +53,19 @@ bool hasColumnOrdering(Type inputType) {
   return true;
 }
 
+// A bitmap vector is a dense vector whose nonzero values mark its entries. It
+// is accepted as a mask and as the vector operand of a matrix-vector multiply.
+bool isBitmapVector(Type inputType) {
+  sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
+      sparse_tensor::getSparseTensorEncoding(inputType);
+  if (!sparseEncoding)
+    return false;
+  ArrayRef<SparseTensorEncodingAttr::DimLevelType> dimLevelType =
+      sparseEncoding.getDimLevelType();
+  return dimLevelType.size() == 1 &&
+         dimLevelType[0] == SparseTensorEncodingAttr::DimLevelType::Dense;
+}
+
 int64_t getRank(Type inputType) {
   mlir::sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
       mlir::sparse_tensor::getSparseTensorEncoding(inputType);
@@ -66,6 +85,8 @@ MemRefType getMemrefPointerType(Type tensorType) {
   sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
       sparse_tensor::getSparseTensorEncoding(tensorType);
   unsigned pointerBitWidth = sparseEncoding.getPointerBitWidth();
+  if (pointerBitWidth == 0) // native width
+    pointerBitWidth = 64;
   Type pointerType = IntegerType::get(tensorType.getContext(), pointerBitWidth);
   return MemRefType::get({-1}, pointerType);
 }
@@ -74,6 +95,8 @@ MemRefType getMemrefIndexType(Type tensorType) {
   sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
       sparse_tensor::getSparseTensorEncoding(tensorType);
   unsigned indexBitWidth = sparseEncoding.getIndexBitWidth();
+  if (indexBitWidth == 0) // native width
+    indexBitWidth = 64;
   Type indexType = IntegerType::get(tensorType.getContext(), indexBitWidth);
   return MemRefType::get({-1}, indexType);
 }
@@ -83,6 +106,60 @@ MemRefType getMemrefValueType(Type tensorType) {
   return MemRefType::get({-1}, rtt.getElementType());
 }
 
+Value loadI64(OpBuilder &builder, Location loc, Value memref,
+              ValueRange indices) {
+  Type int64Type = builder.getIntegerType(64);
+  Value value = builder.create<memref::LoadOp>(loc, memref, indices);
+  if (value.getType() != int64Type)
+    value = builder.create<arith::ExtUIOp>(loc, value, int64Type);
+  return value;
+}
+
+void storeI64(OpBuilder &builder, Location loc, Value value, Value memref,
+              ValueRange indices) {
+  Type elementType = memref.getType().cast<MemRefType>().getElementType();
+  if (value.getType() != elementType)
+    value = builder.create<arith::TruncIOp>(loc, value, elementType);
+  builder.create<memref::StoreOp>(loc, value, memref, indices);
+}
+
+void copyI64(OpBuilder &builder, Location loc, Value source, Value dest) {
+  if (source.getType() == dest.getType()) {
+    builder.create<memref::CopyOp>(loc, source, dest);
+    return;
+  }
+
+  Value c0 = builder.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = builder.create<arith::ConstantIndexOp>(loc, 1);
+  Value size = builder.create<memref::DimOp>(loc, source, c0);
+  scf::ParallelOp loop = builder.create<scf::ParallelOp>(loc, c0, size, c1);
+  {
+    OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToStart(loop.getBody());
+    Value i = loop.getInductionVars()[0];
+    Value value = loadI64(builder, loc, source, i);
+    storeI64(builder, loc, value, dest, i);
+  }
+}
+
+// Aborts at runtime unless all values below `bound` (an index) fit in the
+// element type of `memref`. Emits nothing for 64-bit memrefs.
+void assertFitsBitWidth(OpBuilder &builder, Location loc, Value bound,
+                        Value memref, StringRef message) {
+  unsigned bitWidth =
+      memref.getType().cast<MemRefType>().getElementTypeBitWidth();
+  if (bitWidth >= 64)
+    return;
+
+  Type int64Type = builder.getIntegerType(64);
+  Value bound64 = builder.create<arith::IndexCastOp>(loc, bound, int64Type);
+  Value limit = builder.create<arith::ConstantIntOp>(
+      loc, uint64_t(1) << bitWidth, int64Type);
+  Value fits = builder.create<arith::CmpIOp>(loc, arith::CmpIPredicate::ule,
+                                             bound64, limit);
+  builder.create<AssertOp>(loc, fits, message);
+}
+
 // make Compressed Vector type
 RankedTensorType getCompressedVectorType(MLIRContext *context,
                                          ArrayRef<int64_t> shape,
@@ -217,9 +294,7 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
   Value c0 = builder.create<arith::ConstantIndexOp>(loc, 0);
   Value c1 = builder.create<arith::ConstantIndexOp>(loc, 1);
   Type indexType = builder.getIndexType();
-  Type int64Type = builder.getIntegerType(64);
   Type boolType = builder.getIntegerType(1);
-  Type memref1DI64Type = MemRefType::get({-1}, int64Type);
   Type memref1DValueType = MemRefType::get({-1}, inputValueType);
 
   if (inputType.getRank() == 1) {
@@ -232,7 +307,7 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
     }
 
     Value inputIndices = builder.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, input, c0);
+        loc, getMemrefIndexType(inputType), input, c0);
     Value inputValues = builder.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, input);
     Value vectorLength = builder.create<graphblas::SizeOp>(loc, input);
@@ -264,8 +339,7 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
     {
       Value firstValuesValue =
           builder.create<memref::LoadOp>(loc, inputValues, c0);
-      Value firstIndicesValue_i64 =
-          builder.create<memref::LoadOp>(loc, inputIndices, c0);
+      Value firstIndicesValue_i64 = loadI64(builder, loc, inputIndices, c0);
       Value firstIndicesValue = builder.create<arith::IndexCastOp>(
           loc, firstIndicesValue_i64, indexType);
       builder.create<scf::YieldOp>(
@@ -297,8 +371,8 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
           Value updatedInputValuesAndIndicesPosition =
               builder.create<arith::AddIOp>(loc, inputValuesAndIndicesPosition,
                                             c1);
-          Value updatedInputIndicesValue_i64 = builder.create<memref::LoadOp>(
-              loc, inputIndices, updatedInputValuesAndIndicesPosition);
+          Value updatedInputIndicesValue_i64 = loadI64(
+              builder, loc, inputIndices, updatedInputValuesAndIndicesPosition);
           Value updatedInputIndicesValue = builder.create<arith::IndexCastOp>(
               loc, updatedInputIndicesValue_i64, indexType);
           Value updatedInputValuesValue = builder.create<memref::LoadOp>(
@@ -353,16 +427,10 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
     Value ncols = builder.create<graphblas::NumColsOp>(loc, input);
     Value ncolsMinusOne = builder.create<arith::SubIOp>(loc, ncols, c1);
 
-    sparse_tensor::SparseTensorEncodingAttr sparseEncoding =
-        sparse_tensor::getSparseTensorEncoding(inputType);
-    unsigned pointerBitWidth = sparseEncoding.getPointerBitWidth();
-    Type pointerType = builder.getIntegerType(pointerBitWidth);
-    Type memref1DPointerType = MemRefType::get({-1}, pointerType);
-
     Value matrixPointers = builder.create<sparse_tensor::ToPointersOp>(
-        loc, memref1DPointerType, input, c1);
+        loc, getMemrefPointerType(inputType), input, c1);
     Value matrixIndices = builder.create<sparse_tensor::ToIndicesOp>(
-        loc, memref1DI64Type, input, c1);
+        loc, getMemrefIndexType(inputType), input, c1);
     Value matrixValues = builder.create<sparse_tensor::ToValuesOp>(
         loc, memref1DValueType, input);
     scf::ForOp forRowLoop = builder.create<scf::ForOp>(loc, c0, nrows, c1);
@@ -372,12 +440,11 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
       Value matrixRowIndex = forRowLoop.getInductionVar();
       Value nextMatrixRowIndex =
           builder.create<arith::AddIOp>(loc, matrixRowIndex, c1).getResult();
-      Value firstPtr64 =
-          builder.create<memref::LoadOp>(loc, matrixPointers, matrixRowIndex);
+      Value firstPtr64 = loadI64(builder, loc, matrixPointers, matrixRowIndex);
       Value firstPtr =
           builder.create<arith::IndexCastOp>(loc, firstPtr64, indexType);
-      Value secondPtr64 = builder.create<memref::LoadOp>(loc, matrixPointers,
-                                                         nextMatrixRowIndex);
+      Value secondPtr64 =
+          loadI64(builder, loc, matrixPointers, nextMatrixRowIndex);
       Value secondPtr =
           builder.create<arith::IndexCastOp>(loc, secondPtr64, indexType);
 
@@ -396,8 +463,7 @@ void callPrintTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
         {
           builder.setInsertionPointToStart(ifPtrIsValid.thenBlock());
           {
-            Value col_i64 =
-                builder.create<memref::LoadOp>(loc, matrixIndices, ptr);
+            Value col_i64 = loadI64(builder, loc, matrixIndices, ptr);
             Value col =
                 builder.create<arith::IndexCastOp>(loc, col_i64, indexType);
             Value colEqualsToPrintPosition = builder.create<arith::CmpIOp>(
@@ -549,7 +615,9 @@ Value callNewTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
       npointers = builder.create<graphblas::NumColsOp>(loc, result);
   }
   Value npointers_plus_1 = builder.create<arith::AddIOp>(loc, npointers, c1);
-  callResizePointers(builder, mod, loc, result, dim, npointers_plus_1);
+  // All rows (or columns) start out empty
+  callResizePointers(builder, mod, loc, result, dim, npointers_plus_1,
+                     /*zero=*/true);
 
   return result;
 }
@@ -606,6 +674,31 @@ Value callDupTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
   return tensor;
 }
 
+Value callViewTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
+                     Value tensor) {
+  RankedTensorType tensorType = tensor.getType().dyn_cast<RankedTensorType>();
+  Value ptr = castToPtr8(builder, mod, loc, tensor);
+  Type ptr8Type = ptr.getType();
+
+  FlatSymbolRefAttr func = getFunc(mod, loc, "view_tensor", ptr8Type, ptr8Type);
+  CallOp callOpResult = builder.create<mlir::CallOp>(loc, func, ptr8Type, ptr);
+  Value result = callOpResult->getResult(0);
+  tensor = castToTensor(builder, mod, loc, result, tensorType);
+  return tensor;
+}
+
+CallOp callDetachTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
+                        Value tensor) {
+  Value ptr = castToPtr8(builder, mod, loc, tensor);
+  Type ptr8Type = ptr.getType();
+
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, "detach_tensor", TypeRange(), ptr8Type);
+  CallOp result = builder.create<mlir::CallOp>(loc, func, TypeRange(), ptr);
+
+  return result;
+}
+
 CallOp callAssignRev(OpBuilder &builder, ModuleOp &mod, Location loc,
                      Value tensor, Value d, Value newIndexValue) {
   Value ptr = castToPtr8(builder, mod, loc, tensor);
@@ -635,13 +728,14 @@ CallOp callResizeDim(OpBuilder &builder, ModuleOp &mod, Location loc,
 }
 
 CallOp callResizePointers(OpBuilder &builder, ModuleOp &mod, Location loc,
-                          Value tensor, Value d, Value size) {
+                          Value tensor, Value d, Value size, bool zero) {
   Value ptr = castToPtr8(builder, mod, loc, tensor);
   Type ptr8Type = ptr.getType();
 
   Type indexType = builder.getIndexType();
-  FlatSymbolRefAttr func = getFunc(mod, loc, "resize_pointers", TypeRange(),
-                                   {ptr8Type, indexType, indexType});
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, zero ? "resize_pointers_zeroed" : "resize_pointers",
+              TypeRange(), {ptr8Type, indexType, indexType});
   CallOp result = builder.create<mlir::CallOp>(loc, func, TypeRange(),
                                                ArrayRef<Value>({ptr, d, size}));
 
@@ -649,13 +743,14 @@ CallOp callResizePointers(OpBuilder &builder, ModuleOp &mod, Location loc,
 }
 
 mlir::CallOp callResizeIndex(OpBuilder &builder, ModuleOp &mod, Location loc,
-                             Value tensor, Value d, Value size) {
+                             Value tensor, Value d, Value size, bool zero) {
   Value ptr = castToPtr8(builder, mod, loc, tensor);
   Type ptr8Type = ptr.getType();
 
   Type indexType = builder.getIndexType();
-  FlatSymbolRefAttr func = getFunc(mod, loc, "resize_index", TypeRange(),
-                                   {ptr8Type, indexType, indexType});
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, zero ? "resize_index_zeroed" : "resize_index",
+              TypeRange(), {ptr8Type, indexType, indexType});
   mlir::CallOp result = builder.create<mlir::CallOp>(
       loc, func, TypeRange(), ArrayRef<Value>({ptr, d, size}));
 
@@ -663,19 +758,48 @@ mlir::CallOp callResizeIndex(OpBuilder &builder, ModuleOp &mod, Location loc,
 }
 
 CallOp callResizeValues(OpBuilder &builder, ModuleOp &mod, Location loc,
-                        Value tensor, Value size) {
+                        Value tensor, Value size, bool zero) {
   Value ptr = castToPtr8(builder, mod, loc, tensor);
   Type ptr8Type = ptr.getType();
 
   Type indexType = builder.getIndexType();
   FlatSymbolRefAttr func =
-      getFunc(mod, loc, "resize_values", TypeRange(), {ptr8Type, indexType});
+      getFunc(mod, loc, zero ? "resize_values_zeroed" : "resize_values",
+              TypeRange(), {ptr8Type, indexType});
   CallOp result = builder.create<mlir::CallOp>(loc, func, TypeRange(),
                                                ArrayRef<Value>({ptr, size}));
 
   return result;
 }
 
+CallOp callSharePointers(OpBuilder &builder, ModuleOp &mod, Location loc,
+                         Value tensor, Value other) {
+  Value tPtr = castToPtr8(builder, mod, loc, tensor);
+  Value oPtr = castToPtr8(builder, mod, loc, other);
+  Type ptr8Type = oPtr.getType();
+
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, "share_pointers", TypeRange(), {ptr8Type, ptr8Type});
+  CallOp result = builder.create<mlir::CallOp>(loc, func, TypeRange(),
+                                               ArrayRef<Value>({tPtr, oPtr}));
+
+  return result;
+}
+
+CallOp callShareIndices(OpBuilder &builder, ModuleOp &mod, Location loc,
+                        Value tensor, Value other) {
+  Value tPtr = castToPtr8(builder, mod, loc, tensor);
+  Value oPtr = castToPtr8(builder, mod, loc, other);
+  Type ptr8Type = oPtr.getType();
+
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, "share_indices", TypeRange(), {ptr8Type, ptr8Type});
+  CallOp result = builder.create<mlir::CallOp>(loc, func, TypeRange(),
+                                               ArrayRef<Value>({tPtr, oPtr}));
+
+  return result;
+}
+
 CallOp callSwapPointers(OpBuilder &builder, ModuleOp &mod, Location loc,
                         Value tensor, Value other) {
   Value tPtr = castToPtr8(builder, mod, loc, tensor);
@@ -730,25 +854,409 @@ CallOp callSwapValues(OpBuilder &builder, ModuleOp &mod, Location loc,
   return result;
 }
 
+CallOp callStartRandomStream(OpBuilder &builder, ModuleOp &mod, Location loc,
+                             Value rngContext) {
+  FlatSymbolRefAttr func = getFunc(mod, loc, "start_random_stream",
+                                   TypeRange(), rngContext.getType());
+  CallOp result =
+      builder.create<mlir::CallOp>(loc, func, TypeRange(), rngContext);
+  return result;
+}
+
+Value callRandomDoubleAt(OpBuilder &builder, ModuleOp &mod, Location loc,
+                         Value rngContext, Value row, Value col) {
+  Type int64Type = builder.getIntegerType(64);
+  Type f64Type = builder.getF64Type();
+  Value row64 = builder.create<arith::IndexCastOp>(loc, row, int64Type);
+  Value col64 = builder.create<arith::IndexCastOp>(loc, col, int64Type);
+
+  FlatSymbolRefAttr func =
+      getFunc(mod, loc, "random_double_at", f64Type,
+              {rngContext.getType(), int64Type, int64Type});
+  CallOp result = builder.create<mlir::CallOp>(
+      loc, func, f64Type, ArrayRef<Value>({rngContext, row64, col64}));
+  return result.getResult(0);
+}
+
+// Releases created by cleanupIntermediateTensor carry this attribute until
+// releaseIntermediatesAfterLastUse has moved them to their final position.
+static const char *intermediateReleaseAttr = "graphblas.intermediate";
+
 void cleanupIntermediateTensor(OpBuilder &builder, ModuleOp &mod, Location loc,
                                Value tensor) {
-  // Clean up sparse tensor unless it is returned by the function
+  // Clean up sparse tensor unless it is passed out of its block. The release
+  // is placed at the end of the block for now and moved after the last use
+  // of the tensor once lowering has finished.
   Block *outputBlock = tensor.getParentBlock();
-  ReturnOp lastStatement =
-      llvm::dyn_cast_or_null<ReturnOp>(outputBlock->getTerminator());
-  bool toDelete = true;
-  if (lastStatement != nullptr) {
-    for (Value result : lastStatement->getOperands()) {
-      if (result == tensor) {
-        toDelete = false;
-        break;
+  if (outputBlock->empty())
+    return;
+  Operation *lastStatement = &outputBlock->back();
+  if (!lastStatement->hasTrait<OpTrait::IsTerminator>())
+    return;
+  for (Value result : lastStatement->getOperands()) {
+    if (result == tensor)
+      return;
+  }
+  builder.setInsertionPoint(lastStatement);
+  sparse_tensor::ReleaseOp release =
+      builder.create<sparse_tensor::ReleaseOp>(loc, tensor);
+  release->setAttr(intermediateReleaseAttr, builder.getUnitAttr());
+}
+
+// Returns true if the results of `op` may refer to the same sparse tensor
+// storage as its operands.
+static bool mayAliasOperands(Operation *op) {
+  if (isa<sparse_tensor::ToPointersOp, sparse_tensor::ToIndicesOp,
+          sparse_tensor::ToValuesOp, tensor::CastOp, memref::CastOp,
+          UnrealizedConversionCastOp, ViewLikeOpInterface>(op))
+    return true;
+  if (CallOp call = dyn_cast<CallOp>(op)) {
+    StringRef callee = call.getCallee();
+    if (callee.startswith("ptr8_to_") || callee.endswith("_to_ptr8") ||
+        callee.startswith("get_"))
+      return true;
+    // Runtime functions return fresh tensors, but functions defined in the
+    // module may hand back one of their arguments
+    ModuleOp mod = op->getParentOfType<ModuleOp>();
+    FuncOp func = mod.lookupSymbol<FuncOp>(callee);
+    return func && !func.isExternal();
+  }
+  // scf.for, scf.if, etc. may pass the operand through to their results
+  return op->getNumRegions() > 0;
+}
+
+// Returns true if `callee` is a runtime function which uses its tensor
+// arguments only for the duration of the call.
+static bool isNonCapturingRuntimeFunc(StringRef callee) {
+  for (StringRef prefix : {"print_", "resize_", "share_", "swap_", "get_",
+                           "ptr8_to_", "choose_", "random_"}) {
+    if (callee.startswith(prefix))
+      return true;
+  }
+  for (StringRef name : {"dup_tensor", "view_tensor", "detach_tensor",
+                         "assign_rev", "start_random_stream"}) {
+    if (callee == name)
+      return true;
+  }
+  return callee.endswith("_to_ptr8");
+}
+
+// Returns true if `user` may keep a reference to `value` after it has run,
+// e.g. by storing it to memory, or may free it. Writes into the storage of
+// `value` itself are fine.
+static bool mayCaptureOperand(Operation *user, Value value) {
+  // Terminators are handled by findLastUse, nested ops are checked on their
+  // own
+  if (user->hasTrait<OpTrait::IsTerminator>() ||
+      user->hasTrait<OpTrait::HasRecursiveSideEffects>())
+    return false;
+  // Somebody else already owns the tensor
+  if (isa<sparse_tensor::ReleaseOp>(user))
+    return true;
+  if (CallOp call = dyn_cast<CallOp>(user))
+    return !isNonCapturingRuntimeFunc(call.getCallee());
+
+  MemoryEffectOpInterface effects = dyn_cast<MemoryEffectOpInterface>(user);
+  if (!effects)
+    return true;
+  SmallVector<MemoryEffects::EffectInstance, 4> instances;
+  effects.getEffects(instances);
+  for (MemoryEffects::EffectInstance &instance : instances) {
+    if (!isa<MemoryEffects::Write, MemoryEffects::Free>(instance.getEffect()))
+      continue;
+    // Only the contents of a memref can be written elsewhere, e.g. by a
+    // copy, not the memref itself
+    if (instance.getValue() == value || value.getType().isa<MemRefType>())
+      continue;
+    return true;
+  }
+  return false;
+}
+
+// Returns true if one of `aliases` may outlive what the pass can see, in
+// which case the tensor must not be released.
+static bool isCaptured(const llvm::SetVector<Value> &aliases,
+                       Operation *ignore) {
+  for (Value value : aliases) {
+    for (Operation *user : value.getUsers()) {
+      if (user != ignore && mayCaptureOperand(user, value))
+        return true;
+    }
+  }
+  return false;
+}
+
+// Walks back through casts to the value owning the sparse tensor.
+static Value getAliasRoot(Value value) {
+  while (Operation *defOp = value.getDefiningOp()) {
+    if (isa<tensor::CastOp, memref::CastOp>(defOp)) {
+      value = defOp->getOperand(0);
+      continue;
+    }
+    CallOp call = dyn_cast<CallOp>(defOp);
+    if (!call || call.getNumOperands() != 1)
+      break;
+    StringRef callee = call.getCallee();
+    if (!callee.startswith("ptr8_to_") && !callee.endswith("_to_ptr8"))
+      break;
+    value = call.getOperand(0);
+  }
+  return value;
+}
+
+// Collects every value which may refer to the storage of `root`. Values
+// are not followed into the results of `stopAt`.
+static llvm::SetVector<Value> collectAliases(Value root,
+                                             Operation *stopAt = nullptr) {
+  llvm::SetVector<Value> aliases;
+  aliases.insert(root);
+  for (unsigned i = 0; i < aliases.size(); i++) {
+    Value value = aliases[i];
+    for (Operation *user : value.getUsers()) {
+      if (user == stopAt)
+        continue;
+      if (user->hasTrait<OpTrait::IsTerminator>()) {
+        Operation *parent = user->getParentOp();
+        if (parent && !isa<FuncOp>(parent))
+          aliases.insert(parent->result_begin(), parent->result_end());
+      } else if (mayAliasOperands(user)) {
+        aliases.insert(user->result_begin(), user->result_end());
       }
     }
-    if (toDelete) {
-      builder.setInsertionPoint(lastStatement);
-      builder.create<sparse_tensor::ReleaseOp>(loc, tensor);
+  }
+  return aliases;
+}
+
+// Returns the last operation in `block` which uses one of `aliases`, either
+// directly or from within a nested region. `escapes` is set if one of them
+// is used by the terminator of `block`; `usedOutside` is set if one of them
+// is used outside of `block`.
+static Operation *findLastUse(Block *block,
+                              const llvm::SetVector<Value> &aliases,
+                              Operation *ignore, bool &escapes,
+                              bool &usedOutside) {
+  Operation *lastUse = nullptr;
+  for (Value value : aliases) {
+    for (Operation *user : value.getUsers()) {
+      if (user == ignore)
+        continue;
+      Operation *ancestor = block->findAncestorOpInBlock(*user);
+      if (ancestor == nullptr) {
+        usedOutside = true;
+        continue;
+      }
+      if (ancestor == block->getTerminator()) {
+        escapes = true;
+        continue;
+      }
+      if (lastUse == nullptr || lastUse->isBeforeInBlock(ancestor))
+        lastUse = ancestor;
     }
   }
+  return lastUse;
+}
+
+static Operation *createRelease(OpBuilder &builder, ModuleOp mod,
+                                Location loc, Value tensor) {
+  Operation *release;
+  if (tensor.getType().isa<RankedTensorType>()) {
+    release = builder.create<sparse_tensor::ReleaseOp>(loc, tensor);
+  } else {
+    Type ptr8Type = tensor.getType();
+    FlatSymbolRefAttr delFunc =
+        getFunc(mod, loc, "delSparseTensor", TypeRange(), ptr8Type);
+    release = builder.create<mlir::CallOp>(loc, delFunc, TypeRange(), tensor);
+  }
+  release->setAttr(intermediateReleaseAttr, builder.getUnitAttr());
+  return release;
+}
+
+// Moves `release` right after the last use of its tensor. Returns false if
+// the tensor is passed out of its block, in which case the release is erased
+// and, unless the tensor is returned, recorded in `escapedOwned`. A tensor
+// which may be captured, e.g. stored to memory, is never released.
+static bool placeIntermediateRelease(Operation *release,
+                                     llvm::DenseSet<Value> &escapedOwned) {
+  Value tensor = release->getOperand(0);
+  Block *block = release->getBlock();
+  llvm::SetVector<Value> aliases = collectAliases(tensor);
+  if (isCaptured(aliases, release)) {
+    release->erase();
+    return false;
+  }
+  bool escapes = false;
+  bool usedOutside = false;
+  Operation *lastUse =
+      findLastUse(block, aliases, release, escapes, usedOutside);
+  if (escapes || usedOutside) {
+    if (!isa<ReturnOp>(block->getTerminator()))
+      escapedOwned.insert(tensor);
+    release->erase();
+    return false;
+  }
+  if (lastUse != nullptr)
+    release->moveAfter(lastUse);
+  else if (Operation *defOp = tensor.getDefiningOp())
+    release->moveAfter(defOp);
+  else
+    release->moveBefore(&block->front());
+  return true;
+}
+
+// Releases the previous value of a loop-carried tensor once a fresh tensor
+// replaces it. `yielded` is the next value of the carried tensor in `block`.
+// Nothing is created unless `emit` is set, so this can be run as a check.
+static bool releaseCarriedValue(ModuleOp mod, scf::ForOp loop, Block *block,
+                                Value carried, Value yielded,
+                                const llvm::SetVector<Value> &carriedAliases,
+                                const llvm::DenseSet<Value> &escapedOwned,
+                                bool emit) {
+  Operation *terminator = block->getTerminator();
+
+  // Each branch of an scf.if may produce the next value on its own
+  scf::IfOp ifOp = yielded.getDefiningOp<scf::IfOp>();
+  if (ifOp && ifOp->getBlock() == block && ifOp.elseBlock() != nullptr) {
+    for (Value operand : terminator->getOperands()) {
+      if (operand != yielded && carriedAliases.count(operand))
+        return false;
+    }
+    for (Value value : carriedAliases) {
+      if (value.getDefiningOp() == ifOp)
+        continue;
+      for (Operation *user : value.getUsers()) {
+        Operation *ancestor = block->findAncestorOpInBlock(*user);
+        if (ancestor != nullptr && ancestor != terminator &&
+            ifOp->isBeforeInBlock(ancestor))
+          return false;
+      }
+    }
+    unsigned resultNumber = yielded.cast<OpResult>().getResultNumber();
+    for (Block *branch : {ifOp.thenBlock(), ifOp.elseBlock()}) {
+      Value branchYielded = branch->getTerminator()->getOperand(resultNumber);
+      if (!releaseCarriedValue(mod, loop, branch, carried, branchYielded,
+                               carriedAliases, escapedOwned, emit))
+        return false;
+    }
+    return true;
+  }
+
+  // The carried value is passed on unchanged
+  if (carriedAliases.count(yielded))
+    return true;
+
+  // Otherwise a fresh tensor made in this iteration must replace it
+  Value root = getAliasRoot(yielded);
+  Operation *rootOp = root.getDefiningOp();
+  if (!escapedOwned.count(root) || rootOp == nullptr ||
+      !loop->isProperAncestor(rootOp))
+    return false;
+  bool escapes = false;
+  bool usedOutside = false;
+  Operation *lastUse =
+      findLastUse(block, carriedAliases, nullptr, escapes, usedOutside);
+  if (escapes || isCaptured(carriedAliases, nullptr))
+    return false;
+  if (emit) {
+    OpBuilder builder(mod.getContext());
+    if (lastUse != nullptr)
+      builder.setInsertionPointAfter(lastUse);
+    else
+      builder.setInsertionPointToStart(block);
+    createRelease(builder, mod, loop.getLoc(), carried);
+  }
+  return true;
+}
+
+// Hands ownership of intermediate tensors passed into `loop` to the loop.
+// Each iteration releases the carried tensor once it is replaced, and the
+// final value is released after the loop.
+static void releaseLoopCarriedValues(
+    ModuleOp mod, scf::ForOp loop, llvm::DenseSet<Value> &escapedOwned,
+    llvm::DenseMap<Value, Operation *> &releaseOf) {
+  Block *body = loop.getBody();
+  for (unsigned i = 0; i < loop.getNumIterOperands(); i++) {
+    Value carried = loop.getRegionIterArgs()[i];
+    Type carriedType = carried.getType();
+    if (!carriedType.isa<LLVM::LLVMPointerType>() &&
+        !(carriedType.isa<RankedTensorType>() &&
+          sparse_tensor::getSparseTensorEncoding(carriedType)))
+      continue;
+
+    // The initial value must be an intermediate whose last use is the loop
+    Value initRoot = getAliasRoot(loop.getIterOperands()[i]);
+    auto found = releaseOf.find(initRoot);
+    if (found == releaseOf.end() ||
+        initRoot.getParentBlock() != loop->getBlock())
+      continue;
+    Operation *initRelease = found->second;
+    llvm::SetVector<Value> initAliases = collectAliases(initRoot, loop);
+    unsigned loopUses = 0;
+    bool usedInLoop = false;
+    for (OpOperand &operand : loop->getOpOperands()) {
+      if (initAliases.count(operand.get()))
+        loopUses++;
+    }
+    for (Value value : initAliases) {
+      for (Operation *user : value.getUsers()) {
+        if (loop->isProperAncestor(user))
+          usedInLoop = true;
+      }
+    }
+    bool escapes = false;
+    bool usedOutside = false;
+    Operation *lastUse = findLastUse(loop->getBlock(), initAliases, initRelease,
+                                     escapes, usedOutside);
+    if (loopUses != 1 || usedInLoop || lastUse != loop.getOperation() ||
+        escapes || usedOutside || isCaptured(initAliases, initRelease))
+      continue;
+
+    llvm::SetVector<Value> carriedAliases = collectAliases(carried);
+    Value yielded = body->getTerminator()->getOperand(i);
+    if (!releaseCarriedValue(mod, loop, body, carried, yielded, carriedAliases,
+                             escapedOwned, false))
+      continue;
+    releaseCarriedValue(mod, loop, body, carried, yielded, carriedAliases,
+                        escapedOwned, true);
+
+    // The loop result now owns whichever tensor is left
+    releaseOf.erase(initRoot);
+    if (initRelease != nullptr)
+      initRelease->erase();
+    OpBuilder builder(loop);
+    builder.setInsertionPointAfter(loop);
+    Value result = loop.getResult(i);
+    Operation *release = createRelease(builder, mod, loop.getLoc(), result);
+    releaseOf[result] =
+        placeIntermediateRelease(release, escapedOwned) ? release : nullptr;
+  }
+}
+
+void releaseIntermediatesAfterLastUse(ModuleOp mod) {
+  SmallVector<Operation *, 16> releases;
+  mod.walk([&](Operation *op) {
+    if (op->hasAttr(intermediateReleaseAttr))
+      releases.push_back(op);
+  });
+  if (releases.empty())
+    return;
+
+  // Intermediates whose release had to be dropped map to null, as they may
+  // still be handed over to a loop
+  llvm::DenseSet<Value> escapedOwned;
+  llvm::DenseMap<Value, Operation *> releaseOf;
+  for (Operation *release : releases) {
+    Value tensor = release->getOperand(0);
+    releaseOf[tensor] =
+        placeIntermediateRelease(release, escapedOwned) ? release : nullptr;
+  }
+
+  // Inner loops are visited first, so their results are already owned
+  SmallVector<scf::ForOp, 4> loops;
+  mod.walk([&](scf::ForOp loop) { loops.push_back(loop); });
+  for (scf::ForOp loop : loops)
+    releaseLoopCarriedValues(mod, loop, escapedOwned, releaseOf);
+
+  mod.walk([&](Operation *op) { op->removeAttr(intermediateReleaseAttr); });
 }
 
 LogicalResult
@@ -828,6 +1336,40 @@ ExtensionBlocks::extractBlocks(Operation *op, RegionRange &regions,
   return success();
 };
 
+Value inlineExtensionBlock(PatternRewriter &rewriter, Block *block,
+                           ValueRange args) {
+  args = args.take_front(block->getNumArguments());
+  graphblas::YieldOp yield =
+      llvm::cast<graphblas::YieldOp>(block->getTerminator());
+  Value result = yield.values().front();
+  // A block yielding one of its arguments yields what is passed in for it
+  BlockArgument resultArg = result.dyn_cast<BlockArgument>();
+  if (resultArg && resultArg.getOwner() == block)
+    result = args[resultArg.getArgNumber()];
+  rewriter.eraseOp(yield);
+
+  Block *dest = rewriter.getBlock();
+  Block::iterator insertPt = rewriter.getInsertionPoint();
+  if (insertPt == dest->end())
+    rewriter.mergeBlocks(block, dest, args);
+  else
+    rewriter.mergeBlockBefore(block, &*insertPt, args);
+  return result;
+}
+
+Value cloneExtensionBlock(PatternRewriter &rewriter, Block *block,
+                          ValueRange args) {
+  args = args.take_front(block->getNumArguments());
+  BlockAndValueMapping mapper;
+  mapper.map(block->getArguments().take_front(args.size()), args);
+  for (Operation &op : block->without_terminator())
+    rewriter.clone(op, mapper);
+
+  graphblas::YieldOp yield =
+      llvm::cast<graphblas::YieldOp>(block->getTerminator());
+  return mapper.lookupOrDefault(yield.values().front());
+}
+
 LogicalResult populateUnary(OpBuilder &builder, Location loc, StringRef unaryOp,
                             Type valueType, RegionRange regions,
                             graphblas::YieldKind yieldKind, bool boolAsI8) {
@@ -1290,6 +1832,9 @@ LogicalResult populateBinary(OpBuilder &builder, Location loc,
   return success();
 }
 
+// Marks the yield of an "any" monoid block
+static const char *anyMonoidAttr = "graphblas.any";
+
 LogicalResult populateMonoid(OpBuilder &builder, Location loc,
                              StringRef monoidOp, Type valueType,
                              RegionRange regions,
@@ -1424,11 +1969,22 @@ LogicalResult populateMonoid(OpBuilder &builder, Location loc,
                    });
   }
 
-  builder.create<graphblas::YieldOp>(loc, yieldKind, opResult);
+  graphblas::YieldOp yield =
+      builder.create<graphblas::YieldOp>(loc, yieldKind, opResult);
+  if (monoidOp == "any")
+    yield->setAttr(anyMonoidAttr, builder.getUnitAttr());
 
   return success();
 }
 
+// Whether `block` was populated as the "any" monoid. Its body is the same as
+// the "second" binary op, but any entry may be returned, so lowerings are free
+// to stop at the first one they find.
+bool isAnyMonoidBlock(Block *block) {
+  Operation *terminator = block->getTerminator();
+  return terminator && terminator->hasAttr(anyMonoidAttr);
+}
+
 LogicalResult populateSemiring(OpBuilder &builder, Location loc,
                                StringRef semiringOp, Type valueType,
                                RegionRange regions) {
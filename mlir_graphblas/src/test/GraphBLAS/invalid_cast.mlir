@@ -20,24 +20,3 @@ module {
         return %answer : tensor<?x?xi64, #CSC64>
     }
 }
-
-// -----
-
-#CV64 = #sparse_tensor.encoding<{
-  dimLevelType = [ "compressed" ],
-  pointerBitWidth = 64,
-  indexBitWidth = 64
-}>
-
-#CV32 = #sparse_tensor.encoding<{
-  dimLevelType = [ "compressed" ],
-  pointerBitWidth = 32,
-  indexBitWidth = 32
-}>
-
-module {
-    func @cast(%v: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV32> {
-        %answer = graphblas.cast %v : tensor<?xf64, #CV64> to tensor<?xf64, #CV32> // expected-error {{Changing bit width is not yet supported. Input and output pointer bit widths do not match: 64!=32}}
-        return %answer : tensor<?xf64, #CV32>
-    }
-}
\ No newline at end of file
@@ -0,0 +1,90 @@
+// RUN: graphblas-opt %s -split-input-file -verify-diagnostics
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+    func @from_coo(%indices: tensor<?x1xindex>, %values: tensor<?xf64>, %size: index) -> tensor<?xf64, #CV64> {
+        %answer = graphblas.from_coo %indices, %values [%size] : tensor<?x1xindex>, tensor<?xf64> to tensor<?xf64, #CV64> { // expected-error {{accumulate block must take two arguments of the value type.}}
+          ^bb0(%a : f32, %b : f32):
+            %result = arith.addf %a, %b : f32
+            graphblas.yield accumulate %result : f32
+        }
+        return %answer : tensor<?xf64, #CV64>
+    }
+}
+
+// -----
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+    func @from_coo(%indices: tensor<?x1xindex>, %values: tensor<?xf64>, %size: index) -> tensor<?xf64, #CV64> {
+        %answer = graphblas.from_coo %indices, %values [%size] : tensor<?x1xindex>, tensor<?xf64> to tensor<?xf64, #CV64> { // expected-error {{accumulate block must yield one value of the value type.}}
+          ^bb0(%a : f64, %b : f64):
+            %result = arith.fptosi %a : f64 to i64
+            graphblas.yield accumulate %result : i64
+        }
+        return %answer : tensor<?xf64, #CV64>
+    }
+}
+
+// -----
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+    func @from_coo(%indices: tensor<?x1xindex>, %values: tensor<?xf64>, %size: index) -> tensor<?xf64, #CV64> {
+        %answer = graphblas.from_coo %indices, %values [%size] : tensor<?x1xindex>, tensor<?xf64> to tensor<?xf64, #CV64> { // expected-error {{accumulate block must end in yield accumulate.}}
+          ^bb0(%a : f64, %b : f64):
+            %result = arith.addf %a, %b : f64
+            graphblas.yield mult %result : f64
+        }
+        return %answer : tensor<?xf64, #CV64>
+    }
+}
+
+// -----
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+    func @from_coo(%indices: tensor<?x1xindex>, %values: tensor<?xf64>, %size: index) -> tensor<?xf64, #CV64> {
+        %answer = graphblas.from_coo %indices, %values [%size] { accumulate_operator = "minus" } : tensor<?x1xindex>, tensor<?xf64> to tensor<?xf64, #CV64> // expected-error {{"minus" is not a supported accumulate operator.}}
+        return %answer : tensor<?xf64, #CV64>
+    }
+}
+
+// -----
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+    func @from_coo(%indices: tensor<?x1xindex>, %values: tensor<?xf64>, %size: index) -> tensor<?xf64, #CV64> {
+        %answer = graphblas.from_coo %indices, %values [%size] { accumulate_operator = "plus" } : tensor<?x1xindex>, tensor<?xf64> to tensor<?xf64, #CV64> { // expected-error {{Cannot have both an accumulate_operator and an accumulate block.}}
+          ^bb0(%a : f64, %b : f64):
+            %result = arith.addf %a, %b : f64
+            graphblas.yield accumulate %result : f64
+        }
+        return %answer : tensor<?xf64, #CV64>
+    }
+}
@@ -155,3 +155,29 @@ func @matrix_multiply_plus_times(%vecA: tensor<?xf64, #CV64>, %vecB: tensor<?xf6
     return %answer : tensor<?xf64, #CV64>
 }
  
+
+// -----
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#BV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+func @matrix_vector_multiply_float_bitmap_mask(%matrix: tensor<?x?xf64, #CSR64>, %vector: tensor<?xf64, #CV64>, %mask: tensor<?xf64, #BV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply %matrix, %vector, %mask { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>, tensor<?xf64, #BV64>) to tensor<?xf64, #CV64> // expected-error {{3rd operand (mask) must have an integer element type when it is a bitmap, i.e. has dimLevelType = [ "dense" ].}}
+    return %answer : tensor<?xf64, #CV64>
+}
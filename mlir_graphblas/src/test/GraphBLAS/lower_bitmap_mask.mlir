@@ -0,0 +1,123 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#BV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// A bitmap mask is probed by index; its structure is never loaded or merged.
+// The count pass and the copy pass both test the mask value at the index of
+// every input entry
+
+// CHECK-LABEL:   func @select_mask_bitmap(
+// CHECK-SAME:                             %[[ARG0:.*]]: tensor<?xf64, #{{.*}}>,
+// CHECK-SAME:                             %[[ARG1:.*]]: tensor<?xi8, #{{.*}}>)
+// CHECK-NOT:       sparse_tensor.pointers %[[ARG1]]
+// CHECK-NOT:       sparse_tensor.indices %[[ARG1]]
+// CHECK:           %[[LI:.*]] = sparse_tensor.indices %[[ARG0]], %{{.*}} : tensor<?xf64, #{{.*}}> to memref<?xi64>
+// CHECK:           %[[LX:.*]] = sparse_tensor.values %[[ARG0]] : tensor<?xf64, #{{.*}}> to memref<?xf64>
+// CHECK:           %[[MX:.*]] = sparse_tensor.values %[[ARG1]] : tensor<?xi8, #{{.*}}> to memref<?xi8>
+// CHECK:           scf.parallel (%[[POS:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) init (%{{.*}}) -> i64 {
+// CHECK:             %[[IDX64:.*]] = memref.load %[[LI]]{{\[}}%[[POS]]] : memref<?xi64>
+// CHECK:             %[[IDX:.*]] = arith.index_cast %[[IDX64]] : i64 to index
+// CHECK:             %[[BIT:.*]] = memref.load %[[MX]]{{\[}}%[[IDX]]] : memref<?xi8>
+// CHECK:             %[[KEEP:.*]] = arith.cmpi ne, %[[BIT]], %{{.*}} : i8
+// CHECK:             %[[COUNT:.*]] = select %[[KEEP]], %{{.*}}, %{{.*}} : i64
+// CHECK:             scf.reduce(%[[COUNT]])
+// CHECK-NOT:       memref.alloc
+// CHECK:           scf.for %[[POS2:.*]] = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[POSO:.*]] = %{{.*}}) -> (index) {
+// CHECK:             %[[IDX64_2:.*]] = memref.load %[[LI]]{{\[}}%[[POS2]]] : memref<?xi64>
+// CHECK:             %[[IDX_2:.*]] = arith.index_cast %[[IDX64_2]] : i64 to index
+// CHECK:             %[[BIT_2:.*]] = memref.load %[[MX]]{{\[}}%[[IDX_2]]] : memref<?xi8>
+// CHECK:             %[[KEEP_2:.*]] = arith.cmpi ne, %[[BIT_2]], %{{.*}} : i8
+// CHECK:             %[[NEXT:.*]] = scf.if %[[KEEP_2]] -> (index) {
+// CHECK:               %[[VAL:.*]] = memref.load %[[LX]]{{\[}}%[[POS2]]] : memref<?xf64>
+// CHECK:               memref.store %[[IDX64_2]], %{{.*}}{{\[}}%[[POSO]]] : memref<?xi64>
+// CHECK:               memref.store %[[VAL]], %{{.*}}{{\[}}%[[POSO]]] : memref<?xf64>
+// CHECK:               scf.yield %{{.*}} : index
+// CHECK:             } else {
+// CHECK:               scf.yield %[[POSO]] : index
+// CHECK:             }
+// CHECK:             scf.yield %[[NEXT]] : index
+// CHECK:           }
+// CHECK-NOT:       memref.alloc
+// CHECK:           return
+
+func @select_mask_bitmap(%v: tensor<?xf64, #CV64>, %m: tensor<?xi8, #BV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.select_mask %v, %m : tensor<?xf64, #CV64>, tensor<?xi8, #BV64> to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
+
+// Complementing a bitmap mask flips the probed bit
+
+// CHECK-LABEL:   func @select_mask_bitmap_complement(
+// CHECK-SAME:                                        %[[ARG0:.*]]: tensor<?xf64, #{{.*}}>,
+// CHECK-SAME:                                        %[[ARG1:.*]]: tensor<?xi8, #{{.*}}>)
+// CHECK:           %[[MX:.*]] = sparse_tensor.values %[[ARG1]] : tensor<?xi8, #{{.*}}> to memref<?xi8>
+// CHECK:           scf.parallel
+// CHECK:             %[[BIT:.*]] = memref.load %[[MX]]{{\[}}%{{.*}}] : memref<?xi8>
+// CHECK:             %[[SET:.*]] = arith.cmpi ne, %[[BIT]], %{{.*}} : i8
+// CHECK:             %[[KEEP:.*]] = arith.xori %[[SET]], %{{.*}} : i1
+// CHECK:             select %[[KEEP]], %{{.*}}, %{{.*}} : i64
+// CHECK:           scf.for
+// CHECK:             %[[BIT_2:.*]] = memref.load %[[MX]]{{\[}}%{{.*}}] : memref<?xi8>
+// CHECK:             %[[SET_2:.*]] = arith.cmpi ne, %[[BIT_2]], %{{.*}} : i8
+// CHECK:             %[[KEEP_2:.*]] = arith.xori %[[SET_2]], %{{.*}} : i1
+// CHECK:             scf.if %[[KEEP_2]] -> (index) {
+// CHECK:           return
+
+func @select_mask_bitmap_complement(%v: tensor<?xf64, #CV64>, %m: tensor<?xi8, #BV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.select_mask %v, %m {mask_complement = true} : tensor<?xf64, #CV64>, tensor<?xi8, #BV64> to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
+
+// Inner products skip the output indices outside of the (complemented) mask
+// like empty rows of A
+
+// CHECK-LABEL:   func @matrix_vector_multiply_bitmap_complement(
+// CHECK-SAME:                                                   %[[ARG0:.*]]: tensor<?x?xf64, #{{.*}}>,
+// CHECK-SAME:                                                   %[[ARG1:.*]]: tensor<?xf64, #{{.*}}>,
+// CHECK-SAME:                                                   %[[ARG2:.*]]: tensor<?xi8, #{{.*}}>)
+// CHECK-NOT:       sparse_tensor.pointers %[[ARG2]]
+// CHECK-NOT:       sparse_tensor.indices %[[ARG2]]
+// CHECK:           %[[MX:.*]] = sparse_tensor.values %[[ARG2]] : tensor<?xi8, #{{.*}}> to memref<?xi8>
+// CHECK:           scf.parallel
+// CHECK:             %[[BIT:.*]] = memref.load %[[MX]]{{\[}}%{{.*}}] : memref<?xi8>
+// CHECK:             arith.cmpi ne, %[[BIT]], %{{.*}} : i8
+// CHECK:             %[[SKIP:.*]] = arith.ori %{{.*}}, %{{.*}} : i1
+// CHECK:             scf.if %[[SKIP]] -> (i64) {
+// CHECK:           scf.for
+// CHECK:           return
+
+func @matrix_vector_multiply_bitmap_complement(%a: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %m: tensor<?xi8, #BV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply %a, %v, %m { semiring = "plus_times", mask_complement = true } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>, tensor<?xi8, #BV64>) to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
+
+// CHECK-LABEL:   func @reduce_to_vector_bitmap(
+// CHECK-SAME:                                  %[[ARG0:.*]]: tensor<?x?xf64, #{{.*}}>,
+// CHECK-SAME:                                  %[[ARG1:.*]]: tensor<?xi64, #{{.*}}>)
+// CHECK-NOT:       sparse_tensor.indices %[[ARG1]]
+// CHECK:           %[[MX:.*]] = sparse_tensor.values %[[ARG1]] : tensor<?xi64, #{{.*}}> to memref<?xi64>
+// CHECK:           %[[BIT:.*]] = memref.load %[[MX]]{{\[}}%{{.*}}] : memref<?xi64>
+// CHECK:           arith.cmpi ne, %[[BIT]], %{{.*}} : i64
+// CHECK:           return
+
+func @reduce_to_vector_bitmap(%a: tensor<?x?xf64, #CSR64>, %m: tensor<?xi64, #BV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.reduce_to_vector %a, %m { aggregator = "plus", axis = 1 } : tensor<?x?xf64, #CSR64>, tensor<?xi64, #BV64> to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
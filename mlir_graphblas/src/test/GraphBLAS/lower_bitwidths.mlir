@@ -0,0 +1,75 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR32 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 32,
+  indexBitWidth = 32
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV32 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 32,
+  indexBitWidth = 32
+}>
+
+// CHECK-LABEL:   func @num_vals_csr32(
+// CHECK:           %[[PTRS:.*]] = sparse_tensor.pointers %{{.*}}, %{{.*}} : tensor<?x?xf64, {{.*}}pointerBitWidth = 32, indexBitWidth = 32 }>> to memref<?xi32>
+// CHECK:           %[[LAST:.*]] = memref.load %[[PTRS]]{{\[}}%{{.*}}] : memref<?xi32>
+// CHECK:           %[[WIDE:.*]] = arith.extui %[[LAST]] : i32 to i64
+// CHECK:           %[[NNZ:.*]] = arith.index_cast %[[WIDE]] : i64 to index
+// CHECK:           return %[[NNZ]] : index
+
+func @num_vals_csr32(%m: tensor<?x?xf64, #CSR32>) -> index {
+    %nnz = graphblas.num_vals %m : tensor<?x?xf64, #CSR32>
+    return %nnz : index
+}
+
+// Narrowing casts check that the pointers and indices fit before truncating
+// them
+
+// CHECK-LABEL:   func @cast_cv64_to_cv32(
+// CHECK:           %[[IP:.*]] = sparse_tensor.pointers %{{.*}}, %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           call @resize_pointers(
+// CHECK:           %[[OP:.*]] = sparse_tensor.pointers %{{.*}}, %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 32, indexBitWidth = 32 }>> to memref<?xi32>
+// CHECK:           %[[PTRS_FIT:.*]] = arith.cmpi ule, %{{.*}}, %{{.*}} : i64
+// CHECK:           assert %[[PTRS_FIT]], "graphblas.cast: too many values for the pointer bit width"
+// CHECK:           scf.parallel (%[[I:.*]]) =
+// CHECK:             %[[P:.*]] = memref.load %[[IP]]{{\[}}%[[I]]] : memref<?xi64>
+// CHECK:             %[[P32:.*]] = arith.trunci %[[P]] : i64 to i32
+// CHECK:             memref.store %[[P32]], %[[OP]]{{\[}}%[[I]]] : memref<?xi32>
+// CHECK:           call @resize_index(
+// CHECK:           %[[II:.*]] = sparse_tensor.indices %{{.*}}, %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[OI:.*]] = sparse_tensor.indices %{{.*}}, %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 32, indexBitWidth = 32 }>> to memref<?xi32>
+// CHECK:           %[[INDICES_FIT:.*]] = arith.cmpi ule, %{{.*}}, %{{.*}} : i64
+// CHECK:           assert %[[INDICES_FIT]], "graphblas.cast: dimension too large for the index bit width"
+// CHECK:           scf.parallel (%[[J:.*]]) =
+// CHECK:             %[[X:.*]] = memref.load %[[II]]{{\[}}%[[J]]] : memref<?xi64>
+// CHECK:             %[[X32:.*]] = arith.trunci %[[X]] : i64 to i32
+// CHECK:             memref.store %[[X32]], %[[OI]]{{\[}}%[[J]]] : memref<?xi32>
+// CHECK:           call @resize_values(
+// CHECK:           return %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 32, indexBitWidth = 32 }>>
+
+func @cast_cv64_to_cv32(%v: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV32> {
+    %answer = graphblas.cast %v : tensor<?xf64, #CV64> to tensor<?xf64, #CV32>
+    return %answer : tensor<?xf64, #CV32>
+}
+
+// Widening casts cannot truncate, so they need no checks
+
+// CHECK-LABEL:   func @cast_cv32_to_cv64(
+// CHECK-NOT:       assert
+// CHECK:           arith.extui %{{.*}} : i32 to i64
+// CHECK-NOT:       assert
+// CHECK:           return %{{.*}} : tensor<?xf64, {{.*}}pointerBitWidth = 64, indexBitWidth = 64 }>>
+
+func @cast_cv32_to_cv64(%v: tensor<?xf64, #CV32>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.cast %v : tensor<?xf64, #CV32> to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
@@ -16,10 +16,13 @@
 
 // CHECK-LABEL:   func @convert_layout(
 // CHECK-SAME:                         %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> {
-// CHECK:           %[[VAL_1:.*]] = arith.constant 0 : index
-// CHECK:           %[[VAL_2:.*]] = arith.constant 1 : index
-// CHECK:           %[[VAL_3:.*]] = arith.constant 0 : i64
-// CHECK:           %[[VAL_4:.*]] = arith.constant 1 : i64
+// CHECK-DAG:       %[[VAL_1:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[VAL_2:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[VAL_3:.*]] = arith.constant 0 : i64
+// CHECK-DAG:       %[[VAL_4:.*]] = arith.constant 1 : i64
+// CHECK-DAG:       %[[C64:.*]] = arith.constant 64 : index
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
+// CHECK-DAG:       %[[CBUDGET:.*]] = arith.constant 67108864 : index
 // CHECK:           %[[VAL_5:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_6:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_7:.*]] = sparse_tensor.values %[[VAL_0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
@@ -35,7 +38,7 @@
 // CHECK:           %[[VAL_17:.*]] = tensor.dim %[[VAL_16]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_18:.*]] = arith.addi %[[VAL_17]], %[[VAL_2]] : index
 // CHECK:           %[[VAL_19:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_16]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_19]], %[[VAL_2]], %[[VAL_18]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           call @resize_pointers_zeroed(%[[VAL_19]], %[[VAL_2]], %[[VAL_18]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_20:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_16]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
 // CHECK:           call @assign_rev(%[[VAL_20]], %[[VAL_1]], %[[VAL_2]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_21:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_16]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
@@ -56,53 +59,142 @@
 // CHECK:           %[[VAL_30:.*]] = sparse_tensor.pointers %[[VAL_29]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_31:.*]] = sparse_tensor.indices %[[VAL_29]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_32:.*]] = sparse_tensor.values %[[VAL_29]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           scf.for %[[VAL_33:.*]] = %[[VAL_1]] to %[[VAL_9]] step %[[VAL_2]] {
-// CHECK:             memref.store %[[VAL_3]], %[[VAL_30]]{{\[}}%[[VAL_33]]] : memref<?xi64>
+// CHECK:           %[[NOW:.*]] = arith.cmpi eq, %[[VAL_9]], %[[VAL_1]] : index
+// CHECK:           %[[WNZ:.*]] = select %[[NOW]], %[[VAL_2]], %[[VAL_9]] : index
+// CHECK:           %[[BUDGET:.*]] = arith.divui %[[CBUDGET]], %[[WNZ]] : index
+// CHECK:           %[[CMPB:.*]] = arith.cmpi ult, %[[BUDGET]], %[[C64]] : index
+// CHECK:           %[[MINB:.*]] = select %[[CMPB]], %[[BUDGET]], %[[C64]] : index
+// CHECK:           %[[DENS:.*]] = arith.divui %[[VAL_13]], %[[WNZ]] : index
+// CHECK:           %[[CMPD:.*]] = arith.cmpi ugt, %[[DENS]], %[[MINB]] : index
+// CHECK:           %[[MAXR:.*]] = select %[[CMPD]], %[[DENS]], %[[MINB]] : index
+// CHECK:           %[[CMPN:.*]] = arith.cmpi eq, %[[MAXR]], %[[VAL_1]] : index
+// CHECK:           %[[MAXB:.*]] = select %[[CMPN]], %[[VAL_2]], %[[MAXR]] : index
+// CHECK:           %[[CMPM:.*]] = arith.cmpi ult, %[[MAXB]], %[[C256]] : index
+// CHECK:           %[[NBLK:.*]] = select %[[CMPM]], %[[MAXB]], %[[C256]] : index
+// CHECK:           %[[NRM1:.*]] = arith.subi %[[VAL_8]], %[[VAL_2]] : index
+// CHECK:           %[[BSN:.*]] = arith.addi %[[NRM1]], %[[NBLK]] : index
+// CHECK:           %[[BSR:.*]] = arith.divui %[[BSN]], %[[NBLK]] : index
+// CHECK:           %[[BSE:.*]] = arith.cmpi eq, %[[BSR]], %[[VAL_1]] : index
+// CHECK:           %[[BS:.*]] = select %[[BSE]], %[[VAL_2]], %[[BSR]] : index
+// CHECK:           %[[BSM1:.*]] = arith.subi %[[BS]], %[[VAL_2]] : index
+// CHECK:           %[[NBN:.*]] = arith.addi %[[VAL_8]], %[[BSM1]] : index
+// CHECK:           %[[NB:.*]] = arith.divui %[[NBN]], %[[BS]] : index
+// CHECK:           %[[CSZ:.*]] = arith.muli %[[NB]], %[[VAL_9]] : index
+// CHECK:           %[[COUNTS:.*]] = memref.alloc(%[[CSZ]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[BLK1:.*]]) = (%[[VAL_1]]) to (%[[NB]]) step (%[[VAL_2]]) {
+// CHECK:             %[[BOFF1:.*]] = arith.muli %[[BLK1]], %[[VAL_9]] : index
+// CHECK:             %[[BOFFE1:.*]] = arith.addi %[[BOFF1]], %[[VAL_9]] : index
+// CHECK:             scf.for %[[CI:.*]] = %[[BOFF1]] to %[[BOFFE1]] step %[[VAL_2]] {
+// CHECK:               memref.store %[[VAL_3]], %[[COUNTS]]{{\[}}%[[CI]]] : memref<?xi64>
+// CHECK:             }
+// CHECK:             %[[RS1:.*]] = arith.muli %[[BLK1]], %[[BS]] : index
+// CHECK:             %[[REF1:.*]] = arith.addi %[[RS1]], %[[BS]] : index
+// CHECK:             %[[REC1:.*]] = arith.cmpi ult, %[[REF1]], %[[VAL_8]] : index
+// CHECK:             %[[RE1:.*]] = select %[[REC1]], %[[REF1]], %[[VAL_8]] : index
+// CHECK:             scf.for %[[ROW1:.*]] = %[[RS1]] to %[[RE1]] step %[[VAL_2]] {
+// CHECK:               %[[JS64_1:.*]] = memref.load %[[VAL_5]]{{\[}}%[[ROW1]]] : memref<?xi64>
+// CHECK:               %[[JS1:.*]] = arith.index_cast %[[JS64_1]] : i64 to index
+// CHECK:               %[[RP1_1:.*]] = arith.addi %[[ROW1]], %[[VAL_2]] : index
+// CHECK:               %[[JE64_1:.*]] = memref.load %[[VAL_5]]{{\[}}%[[RP1_1]]] : memref<?xi64>
+// CHECK:               %[[JE1:.*]] = arith.index_cast %[[JE64_1]] : i64 to index
+// CHECK:               scf.for %[[JJ1:.*]] = %[[JS1]] to %[[JE1]] step %[[VAL_2]] {
+// CHECK:                 %[[COL64_1:.*]] = memref.load %[[VAL_6]]{{\[}}%[[JJ1]]] : memref<?xi64>
+// CHECK:                 %[[COL1:.*]] = arith.index_cast %[[COL64_1]] : i64 to index
+// CHECK:                 %[[CPOS1:.*]] = arith.addi %[[BOFF1]], %[[COL1]] : index
+// CHECK:                 %[[CNT1:.*]] = memref.load %[[COUNTS]]{{\[}}%[[CPOS1]]] : memref<?xi64>
+// CHECK:                 %[[CNTP1:.*]] = arith.addi %[[CNT1]], %[[VAL_4]] : i64
+// CHECK:                 memref.store %[[CNTP1]], %[[COUNTS]]{{\[}}%[[CPOS1]]] : memref<?xi64>
+// CHECK:               }
+// CHECK:             }
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           scf.parallel (%[[COL2:.*]]) = (%[[VAL_1]]) to (%[[VAL_9]]) step (%[[VAL_2]]) {
+// CHECK:             %[[COLTOT:.*]] = scf.for %[[BLK2:.*]] = %[[VAL_1]] to %[[NB]] step %[[VAL_2]] iter_args(%[[COFF:.*]] = %[[VAL_3]]) -> (i64) {
+// CHECK:               %[[BOFF2:.*]] = arith.muli %[[BLK2]], %[[VAL_9]] : index
+// CHECK:               %[[CPOS2:.*]] = arith.addi %[[BOFF2]], %[[COL2]] : index
+// CHECK:               %[[CNT2:.*]] = memref.load %[[COUNTS]]{{\[}}%[[CPOS2]]] : memref<?xi64>
+// CHECK:               memref.store %[[COFF]], %[[COUNTS]]{{\[}}%[[CPOS2]]] : memref<?xi64>
+// CHECK:               %[[NCOFF:.*]] = arith.addi %[[COFF]], %[[CNT2]] : i64
+// CHECK:               scf.yield %[[NCOFF]] : i64
+// CHECK:             }
+// CHECK:             memref.store %[[COLTOT]], %[[VAL_30]]{{\[}}%[[COL2]]] : memref<?xi64>
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           scf.for %[[VAL_34:.*]] = %[[VAL_1]] to %[[VAL_13]] step %[[VAL_2]] {
-// CHECK:             %[[VAL_35:.*]] = memref.load %[[VAL_6]]{{\[}}%[[VAL_34]]] : memref<?xi64>
-// CHECK:             %[[VAL_36:.*]] = arith.index_cast %[[VAL_35]] : i64 to index
-// CHECK:             %[[VAL_37:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_36]]] : memref<?xi64>
-// CHECK:             %[[VAL_38:.*]] = arith.addi %[[VAL_37]], %[[VAL_4]] : i64
-// CHECK:             memref.store %[[VAL_38]], %[[VAL_30]]{{\[}}%[[VAL_36]]] : memref<?xi64>
+// CHECK:           %[[NRM1_S:.*]] = arith.subi %[[VAL_9]], %[[VAL_2]] : index
+// CHECK:           %[[BSN_S:.*]] = arith.addi %[[NRM1_S]], %[[C256]] : index
+// CHECK:           %[[BSR_S:.*]] = arith.divui %[[BSN_S]], %[[C256]] : index
+// CHECK:           %[[BSE_S:.*]] = arith.cmpi eq, %[[BSR_S]], %[[VAL_1]] : index
+// CHECK:           %[[BS_S:.*]] = select %[[BSE_S]], %[[VAL_2]], %[[BSR_S]] : index
+// CHECK:           %[[BSM1_S:.*]] = arith.subi %[[BS_S]], %[[VAL_2]] : index
+// CHECK:           %[[NBN_S:.*]] = arith.addi %[[VAL_9]], %[[BSM1_S]] : index
+// CHECK:           %[[NB_S:.*]] = arith.divui %[[NBN_S]], %[[BS_S]] : index
+// CHECK:           %[[BT_S:.*]] = memref.alloc(%[[NB_S]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB1_S:.*]]) = (%[[VAL_1]]) to (%[[NB_S]]) step (%[[VAL_2]]) {
+// CHECK:             %[[RS1_S:.*]] = arith.muli %[[SB1_S]], %[[BS_S]] : index
+// CHECK:             %[[REF1_S:.*]] = arith.addi %[[RS1_S]], %[[BS_S]] : index
+// CHECK:             %[[REC1_S:.*]] = arith.cmpi ult, %[[REF1_S]], %[[VAL_9]] : index
+// CHECK:             %[[RE1_S:.*]] = select %[[REC1_S]], %[[REF1_S]], %[[VAL_9]] : index
+// CHECK:             %[[PSUM_S:.*]] = scf.for %[[SI1_S:.*]] = %[[RS1_S]] to %[[RE1_S]] step %[[VAL_2]] iter_args(%[[PS_S:.*]] = %[[VAL_3]]) -> (i64) {
+// CHECK:               %[[SV1_S:.*]] = memref.load %[[VAL_30]]{{\[}}%[[SI1_S]]] : memref<?xi64>
+// CHECK:               %[[PSN_S:.*]] = arith.addi %[[PS_S]], %[[SV1_S]] : i64
+// CHECK:               scf.yield %[[PSN_S]] : i64
+// CHECK:             }
+// CHECK:             memref.store %[[PSUM_S]], %[[BT_S]]{{\[}}%[[SB1_S]]] : memref<?xi64>
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           memref.store %[[VAL_3]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
-// CHECK:           scf.for %[[VAL_39:.*]] = %[[VAL_1]] to %[[VAL_9]] step %[[VAL_2]] {
-// CHECK:             %[[VAL_40:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_39]]] : memref<?xi64>
-// CHECK:             %[[VAL_41:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_41]], %[[VAL_30]]{{\[}}%[[VAL_39]]] : memref<?xi64>
-// CHECK:             %[[VAL_42:.*]] = arith.addi %[[VAL_41]], %[[VAL_40]] : i64
-// CHECK:             memref.store %[[VAL_42]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
+// CHECK:           %[[TOTAL_S:.*]] = scf.for %[[SBB_S:.*]] = %[[VAL_1]] to %[[NB_S]] step %[[VAL_2]] iter_args(%[[BASE_S:.*]] = %[[VAL_3]]) -> (i64) {
+// CHECK:             %[[BTV_S:.*]] = memref.load %[[BT_S]]{{\[}}%[[SBB_S]]] : memref<?xi64>
+// CHECK:             memref.store %[[BASE_S]], %[[BT_S]]{{\[}}%[[SBB_S]]] : memref<?xi64>
+// CHECK:             %[[BASEN_S:.*]] = arith.addi %[[BASE_S]], %[[BTV_S]] : i64
+// CHECK:             scf.yield %[[BASEN_S]] : i64
 // CHECK:           }
-// CHECK:           scf.for %[[VAL_43:.*]] = %[[VAL_1]] to %[[VAL_8]] step %[[VAL_2]] {
-// CHECK:             %[[VAL_44:.*]] = arith.index_cast %[[VAL_43]] : index to i64
-// CHECK:             %[[VAL_45:.*]] = memref.load %[[VAL_5]]{{\[}}%[[VAL_43]]] : memref<?xi64>
-// CHECK:             %[[VAL_46:.*]] = arith.index_cast %[[VAL_45]] : i64 to index
-// CHECK:             %[[VAL_47:.*]] = arith.addi %[[VAL_43]], %[[VAL_2]] : index
-// CHECK:             %[[VAL_48:.*]] = memref.load %[[VAL_5]]{{\[}}%[[VAL_47]]] : memref<?xi64>
-// CHECK:             %[[VAL_49:.*]] = arith.index_cast %[[VAL_48]] : i64 to index
-// CHECK:             scf.for %[[VAL_50:.*]] = %[[VAL_46]] to %[[VAL_49]] step %[[VAL_2]] {
-// CHECK:               %[[VAL_51:.*]] = memref.load %[[VAL_6]]{{\[}}%[[VAL_50]]] : memref<?xi64>
-// CHECK:               %[[VAL_52:.*]] = arith.index_cast %[[VAL_51]] : i64 to index
-// CHECK:               %[[VAL_53:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_52]]] : memref<?xi64>
-// CHECK:               %[[VAL_54:.*]] = arith.index_cast %[[VAL_53]] : i64 to index
-// CHECK:               memref.store %[[VAL_44]], %[[VAL_31]]{{\[}}%[[VAL_54]]] : memref<?xi64>
-// CHECK:               %[[VAL_55:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_50]]] : memref<?xf64>
-// CHECK:               memref.store %[[VAL_55]], %[[VAL_32]]{{\[}}%[[VAL_54]]] : memref<?xf64>
-// CHECK:               %[[VAL_56:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_52]]] : memref<?xi64>
-// CHECK:               %[[VAL_57:.*]] = arith.addi %[[VAL_56]], %[[VAL_4]] : i64
-// CHECK:               memref.store %[[VAL_57]], %[[VAL_30]]{{\[}}%[[VAL_52]]] : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB3_S:.*]]) = (%[[VAL_1]]) to (%[[NB_S]]) step (%[[VAL_2]]) {
+// CHECK:             %[[RS3_S:.*]] = arith.muli %[[SB3_S]], %[[BS_S]] : index
+// CHECK:             %[[REF3_S:.*]] = arith.addi %[[RS3_S]], %[[BS_S]] : index
+// CHECK:             %[[REC3_S:.*]] = arith.cmpi ult, %[[REF3_S]], %[[VAL_9]] : index
+// CHECK:             %[[RE3_S:.*]] = select %[[REC3_S]], %[[REF3_S]], %[[VAL_9]] : index
+// CHECK:             %[[SBASE_S:.*]] = memref.load %[[BT_S]]{{\[}}%[[SB3_S]]] : memref<?xi64>
+// CHECK:             %[[SCAN_S:.*]] = scf.for %[[SI3_S:.*]] = %[[RS3_S]] to %[[RE3_S]] step %[[VAL_2]] iter_args(%[[CS_S:.*]] = %[[SBASE_S]]) -> (i64) {
+// CHECK:               %[[SV3_S:.*]] = memref.load %[[VAL_30]]{{\[}}%[[SI3_S]]] : memref<?xi64>
+// CHECK:               memref.store %[[CS_S]], %[[VAL_30]]{{\[}}%[[SI3_S]]] : memref<?xi64>
+// CHECK:               %[[CSN_S:.*]] = arith.addi %[[CS_S]], %[[SV3_S]] : i64
+// CHECK:               scf.yield %[[CSN_S]] : i64
 // CHECK:             }
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           %[[VAL_58:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
-// CHECK:           memref.store %[[VAL_3]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
-// CHECK:           scf.for %[[VAL_59:.*]] = %[[VAL_1]] to %[[VAL_9]] step %[[VAL_2]] {
-// CHECK:             %[[VAL_60:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_59]]] : memref<?xi64>
-// CHECK:             %[[VAL_61:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_61]], %[[VAL_30]]{{\[}}%[[VAL_59]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_60]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
+// CHECK:           memref.dealloc %[[BT_S]] : memref<?xi64>
+// CHECK:           memref.store %[[TOTAL_S]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
+// CHECK:           scf.parallel (%[[BLK3:.*]]) = (%[[VAL_1]]) to (%[[NB]]) step (%[[VAL_2]]) {
+// CHECK:             %[[BOFF3:.*]] = arith.muli %[[BLK3]], %[[VAL_9]] : index
+// CHECK:             %[[RS3:.*]] = arith.muli %[[BLK3]], %[[BS]] : index
+// CHECK:             %[[REF3:.*]] = arith.addi %[[RS3]], %[[BS]] : index
+// CHECK:             %[[REC3:.*]] = arith.cmpi ult, %[[REF3]], %[[VAL_8]] : index
+// CHECK:             %[[RE3:.*]] = select %[[REC3]], %[[REF3]], %[[VAL_8]] : index
+// CHECK:             scf.for %[[ROW3:.*]] = %[[RS3]] to %[[RE3]] step %[[VAL_2]] {
+// CHECK:               %[[ROW64:.*]] = arith.index_cast %[[ROW3]] : index to i64
+// CHECK:               %[[JS64_3:.*]] = memref.load %[[VAL_5]]{{\[}}%[[ROW3]]] : memref<?xi64>
+// CHECK:               %[[JS3:.*]] = arith.index_cast %[[JS64_3]] : i64 to index
+// CHECK:               %[[RP1_3:.*]] = arith.addi %[[ROW3]], %[[VAL_2]] : index
+// CHECK:               %[[JE64_3:.*]] = memref.load %[[VAL_5]]{{\[}}%[[RP1_3]]] : memref<?xi64>
+// CHECK:               %[[JE3:.*]] = arith.index_cast %[[JE64_3]] : i64 to index
+// CHECK:               scf.for %[[JJ3:.*]] = %[[JS3]] to %[[JE3]] step %[[VAL_2]] {
+// CHECK:                 %[[COL64_3:.*]] = memref.load %[[VAL_6]]{{\[}}%[[JJ3]]] : memref<?xi64>
+// CHECK:                 %[[COL3:.*]] = arith.index_cast %[[COL64_3]] : i64 to index
+// CHECK:                 %[[CPOS3:.*]] = arith.addi %[[BOFF3]], %[[COL3]] : index
+// CHECK:                 %[[CSTART:.*]] = memref.load %[[VAL_30]]{{\[}}%[[COL3]]] : memref<?xi64>
+// CHECK:                 %[[BPOS:.*]] = memref.load %[[COUNTS]]{{\[}}%[[CPOS3]]] : memref<?xi64>
+// CHECK:                 %[[DEST64:.*]] = arith.addi %[[CSTART]], %[[BPOS]] : i64
+// CHECK:                 %[[DEST:.*]] = arith.index_cast %[[DEST64]] : i64 to index
+// CHECK:                 memref.store %[[ROW64]], %[[VAL_31]]{{\[}}%[[DEST]]] : memref<?xi64>
+// CHECK:                 %[[AXV:.*]] = memref.load %[[VAL_7]]{{\[}}%[[JJ3]]] : memref<?xf64>
+// CHECK:                 memref.store %[[AXV]], %[[VAL_32]]{{\[}}%[[DEST]]] : memref<?xf64>
+// CHECK:                 %[[BPOS1:.*]] = arith.addi %[[BPOS]], %[[VAL_4]] : i64
+// CHECK:                 memref.store %[[BPOS1]], %[[COUNTS]]{{\[}}%[[CPOS3]]] : memref<?xi64>
+// CHECK:               }
+// CHECK:             }
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           memref.store %[[VAL_58]], %[[VAL_30]]{{\[}}%[[VAL_9]]] : memref<?xi64>
+// CHECK:           memref.dealloc %[[COUNTS]] : memref<?xi64>
 // CHECK:           return %[[VAL_29]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:         }
 func @convert_layout(%sparse_tensor: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSC64> {
@@ -27,7 +27,7 @@
 // CHECK:           %[[VAL_9:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_10:.*]] = sparse_tensor.init{{\[}}%[[VAL_9]]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_11:.*]] = call @vector_f64_p64i64_to_ptr8(%[[VAL_10]]) : (tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_11]], %[[VAL_2]], %[[VAL_3]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           call @resize_pointers_zeroed(%[[VAL_11]], %[[VAL_2]], %[[VAL_3]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_12:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_2]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_13:.*]] = memref.load %[[VAL_12]]{{\[}}%[[VAL_4]]] : memref<?xi64>
 // CHECK:           %[[VAL_14:.*]] = arith.index_cast %[[VAL_13]] : i64 to index
@@ -138,19 +138,20 @@ func @vector_intersect(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>) -> te
 // CHECK-LABEL:   func @matrix_intersect(
 // CHECK-SAME:                           %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
 // CHECK-SAME:                           %[[VAL_1:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> {
-// CHECK:           %[[VAL_2:.*]] = arith.constant 0 : index
-// CHECK:           %[[VAL_3:.*]] = arith.constant 1 : index
-// CHECK:           %[[VAL_4:.*]] = arith.constant 0 : i64
-// CHECK:           %[[VAL_5:.*]] = arith.constant false
-// CHECK:           %[[VAL_6:.*]] = arith.constant true
-// CHECK:           %[[VAL_7:.*]] = arith.constant -1.000000e+00 : f64
+// CHECK-DAG:       %[[VAL_2:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[VAL_3:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[VAL_4:.*]] = arith.constant 0 : i64
+// CHECK-DAG:       %[[VAL_5:.*]] = arith.constant false
+// CHECK-DAG:       %[[VAL_6:.*]] = arith.constant true
+// CHECK-DAG:       %[[VAL_7:.*]] = arith.constant -1.000000e+00 : f64
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
 // CHECK:           %[[VAL_8:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_9:.*]] = tensor.dim %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_10:.*]] = sparse_tensor.init{{\[}}%[[VAL_8]], %[[VAL_9]]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_11:.*]] = tensor.dim %[[VAL_10]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_12:.*]] = arith.addi %[[VAL_11]], %[[VAL_3]] : index
 // CHECK:           %[[VAL_13:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_10]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_13]], %[[VAL_3]], %[[VAL_12]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           call @resize_pointers_zeroed(%[[VAL_13]], %[[VAL_3]], %[[VAL_12]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_14:.*]] = tensor.dim %[[VAL_10]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_15:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_16:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
@@ -219,14 +220,50 @@ func @vector_intersect(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>) -> te
 // CHECK:             memref.store %[[VAL_73:.*]], %[[VAL_21]]{{\[}}%[[VAL_22]]] : memref<?xi64>
 // CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           memref.store %[[VAL_4]], %[[VAL_21]]{{\[}}%[[VAL_14]]] : memref<?xi64>
-// CHECK:           scf.for %[[VAL_74:.*]] = %[[VAL_2]] to %[[VAL_14]] step %[[VAL_3]] {
-// CHECK:             %[[VAL_75:.*]] = memref.load %[[VAL_21]]{{\[}}%[[VAL_74]]] : memref<?xi64>
-// CHECK:             %[[VAL_76:.*]] = memref.load %[[VAL_21]]{{\[}}%[[VAL_14]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_76]], %[[VAL_21]]{{\[}}%[[VAL_74]]] : memref<?xi64>
-// CHECK:             %[[VAL_77:.*]] = arith.addi %[[VAL_76]], %[[VAL_75]] : i64
-// CHECK:             memref.store %[[VAL_77]], %[[VAL_21]]{{\[}}%[[VAL_14]]] : memref<?xi64>
+// CHECK:           %[[NRM1:.*]] = arith.subi %[[VAL_14]], %[[VAL_3]] : index
+// CHECK:           %[[BSN:.*]] = arith.addi %[[NRM1]], %[[C256]] : index
+// CHECK:           %[[BSR:.*]] = arith.divui %[[BSN]], %[[C256]] : index
+// CHECK:           %[[BSE:.*]] = arith.cmpi eq, %[[BSR]], %[[VAL_2]] : index
+// CHECK:           %[[BS:.*]] = select %[[BSE]], %[[VAL_3]], %[[BSR]] : index
+// CHECK:           %[[BSM1:.*]] = arith.subi %[[BS]], %[[VAL_3]] : index
+// CHECK:           %[[NBN:.*]] = arith.addi %[[VAL_14]], %[[BSM1]] : index
+// CHECK:           %[[NB:.*]] = arith.divui %[[NBN]], %[[BS]] : index
+// CHECK:           %[[BT:.*]] = memref.alloc(%[[NB]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB1:.*]]) = (%[[VAL_2]]) to (%[[NB]]) step (%[[VAL_3]]) {
+// CHECK:             %[[RS1:.*]] = arith.muli %[[SB1]], %[[BS]] : index
+// CHECK:             %[[REF1:.*]] = arith.addi %[[RS1]], %[[BS]] : index
+// CHECK:             %[[REC1:.*]] = arith.cmpi ult, %[[REF1]], %[[VAL_14]] : index
+// CHECK:             %[[RE1:.*]] = select %[[REC1]], %[[REF1]], %[[VAL_14]] : index
+// CHECK:             %[[PSUM:.*]] = scf.for %[[SI1:.*]] = %[[RS1]] to %[[RE1]] step %[[VAL_3]] iter_args(%[[PS:.*]] = %[[VAL_4]]) -> (i64) {
+// CHECK:               %[[SV1:.*]] = memref.load %[[VAL_21]]{{\[}}%[[SI1]]] : memref<?xi64>
+// CHECK:               %[[PSN:.*]] = arith.addi %[[PS]], %[[SV1]] : i64
+// CHECK:               scf.yield %[[PSN]] : i64
+// CHECK:             }
+// CHECK:             memref.store %[[PSUM]], %[[BT]]{{\[}}%[[SB1]]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[TOTAL:.*]] = scf.for %[[SBB:.*]] = %[[VAL_2]] to %[[NB]] step %[[VAL_3]] iter_args(%[[BASE:.*]] = %[[VAL_4]]) -> (i64) {
+// CHECK:             %[[BTV:.*]] = memref.load %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             memref.store %[[BASE]], %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             %[[BASEN:.*]] = arith.addi %[[BASE]], %[[BTV]] : i64
+// CHECK:             scf.yield %[[BASEN]] : i64
+// CHECK:           }
+// CHECK:           scf.parallel (%[[SB3:.*]]) = (%[[VAL_2]]) to (%[[NB]]) step (%[[VAL_3]]) {
+// CHECK:             %[[RS3:.*]] = arith.muli %[[SB3]], %[[BS]] : index
+// CHECK:             %[[REF3:.*]] = arith.addi %[[RS3]], %[[BS]] : index
+// CHECK:             %[[REC3:.*]] = arith.cmpi ult, %[[REF3]], %[[VAL_14]] : index
+// CHECK:             %[[RE3:.*]] = select %[[REC3]], %[[REF3]], %[[VAL_14]] : index
+// CHECK:             %[[SBASE:.*]] = memref.load %[[BT]]{{\[}}%[[SB3]]] : memref<?xi64>
+// CHECK:             %[[SCAN:.*]] = scf.for %[[SI3:.*]] = %[[RS3]] to %[[RE3]] step %[[VAL_3]] iter_args(%[[CS:.*]] = %[[SBASE]]) -> (i64) {
+// CHECK:               %[[SV3:.*]] = memref.load %[[VAL_21]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               memref.store %[[CS]], %[[VAL_21]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               %[[CSN:.*]] = arith.addi %[[CS]], %[[SV3]] : i64
+// CHECK:               scf.yield %[[CSN]] : i64
+// CHECK:             }
+// CHECK:             scf.yield
 // CHECK:           }
+// CHECK:           memref.dealloc %[[BT]] : memref<?xi64>
+// CHECK:           memref.store %[[TOTAL]], %[[VAL_21]]{{\[}}%[[VAL_14]]] : memref<?xi64>
 // CHECK:           %[[VAL_78:.*]] = sparse_tensor.pointers %[[VAL_10]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_79:.*]] = tensor.dim %[[VAL_10]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_80:.*]] = memref.load %[[VAL_78]]{{\[}}%[[VAL_79]]] : memref<?xi64>
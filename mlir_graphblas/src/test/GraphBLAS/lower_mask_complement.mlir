@@ -0,0 +1,58 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// A complemented mask is merged against the input; its complement is never
+// materialized
+
+// CHECK-LABEL:   func @select_mask_complement_vector(
+// CHECK-NOT:       memref.alloc
+// CHECK:           return
+
+func @select_mask_complement_vector(%v: tensor<?xf64, #CV64>, %m: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.select_mask %v, %m {mask_complement = true} : tensor<?xf64, #CV64>, tensor<?xf64, #CV64> to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
+
+// The complement is written directly into the output indices
+
+// CHECK-LABEL:   func @uniform_complement(
+// CHECK-NOT:       memref.alloc
+// CHECK:           scf.for
+// CHECK:             scf.for
+// CHECK:               scf.parallel
+// CHECK:           linalg.fill
+// CHECK-NOT:       memref.alloc
+// CHECK:           return
+
+func @uniform_complement(%m: tensor<?x?xf64, #CSR64>, %val: f64) -> tensor<?x?xf64, #CSR64> {
+    %answer = graphblas.uniform_complement %m, %val : tensor<?x?xf64, #CSR64>, f64 to tensor<?x?xf64, #CSR64>
+    return %answer : tensor<?x?xf64, #CSR64>
+}
+
+// Inner products visit the gaps between mask entries, then the columns in
+// each gap
+
+// CHECK-LABEL:   func @matrix_vector_multiply_mask_complement(
+// CHECK:           scf.parallel
+// CHECK:             scf.parallel
+// CHECK:               scf.while
+// CHECK:           scf.for
+// CHECK:             scf.for
+// CHECK:           return
+
+func @matrix_vector_multiply_mask_complement(%a: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %m: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply %a, %v, %m { semiring = "plus_times", mask_complement = true } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
@@ -0,0 +1,58 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// The "any" monoid searches each row of A backwards and stops at its first
+// overlap with the vector, i.e. the last one in index order
+
+// CHECK-LABEL:   func @matrix_vector_any(
+// CHECK:           %[[VAL_0:.*]]:3 = scf.while (%[[VAL_1:.*]] = %[[VAL_2:.*]], %[[VAL_3:.*]] = %[[VAL_4:.*]], %[[VAL_5:.*]] = %[[VAL_6:.*]]) : (index, f64, i1) -> (index, f64, i1) {
+// CHECK:             %[[VAL_7:.*]] = arith.cmpi ugt, %[[VAL_1]], %{{.*}} : index
+// CHECK:             %[[VAL_8:.*]] = arith.xori %[[VAL_5]], %{{.*}} : i1
+// CHECK:             %[[VAL_9:.*]] = arith.andi %[[VAL_7]], %[[VAL_8]] : i1
+// CHECK:             scf.condition(%[[VAL_9]]) %[[VAL_1]], %[[VAL_3]], %[[VAL_5]] : index, f64, i1
+// CHECK:           } do {
+// CHECK:           ^bb0(%[[VAL_10:.*]]: index, %[[VAL_11:.*]]: f64, %[[VAL_12:.*]]: i1):
+// CHECK:             %[[VAL_13:.*]] = arith.subi %[[VAL_10]], %{{.*}} : index
+// CHECK:             %[[VAL_14:.*]] = memref.load %{{.*}}{{\[}}%[[VAL_13]]] : memref<?xi64>
+// CHECK:             scf.yield %[[VAL_13]], %{{.*}}, %{{.*}} : index, f64, i1
+// CHECK:           }
+// CHECK:           return
+
+func @matrix_vector_any(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply %a, %b { semiring = "any_overlapi" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
+
+// A user block which merely yields its second argument is not the "any"
+// monoid, so every overlap is visited
+
+// CHECK-LABEL:   func @matrix_vector_second(
+// CHECK-NOT:       (index, f64, i1) -> (index, f64, i1)
+// CHECK:           return
+
+func @matrix_vector_second(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply_generic %a, %b {mask_complement = false} : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64> {
+        ^bb0:
+            %identity = arith.constant 0.0 : f64
+            graphblas.yield add_identity %identity : f64
+    },{
+        ^bb0(%add_a: f64, %add_b: f64):
+            graphblas.yield add %add_b : f64
+    },{
+        ^bb0(%mult_a: f64, %mult_b: f64):
+            graphblas.yield mult %mult_b : f64
+    }
+    return %answer : tensor<?xf64, #CV64>
+}
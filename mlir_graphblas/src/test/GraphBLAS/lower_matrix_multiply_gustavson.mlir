@@ -0,0 +1,78 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// CSR x CSR without a mask is computed row-wise; B must not be converted to CSC
+
+// CHECK-LABEL:   func @matrix_multiply_csr_csr(
+// CHECK-NOT:       call @assign_rev
+// CHECK:           %[[NEG1:.*]] = arith.constant -1 : i64
+// CHECK:           scf.parallel
+// CHECK:             %[[MARKER:.*]] = memref.alloc(%{{.*}}) : memref<?xi64>
+// CHECK:             scf.for
+// CHECK:               scf.for
+// CHECK:                 scf.for
+// CHECK:                   memref.load %[[MARKER]][%{{.*}}] : memref<?xi64>
+// CHECK:             memref.dealloc %[[MARKER]] : memref<?xi64>
+// CHECK:           scf.parallel
+// CHECK:             memref.alloc(%{{.*}}) : memref<?xi64>
+// CHECK:             %[[WORKSPACE:.*]] = memref.alloc(%{{.*}}) : memref<?xf64>
+// CHECK:             scf.for
+// CHECK:               scf.while
+// CHECK:               scf.for
+// CHECK:                 memref.load %[[WORKSPACE]][%{{.*}}] : memref<?xf64>
+// CHECK:             memref.dealloc %[[WORKSPACE]] : memref<?xf64>
+// CHECK-NOT:       call @assign_rev
+// CHECK:           return
+
+func @matrix_multiply_csr_csr(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSR64> {
+    %answer = graphblas.matrix_multiply %a, %b { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    return %answer : tensor<?x?xf64, #CSR64>
+}
+
+// A complemented mask is applied by stamping the marker, without building
+// the complement of each mask row
+
+// CHECK-LABEL:   func @matrix_multiply_csr_csr_mask_complement(
+// CHECK-NOT:       call @assign_rev
+// CHECK:           scf.parallel
+// CHECK:           scf.parallel
+// CHECK-NOT:       call @assign_rev
+// CHECK:           return
+
+func @matrix_multiply_csr_csr_mask_complement(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CSR64>, %m: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSR64> {
+    %answer = graphblas.matrix_multiply %a, %b, %m { semiring = "plus_times", mask_complement = true } : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    return %answer : tensor<?x?xf64, #CSR64>
+}
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// vector x CSR is a single saxpy row: the marker doubles as a dense bitmap
+// of the result and the complemented mask is stamped into it
+
+// CHECK-LABEL:   func @vector_matrix_multiply_csr_mask_complement(
+// CHECK-NOT:       call @assign_rev
+// CHECK:           %[[MARKER:.*]] = memref.alloc(%{{.*}}) : memref<?xi64>
+// CHECK:           linalg.fill
+// CHECK:           scf.for
+// CHECK:             memref.store %{{.*}}, %[[MARKER]][%{{.*}}] : memref<?xi64>
+// CHECK:           scf.if
+// CHECK:             %[[WORKSPACE:.*]] = memref.alloc(%{{.*}}) : memref<?xf64>
+// CHECK:             memref.dealloc %[[WORKSPACE]] : memref<?xf64>
+// CHECK:           memref.dealloc %[[MARKER]] : memref<?xi64>
+// CHECK-NOT:       call @assign_rev
+// CHECK:           return
+
+func @vector_matrix_multiply_csr_mask_complement(%v: tensor<?xf64, #CV64>, %b: tensor<?x?xf64, #CSR64>, %m: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %answer = graphblas.matrix_multiply %v, %b, %m { semiring = "any_overlapi", mask_complement = true } : (tensor<?xf64, #CV64>, tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    return %answer : tensor<?xf64, #CV64>
+}
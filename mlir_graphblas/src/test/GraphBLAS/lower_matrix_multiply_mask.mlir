@@ -14,190 +14,372 @@
   indexBitWidth = 64
 }>
 
+// The mask selects the columns of B visited for each row of A; the row of A
+// is held in a per-block workspace
+
 // CHECK-LABEL:   func @matrix_multiply_mask_plus_pair(
-// CHECK-SAME:                                         %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
-// CHECK-SAME:                                         %[[VAL_1:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
-// CHECK-SAME:                                         %[[VAL_2:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> {
-// CHECK:           %[[VAL_3:.*]] = arith.constant 0 : index
-// CHECK:           %[[VAL_4:.*]] = arith.constant 1 : index
-// CHECK:           %[[VAL_5:.*]] = arith.constant 0 : i64
-// CHECK:           %[[VAL_6:.*]] = arith.constant 1 : i64
-// CHECK:           %[[VAL_7:.*]] = arith.constant true
-// CHECK:           %[[VAL_8:.*]] = arith.constant false
-// CHECK:           %[[VAL_9:.*]] = arith.constant 0.000000e+00 : f64
-// CHECK:           %[[VAL_10:.*]] = arith.constant 1.000000e+00 : f64
-// CHECK:           %[[VAL_11:.*]] = tensor.dim %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_12:.*]] = tensor.dim %[[VAL_1]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_13:.*]] = tensor.dim %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_14:.*]] = arith.addi %[[VAL_11]], %[[VAL_4]] : index
-// CHECK:           %[[VAL_15:.*]] = tensor.dim %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_16:.*]] = tensor.dim %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_17:.*]] = sparse_tensor.init{{\[}}%[[VAL_15]], %[[VAL_16]]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_18:.*]] = tensor.dim %[[VAL_17]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_19:.*]] = arith.addi %[[VAL_18]], %[[VAL_4]] : index
-// CHECK:           %[[VAL_20:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_20]], %[[VAL_4]], %[[VAL_19]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_21:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_dim(%[[VAL_21]], %[[VAL_3]], %[[VAL_11]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_22:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_dim(%[[VAL_22]], %[[VAL_4]], %[[VAL_12]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_23:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_23]], %[[VAL_4]], %[[VAL_14]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_24:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_25:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_26:.*]] = sparse_tensor.values %[[VAL_0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           %[[VAL_27:.*]] = sparse_tensor.pointers %[[VAL_1]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_28:.*]] = sparse_tensor.indices %[[VAL_1]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_29:.*]] = sparse_tensor.pointers %[[VAL_17]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_30:.*]] = sparse_tensor.pointers %[[VAL_2]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_31:.*]] = sparse_tensor.indices %[[VAL_2]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           scf.parallel (%[[VAL_32:.*]]) = (%[[VAL_3]]) to (%[[VAL_11]]) step (%[[VAL_4]]) {
-// CHECK:             %[[VAL_33:.*]] = memref.load %[[VAL_24]]{{\[}}%[[VAL_32]]] : memref<?xi64>
-// CHECK:             %[[VAL_34:.*]] = arith.addi %[[VAL_32]], %[[VAL_4]] : index
-// CHECK:             %[[VAL_35:.*]] = memref.load %[[VAL_24]]{{\[}}%[[VAL_34]]] : memref<?xi64>
-// CHECK:             %[[VAL_36:.*]] = arith.cmpi eq, %[[VAL_33]], %[[VAL_35]] : i64
-// CHECK:             %[[VAL_37:.*]] = scf.if %[[VAL_36]] -> (i64) {
-// CHECK:               scf.yield %[[VAL_5]] : i64
-// CHECK:             } else {
-// CHECK:               %[[VAL_38:.*]] = arith.index_cast %[[VAL_33]] : i64 to index
-// CHECK:               %[[VAL_39:.*]] = arith.index_cast %[[VAL_35]] : i64 to index
-// CHECK:               %[[VAL_40:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_32]]] : memref<?xi64>
-// CHECK:               %[[VAL_41:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_34]]] : memref<?xi64>
-// CHECK:               %[[VAL_42:.*]] = arith.index_cast %[[VAL_40]] : i64 to index
-// CHECK:               %[[VAL_43:.*]] = arith.index_cast %[[VAL_41]] : i64 to index
-// CHECK:               %[[VAL_44:.*]] = memref.alloc(%[[VAL_13]]) : memref<?xi1>
-// CHECK:               linalg.fill(%[[VAL_8]], %[[VAL_44]]) : i1, memref<?xi1>
-// CHECK:               scf.parallel (%[[VAL_45:.*]]) = (%[[VAL_38]]) to (%[[VAL_39]]) step (%[[VAL_4]]) {
-// CHECK:                 %[[VAL_46:.*]] = memref.load %[[VAL_25]]{{\[}}%[[VAL_45]]] : memref<?xi64>
-// CHECK:                 %[[VAL_47:.*]] = arith.index_cast %[[VAL_46]] : i64 to index
-// CHECK:                 memref.store %[[VAL_7]], %[[VAL_44]]{{\[}}%[[VAL_47]]] : memref<?xi1>
-// CHECK:                 scf.yield
-// CHECK:               }
-// CHECK:               %[[VAL_48:.*]] = scf.parallel (%[[VAL_49:.*]]) = (%[[VAL_42]]) to (%[[VAL_43]]) step (%[[VAL_4]]) init (%[[VAL_5]]) -> i64 {
-// CHECK:                 %[[VAL_50:.*]] = memref.load %[[VAL_31]]{{\[}}%[[VAL_49]]] : memref<?xi64>
-// CHECK:                 %[[VAL_51:.*]] = arith.index_cast %[[VAL_50]] : i64 to index
-// CHECK:                 %[[VAL_52:.*]] = arith.addi %[[VAL_51]], %[[VAL_4]] : index
-// CHECK:                 %[[VAL_53:.*]] = memref.load %[[VAL_27]]{{\[}}%[[VAL_51]]] : memref<?xi64>
-// CHECK:                 %[[VAL_54:.*]] = memref.load %[[VAL_27]]{{\[}}%[[VAL_52]]] : memref<?xi64>
-// CHECK:                 %[[VAL_55:.*]] = arith.cmpi eq, %[[VAL_53]], %[[VAL_54]] : i64
-// CHECK:                 %[[VAL_56:.*]] = scf.if %[[VAL_55]] -> (i64) {
-// CHECK:                   scf.yield %[[VAL_5]] : i64
-// CHECK:                 } else {
-// CHECK:                   %[[VAL_57:.*]] = scf.while (%[[VAL_58:.*]] = %[[VAL_53]]) : (i64) -> i64 {
-// CHECK:                     %[[VAL_59:.*]] = arith.cmpi uge, %[[VAL_58]], %[[VAL_54]] : i64
-// CHECK:                     %[[VAL_60:.*]]:2 = scf.if %[[VAL_59]] -> (i1, i64) {
-// CHECK:                       scf.yield %[[VAL_8]], %[[VAL_5]] : i1, i64
-// CHECK:                     } else {
-// CHECK:                       %[[VAL_61:.*]] = arith.index_cast %[[VAL_58]] : i64 to index
-// CHECK:                       %[[VAL_62:.*]] = memref.load %[[VAL_28]]{{\[}}%[[VAL_61]]] : memref<?xi64>
-// CHECK:                       %[[VAL_63:.*]] = arith.index_cast %[[VAL_62]] : i64 to index
-// CHECK:                       %[[VAL_64:.*]] = memref.load %[[VAL_44]]{{\[}}%[[VAL_63]]] : memref<?xi1>
-// CHECK:                       %[[VAL_65:.*]] = select %[[VAL_64]], %[[VAL_8]], %[[VAL_7]] : i1
-// CHECK:                       %[[VAL_66:.*]] = select %[[VAL_64]], %[[VAL_6]], %[[VAL_58]] : i64
-// CHECK:                       scf.yield %[[VAL_65]], %[[VAL_66]] : i1, i64
+// CHECK-SAME:                                         %[[A:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
+// CHECK-SAME:                                         %[[B:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
+// CHECK-SAME:                                         %[[M:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> {
+// CHECK-DAG:       %[[C0:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[C1:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[C2:.*]] = arith.constant 2 : index
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
+// CHECK-DAG:       %[[C1023:.*]] = arith.constant 1023 : index
+// CHECK-DAG:       %[[C1024:.*]] = arith.constant 1024 : index
+// CHECK-DAG:       %[[CI0:.*]] = arith.constant 0 : i64
+// CHECK-DAG:       %[[CI1:.*]] = arith.constant 1 : i64
+// CHECK-DAG:       %[[CNEG1:.*]] = arith.constant -1 : i64
+// CHECK-DAG:       %[[CHASH:.*]] = arith.constant -7046029254386353131 : i64
+// CHECK-DAG:       %[[CSHIFT:.*]] = arith.constant 54 : i64
+// CHECK-DAG:       %[[TRUE:.*]] = arith.constant true
+// CHECK-DAG:       %[[FALSE:.*]] = arith.constant false
+// CHECK-DAG:       %[[ZERO:.*]] = arith.constant 0.000000e+00 : f64
+// CHECK-DAG:       %[[ONE:.*]] = arith.constant 1.000000e+00 : f64
+// CHECK:           %[[NROW:.*]] = tensor.dim %[[A]], %[[C0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[NCOL:.*]] = tensor.dim %[[B]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[NK:.*]] = tensor.dim %[[A]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[NROW1:.*]] = arith.addi %[[NROW]], %[[C1]] : index
+// CHECK:           %[[ENROW:.*]] = tensor.dim %[[A]], %[[C0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[ENCOL:.*]] = tensor.dim %[[A]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[C:.*]] = sparse_tensor.init{{\[}}%[[ENROW]], %[[ENCOL]]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[CNROW:.*]] = tensor.dim %[[C]], %[[C0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[CNROW1:.*]] = arith.addi %[[CNROW]], %[[C1]] : index
+// CHECK:           %[[P0:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_pointers_zeroed(%[[P0]], %[[C1]], %[[CNROW1]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P1:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_dim(%[[P1]], %[[C0]], %[[NROW]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P2:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_dim(%[[P2]], %[[C1]], %[[NCOL]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P3:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_pointers(%[[P3]], %[[C1]], %[[NROW1]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[AP:.*]] = sparse_tensor.pointers %[[A]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[AJ:.*]] = sparse_tensor.indices %[[A]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[AX:.*]] = sparse_tensor.values %[[A]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
+// CHECK:           %[[BP:.*]] = sparse_tensor.pointers %[[B]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[BI:.*]] = sparse_tensor.indices %[[B]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d1, d0)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[CP:.*]] = sparse_tensor.pointers %[[C]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[MP:.*]] = sparse_tensor.pointers %[[M]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[MJ:.*]] = sparse_tensor.indices %[[M]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[NRM1:.*]] = arith.subi %[[NROW]], %[[C1]] : index
+// CHECK:           %[[BSN:.*]] = arith.addi %[[NRM1]], %[[C256]] : index
+// CHECK:           %[[BSR:.*]] = arith.divui %[[BSN]], %[[C256]] : index
+// CHECK:           %[[BSE:.*]] = arith.cmpi eq, %[[BSR]], %[[C0]] : index
+// CHECK:           %[[BS:.*]] = select %[[BSE]], %[[C1]], %[[BSR]] : index
+// CHECK:           %[[BSM1:.*]] = arith.subi %[[BS]], %[[C1]] : index
+// CHECK:           %[[NBN:.*]] = arith.addi %[[NROW]], %[[BSM1]] : index
+// CHECK:           %[[NB:.*]] = arith.divui %[[NBN]], %[[BS]] : index
+// CHECK:           scf.parallel (%[[BLK1:.*]]) = (%[[C0]]) to (%[[NB]]) step (%[[C1]]) {
+// CHECK:             %[[RS1:.*]] = arith.muli %[[BLK1]], %[[BS]] : index
+// CHECK:             %[[REF1:.*]] = arith.addi %[[RS1]], %[[BS]] : index
+// CHECK:             %[[REC1:.*]] = arith.cmpi ult, %[[REF1]], %[[NROW]] : index
+// CHECK:             %[[RE1:.*]] = select %[[REC1]], %[[REF1]], %[[NROW]] : index
+// CHECK:             %[[MARKER1:.*]] = memref.alloc(%[[NK]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[MARKER1]]) : i64, memref<?xi64>
+// CHECK:             %[[TAGS1:.*]] = memref.alloc(%[[C1024]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[TAGS1]]) : i64, memref<?xi64>
+// CHECK:             %[[KEYS1:.*]] = memref.alloc(%[[C1024]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[KEYS1]]) : i64, memref<?xi64>
+// CHECK:             scf.for %[[ROW1:.*]] = %[[RS1]] to %[[RE1]] step %[[C1]] {
+// CHECK:               %[[CS64_1:.*]] = memref.load %[[AP]]{{\[}}%[[ROW1]]] : memref<?xi64>
+// CHECK:               %[[RP1_1:.*]] = arith.addi %[[ROW1]], %[[C1]] : index
+// CHECK:               %[[CE64_1:.*]] = memref.load %[[AP]]{{\[}}%[[RP1_1]]] : memref<?xi64>
+// CHECK:               %[[EMPTY1:.*]] = arith.cmpi eq, %[[CS64_1]], %[[CE64_1]] : i64
+// CHECK:               %[[TOTAL1:.*]] = scf.if %[[EMPTY1]] -> (i64) {
+// CHECK:                 scf.yield %[[CI0]] : i64
+// CHECK:               } else {
+// CHECK:                 %[[CS1:.*]] = arith.index_cast %[[CS64_1]] : i64 to index
+// CHECK:                 %[[CE1:.*]] = arith.index_cast %[[CE64_1]] : i64 to index
+// CHECK:                 %[[MS641:.*]] = memref.load %[[MP]]{{\[}}%[[ROW1]]] : memref<?xi64>
+// CHECK:                 %[[ME641:.*]] = memref.load %[[MP]]{{\[}}%[[RP1_1]]] : memref<?xi64>
+// CHECK:                 %[[MS1:.*]] = arith.index_cast %[[MS641]] : i64 to index
+// CHECK:                 %[[ME1:.*]] = arith.index_cast %[[ME641]] : i64 to index
+// CHECK:                 %[[TAG1:.*]] = arith.index_cast %[[ROW1]] : index to i64
+// CHECK:                 %[[RSZ1:.*]] = arith.subi %[[CE1]], %[[CS1]] : index
+// CHECK:                 %[[RSZ21:.*]] = arith.muli %[[RSZ1]], %[[C2]] : index
+// CHECK:                 %[[FITS1:.*]] = arith.cmpi ule, %[[RSZ21]], %[[C1024]] : index
+// CHECK:                 %[[SMALL1:.*]] = arith.cmpi ult, %[[C1024]], %[[NK]] : index
+// CHECK:                 %[[USEH1:.*]] = arith.andi %[[FITS1]], %[[SMALL1]] : i1
+// CHECK:                 scf.for %[[JJ1:.*]] = %[[CS1]] to %[[CE1]] step %[[C1]] {
+// CHECK:                   %[[AJV1:.*]] = memref.load %[[AJ]]{{\[}}%[[JJ1]]] : memref<?xi64>
+// CHECK:                   scf.if %[[USEH1]] {
+// CHECK:                     %[[HF1:.*]] = arith.muli %[[AJV1]], %[[CHASH]] : i64
+// CHECK:                     %[[HSF1:.*]] = arith.shrui %[[HF1]], %[[CSHIFT]] : i64
+// CHECK:                     %[[SLOT0F1:.*]] = arith.index_cast %[[HSF1]] : i64 to index
+// CHECK:                     %[[SLOTF1:.*]] = scf.while (%[[SF1:.*]] = %[[SLOT0F1]]) : (index) -> index {
+// CHECK:                       %[[STAGF1:.*]] = memref.load %[[TAGS1]]{{\[}}%[[SF1]]] : memref<?xi64>
+// CHECK:                       %[[SKEYF1:.*]] = memref.load %[[KEYS1]]{{\[}}%[[SF1]]] : memref<?xi64>
+// CHECK:                       %[[OCCF1:.*]] = arith.cmpi eq, %[[STAGF1]], %[[TAG1]] : i64
+// CHECK:                       %[[OTHERF1:.*]] = arith.cmpi ne, %[[SKEYF1]], %[[AJV1]] : i64
+// CHECK:                       %[[CONTF1:.*]] = arith.andi %[[OCCF1]], %[[OTHERF1]] : i1
+// CHECK:                       scf.condition(%[[CONTF1]]) %[[SF1]] : index
+// CHECK:                     } do {
+// CHECK:                     ^bb0(%[[SPF1:.*]]: index):
+// CHECK:                       %[[SP1F1:.*]] = arith.addi %[[SPF1]], %[[C1]] : index
+// CHECK:                       %[[SNF1:.*]] = arith.andi %[[SP1F1]], %[[C1023]] : index
+// CHECK:                       scf.yield %[[SNF1]] : index
 // CHECK:                     }
-// CHECK:                     scf.condition(%[[VAL_67:.*]]#0) %[[VAL_67]]#1 : i64
-// CHECK:                   } do {
-// CHECK:                   ^bb0(%[[VAL_68:.*]]: i64):
-// CHECK:                     %[[VAL_69:.*]] = arith.addi %[[VAL_68]], %[[VAL_6]] : i64
-// CHECK:                     scf.yield %[[VAL_69]] : i64
+// CHECK:                     memref.store %[[TAG1]], %[[TAGS1]]{{\[}}%[[SLOTF1]]] : memref<?xi64>
+// CHECK:                     memref.store %[[AJV1]], %[[KEYS1]]{{\[}}%[[SLOTF1]]] : memref<?xi64>
+// CHECK:                   } else {
+// CHECK:                     %[[ACOL1:.*]] = arith.index_cast %[[AJV1]] : i64 to index
+// CHECK:                     memref.store %[[TAG1]], %[[MARKER1]]{{\[}}%[[ACOL1]]] : memref<?xi64>
 // CHECK:                   }
-// CHECK:                   scf.yield %[[VAL_70:.*]] : i64
 // CHECK:                 }
-// CHECK:                 scf.reduce(%[[VAL_71:.*]])  : i64 {
-// CHECK:                 ^bb0(%[[VAL_72:.*]]: i64, %[[VAL_73:.*]]: i64):
-// CHECK:                   %[[VAL_74:.*]] = arith.addi %[[VAL_72]], %[[VAL_73]] : i64
-// CHECK:                   scf.reduce.return %[[VAL_74]] : i64
+// CHECK:                 %[[COLTOT1:.*]] = scf.parallel (%[[MM1:.*]]) = (%[[MS1]]) to (%[[ME1]]) step (%[[C1]]) init (%[[CI0]]) -> i64 {
+// CHECK:                   %[[MJV1:.*]] = memref.load %[[MJ]]{{\[}}%[[MM1]]] : memref<?xi64>
+// CHECK:                   %[[COL1:.*]] = arith.index_cast %[[MJV1]] : i64 to index
+// CHECK:                   %[[COLP1_1:.*]] = arith.addi %[[COL1]], %[[C1]] : index
+// CHECK:                   %[[BS64_1:.*]] = memref.load %[[BP]]{{\[}}%[[COL1]]] : memref<?xi64>
+// CHECK:                   %[[BE64_1:.*]] = memref.load %[[BP]]{{\[}}%[[COLP1_1]]] : memref<?xi64>
+// CHECK:                   %[[BEMPTY1:.*]] = arith.cmpi eq, %[[BS64_1]], %[[BE64_1]] : i64
+// CHECK:                   %[[OVL1:.*]] = scf.if %[[BEMPTY1]] -> (i64) {
+// CHECK:                     scf.yield %[[CI0]] : i64
+// CHECK:                   } else {
+// CHECK:                     %[[WHILE1:.*]] = scf.while (%[[II64_1:.*]] = %[[BS64_1]]) : (i64) -> i64 {
+// CHECK:                       %[[ENDR1:.*]] = arith.cmpi uge, %[[II64_1]], %[[BE64_1]] : i64
+// CHECK:                       %[[SRCH1:.*]]:2 = scf.if %[[ENDR1]] -> (i1, i64) {
+// CHECK:                         scf.yield %[[FALSE]], %[[CI0]] : i1, i64
+// CHECK:                       } else {
+// CHECK:                         %[[II1:.*]] = arith.index_cast %[[II64_1]] : i64 to index
+// CHECK:                         %[[KK64_1:.*]] = memref.load %[[BI]]{{\[}}%[[II1]]] : memref<?xi64>
+// CHECK:                         %[[KK1:.*]] = arith.index_cast %[[KK64_1]] : i64 to index
+// CHECK:                         %[[LK1:.*]]:2 = scf.if %[[USEH1]] -> (i1, index) {
+// CHECK:                           %[[HL1:.*]] = arith.muli %[[KK64_1]], %[[CHASH]] : i64
+// CHECK:                           %[[HSL1:.*]] = arith.shrui %[[HL1]], %[[CSHIFT]] : i64
+// CHECK:                           %[[SLOT0L1:.*]] = arith.index_cast %[[HSL1]] : i64 to index
+// CHECK:                           %[[SLOTL1:.*]] = scf.while (%[[SL1:.*]] = %[[SLOT0L1]]) : (index) -> index {
+// CHECK:                             %[[STAGL1:.*]] = memref.load %[[TAGS1]]{{\[}}%[[SL1]]] : memref<?xi64>
+// CHECK:                             %[[SKEYL1:.*]] = memref.load %[[KEYS1]]{{\[}}%[[SL1]]] : memref<?xi64>
+// CHECK:                             %[[OCCL1:.*]] = arith.cmpi eq, %[[STAGL1]], %[[TAG1]] : i64
+// CHECK:                             %[[OTHERL1:.*]] = arith.cmpi ne, %[[SKEYL1]], %[[KK64_1]] : i64
+// CHECK:                             %[[CONTL1:.*]] = arith.andi %[[OCCL1]], %[[OTHERL1]] : i1
+// CHECK:                             scf.condition(%[[CONTL1]]) %[[SL1]] : index
+// CHECK:                           } do {
+// CHECK:                           ^bb0(%[[SPL1:.*]]: index):
+// CHECK:                             %[[SP1L1:.*]] = arith.addi %[[SPL1]], %[[C1]] : index
+// CHECK:                             %[[SNL1:.*]] = arith.andi %[[SP1L1]], %[[C1023]] : index
+// CHECK:                             scf.yield %[[SNL1]] : index
+// CHECK:                           }
+// CHECK:                           %[[LTAG1:.*]] = memref.load %[[TAGS1]]{{\[}}%[[SLOTL1]]] : memref<?xi64>
+// CHECK:                           %[[LFOUND1:.*]] = arith.cmpi eq, %[[LTAG1]], %[[TAG1]] : i64
+// CHECK:                           scf.yield %[[LFOUND1]], %[[SLOTL1]] : i1, index
+// CHECK:                         } else {
+// CHECK:                           %[[MTAG1:.*]] = memref.load %[[MARKER1]]{{\[}}%[[KK1]]] : memref<?xi64>
+// CHECK:                           %[[MFOUND1:.*]] = arith.cmpi eq, %[[MTAG1]], %[[TAG1]] : i64
+// CHECK:                           scf.yield %[[MFOUND1]], %[[KK1]] : i1, index
+// CHECK:                         }
+// CHECK:                         %[[R0_1:.*]] = select %[[LK1]]#0, %[[FALSE]], %[[TRUE]] : i1
+// CHECK:                         %[[R1_1:.*]] = select %[[LK1]]#0, %[[CI1]], %[[II64_1]] : i64
+// CHECK:                         scf.yield %[[R0_1]], %[[R1_1]] : i1, i64
+// CHECK:                       }
+// CHECK:                       scf.condition(%[[SRCH1]]#0) %[[SRCH1]]#1 : i64
+// CHECK:                     } do {
+// CHECK:                     ^bb0(%[[IIP1:.*]]: i64):
+// CHECK:                       %[[IIN1:.*]] = arith.addi %[[IIP1]], %[[CI1]] : i64
+// CHECK:                       scf.yield %[[IIN1]] : i64
+// CHECK:                     }
+// CHECK:                     scf.yield %[[WHILE1]] : i64
+// CHECK:                   }
+// CHECK:                   scf.reduce(%[[OVL1]])  : i64 {
+// CHECK:                   ^bb0(%[[LHS1:.*]]: i64, %[[RHS1:.*]]: i64):
+// CHECK:                     %[[SUM1:.*]] = arith.addi %[[LHS1]], %[[RHS1]] : i64
+// CHECK:                     scf.reduce.return %[[SUM1]] : i64
+// CHECK:                   }
+// CHECK:                   scf.yield
 // CHECK:                 }
-// CHECK:                 scf.yield
+// CHECK:                 scf.yield %[[COLTOT1]] : i64
 // CHECK:               }
-// CHECK:               memref.dealloc %[[VAL_44]] : memref<?xi1>
-// CHECK:               scf.yield %[[VAL_75:.*]] : i64
+// CHECK:               memref.store %[[TOTAL1]], %[[CP]]{{\[}}%[[ROW1]]] : memref<?xi64>
+// CHECK:             }
+// CHECK:             memref.dealloc %[[MARKER1]] : memref<?xi64>
+// CHECK:             memref.dealloc %[[TAGS1]] : memref<?xi64>
+// CHECK:             memref.dealloc %[[KEYS1]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[NRM1_S:.*]] = arith.subi %[[NROW]], %[[C1]] : index
+// CHECK:           %[[BSN_S:.*]] = arith.addi %[[NRM1_S]], %[[C256]] : index
+// CHECK:           %[[BSR_S:.*]] = arith.divui %[[BSN_S]], %[[C256]] : index
+// CHECK:           %[[BSE_S:.*]] = arith.cmpi eq, %[[BSR_S]], %[[C0]] : index
+// CHECK:           %[[BS_S:.*]] = select %[[BSE_S]], %[[C1]], %[[BSR_S]] : index
+// CHECK:           %[[BSM1_S:.*]] = arith.subi %[[BS_S]], %[[C1]] : index
+// CHECK:           %[[NBN_S:.*]] = arith.addi %[[NROW]], %[[BSM1_S]] : index
+// CHECK:           %[[NB_S:.*]] = arith.divui %[[NBN_S]], %[[BS_S]] : index
+// CHECK:           %[[BT_S:.*]] = memref.alloc(%[[NB_S]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB1_S:.*]]) = (%[[C0]]) to (%[[NB_S]]) step (%[[C1]]) {
+// CHECK:             %[[RS1_S:.*]] = arith.muli %[[SB1_S]], %[[BS_S]] : index
+// CHECK:             %[[REF1_S:.*]] = arith.addi %[[RS1_S]], %[[BS_S]] : index
+// CHECK:             %[[REC1_S:.*]] = arith.cmpi ult, %[[REF1_S]], %[[NROW]] : index
+// CHECK:             %[[RE1_S:.*]] = select %[[REC1_S]], %[[REF1_S]], %[[NROW]] : index
+// CHECK:             %[[PSUM_S:.*]] = scf.for %[[SI1_S:.*]] = %[[RS1_S]] to %[[RE1_S]] step %[[C1]] iter_args(%[[PS_S:.*]] = %[[CI0]]) -> (i64) {
+// CHECK:               %[[SV1_S:.*]] = memref.load %[[CP]]{{\[}}%[[SI1_S]]] : memref<?xi64>
+// CHECK:               %[[PSN_S:.*]] = arith.addi %[[PS_S]], %[[SV1_S]] : i64
+// CHECK:               scf.yield %[[PSN_S]] : i64
 // CHECK:             }
-// CHECK:             memref.store %[[VAL_76:.*]], %[[VAL_29]]{{\[}}%[[VAL_32]]] : memref<?xi64>
+// CHECK:             memref.store %[[PSUM_S]], %[[BT_S]]{{\[}}%[[SB1_S]]] : memref<?xi64>
 // CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           scf.for %[[VAL_77:.*]] = %[[VAL_3]] to %[[VAL_11]] step %[[VAL_4]] {
-// CHECK:             %[[VAL_78:.*]] = memref.load %[[VAL_29]]{{\[}}%[[VAL_77]]] : memref<?xi64>
-// CHECK:             %[[VAL_79:.*]] = memref.load %[[VAL_29]]{{\[}}%[[VAL_11]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_79]], %[[VAL_29]]{{\[}}%[[VAL_77]]] : memref<?xi64>
-// CHECK:             %[[VAL_80:.*]] = arith.addi %[[VAL_79]], %[[VAL_78]] : i64
-// CHECK:             memref.store %[[VAL_80]], %[[VAL_29]]{{\[}}%[[VAL_11]]] : memref<?xi64>
+// CHECK:           %[[TOTAL_S:.*]] = scf.for %[[SBB_S:.*]] = %[[C0]] to %[[NB_S]] step %[[C1]] iter_args(%[[BASE_S:.*]] = %[[CI0]]) -> (i64) {
+// CHECK:             %[[BTV_S:.*]] = memref.load %[[BT_S]]{{\[}}%[[SBB_S]]] : memref<?xi64>
+// CHECK:             memref.store %[[BASE_S]], %[[BT_S]]{{\[}}%[[SBB_S]]] : memref<?xi64>
+// CHECK:             %[[BASEN_S:.*]] = arith.addi %[[BASE_S]], %[[BTV_S]] : i64
+// CHECK:             scf.yield %[[BASEN_S]] : i64
 // CHECK:           }
-// CHECK:           %[[VAL_81:.*]] = sparse_tensor.pointers %[[VAL_17]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_82:.*]] = tensor.dim %[[VAL_17]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_83:.*]] = memref.load %[[VAL_81]]{{\[}}%[[VAL_82]]] : memref<?xi64>
-// CHECK:           %[[VAL_84:.*]] = arith.index_cast %[[VAL_83]] : i64 to index
-// CHECK:           %[[VAL_85:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_index(%[[VAL_85]], %[[VAL_4]], %[[VAL_84]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_86:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_17]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_values(%[[VAL_86]], %[[VAL_84]]) : (!llvm.ptr<i8>, index) -> ()
-// CHECK:           %[[VAL_87:.*]] = sparse_tensor.indices %[[VAL_17]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_88:.*]] = sparse_tensor.values %[[VAL_17]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           scf.parallel (%[[VAL_89:.*]]) = (%[[VAL_3]]) to (%[[VAL_11]]) step (%[[VAL_4]]) {
-// CHECK:             %[[VAL_90:.*]] = arith.addi %[[VAL_89]], %[[VAL_4]] : index
-// CHECK:             %[[VAL_91:.*]] = memref.load %[[VAL_29]]{{\[}}%[[VAL_89]]] : memref<?xi64>
-// CHECK:             %[[VAL_92:.*]] = memref.load %[[VAL_29]]{{\[}}%[[VAL_90]]] : memref<?xi64>
-// CHECK:             %[[VAL_93:.*]] = arith.cmpi ne, %[[VAL_91]], %[[VAL_92]] : i64
-// CHECK:             scf.if %[[VAL_93]] {
-// CHECK:               %[[VAL_94:.*]] = memref.load %[[VAL_29]]{{\[}}%[[VAL_89]]] : memref<?xi64>
-// CHECK:               %[[VAL_95:.*]] = arith.index_cast %[[VAL_94]] : i64 to index
-// CHECK:               %[[VAL_96:.*]] = memref.load %[[VAL_24]]{{\[}}%[[VAL_89]]] : memref<?xi64>
-// CHECK:               %[[VAL_97:.*]] = memref.load %[[VAL_24]]{{\[}}%[[VAL_90]]] : memref<?xi64>
-// CHECK:               %[[VAL_98:.*]] = arith.index_cast %[[VAL_96]] : i64 to index
-// CHECK:               %[[VAL_99:.*]] = arith.index_cast %[[VAL_97]] : i64 to index
-// CHECK:               %[[VAL_100:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_89]]] : memref<?xi64>
-// CHECK:               %[[VAL_101:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_90]]] : memref<?xi64>
-// CHECK:               %[[VAL_102:.*]] = arith.index_cast %[[VAL_100]] : i64 to index
-// CHECK:               %[[VAL_103:.*]] = arith.index_cast %[[VAL_101]] : i64 to index
-// CHECK:               %[[VAL_104:.*]] = memref.alloc(%[[VAL_13]]) : memref<?xf64>
-// CHECK:               %[[VAL_105:.*]] = memref.alloc(%[[VAL_13]]) : memref<?xi1>
-// CHECK:               linalg.fill(%[[VAL_8]], %[[VAL_105]]) : i1, memref<?xi1>
-// CHECK:               scf.parallel (%[[VAL_106:.*]]) = (%[[VAL_98]]) to (%[[VAL_99]]) step (%[[VAL_4]]) {
-// CHECK:                 %[[VAL_107:.*]] = memref.load %[[VAL_25]]{{\[}}%[[VAL_106]]] : memref<?xi64>
-// CHECK:                 %[[VAL_108:.*]] = arith.index_cast %[[VAL_107]] : i64 to index
-// CHECK:                 memref.store %[[VAL_7]], %[[VAL_105]]{{\[}}%[[VAL_108]]] : memref<?xi1>
-// CHECK:                 %[[VAL_109:.*]] = memref.load %[[VAL_26]]{{\[}}%[[VAL_106]]] : memref<?xf64>
-// CHECK:                 memref.store %[[VAL_109]], %[[VAL_104]]{{\[}}%[[VAL_108]]] : memref<?xf64>
-// CHECK:                 scf.yield
-// CHECK:               }
-// CHECK:               %[[VAL_110:.*]] = scf.for %[[VAL_111:.*]] = %[[VAL_102]] to %[[VAL_103]] step %[[VAL_4]] iter_args(%[[VAL_112:.*]] = %[[VAL_3]]) -> (index) {
-// CHECK:                 %[[VAL_113:.*]] = memref.load %[[VAL_31]]{{\[}}%[[VAL_111]]] : memref<?xi64>
-// CHECK:                 %[[VAL_114:.*]] = arith.index_cast %[[VAL_113]] : i64 to index
-// CHECK:                 %[[VAL_115:.*]] = arith.addi %[[VAL_114]], %[[VAL_4]] : index
-// CHECK:                 %[[VAL_116:.*]] = memref.load %[[VAL_27]]{{\[}}%[[VAL_114]]] : memref<?xi64>
-// CHECK:                 %[[VAL_117:.*]] = memref.load %[[VAL_27]]{{\[}}%[[VAL_115]]] : memref<?xi64>
-// CHECK:                 %[[VAL_118:.*]] = arith.index_cast %[[VAL_116]] : i64 to index
-// CHECK:                 %[[VAL_119:.*]] = arith.index_cast %[[VAL_117]] : i64 to index
-// CHECK:                 %[[VAL_120:.*]]:2 = scf.for %[[VAL_121:.*]] = %[[VAL_118]] to %[[VAL_119]] step %[[VAL_4]] iter_args(%[[VAL_122:.*]] = %[[VAL_9]], %[[VAL_123:.*]] = %[[VAL_8]]) -> (f64, i1) {
-// CHECK:                   %[[VAL_124:.*]] = memref.load %[[VAL_28]]{{\[}}%[[VAL_121]]] : memref<?xi64>
-// CHECK:                   %[[VAL_125:.*]] = arith.index_cast %[[VAL_124]] : i64 to index
-// CHECK:                   %[[VAL_126:.*]] = memref.load %[[VAL_105]]{{\[}}%[[VAL_125]]] : memref<?xi1>
-// CHECK:                   %[[VAL_127:.*]]:2 = scf.if %[[VAL_126]] -> (f64, i1) {
-// CHECK:                     %[[VAL_128:.*]] = arith.addf %[[VAL_122]], %[[VAL_10]] : f64
-// CHECK:                     scf.yield %[[VAL_128]], %[[VAL_7]] : f64, i1
+// CHECK:           scf.parallel (%[[SB3_S:.*]]) = (%[[C0]]) to (%[[NB_S]]) step (%[[C1]]) {
+// CHECK:             %[[RS3_S:.*]] = arith.muli %[[SB3_S]], %[[BS_S]] : index
+// CHECK:             %[[REF3_S:.*]] = arith.addi %[[RS3_S]], %[[BS_S]] : index
+// CHECK:             %[[REC3_S:.*]] = arith.cmpi ult, %[[REF3_S]], %[[NROW]] : index
+// CHECK:             %[[RE3_S:.*]] = select %[[REC3_S]], %[[REF3_S]], %[[NROW]] : index
+// CHECK:             %[[SBASE_S:.*]] = memref.load %[[BT_S]]{{\[}}%[[SB3_S]]] : memref<?xi64>
+// CHECK:             %[[SCAN_S:.*]] = scf.for %[[SI3_S:.*]] = %[[RS3_S]] to %[[RE3_S]] step %[[C1]] iter_args(%[[CS_S:.*]] = %[[SBASE_S]]) -> (i64) {
+// CHECK:               %[[SV3_S:.*]] = memref.load %[[CP]]{{\[}}%[[SI3_S]]] : memref<?xi64>
+// CHECK:               memref.store %[[CS_S]], %[[CP]]{{\[}}%[[SI3_S]]] : memref<?xi64>
+// CHECK:               %[[CSN_S:.*]] = arith.addi %[[CS_S]], %[[SV3_S]] : i64
+// CHECK:               scf.yield %[[CSN_S]] : i64
+// CHECK:             }
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           memref.dealloc %[[BT_S]] : memref<?xi64>
+// CHECK:           memref.store %[[TOTAL_S]], %[[CP]]{{\[}}%[[NROW]]] : memref<?xi64>
+// CHECK:           %[[NVP:.*]] = sparse_tensor.pointers %[[C]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[NVD:.*]] = tensor.dim %[[C]], %[[C0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[NVL:.*]] = memref.load %[[NVP]]{{\[}}%[[NVD]]] : memref<?xi64>
+// CHECK:           %[[NNZ:.*]] = arith.index_cast %[[NVL]] : i64 to index
+// CHECK:           %[[P4:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_index(%[[P4]], %[[C1]], %[[NNZ]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P5:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[C]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_values(%[[P5]], %[[NNZ]]) : (!llvm.ptr<i8>, index) -> ()
+// CHECK:           %[[CJ:.*]] = sparse_tensor.indices %[[C]], %[[C1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[CX:.*]] = sparse_tensor.values %[[C]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
+// CHECK:           scf.parallel (%[[BLK3:.*]]) = (%[[C0]]) to (%[[NB]]) step (%[[C1]]) {
+// CHECK:             %[[RS3:.*]] = arith.muli %[[BLK3]], %[[BS]] : index
+// CHECK:             %[[REF3:.*]] = arith.addi %[[RS3]], %[[BS]] : index
+// CHECK:             %[[REC3:.*]] = arith.cmpi ult, %[[REF3]], %[[NROW]] : index
+// CHECK:             %[[RE3:.*]] = select %[[REC3]], %[[REF3]], %[[NROW]] : index
+// CHECK:             %[[MARKER3:.*]] = memref.alloc(%[[NK]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[MARKER3]]) : i64, memref<?xi64>
+// CHECK:             %[[VALS3:.*]] = memref.alloc(%[[NK]]) : memref<?xf64>
+// CHECK:             %[[TAGS3:.*]] = memref.alloc(%[[C1024]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[TAGS3]]) : i64, memref<?xi64>
+// CHECK:             %[[KEYS3:.*]] = memref.alloc(%[[C1024]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[KEYS3]]) : i64, memref<?xi64>
+// CHECK:             %[[HVALS3:.*]] = memref.alloc(%[[C1024]]) : memref<?xf64>
+// CHECK:             scf.for %[[ROW3:.*]] = %[[RS3]] to %[[RE3]] step %[[C1]] {
+// CHECK:               %[[RP1_3:.*]] = arith.addi %[[ROW3]], %[[C1]] : index
+// CHECK:               %[[CPS:.*]] = memref.load %[[CP]]{{\[}}%[[ROW3]]] : memref<?xi64>
+// CHECK:               %[[CPE:.*]] = memref.load %[[CP]]{{\[}}%[[RP1_3]]] : memref<?xi64>
+// CHECK:               %[[NONEMPTY:.*]] = arith.cmpi ne, %[[CPS]], %[[CPE]] : i64
+// CHECK:               scf.if %[[NONEMPTY]] {
+// CHECK:                 %[[BASE64:.*]] = memref.load %[[CP]]{{\[}}%[[ROW3]]] : memref<?xi64>
+// CHECK:                 %[[BASE:.*]] = arith.index_cast %[[BASE64]] : i64 to index
+// CHECK:                 %[[CS64_3:.*]] = memref.load %[[AP]]{{\[}}%[[ROW3]]] : memref<?xi64>
+// CHECK:                 %[[CE64_3:.*]] = memref.load %[[AP]]{{\[}}%[[RP1_3]]] : memref<?xi64>
+// CHECK:                 %[[CS3:.*]] = arith.index_cast %[[CS64_3]] : i64 to index
+// CHECK:                 %[[CE3:.*]] = arith.index_cast %[[CE64_3]] : i64 to index
+// CHECK:                 %[[MS643:.*]] = memref.load %[[MP]]{{\[}}%[[ROW3]]] : memref<?xi64>
+// CHECK:                 %[[ME643:.*]] = memref.load %[[MP]]{{\[}}%[[RP1_3]]] : memref<?xi64>
+// CHECK:                 %[[MS3:.*]] = arith.index_cast %[[MS643]] : i64 to index
+// CHECK:                 %[[ME3:.*]] = arith.index_cast %[[ME643]] : i64 to index
+// CHECK:                 %[[TAG3:.*]] = arith.index_cast %[[ROW3]] : index to i64
+// CHECK:                 %[[RSZ3:.*]] = arith.subi %[[CE3]], %[[CS3]] : index
+// CHECK:                 %[[RSZ23:.*]] = arith.muli %[[RSZ3]], %[[C2]] : index
+// CHECK:                 %[[FITS3:.*]] = arith.cmpi ule, %[[RSZ23]], %[[C1024]] : index
+// CHECK:                 %[[SMALL3:.*]] = arith.cmpi ult, %[[C1024]], %[[NK]] : index
+// CHECK:                 %[[USEH3:.*]] = arith.andi %[[FITS3]], %[[SMALL3]] : i1
+// CHECK:                 scf.for %[[JJ3:.*]] = %[[CS3]] to %[[CE3]] step %[[C1]] {
+// CHECK:                   %[[AJV3:.*]] = memref.load %[[AJ]]{{\[}}%[[JJ3]]] : memref<?xi64>
+// CHECK:                   %[[AXV3:.*]] = memref.load %[[AX]]{{\[}}%[[JJ3]]] : memref<?xf64>
+// CHECK:                   scf.if %[[USEH3]] {
+// CHECK:                     %[[HF3:.*]] = arith.muli %[[AJV3]], %[[CHASH]] : i64
+// CHECK:                     %[[HSF3:.*]] = arith.shrui %[[HF3]], %[[CSHIFT]] : i64
+// CHECK:                     %[[SLOT0F3:.*]] = arith.index_cast %[[HSF3]] : i64 to index
+// CHECK:                     %[[SLOTF3:.*]] = scf.while (%[[SF3:.*]] = %[[SLOT0F3]]) : (index) -> index {
+// CHECK:                       %[[STAGF3:.*]] = memref.load %[[TAGS3]]{{\[}}%[[SF3]]] : memref<?xi64>
+// CHECK:                       %[[SKEYF3:.*]] = memref.load %[[KEYS3]]{{\[}}%[[SF3]]] : memref<?xi64>
+// CHECK:                       %[[OCCF3:.*]] = arith.cmpi eq, %[[STAGF3]], %[[TAG3]] : i64
+// CHECK:                       %[[OTHERF3:.*]] = arith.cmpi ne, %[[SKEYF3]], %[[AJV3]] : i64
+// CHECK:                       %[[CONTF3:.*]] = arith.andi %[[OCCF3]], %[[OTHERF3]] : i1
+// CHECK:                       scf.condition(%[[CONTF3]]) %[[SF3]] : index
+// CHECK:                     } do {
+// CHECK:                     ^bb0(%[[SPF3:.*]]: index):
+// CHECK:                       %[[SP1F3:.*]] = arith.addi %[[SPF3]], %[[C1]] : index
+// CHECK:                       %[[SNF3:.*]] = arith.andi %[[SP1F3]], %[[C1023]] : index
+// CHECK:                       scf.yield %[[SNF3]] : index
+// CHECK:                     }
+// CHECK:                     memref.store %[[TAG3]], %[[TAGS3]]{{\[}}%[[SLOTF3]]] : memref<?xi64>
+// CHECK:                     memref.store %[[AJV3]], %[[KEYS3]]{{\[}}%[[SLOTF3]]] : memref<?xi64>
+// CHECK:                     memref.store %[[AXV3]], %[[HVALS3]]{{\[}}%[[SLOTF3]]] : memref<?xf64>
 // CHECK:                   } else {
-// CHECK:                     scf.yield %[[VAL_122]], %[[VAL_123]] : f64, i1
+// CHECK:                     %[[ACOL3:.*]] = arith.index_cast %[[AJV3]] : i64 to index
+// CHECK:                     memref.store %[[TAG3]], %[[MARKER3]]{{\[}}%[[ACOL3]]] : memref<?xi64>
+// CHECK:                     memref.store %[[AXV3]], %[[VALS3]]{{\[}}%[[ACOL3]]] : memref<?xf64>
 // CHECK:                   }
-// CHECK:                   scf.yield %[[VAL_129:.*]]#0, %[[VAL_129]]#1 : f64, i1
 // CHECK:                 }
-// CHECK:                 %[[VAL_130:.*]] = scf.if %[[VAL_131:.*]]#1 -> (index) {
-// CHECK:                   %[[VAL_132:.*]] = arith.addi %[[VAL_95]], %[[VAL_112]] : index
-// CHECK:                   memref.store %[[VAL_113]], %[[VAL_87]]{{\[}}%[[VAL_132]]] : memref<?xi64>
-// CHECK:                   memref.store %[[VAL_131]]#0, %[[VAL_88]]{{\[}}%[[VAL_132]]] : memref<?xf64>
-// CHECK:                   %[[VAL_133:.*]] = arith.addi %[[VAL_112]], %[[VAL_4]] : index
-// CHECK:                   scf.yield %[[VAL_133]] : index
-// CHECK:                 } else {
-// CHECK:                   scf.yield %[[VAL_112]] : index
+// CHECK:                 %[[OFFS:.*]] = scf.for %[[MM3:.*]] = %[[MS3]] to %[[ME3]] step %[[C1]] iter_args(%[[OFF:.*]] = %[[C0]]) -> (index) {
+// CHECK:                   %[[COL64:.*]] = memref.load %[[MJ]]{{\[}}%[[MM3]]] : memref<?xi64>
+// CHECK:                   %[[COL3:.*]] = arith.index_cast %[[COL64]] : i64 to index
+// CHECK:                   %[[COLP1_3:.*]] = arith.addi %[[COL3]], %[[C1]] : index
+// CHECK:                   %[[IS64:.*]] = memref.load %[[BP]]{{\[}}%[[COL3]]] : memref<?xi64>
+// CHECK:                   %[[IE64:.*]] = memref.load %[[BP]]{{\[}}%[[COLP1_3]]] : memref<?xi64>
+// CHECK:                   %[[IS:.*]] = arith.index_cast %[[IS64]] : i64 to index
+// CHECK:                   %[[IE:.*]] = arith.index_cast %[[IE64]] : i64 to index
+// CHECK:                   %[[K:.*]]:2 = scf.for %[[II3:.*]] = %[[IS]] to %[[IE]] step %[[C1]] iter_args(%[[CURR:.*]] = %[[ZERO]], %[[ALIVE:.*]] = %[[FALSE]]) -> (f64, i1) {
+// CHECK:                     %[[KK64_3:.*]] = memref.load %[[BI]]{{\[}}%[[II3]]] : memref<?xi64>
+// CHECK:                     %[[KK3:.*]] = arith.index_cast %[[KK64_3]] : i64 to index
+// CHECK:                     %[[LK3:.*]]:2 = scf.if %[[USEH3]] -> (i1, index) {
+// CHECK:                       %[[HL3:.*]] = arith.muli %[[KK64_3]], %[[CHASH]] : i64
+// CHECK:                       %[[HSL3:.*]] = arith.shrui %[[HL3]], %[[CSHIFT]] : i64
+// CHECK:                       %[[SLOT0L3:.*]] = arith.index_cast %[[HSL3]] : i64 to index
+// CHECK:                       %[[SLOTL3:.*]] = scf.while (%[[SL3:.*]] = %[[SLOT0L3]]) : (index) -> index {
+// CHECK:                         %[[STAGL3:.*]] = memref.load %[[TAGS3]]{{\[}}%[[SL3]]] : memref<?xi64>
+// CHECK:                         %[[SKEYL3:.*]] = memref.load %[[KEYS3]]{{\[}}%[[SL3]]] : memref<?xi64>
+// CHECK:                         %[[OCCL3:.*]] = arith.cmpi eq, %[[STAGL3]], %[[TAG3]] : i64
+// CHECK:                         %[[OTHERL3:.*]] = arith.cmpi ne, %[[SKEYL3]], %[[KK64_3]] : i64
+// CHECK:                         %[[CONTL3:.*]] = arith.andi %[[OCCL3]], %[[OTHERL3]] : i1
+// CHECK:                         scf.condition(%[[CONTL3]]) %[[SL3]] : index
+// CHECK:                       } do {
+// CHECK:                       ^bb0(%[[SPL3:.*]]: index):
+// CHECK:                         %[[SP1L3:.*]] = arith.addi %[[SPL3]], %[[C1]] : index
+// CHECK:                         %[[SNL3:.*]] = arith.andi %[[SP1L3]], %[[C1023]] : index
+// CHECK:                         scf.yield %[[SNL3]] : index
+// CHECK:                       }
+// CHECK:                       %[[LTAG3:.*]] = memref.load %[[TAGS3]]{{\[}}%[[SLOTL3]]] : memref<?xi64>
+// CHECK:                       %[[LFOUND3:.*]] = arith.cmpi eq, %[[LTAG3]], %[[TAG3]] : i64
+// CHECK:                       scf.yield %[[LFOUND3]], %[[SLOTL3]] : i1, index
+// CHECK:                     } else {
+// CHECK:                       %[[MTAG3:.*]] = memref.load %[[MARKER3]]{{\[}}%[[KK3]]] : memref<?xi64>
+// CHECK:                       %[[MFOUND3:.*]] = arith.cmpi eq, %[[MTAG3]], %[[TAG3]] : i64
+// CHECK:                       scf.yield %[[MFOUND3]], %[[KK3]] : i1, index
+// CHECK:                     }
+// CHECK:                     %[[PR:.*]]:2 = scf.if %[[LK3]]#0 -> (f64, i1) {
+// CHECK:                       %[[ADD:.*]] = arith.addf %[[CURR]], %[[ONE]] : f64
+// CHECK:                       scf.yield %[[ADD]], %[[TRUE]] : f64, i1
+// CHECK:                     } else {
+// CHECK:                       scf.yield %[[CURR]], %[[ALIVE]] : f64, i1
+// CHECK:                     }
+// CHECK:                     scf.yield %[[PR]]#0, %[[PR]]#1 : f64, i1
+// CHECK:                   }
+// CHECK:                   %[[NEWOFF:.*]] = scf.if %[[K]]#1 -> (index) {
+// CHECK:                     %[[CJPOS:.*]] = arith.addi %[[BASE]], %[[OFF]] : index
+// CHECK:                     memref.store %[[COL64]], %[[CJ]]{{\[}}%[[CJPOS]]] : memref<?xi64>
+// CHECK:                     memref.store %[[K]]#0, %[[CX]]{{\[}}%[[CJPOS]]] : memref<?xf64>
+// CHECK:                     %[[OFFP1:.*]] = arith.addi %[[OFF]], %[[C1]] : index
+// CHECK:                     scf.yield %[[OFFP1]] : index
+// CHECK:                   } else {
+// CHECK:                     scf.yield %[[OFF]] : index
+// CHECK:                   }
+// CHECK:                   scf.yield %[[NEWOFF]] : index
 // CHECK:                 }
-// CHECK:                 scf.yield %[[VAL_134:.*]] : index
 // CHECK:               }
-// CHECK:               memref.dealloc %[[VAL_104]] : memref<?xf64>
-// CHECK:               memref.dealloc %[[VAL_105]] : memref<?xi1>
 // CHECK:             }
+// CHECK:             memref.dealloc %[[MARKER3]] : memref<?xi64>
+// CHECK:             memref.dealloc %[[VALS3]] : memref<?xf64>
+// CHECK:             memref.dealloc %[[TAGS3]] : memref<?xi64>
+// CHECK:             memref.dealloc %[[KEYS3]] : memref<?xi64>
+// CHECK:             memref.dealloc %[[HVALS3]] : memref<?xf64>
 // CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           return %[[VAL_17]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           return %[[C]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:         }
 
 func @matrix_multiply_mask_plus_pair(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CSC64>, %m: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSR64> {
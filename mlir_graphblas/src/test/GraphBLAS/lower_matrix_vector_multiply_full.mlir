@@ -17,20 +17,21 @@
 // CHECK-LABEL:   func @matrix_vector_multiply_plus_times(
 // CHECK-SAME:                                            %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>,
 // CHECK-SAME:                                            %[[VAL_1:.*]]: tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>> {
-// CHECK:           %[[VAL_2:.*]] = arith.constant 0 : index
-// CHECK:           %[[VAL_3:.*]] = arith.constant 1 : index
-// CHECK:           %[[VAL_4:.*]] = arith.constant 2 : index
-// CHECK:           %[[VAL_5:.*]] = arith.constant 0 : i64
-// CHECK:           %[[VAL_6:.*]] = arith.constant 1 : i64
-// CHECK:           %[[VAL_7:.*]] = arith.constant true
-// CHECK:           %[[VAL_8:.*]] = arith.constant false
-// CHECK:           %[[VAL_9:.*]] = arith.constant 0.000000e+00 : f64
+// CHECK-DAG:       %[[VAL_2:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[VAL_3:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[VAL_4:.*]] = arith.constant 2 : index
+// CHECK-DAG:       %[[VAL_5:.*]] = arith.constant 0 : i64
+// CHECK-DAG:       %[[VAL_6:.*]] = arith.constant 1 : i64
+// CHECK-DAG:       %[[VAL_7:.*]] = arith.constant true
+// CHECK-DAG:       %[[VAL_8:.*]] = arith.constant false
+// CHECK-DAG:       %[[VAL_9:.*]] = arith.constant 0.000000e+00 : f64
+// CHECK-DAG:       %[[CNEG1:.*]] = arith.constant -1 : i64
 // CHECK:           %[[VAL_10:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_11:.*]] = tensor.dim %[[VAL_1]], %[[VAL_2]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_12:.*]] = tensor.dim %[[VAL_1]], %[[VAL_2]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_13:.*]] = sparse_tensor.init{{\[}}%[[VAL_12]]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_14:.*]] = call @vector_f64_p64i64_to_ptr8(%[[VAL_13]]) : (tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_pointers(%[[VAL_14]], %[[VAL_2]], %[[VAL_4]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           call @resize_pointers_zeroed(%[[VAL_14]], %[[VAL_2]], %[[VAL_4]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_15:.*]] = call @vector_f64_p64i64_to_ptr8(%[[VAL_13]]) : (tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
 // CHECK:           call @resize_dim(%[[VAL_15]], %[[VAL_2]], %[[VAL_10]]) : (!llvm.ptr<i8>, index, index) -> ()
 // CHECK:           %[[VAL_16:.*]] = call @vector_f64_p64i64_to_ptr8(%[[VAL_13]]) : (tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
@@ -48,13 +49,12 @@
 // CHECK:           %[[VAL_27:.*]] = scf.if %[[VAL_26]] -> (i64) {
 // CHECK:             scf.yield %[[VAL_5]] : i64
 // CHECK:           } else {
-// CHECK:             %[[VAL_28:.*]] = memref.alloc(%[[VAL_11]]) : memref<?xi1>
-// CHECK:             linalg.fill(%[[VAL_8]], %[[VAL_28]]) : i1, memref<?xi1>
-// CHECK:             scf.parallel (%[[VAL_29:.*]]) = (%[[VAL_2]]) to (%[[VAL_25]]) step (%[[VAL_3]]) {
+// CHECK:             %[[VAL_28:.*]] = memref.alloc(%[[VAL_11]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[VAL_28]]) : i64, memref<?xi64>
+// CHECK:             scf.for %[[VAL_29:.*]] = %[[VAL_2]] to %[[VAL_25]] step %[[VAL_3]] {
 // CHECK:               %[[VAL_30:.*]] = memref.load %[[VAL_21]]{{\[}}%[[VAL_29]]] : memref<?xi64>
 // CHECK:               %[[VAL_31:.*]] = arith.index_cast %[[VAL_30]] : i64 to index
-// CHECK:               memref.store %[[VAL_7]], %[[VAL_28]]{{\[}}%[[VAL_31]]] : memref<?xi1>
-// CHECK:               scf.yield
+// CHECK:               memref.store %[[VAL_5]], %[[VAL_28]]{{\[}}%[[VAL_31]]] : memref<?xi64>
 // CHECK:             }
 // CHECK:             %[[VAL_32:.*]] = scf.parallel (%[[VAL_33:.*]]) = (%[[VAL_2]]) to (%[[VAL_10]]) step (%[[VAL_3]]) init (%[[VAL_5]]) -> i64 {
 // CHECK:               %[[VAL_34:.*]] = arith.addi %[[VAL_33]], %[[VAL_3]] : index
@@ -72,7 +72,8 @@
 // CHECK:                     %[[VAL_43:.*]] = arith.index_cast %[[VAL_40]] : i64 to index
 // CHECK:                     %[[VAL_44:.*]] = memref.load %[[VAL_18]]{{\[}}%[[VAL_43]]] : memref<?xi64>
 // CHECK:                     %[[VAL_45:.*]] = arith.index_cast %[[VAL_44]] : i64 to index
-// CHECK:                     %[[VAL_46:.*]] = memref.load %[[VAL_28]]{{\[}}%[[VAL_45]]] : memref<?xi1>
+// CHECK:                     %[[KK_TAG:.*]] = memref.load %[[VAL_28]]{{\[}}%[[VAL_45]]] : memref<?xi64>
+// CHECK:                     %[[VAL_46:.*]] = arith.cmpi eq, %[[KK_TAG]], %[[VAL_5]] : i64
 // CHECK:                     %[[VAL_47:.*]] = select %[[VAL_46]], %[[VAL_8]], %[[VAL_7]] : i1
 // CHECK:                     %[[VAL_48:.*]] = select %[[VAL_46]], %[[VAL_6]], %[[VAL_40]] : i64
 // CHECK:                     scf.yield %[[VAL_47]], %[[VAL_48]] : i1, i64
@@ -92,7 +93,7 @@
 // CHECK:               }
 // CHECK:               scf.yield
 // CHECK:             }
-// CHECK:             memref.dealloc %[[VAL_28]] : memref<?xi1>
+// CHECK:             memref.dealloc %[[VAL_28]] : memref<?xi64>
 // CHECK:             scf.yield %[[VAL_57:.*]] : i64
 // CHECK:           }
 // CHECK:           %[[VAL_58:.*]] = arith.index_cast %[[VAL_59:.*]] : i64 to index
@@ -105,16 +106,15 @@
 // CHECK:           %[[VAL_63:.*]] = sparse_tensor.values %[[VAL_13]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
 // CHECK:           %[[VAL_64:.*]] = arith.cmpi ne, %[[VAL_2]], %[[VAL_58]] : index
 // CHECK:           scf.if %[[VAL_64]] {
+// CHECK:             %[[VAL_66:.*]] = memref.alloc(%[[VAL_11]]) : memref<?xi64>
+// CHECK:             linalg.fill(%[[CNEG1]], %[[VAL_66]]) : i64, memref<?xi64>
 // CHECK:             %[[VAL_65:.*]] = memref.alloc(%[[VAL_11]]) : memref<?xf64>
-// CHECK:             %[[VAL_66:.*]] = memref.alloc(%[[VAL_11]]) : memref<?xi1>
-// CHECK:             linalg.fill(%[[VAL_8]], %[[VAL_66]]) : i1, memref<?xi1>
-// CHECK:             scf.parallel (%[[VAL_67:.*]]) = (%[[VAL_2]]) to (%[[VAL_25]]) step (%[[VAL_3]]) {
+// CHECK:             scf.for %[[VAL_67:.*]] = %[[VAL_2]] to %[[VAL_25]] step %[[VAL_3]] {
 // CHECK:               %[[VAL_68:.*]] = memref.load %[[VAL_21]]{{\[}}%[[VAL_67]]] : memref<?xi64>
-// CHECK:               %[[VAL_69:.*]] = arith.index_cast %[[VAL_68]] : i64 to index
-// CHECK:               memref.store %[[VAL_7]], %[[VAL_66]]{{\[}}%[[VAL_69]]] : memref<?xi1>
 // CHECK:               %[[VAL_70:.*]] = memref.load %[[VAL_22]]{{\[}}%[[VAL_67]]] : memref<?xf64>
+// CHECK:               %[[VAL_69:.*]] = arith.index_cast %[[VAL_68]] : i64 to index
+// CHECK:               memref.store %[[VAL_5]], %[[VAL_66]]{{\[}}%[[VAL_69]]] : memref<?xi64>
 // CHECK:               memref.store %[[VAL_70]], %[[VAL_65]]{{\[}}%[[VAL_69]]] : memref<?xf64>
-// CHECK:               scf.yield
 // CHECK:             }
 // CHECK:             %[[VAL_71:.*]] = scf.for %[[VAL_72:.*]] = %[[VAL_2]] to %[[VAL_10]] step %[[VAL_3]] iter_args(%[[VAL_73:.*]] = %[[VAL_2]]) -> (index) {
 // CHECK:               %[[VAL_74:.*]] = arith.index_cast %[[VAL_72]] : index to i64
@@ -126,7 +126,8 @@
 // CHECK:               %[[VAL_80:.*]]:2 = scf.for %[[VAL_81:.*]] = %[[VAL_78]] to %[[VAL_79]] step %[[VAL_3]] iter_args(%[[VAL_82:.*]] = %[[VAL_9]], %[[VAL_83:.*]] = %[[VAL_8]]) -> (f64, i1) {
 // CHECK:                 %[[VAL_84:.*]] = memref.load %[[VAL_18]]{{\[}}%[[VAL_81]]] : memref<?xi64>
 // CHECK:                 %[[VAL_85:.*]] = arith.index_cast %[[VAL_84]] : i64 to index
-// CHECK:                 %[[VAL_86:.*]] = memref.load %[[VAL_66]]{{\[}}%[[VAL_85]]] : memref<?xi1>
+// CHECK:                 %[[KK_TAG2:.*]] = memref.load %[[VAL_66]]{{\[}}%[[VAL_85]]] : memref<?xi64>
+// CHECK:                 %[[VAL_86:.*]] = arith.cmpi eq, %[[KK_TAG2]], %[[VAL_5]] : i64
 // CHECK:                 %[[VAL_87:.*]]:2 = scf.if %[[VAL_86]] -> (f64, i1) {
 // CHECK:                   %[[VAL_88:.*]] = memref.load %[[VAL_65]]{{\[}}%[[VAL_85]]] : memref<?xf64>
 // CHECK:                   %[[VAL_89:.*]] = memref.load %[[VAL_19]]{{\[}}%[[VAL_81]]] : memref<?xf64>
@@ -148,8 +149,8 @@
 // CHECK:               }
 // CHECK:               scf.yield %[[VAL_96:.*]] : index
 // CHECK:             }
+// CHECK:             memref.dealloc %[[VAL_66]] : memref<?xi64>
 // CHECK:             memref.dealloc %[[VAL_65]] : memref<?xf64>
-// CHECK:             memref.dealloc %[[VAL_66]] : memref<?xi1>
 // CHECK:           }
 // CHECK:           return %[[VAL_13]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:         }
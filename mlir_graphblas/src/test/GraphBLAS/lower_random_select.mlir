@@ -18,65 +18,118 @@ func private @choose_uniform(!llvm.ptr<i8>, i64, i64, memref<?xi64, #map>, memre
 // CHECK-DAG:       %[[VAL_3:.*]] = arith.constant 0 : i64
 // CHECK-DAG:       %[[VAL_4:.*]] = arith.constant 1 : index
 // CHECK-DAG:       %[[VAL_5:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
 // CHECK:           %[[VAL_6:.*]] = tensor.dim %[[VAL_0]], %[[VAL_5]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:           %[[VAL_7:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_8:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
 // CHECK:           %[[VAL_9:.*]] = sparse_tensor.values %[[VAL_0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           %[[VAL_10:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_0]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           %[[VAL_11:.*]] = call @dup_tensor(%[[VAL_10]]) : (!llvm.ptr<i8>) -> !llvm.ptr<i8>
-// CHECK:           %[[VAL_12:.*]] = call @ptr8_to_matrix_csr_f64_p64i64(%[[VAL_11]]) : (!llvm.ptr<i8>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_13:.*]] = sparse_tensor.pointers %[[VAL_12]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_14:.*]] = sparse_tensor.indices %[[VAL_12]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_15:.*]] = sparse_tensor.values %[[VAL_12]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           memref.store %[[VAL_3]], %[[VAL_13]]{{\[}}%[[VAL_5]]] : memref<?xi64>
-// CHECK:           scf.for %[[VAL_16:.*]] = %[[VAL_5]] to %[[VAL_6]] step %[[VAL_4]] {
-// CHECK:             %[[VAL_17:.*]] = arith.addi %[[VAL_16]], %[[VAL_4]] : index
-// CHECK:             %[[VAL_18:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_16]]] : memref<?xi64>
-// CHECK:             %[[VAL_19:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_17]]] : memref<?xi64>
-// CHECK:             %[[VAL_20:.*]] = arith.subi %[[VAL_19]], %[[VAL_18]] : i64
-// CHECK:             %[[VAL_21:.*]] = arith.cmpi ule, %[[VAL_20]], %[[VAL_1]] : i64
-// CHECK:             %[[VAL_22:.*]] = select %[[VAL_21]], %[[VAL_20]], %[[VAL_1]] : i64
-// CHECK:             %[[VAL_23:.*]] = memref.load %[[VAL_13]]{{\[}}%[[VAL_16]]] : memref<?xi64>
-// CHECK:             %[[VAL_24:.*]] = arith.addi %[[VAL_23]], %[[VAL_22]] : i64
-// CHECK:             memref.store %[[VAL_24]], %[[VAL_13]]{{\[}}%[[VAL_17]]] : memref<?xi64>
+// CHECK:           %[[ENROW:.*]] = tensor.dim %[[VAL_0]], %[[VAL_5]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[ENCOL:.*]] = tensor.dim %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[VAL_10:.*]] = sparse_tensor.init{{\[}}%[[ENROW]], %[[ENCOL]]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[BNROW:.*]] = tensor.dim %[[VAL_10]], %[[VAL_5]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[BNROW1:.*]] = arith.addi %[[BNROW]], %[[VAL_4]] : index
+// CHECK:           %[[P0:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_10]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_pointers_zeroed(%[[P0]], %[[VAL_4]], %[[BNROW1]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[VAL_11:.*]] = sparse_tensor.pointers %[[VAL_10]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           call @start_random_stream(%[[VAL_2]]) : (!llvm.ptr<i8>) -> ()
+// CHECK:           scf.parallel (%[[VAL_12:.*]]) = (%[[VAL_5]]) to (%[[VAL_6]]) step (%[[VAL_4]]) {
+// CHECK:             %[[VAL_13:.*]] = arith.addi %[[VAL_12]], %[[VAL_4]] : index
+// CHECK:             %[[VAL_14:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_12]]] : memref<?xi64>
+// CHECK:             %[[VAL_15:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_13]]] : memref<?xi64>
+// CHECK:             %[[VAL_16:.*]] = arith.subi %[[VAL_15]], %[[VAL_14]] : i64
+// CHECK:             %[[VAL_17:.*]] = arith.cmpi ule, %[[VAL_16]], %[[VAL_1]] : i64
+// CHECK:             %[[VAL_18:.*]] = select %[[VAL_17]], %[[VAL_16]], %[[VAL_1]] : i64
+// CHECK:             memref.store %[[VAL_18]], %[[VAL_11]]{{\[}}%[[VAL_12]]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[NRM1:.*]] = arith.subi %[[VAL_6]], %[[VAL_4]] : index
+// CHECK:           %[[BSN:.*]] = arith.addi %[[NRM1]], %[[C256]] : index
+// CHECK:           %[[BSR:.*]] = arith.divui %[[BSN]], %[[C256]] : index
+// CHECK:           %[[BSE:.*]] = arith.cmpi eq, %[[BSR]], %[[VAL_5]] : index
+// CHECK:           %[[BS:.*]] = select %[[BSE]], %[[VAL_4]], %[[BSR]] : index
+// CHECK:           %[[BSM1:.*]] = arith.subi %[[BS]], %[[VAL_4]] : index
+// CHECK:           %[[NBN:.*]] = arith.addi %[[VAL_6]], %[[BSM1]] : index
+// CHECK:           %[[NB:.*]] = arith.divui %[[NBN]], %[[BS]] : index
+// CHECK:           %[[BT:.*]] = memref.alloc(%[[NB]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB1:.*]]) = (%[[VAL_5]]) to (%[[NB]]) step (%[[VAL_4]]) {
+// CHECK:             %[[RS1:.*]] = arith.muli %[[SB1]], %[[BS]] : index
+// CHECK:             %[[REF1:.*]] = arith.addi %[[RS1]], %[[BS]] : index
+// CHECK:             %[[REC1:.*]] = arith.cmpi ult, %[[REF1]], %[[VAL_6]] : index
+// CHECK:             %[[RE1:.*]] = select %[[REC1]], %[[REF1]], %[[VAL_6]] : index
+// CHECK:             %[[PSUM:.*]] = scf.for %[[SI1:.*]] = %[[RS1]] to %[[RE1]] step %[[VAL_4]] iter_args(%[[PS:.*]] = %[[VAL_3]]) -> (i64) {
+// CHECK:               %[[SV1:.*]] = memref.load %[[VAL_11]]{{\[}}%[[SI1]]] : memref<?xi64>
+// CHECK:               %[[PSN:.*]] = arith.addi %[[PS]], %[[SV1]] : i64
+// CHECK:               scf.yield %[[PSN]] : i64
+// CHECK:             }
+// CHECK:             memref.store %[[PSUM]], %[[BT]]{{\[}}%[[SB1]]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[TOTAL:.*]] = scf.for %[[SBB:.*]] = %[[VAL_5]] to %[[NB]] step %[[VAL_4]] iter_args(%[[BASE:.*]] = %[[VAL_3]]) -> (i64) {
+// CHECK:             %[[BTV:.*]] = memref.load %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             memref.store %[[BASE]], %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             %[[BASEN:.*]] = arith.addi %[[BASE]], %[[BTV]] : i64
+// CHECK:             scf.yield %[[BASEN]] : i64
+// CHECK:           }
+// CHECK:           scf.parallel (%[[SB3:.*]]) = (%[[VAL_5]]) to (%[[NB]]) step (%[[VAL_4]]) {
+// CHECK:             %[[RS3:.*]] = arith.muli %[[SB3]], %[[BS]] : index
+// CHECK:             %[[REF3:.*]] = arith.addi %[[RS3]], %[[BS]] : index
+// CHECK:             %[[REC3:.*]] = arith.cmpi ult, %[[REF3]], %[[VAL_6]] : index
+// CHECK:             %[[RE3:.*]] = select %[[REC3]], %[[REF3]], %[[VAL_6]] : index
+// CHECK:             %[[SBASE:.*]] = memref.load %[[BT]]{{\[}}%[[SB3]]] : memref<?xi64>
+// CHECK:             %[[SCAN:.*]] = scf.for %[[SI3:.*]] = %[[RS3]] to %[[RE3]] step %[[VAL_4]] iter_args(%[[CS:.*]] = %[[SBASE]]) -> (i64) {
+// CHECK:               %[[SV3:.*]] = memref.load %[[VAL_11]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               memref.store %[[CS]], %[[VAL_11]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               %[[CSN:.*]] = arith.addi %[[CS]], %[[SV3]] : i64
+// CHECK:               scf.yield %[[CSN]] : i64
+// CHECK:             }
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           scf.parallel (%[[VAL_25:.*]]) = (%[[VAL_5]]) to (%[[VAL_6]]) step (%[[VAL_4]]) {
-// CHECK:             %[[VAL_26:.*]] = arith.addi %[[VAL_25]], %[[VAL_4]] : index
-// CHECK:             %[[VAL_27:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_25]]] : memref<?xi64>
-// CHECK:             %[[VAL_28:.*]] = arith.index_cast %[[VAL_27]] : i64 to index
-// CHECK:             %[[VAL_29:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_26]]] : memref<?xi64>
-// CHECK:             %[[VAL_30:.*]] = arith.index_cast %[[VAL_29]] : i64 to index
-// CHECK:             %[[VAL_31:.*]] = memref.load %[[VAL_13]]{{\[}}%[[VAL_25]]] : memref<?xi64>
-// CHECK:             %[[VAL_32:.*]] = arith.index_cast %[[VAL_31]] : i64 to index
-// CHECK:             %[[VAL_33:.*]] = memref.load %[[VAL_13]]{{\[}}%[[VAL_26]]] : memref<?xi64>
-// CHECK:             %[[VAL_34:.*]] = arith.index_cast %[[VAL_33]] : i64 to index
-// CHECK:             %[[VAL_35:.*]] = arith.subi %[[VAL_30]], %[[VAL_28]] : index
-// CHECK:             %[[VAL_36:.*]] = arith.index_cast %[[VAL_35]] : index to i64
-// CHECK:             %[[VAL_37:.*]] = arith.subi %[[VAL_34]], %[[VAL_32]] : index
-// CHECK:             %[[VAL_38:.*]] = arith.index_cast %[[VAL_37]] : index to i64
-// CHECK:             %[[VAL_39:.*]] = arith.cmpi eq, %[[VAL_35]], %[[VAL_37]] : index
-// CHECK:             %[[VAL_40:.*]] = memref.subview %[[VAL_14]]{{\[}}%[[VAL_32]]] {{\[}}%[[VAL_37]]] {{\[}}%[[VAL_4]]] : memref<?xi64> to memref<?xi64, #map>
-// CHECK:             %[[VAL_41:.*]] = memref.subview %[[VAL_15]]{{\[}}%[[VAL_32]]] {{\[}}%[[VAL_37]]] {{\[}}%[[VAL_4]]] : memref<?xf64> to memref<?xf64, #map>
-// CHECK:             %[[VAL_42:.*]] = memref.subview %[[VAL_8]]{{\[}}%[[VAL_28]]] {{\[}}%[[VAL_35]]] {{\[}}%[[VAL_4]]] : memref<?xi64> to memref<?xi64, #map>
-// CHECK:             %[[VAL_43:.*]] = memref.subview %[[VAL_9]]{{\[}}%[[VAL_28]]] {{\[}}%[[VAL_35]]] {{\[}}%[[VAL_4]]] : memref<?xf64> to memref<?xf64, #map>
-// CHECK:             scf.if %[[VAL_39]] {
-// CHECK:               memref.copy %[[VAL_42]], %[[VAL_40]] : memref<?xi64, #map> to memref<?xi64, #map>
-// CHECK:               memref.copy %[[VAL_43]], %[[VAL_41]] : memref<?xf64, #map> to memref<?xf64, #map>
+// CHECK:           memref.dealloc %[[BT]] : memref<?xi64>
+// CHECK:           memref.store %[[TOTAL]], %[[VAL_11]]{{\[}}%[[VAL_6]]] : memref<?xi64>
+// CHECK:           %[[BNNZ:.*]] = arith.index_cast %[[TOTAL]] : i64 to index
+// CHECK:           %[[P1:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_10]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_index(%[[P1]], %[[VAL_4]], %[[BNNZ]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P2:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_10]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_values(%[[P2]], %[[BNNZ]]) : (!llvm.ptr<i8>, index) -> ()
+// CHECK:           %[[VAL_20:.*]] = sparse_tensor.indices %[[VAL_10]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[VAL_21:.*]] = sparse_tensor.values %[[VAL_10]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
+// CHECK:           scf.parallel (%[[VAL_22:.*]]) = (%[[VAL_5]]) to (%[[VAL_6]]) step (%[[VAL_4]]) {
+// CHECK:             %[[VAL_23:.*]] = arith.addi %[[VAL_22]], %[[VAL_4]] : index
+// CHECK:             %[[VAL_24:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_22]]] : memref<?xi64>
+// CHECK:             %[[VAL_25:.*]] = arith.index_cast %[[VAL_24]] : i64 to index
+// CHECK:             %[[VAL_26:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_23]]] : memref<?xi64>
+// CHECK:             %[[VAL_27:.*]] = arith.index_cast %[[VAL_26]] : i64 to index
+// CHECK:             %[[VAL_28:.*]] = memref.load %[[VAL_11]]{{\[}}%[[VAL_22]]] : memref<?xi64>
+// CHECK:             %[[VAL_29:.*]] = arith.index_cast %[[VAL_28]] : i64 to index
+// CHECK:             %[[VAL_30:.*]] = memref.load %[[VAL_11]]{{\[}}%[[VAL_23]]] : memref<?xi64>
+// CHECK:             %[[VAL_31:.*]] = arith.index_cast %[[VAL_30]] : i64 to index
+// CHECK:             %[[VAL_32:.*]] = arith.subi %[[VAL_27]], %[[VAL_25]] : index
+// CHECK:             %[[VAL_33:.*]] = arith.index_cast %[[VAL_32]] : index to i64
+// CHECK:             %[[VAL_34:.*]] = arith.subi %[[VAL_31]], %[[VAL_29]] : index
+// CHECK:             %[[VAL_35:.*]] = arith.index_cast %[[VAL_34]] : index to i64
+// CHECK:             %[[VAL_36:.*]] = arith.cmpi eq, %[[VAL_32]], %[[VAL_34]] : index
+// CHECK:             %[[VAL_37:.*]] = memref.subview %[[VAL_20]]{{\[}}%[[VAL_29]]] {{\[}}%[[VAL_34]]] {{\[}}%[[VAL_4]]] : memref<?xi64> to memref<?xi64, #map>
+// CHECK:             %[[VAL_38:.*]] = memref.subview %[[VAL_21]]{{\[}}%[[VAL_29]]] {{\[}}%[[VAL_34]]] {{\[}}%[[VAL_4]]] : memref<?xf64> to memref<?xf64, #map>
+// CHECK:             %[[VAL_39:.*]] = memref.subview %[[VAL_8]]{{\[}}%[[VAL_25]]] {{\[}}%[[VAL_32]]] {{\[}}%[[VAL_4]]] : memref<?xi64> to memref<?xi64, #map>
+// CHECK:             %[[VAL_40:.*]] = memref.subview %[[VAL_9]]{{\[}}%[[VAL_25]]] {{\[}}%[[VAL_32]]] {{\[}}%[[VAL_4]]] : memref<?xf64> to memref<?xf64, #map>
+// CHECK:             scf.if %[[VAL_36]] {
+// CHECK:               memref.copy %[[VAL_39]], %[[VAL_37]] : memref<?xi64, #map> to memref<?xi64, #map>
+// CHECK:               memref.copy %[[VAL_40]], %[[VAL_38]] : memref<?xf64, #map> to memref<?xf64, #map>
 // CHECK:             } else {
-// CHECK:               call @choose_uniform(%[[VAL_2]], %[[VAL_38]], %[[VAL_36]], %[[VAL_40]], %[[VAL_43]]) : (!llvm.ptr<i8>, i64, i64, memref<?xi64, #map>, memref<?xf64, #map>) -> ()
-// CHECK:               scf.parallel (%[[VAL_44:.*]]) = (%[[VAL_5]]) to (%[[VAL_37]]) step (%[[VAL_4]]) {
-// CHECK:                 %[[VAL_45:.*]] = memref.load %[[VAL_40]]{{\[}}%[[VAL_44]]] : memref<?xi64, #map>
-// CHECK:                 %[[VAL_46:.*]] = arith.index_cast %[[VAL_45]] : i64 to index
-// CHECK:                 %[[VAL_47:.*]] = memref.load %[[VAL_42]]{{\[}}%[[VAL_46]]] : memref<?xi64, #map>
-// CHECK:                 %[[VAL_48:.*]] = memref.load %[[VAL_43]]{{\[}}%[[VAL_46]]] : memref<?xf64, #map>
-// CHECK:                 memref.store %[[VAL_47]], %[[VAL_40]]{{\[}}%[[VAL_44]]] : memref<?xi64, #map>
-// CHECK:                 memref.store %[[VAL_48]], %[[VAL_41]]{{\[}}%[[VAL_44]]] : memref<?xf64, #map>
+// CHECK:               call @choose_uniform(%[[VAL_2]], %[[VAL_35]], %[[VAL_33]], %[[VAL_37]], %[[VAL_40]]) : (!llvm.ptr<i8>, i64, i64, memref<?xi64, #map>, memref<?xf64, #map>) -> ()
+// CHECK:               scf.parallel (%[[VAL_41:.*]]) = (%[[VAL_5]]) to (%[[VAL_34]]) step (%[[VAL_4]]) {
+// CHECK:                 %[[VAL_42:.*]] = memref.load %[[VAL_37]]{{\[}}%[[VAL_41]]] : memref<?xi64, #map>
+// CHECK:                 %[[VAL_43:.*]] = arith.index_cast %[[VAL_42]] : i64 to index
+// CHECK:                 %[[VAL_44:.*]] = memref.load %[[VAL_39]]{{\[}}%[[VAL_43]]] : memref<?xi64, #map>
+// CHECK:                 %[[VAL_45:.*]] = memref.load %[[VAL_40]]{{\[}}%[[VAL_43]]] : memref<?xf64, #map>
+// CHECK:                 memref.store %[[VAL_44]], %[[VAL_37]]{{\[}}%[[VAL_41]]] : memref<?xi64, #map>
+// CHECK:                 memref.store %[[VAL_45]], %[[VAL_38]]{{\[}}%[[VAL_41]]] : memref<?xf64, #map>
 // CHECK:                 scf.yield
 // CHECK:               }
 // CHECK:             }
 // CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           return %[[VAL_12]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           return %[[VAL_10]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:         }
 func @select_random_uniform(%sparse_tensor: tensor<?x?xf64, #CSR64>, %n: i64, %ctx: !llvm.ptr<i8>) -> tensor<?x?xf64, #CSR64> {
     %answer = graphblas.matrix_select_random %sparse_tensor, %n, %ctx { choose_n = @choose_uniform } : (tensor<?x?xf64, #CSR64>, i64, !llvm.ptr<i8>) to tensor<?x?xf64, #CSR64>
@@ -0,0 +1,91 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+func private @vector_f64_p64i64_to_ptr8(tensor<?xf64, #CV64>) -> !llvm.ptr<i8>
+func private @ptr8_to_vector_f64_p64i64(!llvm.ptr<i8>) -> tensor<?xf64, #CV64>
+
+// Intermediates made inside a loop body are released after their last use
+
+// CHECK-LABEL:   func @release_in_loop_body(
+// CHECK:           scf.for
+// CHECK:             sparse_tensor.init
+// CHECK:             sparse_tensor.release %{{.*}} : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:             arith.addf
+// CHECK:             scf.yield
+// CHECK:           return
+
+func @release_in_loop_body(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>, %n: index) -> f64 {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %zero = arith.constant 0.0 : f64
+    %total = scf.for %i = %c0 to %n step %c1 iter_args(%sum = %zero) -> (f64) {
+        %product = graphblas.intersect %a, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        %partial = graphblas.reduce_to_scalar %product { aggregator = "plus" } : tensor<?xf64, #CV64> to f64
+        %new_sum = arith.addf %sum, %partial : f64
+        scf.yield %new_sum : f64
+    }
+    return %total : f64
+}
+
+// A loop-carried tensor is released by the iteration which replaces it, and
+// the initial value is handed over to the loop
+
+// CHECK-LABEL:   func @release_loop_carried(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           scf.for
+// CHECK:             call @delSparseTensor(%{{.*}}) : (!llvm.ptr<i8>) -> ()
+// CHECK:             call @vector_f64_p64i64_to_ptr8
+// CHECK:             scf.yield
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           return
+
+func @release_loop_carried(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>, %n: index) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %start = graphblas.intersect %a, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    %start_ptr8 = call @vector_f64_p64i64_to_ptr8(%start) : (tensor<?xf64, #CV64>) -> !llvm.ptr<i8>
+    %final_ptr8 = scf.for %i = %c0 to %n step %c1 iter_args(%prev_ptr8 = %start_ptr8) -> (!llvm.ptr<i8>) {
+        %prev = call @ptr8_to_vector_f64_p64i64(%prev_ptr8) : (!llvm.ptr<i8>) -> tensor<?xf64, #CV64>
+        %next = graphblas.intersect %prev, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        %next_ptr8 = call @vector_f64_p64i64_to_ptr8(%next) : (tensor<?xf64, #CV64>) -> !llvm.ptr<i8>
+        scf.yield %next_ptr8 : !llvm.ptr<i8>
+    }
+    %final = call @ptr8_to_vector_f64_p64i64(%final_ptr8) : (!llvm.ptr<i8>) -> tensor<?xf64, #CV64>
+    return %final : tensor<?xf64, #CV64>
+}
+
+// An intermediate stored to memory or handed to an unknown function may
+// outlive the function, so it is not released
+
+// CHECK-LABEL:   func @no_release_when_stored(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           %[[PTR8:.*]] = call @vector_f64_p64i64_to_ptr8(
+// CHECK-NEXT:      llvm.store %[[PTR8]], %{{.*}} : !llvm.ptr<!llvm.ptr<i8>>
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           return
+
+func @no_release_when_stored(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>, %dest: !llvm.ptr<!llvm.ptr<i8>>) {
+    %product = graphblas.intersect %a, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    %product_ptr8 = call @vector_f64_p64i64_to_ptr8(%product) : (tensor<?xf64, #CV64>) -> !llvm.ptr<i8>
+    llvm.store %product_ptr8, %dest : !llvm.ptr<!llvm.ptr<i8>>
+    return
+}
+
+func private @keep_vector(tensor<?xf64, #CV64>) -> ()
+
+// CHECK-LABEL:   func @no_release_when_passed_to_external_call(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           call @keep_vector(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           return
+
+func @no_release_when_passed_to_external_call(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>) {
+    %product = graphblas.intersect %a, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    call @keep_vector(%product) : (tensor<?xf64, #CV64>) -> ()
+    return
+}
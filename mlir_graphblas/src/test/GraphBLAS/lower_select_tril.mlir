@@ -9,51 +9,121 @@
 
 // CHECK-LABEL:   func @select_tril(
 // CHECK-SAME:                      %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> {
-// CHECK-DAG:       %[[VAL_2:.*]] = arith.constant 1 : i64
-// CHECK-DAG:       %[[VAL_3:.*]] = arith.constant 1 : index
-// CHECK-DAG:       %[[VAL_4:.*]] = arith.constant 0 : index
-// CHECK:           %[[VAL_5:.*]] = tensor.dim %[[VAL_0]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_6:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_7:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_8:.*]] = sparse_tensor.values %[[VAL_0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           %[[VAL_9:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_0]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           %[[VAL_10:.*]] = call @dup_tensor(%[[VAL_9]]) : (!llvm.ptr<i8>) -> !llvm.ptr<i8>
-// CHECK:           %[[VAL_11:.*]] = call @ptr8_to_matrix_csr_f64_p64i64(%[[VAL_10]]) : (!llvm.ptr<i8>) -> tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_12:.*]] = sparse_tensor.pointers %[[VAL_11]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_13:.*]] = sparse_tensor.indices %[[VAL_11]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_14:.*]] = sparse_tensor.values %[[VAL_11]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
-// CHECK:           scf.for %[[VAL_15:.*]] = %[[VAL_4]] to %[[VAL_5]] step %[[VAL_3]] {
-// CHECK:             %[[VAL_16:.*]] = arith.addi %[[VAL_15]], %[[VAL_3]] : index
-// CHECK:             %[[VAL_17:.*]] = memref.load %[[VAL_12]]{{\[}}%[[VAL_15]]] : memref<?xi64>
-// CHECK:             memref.store %[[VAL_17]], %[[VAL_12]]{{\[}}%[[VAL_16]]] : memref<?xi64>
-// CHECK:             %[[VAL_18:.*]] = memref.load %[[VAL_6]]{{\[}}%[[VAL_15]]] : memref<?xi64>
-// CHECK:             %[[VAL_19:.*]] = memref.load %[[VAL_6]]{{\[}}%[[VAL_16]]] : memref<?xi64>
-// CHECK:             %[[VAL_20:.*]] = arith.index_cast %[[VAL_18]] : i64 to index
-// CHECK:             %[[VAL_21:.*]] = arith.index_cast %[[VAL_19]] : i64 to index
-// CHECK:             scf.for %[[VAL_22:.*]] = %[[VAL_20]] to %[[VAL_21]] step %[[VAL_3]] {
-// CHECK:               %[[VAL_23:.*]] = memref.load %[[VAL_7]]{{\[}}%[[VAL_22]]] : memref<?xi64>
-// CHECK:               %[[VAL_24:.*]] = arith.index_cast %[[VAL_23]] : i64 to index
-// CHECK:               %[[VAL_25:.*]] = memref.load %[[VAL_8]]{{\[}}%[[VAL_22]]] : memref<?xf64>
-// CHECK:               %[[VAL_26:.*]] = arith.cmpi ult, %[[VAL_24]], %[[VAL_15]] : index
-// CHECK:               scf.if %[[VAL_26]] {
-// CHECK:                 %[[VAL_27:.*]] = memref.load %[[VAL_12]]{{\[}}%[[VAL_16]]] : memref<?xi64>
-// CHECK:                 %[[VAL_28:.*]] = arith.index_cast %[[VAL_27]] : i64 to index
-// CHECK:                 memref.store %[[VAL_23]], %[[VAL_13]]{{\[}}%[[VAL_28]]] : memref<?xi64>
-// CHECK:                 memref.store %[[VAL_25]], %[[VAL_14]]{{\[}}%[[VAL_28]]] : memref<?xf64>
-// CHECK:                 %[[VAL_29:.*]] = arith.addi %[[VAL_27]], %[[VAL_2]] : i64
-// CHECK:                 memref.store %[[VAL_29]], %[[VAL_12]]{{\[}}%[[VAL_16]]] : memref<?xi64>
+// CHECK-DAG:       %[[VAL_1:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[VAL_2:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[CI0:.*]] = arith.constant 0 : i64
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
+// CHECK:           %[[VAL_3:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[VAL_4:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[VAL_5:.*]] = sparse_tensor.indices %[[VAL_0]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[VAL_6:.*]] = sparse_tensor.values %[[VAL_0]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
+// CHECK:           %[[NNZP:.*]] = sparse_tensor.pointers %[[VAL_0]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[NNZD:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[NNZ64:.*]] = memref.load %[[NNZP]]{{\[}}%[[NNZD]]] : memref<?xi64>
+// CHECK:           %[[NNZ:.*]] = arith.index_cast %[[NNZ64]] : i64 to index
+// CHECK:           %[[ENROW:.*]] = tensor.dim %[[VAL_0]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[ENCOL:.*]] = tensor.dim %[[VAL_0]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[VAL_7:.*]] = sparse_tensor.init{{\[}}%[[ENROW]], %[[ENCOL]]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[BNROW:.*]] = tensor.dim %[[VAL_7]], %[[VAL_2]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           %[[BNROW1:.*]] = arith.addi %[[BNROW]], %[[VAL_1]] : index
+// CHECK:           %[[P0:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_7]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_pointers_zeroed(%[[P0]], %[[VAL_1]], %[[BNROW1]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[VAL_8:.*]] = sparse_tensor.pointers %[[VAL_7]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[VAL_9:.*]] = memref.alloc(%[[NNZ]]) : memref<?xi1>
+// CHECK:           scf.parallel (%[[VAL_10:.*]]) = (%[[VAL_2]]) to (%[[VAL_3]]) step (%[[VAL_1]]) {
+// CHECK:             %[[R1:.*]] = arith.addi %[[VAL_10]], %[[VAL_1]] : index
+// CHECK:             %[[JS64:.*]] = memref.load %[[VAL_4]]{{\[}}%[[VAL_10]]] : memref<?xi64>
+// CHECK:             %[[JE64:.*]] = memref.load %[[VAL_4]]{{\[}}%[[R1]]] : memref<?xi64>
+// CHECK:             %[[JS:.*]] = arith.index_cast %[[JS64]] : i64 to index
+// CHECK:             %[[JE:.*]] = arith.index_cast %[[JE64]] : i64 to index
+// CHECK:             %[[VAL_11:.*]] = scf.for %[[VAL_12:.*]] = %[[JS]] to %[[JE]] step %[[VAL_1]] iter_args(%[[VAL_13:.*]] = %[[VAL_2]]) -> (index) {
+// CHECK:               %[[VAL_14:.*]] = memref.load %[[VAL_5]]{{\[}}%[[VAL_12]]] : memref<?xi64>
+// CHECK:               %[[VAL_15:.*]] = arith.index_cast %[[VAL_14]] : i64 to index
+// CHECK:               %[[VAL_16:.*]] = arith.cmpi ult, %[[VAL_15]], %[[VAL_10]] : index
+// CHECK:               memref.store %[[VAL_16]], %[[VAL_9]]{{\[}}%[[VAL_12]]] : memref<?xi1>
+// CHECK:               %[[VAL_17:.*]] = select %[[VAL_16]], %[[VAL_1]], %[[VAL_2]] : index
+// CHECK:               %[[VAL_18:.*]] = arith.addi %[[VAL_13]], %[[VAL_17]] : index
+// CHECK:               scf.yield %[[VAL_18]] : index
+// CHECK:             }
+// CHECK:             %[[VAL_19:.*]] = arith.index_cast %[[VAL_11]] : index to i64
+// CHECK:             memref.store %[[VAL_19]], %[[VAL_8]]{{\[}}%[[VAL_10]]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[NRM1:.*]] = arith.subi %[[VAL_3]], %[[VAL_1]] : index
+// CHECK:           %[[BSN:.*]] = arith.addi %[[NRM1]], %[[C256]] : index
+// CHECK:           %[[BSR:.*]] = arith.divui %[[BSN]], %[[C256]] : index
+// CHECK:           %[[BSE:.*]] = arith.cmpi eq, %[[BSR]], %[[VAL_2]] : index
+// CHECK:           %[[BS:.*]] = select %[[BSE]], %[[VAL_1]], %[[BSR]] : index
+// CHECK:           %[[BSM1:.*]] = arith.subi %[[BS]], %[[VAL_1]] : index
+// CHECK:           %[[NBN:.*]] = arith.addi %[[VAL_3]], %[[BSM1]] : index
+// CHECK:           %[[NB:.*]] = arith.divui %[[NBN]], %[[BS]] : index
+// CHECK:           %[[BT:.*]] = memref.alloc(%[[NB]]) : memref<?xi64>
+// CHECK:           scf.parallel (%[[SB1:.*]]) = (%[[VAL_2]]) to (%[[NB]]) step (%[[VAL_1]]) {
+// CHECK:             %[[RS1:.*]] = arith.muli %[[SB1]], %[[BS]] : index
+// CHECK:             %[[REF1:.*]] = arith.addi %[[RS1]], %[[BS]] : index
+// CHECK:             %[[REC1:.*]] = arith.cmpi ult, %[[REF1]], %[[VAL_3]] : index
+// CHECK:             %[[RE1:.*]] = select %[[REC1]], %[[REF1]], %[[VAL_3]] : index
+// CHECK:             %[[PSUM:.*]] = scf.for %[[SI1:.*]] = %[[RS1]] to %[[RE1]] step %[[VAL_1]] iter_args(%[[PS:.*]] = %[[CI0]]) -> (i64) {
+// CHECK:               %[[SV1:.*]] = memref.load %[[VAL_8]]{{\[}}%[[SI1]]] : memref<?xi64>
+// CHECK:               %[[PSN:.*]] = arith.addi %[[PS]], %[[SV1]] : i64
+// CHECK:               scf.yield %[[PSN]] : i64
+// CHECK:             }
+// CHECK:             memref.store %[[PSUM]], %[[BT]]{{\[}}%[[SB1]]] : memref<?xi64>
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           %[[TOTAL:.*]] = scf.for %[[SBB:.*]] = %[[VAL_2]] to %[[NB]] step %[[VAL_1]] iter_args(%[[BASE:.*]] = %[[CI0]]) -> (i64) {
+// CHECK:             %[[BTV:.*]] = memref.load %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             memref.store %[[BASE]], %[[BT]]{{\[}}%[[SBB]]] : memref<?xi64>
+// CHECK:             %[[BASEN:.*]] = arith.addi %[[BASE]], %[[BTV]] : i64
+// CHECK:             scf.yield %[[BASEN]] : i64
+// CHECK:           }
+// CHECK:           scf.parallel (%[[SB3:.*]]) = (%[[VAL_2]]) to (%[[NB]]) step (%[[VAL_1]]) {
+// CHECK:             %[[RS3:.*]] = arith.muli %[[SB3]], %[[BS]] : index
+// CHECK:             %[[REF3:.*]] = arith.addi %[[RS3]], %[[BS]] : index
+// CHECK:             %[[REC3:.*]] = arith.cmpi ult, %[[REF3]], %[[VAL_3]] : index
+// CHECK:             %[[RE3:.*]] = select %[[REC3]], %[[REF3]], %[[VAL_3]] : index
+// CHECK:             %[[SBASE:.*]] = memref.load %[[BT]]{{\[}}%[[SB3]]] : memref<?xi64>
+// CHECK:             %[[SCAN:.*]] = scf.for %[[SI3:.*]] = %[[RS3]] to %[[RE3]] step %[[VAL_1]] iter_args(%[[CS:.*]] = %[[SBASE]]) -> (i64) {
+// CHECK:               %[[SV3:.*]] = memref.load %[[VAL_8]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               memref.store %[[CS]], %[[VAL_8]]{{\[}}%[[SI3]]] : memref<?xi64>
+// CHECK:               %[[CSN:.*]] = arith.addi %[[CS]], %[[SV3]] : i64
+// CHECK:               scf.yield %[[CSN]] : i64
+// CHECK:             }
+// CHECK:             scf.yield
+// CHECK:           }
+// CHECK:           memref.dealloc %[[BT]] : memref<?xi64>
+// CHECK:           memref.store %[[TOTAL]], %[[VAL_8]]{{\[}}%[[VAL_3]]] : memref<?xi64>
+// CHECK:           %[[BNNZ:.*]] = arith.index_cast %[[TOTAL]] : i64 to index
+// CHECK:           %[[P1:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_7]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_index(%[[P1]], %[[VAL_1]], %[[BNNZ]]) : (!llvm.ptr<i8>, index, index) -> ()
+// CHECK:           %[[P2:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_7]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
+// CHECK:           call @resize_values(%[[P2]], %[[BNNZ]]) : (!llvm.ptr<i8>, index) -> ()
+// CHECK:           %[[VAL_20:.*]] = sparse_tensor.indices %[[VAL_7]], %[[VAL_1]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
+// CHECK:           %[[VAL_21:.*]] = sparse_tensor.values %[[VAL_7]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xf64>
+// CHECK:           scf.parallel (%[[VAL_22:.*]]) = (%[[VAL_2]]) to (%[[VAL_3]]) step (%[[VAL_1]]) {
+// CHECK:             %[[R3:.*]] = arith.addi %[[VAL_22]], %[[VAL_1]] : index
+// CHECK:             %[[JS364:.*]] = memref.load %[[VAL_4]]{{\[}}%[[VAL_22]]] : memref<?xi64>
+// CHECK:             %[[JE364:.*]] = memref.load %[[VAL_4]]{{\[}}%[[R3]]] : memref<?xi64>
+// CHECK:             %[[JS3:.*]] = arith.index_cast %[[JS364]] : i64 to index
+// CHECK:             %[[JE3:.*]] = arith.index_cast %[[JE364]] : i64 to index
+// CHECK:             %[[VAL_23:.*]] = memref.load %[[VAL_8]]{{\[}}%[[VAL_22]]] : memref<?xi64>
+// CHECK:             %[[VAL_24:.*]] = arith.index_cast %[[VAL_23]] : i64 to index
+// CHECK:             %{{.*}} = scf.for %[[VAL_25:.*]] = %[[JS3]] to %[[JE3]] step %[[VAL_1]] iter_args(%[[VAL_26:.*]] = %[[VAL_24]]) -> (index) {
+// CHECK:               %[[VAL_27:.*]] = memref.load %[[VAL_9]]{{\[}}%[[VAL_25]]] : memref<?xi1>
+// CHECK:               scf.if %[[VAL_27]] {
+// CHECK:                 %[[VAL_28:.*]] = memref.load %[[VAL_5]]{{\[}}%[[VAL_25]]] : memref<?xi64>
+// CHECK:                 %[[VAL_29:.*]] = memref.load %[[VAL_6]]{{\[}}%[[VAL_25]]] : memref<?xf64>
+// CHECK:                 memref.store %[[VAL_28]], %[[VAL_20]]{{\[}}%[[VAL_26]]] : memref<?xi64>
+// CHECK:                 memref.store %[[VAL_29]], %[[VAL_21]]{{\[}}%[[VAL_26]]] : memref<?xf64>
 // CHECK:               }
+// CHECK:               %[[VAL_30:.*]] = select %[[VAL_27]], %[[VAL_1]], %[[VAL_2]] : index
+// CHECK:               %[[VAL_31:.*]] = arith.addi %[[VAL_26]], %[[VAL_30]] : index
+// CHECK:               scf.yield %[[VAL_31]] : index
 // CHECK:             }
+// CHECK:             scf.yield
 // CHECK:           }
-// CHECK:           %[[VAL_30:.*]] = sparse_tensor.pointers %[[VAL_11]], %[[VAL_3]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>> to memref<?xi64>
-// CHECK:           %[[VAL_31:.*]] = tensor.dim %[[VAL_11]], %[[VAL_4]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
-// CHECK:           %[[VAL_32:.*]] = memref.load %[[VAL_30]]{{\[}}%[[VAL_31]]] : memref<?xi64>
-// CHECK:           %[[VAL_33:.*]] = arith.index_cast %[[VAL_32]] : i64 to index
-// CHECK:           %[[VAL_34:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_11]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_index(%[[VAL_34]], %[[VAL_3]], %[[VAL_33]]) : (!llvm.ptr<i8>, index, index) -> ()
-// CHECK:           %[[VAL_35:.*]] = call @matrix_csr_f64_p64i64_to_ptr8(%[[VAL_11]]) : (tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>) -> !llvm.ptr<i8>
-// CHECK:           call @resize_values(%[[VAL_35]], %[[VAL_33]]) : (!llvm.ptr<i8>, index) -> ()
-// CHECK:           return %[[VAL_11]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK:           memref.dealloc %[[VAL_9]] : memref<?xi1>
+// CHECK:           return %[[VAL_7]] : tensor<?x?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "dense", "compressed" ], dimOrdering = affine_map<(d0, d1) -> (d0, d1)>, pointerBitWidth = 64, indexBitWidth = 64 }>>
 // CHECK:         }
 
 func @select_tril(%sparse_tensor: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSR64> {
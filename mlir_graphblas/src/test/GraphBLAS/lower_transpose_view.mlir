@@ -0,0 +1,47 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CSC64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (j,i)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// Transpose relabels a view of the input rather than copying its storage
+
+// CHECK-LABEL:   func @transpose(
+// CHECK-NOT:       call @dup_tensor
+// CHECK:           %[[VIEW:.*]] = call @view_tensor(%{{.*}}) : (!llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:           call @assign_rev
+// CHECK:           call @assign_rev
+// CHECK-NOT:       call @dup_tensor
+// CHECK:           return
+
+func @transpose(%m: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSC64> {
+    %answer = graphblas.transpose %m : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSC64>
+    return %answer : tensor<?x?xf64, #CSC64>
+}
+
+// Cast shares the pointers and indices of the input and only allocates values
+
+// CHECK-LABEL:   func @cast(
+// CHECK-NOT:       call @dup_tensor
+// CHECK:           call @share_pointers(%{{.*}}, %{{.*}}) : (!llvm.ptr<i8>, !llvm.ptr<i8>) -> ()
+// CHECK:           call @share_indices(%{{.*}}, %{{.*}}) : (!llvm.ptr<i8>, !llvm.ptr<i8>) -> ()
+// CHECK:           call @resize_values
+// CHECK:           scf.parallel
+// CHECK:             arith.fptosi
+// CHECK-NOT:       call @dup_tensor
+// CHECK:           return
+
+func @cast(%m: tensor<?x?xf64, #CSR64>) -> tensor<?x?xi64, #CSR64> {
+    %answer = graphblas.cast %m : tensor<?x?xf64, #CSR64> to tensor<?x?xi64, #CSR64>
+    return %answer : tensor<?x?xi64, #CSR64>
+}
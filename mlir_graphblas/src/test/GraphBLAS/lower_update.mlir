@@ -0,0 +1,51 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-lower | FileCheck %s
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// An input read only by the update has its buffers moved into the output, and
+// is then released once, by the intermediate release of its producer
+
+// CHECK-LABEL:   func @update_move_from_select(
+// CHECK-SAME:                                   %[[VAL_0:.*]]: tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>,
+// CHECK-SAME:                                   %[[VAL_1:.*]]: tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>,
+// CHECK-SAME:                                   %[[VAL_2:.*]]: f64) {
+// CHECK-NOT:       call @dup_tensor
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           call @swap_pointers(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           call @swap_indices(
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           call @swap_values(
+// CHECK-NEXT:      sparse_tensor.release %{{.*}} : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           return
+// CHECK:         }
+
+func @update_move_from_select(%input: tensor<?xf64, #CV64>, %output: tensor<?xf64, #CV64>, %thunk: f64) {
+    %selected = graphblas.select %input, %thunk { selector = "gt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    graphblas.update %selected -> %output : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>
+    return
+}
+
+// An input which is still read afterwards is copied, and only the copy is
+// released by the update
+
+// CHECK-LABEL:   func @update_copy_from_argument(
+// CHECK:           %[[VAL_0:.*]] = call @dup_tensor(
+// CHECK:           %[[VAL_1:.*]] = call @ptr8_to_vector_f64_p64i64(%[[VAL_0]])
+// CHECK:           call @swap_pointers(
+// CHECK:           call @swap_indices(
+// CHECK:           call @swap_values(
+// CHECK:           sparse_tensor.release %[[VAL_1]] : tensor<?xf64, #sparse_tensor.encoding<{ dimLevelType = [ "compressed" ], pointerBitWidth = 64, indexBitWidth = 64 }>>
+// CHECK-NOT:       sparse_tensor.release
+// CHECK:           return
+// CHECK:         }
+
+func @update_copy_from_argument(%input: tensor<?xf64, #CV64>, %output: tensor<?xf64, #CV64>) {
+    graphblas.update %input -> %output : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>
+    return
+}
@@ -0,0 +1,200 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-structuralize --graphblas-optimize | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CSC64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (j,i)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// CHECK-LABEL:   func @fuse_apply_apply(
+// CHECK-SAME:                           %[[ARG0:.*]]: tensor<?x?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.apply_generic %[[ARG0]] : {{.*}} {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        %[[NEG:.*]] = arith.negf %[[ABS]] : f64
+// CHECK-NEXT:        graphblas.yield transform_out %[[NEG]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_apply_apply(%m: tensor<?x?xf64, #CSR64>) -> tensor<?x?xf64, #CSR64> {
+    %0 = graphblas.apply %m { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.apply %0 { apply_operator = "ainv" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    return %1 : tensor<?x?xf64, #CSR64>
+}
+
+// CHECK-LABEL:   func @fuse_select_apply(
+// CHECK-SAME:                            %[[ARG0:.*]]: tensor<?x?xf64, {{.*}}>>, %[[THUNK:.*]]: f64)
+// CHECK:           %[[RESULT:.*]] = graphblas.select_generic %[[ARG0]] : {{.*}} {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        graphblas.yield transform_out %[[ABS]] : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[X:.*]]: f64):
+// CHECK-NEXT:        %[[KEEP:.*]] = arith.cmpf ogt, %[[X]], %[[THUNK]] : f64
+// CHECK-NEXT:        graphblas.yield select_out %[[KEEP]] : i1
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_select_apply(%m: tensor<?x?xf64, #CSR64>, %thunk: f64) -> tensor<?x?xf64, #CSR64> {
+    %0 = graphblas.apply %m { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.select %0, %thunk { selector = "gt" } : tensor<?x?xf64, #CSR64>, f64 to tensor<?x?xf64, #CSR64>
+    return %1 : tensor<?x?xf64, #CSR64>
+}
+
+// CHECK-LABEL:   func @fuse_select_select(
+// CHECK-SAME:                             %[[ARG0:.*]]: tensor<?xf64, {{.*}}>>, %[[LO:.*]]: f64, %[[HI:.*]]: f64)
+// CHECK:           %[[RESULT:.*]] = graphblas.select_generic %[[ARG0]] : {{.*}} {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABOVE:.*]] = arith.cmpf ogt, %[[VAL]], %[[LO]] : f64
+// CHECK-NEXT:        %[[BELOW:.*]] = arith.cmpf olt, %[[VAL]], %[[HI]] : f64
+// CHECK-NEXT:        %[[KEEP:.*]] = arith.andi %[[ABOVE]], %[[BELOW]] : i1
+// CHECK-NEXT:        graphblas.yield select_out %[[KEEP]] : i1
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.select_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_select_select(%v: tensor<?xf64, #CV64>, %lo: f64, %hi: f64) -> tensor<?xf64, #CV64> {
+    %0 = graphblas.select %v, %lo { selector = "gt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    %1 = graphblas.select %0, %hi { selector = "lt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    return %1 : tensor<?xf64, #CV64>
+}
+
+// CHECK-LABEL:   func @fuse_intersect_apply(
+// CHECK-SAME:                               %[[A:.*]]: tensor<?xf64, {{.*}}>>, %[[B:.*]]: tensor<?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.intersect_generic %[[A]], %[[B]] {{.*}} {
+// CHECK-NEXT:      ^bb0(%[[X:.*]]: f64, %[[Y:.*]]: f64):
+// CHECK-NEXT:        %[[PROD:.*]] = arith.mulf %[[X]], %[[Y]] : f64
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[PROD]] : f64
+// CHECK-NEXT:        graphblas.yield mult %[[ABS]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_intersect_apply(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %0 = graphblas.intersect %a, %b { intersect_operator = "times" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    %1 = graphblas.apply %0 { apply_operator = "abs" } : (tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    return %1 : tensor<?xf64, #CV64>
+}
+
+// CHECK-LABEL:   func @fuse_union_apply(
+// CHECK-SAME:                           %[[A:.*]]: tensor<?xf64, {{.*}}>>, %[[B:.*]]: tensor<?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.union_generic %[[A]], %[[B]] {{.*}} {
+// CHECK-NEXT:      ^bb0(%[[X:.*]]: f64, %[[Y:.*]]: f64):
+// CHECK-NEXT:        %[[SUM:.*]] = arith.addf %[[X]], %[[Y]] : f64
+// CHECK-NEXT:        graphblas.yield mult %[[SUM]] : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        graphblas.yield transform_out %[[ABS]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_union_apply(%a: tensor<?xf64, #CV64>, %b: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %0 = graphblas.union %a, %b { union_operator = "plus" } : (tensor<?xf64, #CV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    %1 = graphblas.apply %0 { apply_operator = "abs" } : (tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    return %1 : tensor<?xf64, #CV64>
+}
+
+// CHECK-LABEL:   func @fuse_reduce_to_scalar_apply(
+// CHECK-SAME:                                      %[[ARG0:.*]]: tensor<?x?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.reduce_to_scalar_generic %[[ARG0]] : {{.*}} to f64  {
+// CHECK:             graphblas.yield agg_identity %{{.*}} : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[X:.*]]: f64, %[[Y:.*]]: f64):
+// CHECK-NEXT:        %[[SUM:.*]] = arith.addf %[[X]], %[[Y]] : f64
+// CHECK-NEXT:        graphblas.yield agg %[[SUM]] : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        graphblas.yield transform_in_a %[[ABS]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_reduce_to_scalar_apply(%m: tensor<?x?xf64, #CSR64>) -> f64 {
+    %0 = graphblas.apply %m { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.reduce_to_scalar %0 { aggregator = "plus" } : tensor<?x?xf64, #CSR64> to f64
+    return %1 : f64
+}
+
+// CHECK-LABEL:   func @fuse_reduce_to_scalar_select(
+// CHECK-SAME:                                       %[[ARG0:.*]]: tensor<?xf64, {{.*}}>>, %[[THUNK:.*]]: f64)
+// CHECK:           %[[RESULT:.*]] = graphblas.reduce_to_scalar_generic %[[ARG0]] : {{.*}} to f64  {
+// CHECK:             graphblas.yield agg_identity %{{.*}} : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[X:.*]]: f64, %[[Y:.*]]: f64):
+// CHECK-NEXT:        %[[SUM:.*]] = arith.addf %[[X]], %[[Y]] : f64
+// CHECK-NEXT:        graphblas.yield agg %[[SUM]] : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[KEEP:.*]] = arith.cmpf ogt, %[[VAL]], %[[THUNK]] : f64
+// CHECK-NEXT:        graphblas.yield select_in_a %[[KEEP]] : i1
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.select_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_reduce_to_scalar_select(%v: tensor<?xf64, #CV64>, %thunk: f64) -> f64 {
+    %0 = graphblas.select %v, %thunk { selector = "gt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    %1 = graphblas.reduce_to_scalar %0 { aggregator = "plus" } : tensor<?xf64, #CV64> to f64
+    return %1 : f64
+}
+
+// CHECK-LABEL:   func @fuse_reduce_to_vector_apply(
+// CHECK-SAME:                                      %[[ARG0:.*]]: tensor<?x?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.reduce_to_vector_generic %[[ARG0]] {{.*}} {
+// CHECK:             graphblas.yield agg_identity %{{.*}} : f64
+// CHECK:             graphblas.yield agg %{{.*}} : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        graphblas.yield transform_in_a %[[ABS]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_reduce_to_vector_apply(%m: tensor<?x?xf64, #CSR64>) -> tensor<?xf64, #CV64> {
+    %0 = graphblas.apply %m { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.reduce_to_vector %0 { aggregator = "plus", axis = 1 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+    return %1 : tensor<?xf64, #CV64>
+}
+
+// CHECK-LABEL:   func @fuse_matrix_multiply_apply_apply(
+// CHECK-SAME:                                           %[[A:.*]]: tensor<?x?xf64, {{.*}}>>, %[[B:.*]]: tensor<?x?xf64, {{.*}}>>)
+// CHECK:           %[[RESULT:.*]] = graphblas.matrix_multiply_generic %[[A]], %[[B]] {{.*}} {
+// CHECK:             graphblas.yield mult %{{.*}} : f64
+// CHECK-NEXT:      },  {
+// CHECK-NEXT:      ^bb0(%[[VAL:.*]]: f64):
+// CHECK-NEXT:        %[[ABS:.*]] = math.abs %[[VAL]] : f64
+// CHECK-NEXT:        %[[NEG:.*]] = arith.negf %[[ABS]] : f64
+// CHECK-NEXT:        graphblas.yield transform_out %[[NEG]] : f64
+// CHECK-NEXT:      }
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %[[RESULT]]
+func @fuse_matrix_multiply_apply_apply(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CSC64>) -> tensor<?x?xf64, #CSR64> {
+    %0 = graphblas.matrix_multiply %a, %b { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSC64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.apply %0 { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %2 = graphblas.apply %1 { apply_operator = "ainv" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    return %2 : tensor<?x?xf64, #CSR64>
+}
+
+// CHECK-LABEL:   func @nofuse_multi_use(
+// CHECK-SAME:                           %[[ARG0:.*]]: tensor<?x?xf64, {{.*}}>>)
+// CHECK:           %[[ABS:.*]] = graphblas.apply_generic %[[ARG0]]
+// CHECK:             graphblas.yield transform_out
+// CHECK:           %[[NEG:.*]] = graphblas.apply_generic %[[ABS]]
+// CHECK:             graphblas.yield transform_out
+// CHECK:           return %[[ABS]], %[[NEG]]
+func @nofuse_multi_use(%m: tensor<?x?xf64, #CSR64>) -> (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSR64>) {
+    %0 = graphblas.apply %m { apply_operator = "abs" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    %1 = graphblas.apply %0 { apply_operator = "ainv" } : (tensor<?x?xf64, #CSR64>) to tensor<?x?xf64, #CSR64>
+    return %0, %1 : tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSR64>
+}
@@ -0,0 +1,180 @@
+// RUN: graphblas-opt %s | graphblas-opt --graphblas-structuralize --graphblas-optimize | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CSC64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (j,i)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+// A loop whose trip count is unknown is skipped when empty, so the hoisted ops
+// only run if the loop body would have
+
+// CHECK-LABEL:   func @hoist_transpose(
+// CHECK-SAME:                          %[[VAL_0:.*]]: tensor<?x?xf64, #sparse_tensor.encoding<{{.*}}>>,
+// CHECK-SAME:                          %[[VAL_1:.*]]: tensor<?xf64, #sparse_tensor.encoding<{{.*}}>>,
+// CHECK-SAME:                          %[[VAL_2:.*]]: index) -> tensor<?xf64, #sparse_tensor.encoding<{{.*}}>> {
+// CHECK:           %[[VAL_3:.*]] = arith.constant 0 : index
+// CHECK:           %[[VAL_4:.*]] = arith.cmpi slt, %[[VAL_3]], %[[VAL_2]] : index
+// CHECK:           %[[VAL_5:.*]] = scf.if %[[VAL_4]] -> (tensor<?xf64, #sparse_tensor.encoding<{{.*}}>>) {
+// CHECK:             %[[VAL_6:.*]] = graphblas.convert_layout %[[VAL_0]]
+// CHECK:             %[[VAL_7:.*]] = graphblas.transpose %[[VAL_6]]
+// CHECK:             %[[VAL_8:.*]] = scf.for
+// CHECK-NOT:           graphblas.convert_layout
+// CHECK-NOT:           graphblas.transpose
+// CHECK:               graphblas.matrix_multiply_generic %[[VAL_7]], %{{.*}}
+// CHECK:             scf.yield %[[VAL_8]] : tensor<?xf64, #sparse_tensor.encoding<{{.*}}>>
+// CHECK:           } else {
+// CHECK:             scf.yield %[[VAL_1]] : tensor<?xf64, #sparse_tensor.encoding<{{.*}}>>
+// CHECK:           }
+// CHECK:           return %[[VAL_5]] : tensor<?xf64, #sparse_tensor.encoding<{{.*}}>>
+func @hoist_transpose(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %n: index) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %result = scf.for %i = %c0 to %n step %c1 iter_args(%x = %v) -> (tensor<?xf64, #CV64>) {
+        %AT = graphblas.transpose %A : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+        %y = graphblas.matrix_multiply %AT, %x { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        scf.yield %y : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
+
+// A loop with constant bounds which is known to run needs no guard
+
+// CHECK-LABEL:   func @hoist_constant_trip_count(
+// CHECK-NOT:       scf.if
+// CHECK:           %[[VAL_0:.*]] = graphblas.transpose
+// CHECK:           scf.for
+// CHECK-NOT:         graphblas.transpose
+// CHECK:             graphblas.matrix_multiply_generic %[[VAL_0]], %{{.*}}
+// CHECK:           return
+func @hoist_constant_trip_count(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c10 = arith.constant 10 : index
+    %result = scf.for %i = %c0 to %c10 step %c1 iter_args(%x = %v) -> (tensor<?xf64, #CV64>) {
+        %AT = graphblas.transpose %A : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+        %y = graphblas.matrix_multiply %AT, %x { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        scf.yield %y : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
+
+// An op hoisted out of an inner loop with an unknown trip count stays in its
+// guard, so it still only runs when the inner loop does
+
+// CHECK-LABEL:   func @keep_in_inner_guard(
+// CHECK-NOT:       graphblas
+// CHECK:           scf.for
+// CHECK:             %[[VAL_0:.*]] = arith.cmpi slt, %{{.*}}, %{{.*}} : index
+// CHECK:             scf.if %[[VAL_0]]
+// CHECK:               %[[VAL_1:.*]] = graphblas.transpose
+// CHECK:               scf.for
+// CHECK-NOT:             graphblas.transpose
+// CHECK:                 graphblas.matrix_multiply_generic %[[VAL_1]], %{{.*}}
+// CHECK:             } else {
+// CHECK-NOT:         graphblas
+// CHECK:           return
+func @keep_in_inner_guard(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %n: index, %maxiter: index) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %result = scf.for %k = %c0 to %maxiter step %c1 iter_args(%x = %v) -> (tensor<?xf64, #CV64>) {
+        %inner = scf.for %i = %c0 to %n step %c1 iter_args(%y = %x) -> (tensor<?xf64, #CV64>) {
+            %AT = graphblas.transpose %A : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+            %z = graphblas.matrix_multiply %AT, %y { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+            scf.yield %z : tensor<?xf64, #CV64>
+        }
+        scf.yield %inner : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
+
+// Ops in a branch of an scf.if may not run on any iteration, so they stay put
+
+// CHECK-LABEL:   func @keep_conditional(
+// CHECK-NOT:       graphblas
+// CHECK:           scf.for
+// CHECK:             scf.if
+// CHECK:             } else {
+// CHECK:               graphblas.transpose
+// CHECK:               graphblas.matrix_multiply_generic
+// CHECK:           return
+func @keep_conditional(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %n: index, %done: i1) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %result = scf.for %i = %c0 to %n step %c1 iter_args(%x = %v) -> (tensor<?xf64, #CV64>) {
+        %next = scf.if %done -> (tensor<?xf64, #CV64>) {
+            scf.yield %x : tensor<?xf64, #CV64>
+        } else {
+            %AT = graphblas.transpose %A : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+            %y = graphblas.matrix_multiply %AT, %x { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+            scf.yield %y : tensor<?xf64, #CV64>
+        }
+        scf.yield %next : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
+
+// The "before" region of an scf.while always runs, but its "after" region
+// may not
+
+// CHECK-LABEL:   func @hoist_while_before(
+// CHECK-NOT:       scf.if
+// CHECK:           %[[VAL_0:.*]] = graphblas.transpose
+// CHECK:           scf.while
+// CHECK-NOT:         graphblas.transpose
+// CHECK:             graphblas.matrix_multiply_generic %[[VAL_0]], %{{.*}}
+// CHECK:             scf.condition
+// CHECK:           } do {
+// CHECK:             graphblas.num_vals
+// CHECK:             scf.yield
+// CHECK:           return
+func @hoist_while_before(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %done: i1) -> tensor<?xf64, #CV64> {
+    %result = scf.while (%x = %v) : (tensor<?xf64, #CV64>) -> tensor<?xf64, #CV64> {
+        %AT = graphblas.transpose %A : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+        %y = graphblas.matrix_multiply %AT, %x { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        scf.condition(%done) %y : tensor<?xf64, #CV64>
+    } do {
+    ^bb0(%z: tensor<?xf64, #CV64>):
+        %nnz = graphblas.num_vals %A : tensor<?x?xf64, #CSR64>
+        scf.yield %z : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
+
+// Ops using the loop-carried value or a tensor updated in the loop stay put
+
+// CHECK-LABEL:   func @keep_variant(
+// CHECK-NOT:       graphblas
+// CHECK:           scf.for
+// CHECK:             graphblas.convert_layout
+// CHECK:             graphblas.update
+// CHECK:             graphblas.apply
+// CHECK:           return
+func @keep_variant(%A: tensor<?x?xf64, #CSR64>, %v: tensor<?xf64, #CV64>, %w: tensor<?xf64, #CV64>, %n: index) -> tensor<?xf64, #CV64> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %result = scf.for %i = %c0 to %n step %c1 iter_args(%x = %v) -> (tensor<?xf64, #CV64>) {
+        %X = graphblas.diag %x : tensor<?xf64, #CV64> to tensor<?x?xf64, #CSR64>
+        %XC = graphblas.convert_layout %X : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSC64>
+        %y = graphblas.matrix_multiply %A, %XC { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSC64>) to tensor<?x?xf64, #CSR64>
+        %d = graphblas.reduce_to_vector %y { aggregator = "plus", axis = 1 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+        graphblas.update %d -> %w { accumulate_operator = "plus" } : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>
+        %z = graphblas.apply %w { apply_operator = "abs" } : (tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+        scf.yield %z : tensor<?xf64, #CV64>
+    }
+    return %result : tensor<?xf64, #CV64>
+}
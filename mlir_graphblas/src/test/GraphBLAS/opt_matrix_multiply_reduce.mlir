@@ -158,3 +158,97 @@ func @nofuse_multi_use(%A: tensor<?x?xf64, #CSR64>, %B: tensor<?x?xf64, #CSC64>)
     }
     return %reduce_result, %C : f64, tensor<?x?xf64, #CSR64>
 }
+
+// A reduce which also selects its input keeps the selection, so the multiply
+// is not fused into it
+
+// CHECK-LABEL:   func @nofuse_select_between(
+// CHECK-SAME:                                %[[VAL_0:.*]]: tensor<?x?xf64, {{.*}}>>,
+// CHECK-SAME:                                %[[VAL_1:.*]]: tensor<?x?xf64, {{.*}}>>,
+// CHECK-SAME:                                %[[VAL_2:.*]]: f64) -> f64 {
+// CHECK-NOT:       graphblas.matrix_multiply_reduce_to_scalar_generic
+// CHECK:           %[[VAL_3:.*]] = graphblas.matrix_multiply_generic %[[VAL_0]], %[[VAL_1]] {{.*}} {
+// CHECK:             graphblas.yield mult %{{.*}} : f64
+// CHECK:           }
+// CHECK:           %[[VAL_4:.*]] = graphblas.reduce_to_scalar_generic %[[VAL_3]] : {{.*}} to f64  {
+// CHECK:             graphblas.yield agg_identity %{{.*}} : f64
+// CHECK:           },  {
+// CHECK:             graphblas.yield agg %{{.*}} : f64
+// CHECK:           },  {
+// CHECK:           ^bb0(%[[VAL_5:.*]]: f64):
+// CHECK:             %[[VAL_6:.*]] = arith.cmpf ogt, %[[VAL_5]], %[[VAL_2]] : f64
+// CHECK:             graphblas.yield select_in_a %[[VAL_6]] : i1
+// CHECK:           }
+// CHECK-NOT:       graphblas.select_generic
+// CHECK:           return %[[VAL_4]] : f64
+// CHECK:         }
+func @nofuse_select_between(%A: tensor<?x?xf64, #CSR64>, %B: tensor<?x?xf64, #CSC64>, %thunk: f64) -> f64 {
+    %cst = arith.constant 0.000000e+00 : f64
+    %C = graphblas.matrix_multiply_generic %A, %B {mask_complement = false} : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSC64>) to tensor<?x?xf64, #CSR64> {
+        ^bb0:
+            %identity = arith.constant 0.0 : f64
+            graphblas.yield add_identity %identity : f64
+    },{
+        ^bb0(%add_a: f64, %add_b: f64):
+            %add_result = arith.addf %add_a, %add_b : f64
+            graphblas.yield add %add_result : f64
+    },{
+        ^bb0(%mult_a: f64, %mult_b: f64):
+            %mult_result = arith.mulf %mult_a, %mult_b : f64
+            graphblas.yield mult %mult_result : f64
+    }
+    %D = graphblas.select_generic %C : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64> {
+        ^bb0(%val: f64):
+            %keep = arith.cmpf ogt, %val, %thunk : f64
+            graphblas.yield select_out %keep : i1
+    }
+    %reduce_result = graphblas.reduce_to_scalar_generic %D : tensor<?x?xf64, #CSR64> to f64  {
+      graphblas.yield agg_identity %cst : f64
+    },  {
+    ^bb0(%arg1: f64, %arg2: f64):
+      %1 = arith.addf %arg1, %arg2 : f64
+      graphblas.yield agg %1 : f64
+    }
+    return %reduce_result : f64
+}
+
+// The transform of an apply between the multiply and the reduce is kept,
+// whichever of the two it is fused into
+
+// CHECK-LABEL:   func @keep_apply_between(
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK-DAG:       %[[ABS:.*]] = math.abs %{{.*}} : f64
+// CHECK-DAG:       graphblas.yield {{transform_out|transform_in_a}} %[[ABS]] : f64
+// CHECK-DAG:       graphblas.yield agg %{{.*}} : f64
+// CHECK-NOT:       graphblas.apply_generic
+// CHECK:           return %{{.*}} : f64
+// CHECK:         }
+func @keep_apply_between(%A: tensor<?x?xf64, #CSR64>, %B: tensor<?x?xf64, #CSC64>) -> f64 {
+    %cst = arith.constant 0.000000e+00 : f64
+    %C = graphblas.matrix_multiply_generic %A, %B {mask_complement = false} : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSC64>) to tensor<?x?xf64, #CSR64> {
+        ^bb0:
+            %identity = arith.constant 0.0 : f64
+            graphblas.yield add_identity %identity : f64
+    },{
+        ^bb0(%add_a: f64, %add_b: f64):
+            %add_result = arith.addf %add_a, %add_b : f64
+            graphblas.yield add %add_result : f64
+    },{
+        ^bb0(%mult_a: f64, %mult_b: f64):
+            %mult_result = arith.mulf %mult_a, %mult_b : f64
+            graphblas.yield mult %mult_result : f64
+    }
+    %D = graphblas.apply_generic %C : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64> {
+        ^bb0(%val: f64):
+            %abs = math.abs %val : f64
+            graphblas.yield transform_out %abs : f64
+    }
+    %reduce_result = graphblas.reduce_to_scalar_generic %D : tensor<?x?xf64, #CSR64> to f64  {
+      graphblas.yield agg_identity %cst : f64
+    },  {
+    ^bb0(%arg1: f64, %arg2: f64):
+      %1 = arith.addf %arg1, %arg2 : f64
+      graphblas.yield agg %1 : f64
+    }
+    return %reduce_result : f64
+}
@@ -50,7 +50,7 @@ func @matrix_multiply_min_X(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CS
 // CHECK:             graphblas.yield add_identity %[[VAL_2]] : f64
 // CHECK:           },  {
 // CHECK:           ^bb0(%[[VAL_5:.*]]: f64, %[[VAL_6:.*]]: f64):
-// CHECK:             graphblas.yield add %[[VAL_6]] : f64
+// CHECK:             graphblas.yield add %[[VAL_6]] {graphblas.any} : f64
 // CHECK:           },  {
 func @matrix_multiply_any_X(%a: tensor<?x?xf64, #CSR64>, %b: tensor<?x?xf64, #CSC64>) -> tensor<?x?xf64, #CSR64> {
     %answer = graphblas.matrix_multiply %a, %b { semiring = "any_pair" } : (tensor<?x?xf64, #CSR64>, tensor<?x?xf64, #CSC64>) to tensor<?x?xf64, #CSR64>
@@ -0,0 +1,106 @@
+// RUN: graphblas-opt %s | graphblas-exec entry | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+  func @entry() {
+    %c3 = arith.constant 3 : index
+    %c4 = arith.constant 4 : index
+    %c6 = arith.constant 6 : index
+
+    ///////////////
+    // Test Matrix
+    ///////////////
+
+    %indices = arith.constant dense<[
+      [2, 1], [0, 3], [1, 0], [0, 3], [2, 1], [0, 0]
+    ]> : tensor<6x2xindex>
+    %values = arith.constant dense<
+      [1.0, 2.0, 3.0, 4.0, 7.0, 6.0]
+    > : tensor<6xf64>
+
+    // Unsorted with duplicates, last one wins
+    //
+    // CHECK:      pointers=(0, 2, 3, 4)
+    // CHECK-NEXT: indices=(0, 3, 0, 1)
+    // CHECK-NEXT: values=(6, 4, 3, 7)
+    //
+    %0 = graphblas.from_coo %indices, %values [%c3, %c4] : tensor<6x2xindex>, tensor<6xf64> to tensor<?x?xf64, #CSR64>
+    graphblas.print_tensor %0 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    // Unsorted with duplicates, accumulated
+    //
+    // CHECK:      pointers=(0, 2, 3, 4)
+    // CHECK-NEXT: indices=(0, 3, 0, 1)
+    // CHECK-NEXT: values=(6, 6, 3, 8)
+    //
+    %1 = graphblas.from_coo %indices, %values [%c3, %c4] : tensor<6x2xindex>, tensor<6xf64> to tensor<?x?xf64, #CSR64> {
+      ^bb0(%a : f64, %b : f64):
+        %result = arith.addf %a, %b : f64
+        graphblas.yield accumulate %result : f64
+    }
+    graphblas.print_tensor %1 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    %sorted_indices = arith.constant dense<[
+      [0, 1], [0, 1], [2, 0], [2, 2]
+    ]> : tensor<4x2xindex>
+    %sorted_values = arith.constant dense<
+      [1.0, 2.0, 3.0, 4.0]
+    > : tensor<4xf64>
+
+    // Sorted with duplicates
+    //
+    // CHECK:      pointers=(0, 1, 1, 3)
+    // CHECK-NEXT: indices=(1, 0, 2)
+    // CHECK-NEXT: values=(2, 3, 4)
+    //
+    %2 = graphblas.from_coo %sorted_indices, %sorted_values [%c3, %c3] { sorted = true } : tensor<4x2xindex>, tensor<4xf64> to tensor<?x?xf64, #CSR64>
+    graphblas.print_tensor %2 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    ///////////////
+    // Test Vector
+    ///////////////
+
+    %v_indices = arith.constant dense<[
+      [5], [1], [5], [3]
+    ]> : tensor<4x1xindex>
+    %v_values = arith.constant dense<
+      [1.0, 2.0, 3.0, 4.0]
+    > : tensor<4xf64>
+
+    // Unsorted with duplicates, accumulated
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(1, 3, 5)
+    // CHECK-NEXT: values=(2, 4, 4)
+    //
+    %3 = graphblas.from_coo %v_indices, %v_values [%c6] : tensor<4x1xindex>, tensor<4xf64> to tensor<?xf64, #CV64> {
+      ^bb0(%a : f64, %b : f64):
+        %result = arith.addf %a, %b : f64
+        graphblas.yield accumulate %result : f64
+    }
+    graphblas.print_tensor %3 { level=3 } : tensor<?xf64, #CV64>
+
+    // Unsorted with duplicates, named accumulator
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(1, 3, 5)
+    // CHECK-NEXT: values=(2, 4, 3)
+    //
+    %4 = graphblas.from_coo %v_indices, %v_values [%c6] { accumulate_operator = "max" } : tensor<4x1xindex>, tensor<4xf64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %4 { level=3 } : tensor<?xf64, #CV64>
+
+    return
+  }
+}
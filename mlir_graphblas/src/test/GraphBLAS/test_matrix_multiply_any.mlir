@@ -0,0 +1,105 @@
+// RUN: graphblas-opt %s | graphblas-exec entry | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#BV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+  func @entry() {
+    %cf0 = arith.constant 0.0 : f64
+
+    ///////////////
+    // Test Matrix
+    ///////////////
+
+    // Row 0 overlaps the vector twice, so taking the first overlap instead of
+    // the last one changes its result
+    %m = arith.constant dense<[
+      [ 1.0,  1.0,  1.0,  0.0],
+      [ 0.0,  1.0,  0.0,  0.0],
+      [ 1.0,  0.0,  0.0,  0.0],
+      [ 0.0,  0.0,  1.0,  1.0]
+    ]> : tensor<4x4xf64>
+    %m_csr = sparse_tensor.convert %m : tensor<4x4xf64> to tensor<?x?xf64, #CSR64>
+
+    %v_dense = arith.constant dense<[ 1.0, 0.0, 1.0, 0.0 ]> : tensor<4xf64>
+    %v = sparse_tensor.convert %v_dense : tensor<4xf64> to tensor<?xf64, #CV64>
+    %v_bitmap = sparse_tensor.convert %v_dense : tensor<4xf64> to tensor<?xf64, #BV64>
+
+    %mask_dense = arith.constant dense<[ 0.0, 0.0, 0.0, 1.0 ]> : tensor<4xf64>
+    %mask = sparse_tensor.convert %mask_dense : tensor<4xf64> to tensor<?xf64, #CV64>
+
+    // matrix x vector any_overlapi keeps the last overlap
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 2, 3)
+    // CHECK-NEXT: values=(2, 0, 2)
+    //
+    %0 = graphblas.matrix_multiply %m_csr, %v { semiring = "any_overlapi" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    graphblas.print_tensor %0 { level=3 } : tensor<?xf64, #CV64>
+
+    // matrix x vector with a user block equal to "any" scans every overlap
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 2, 3)
+    // CHECK-NEXT: values=(2, 0, 2)
+    //
+    %1 = graphblas.matrix_multiply_generic %m_csr, %v { mask_complement = false } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    {
+      graphblas.yield add_identity %cf0 : f64
+    }, {
+    ^bb0(%arg0: f64, %arg1: f64):
+      graphblas.yield add %arg1 : f64
+    }, {
+    ^bb0(%arg0: f64, %arg1: f64, %row: index, %col: index, %overlap: index):
+      %overlap_i64 = arith.index_cast %overlap : index to i64
+      %overlap_f64 = arith.sitofp %overlap_i64 : i64 to f64
+      graphblas.yield mult %overlap_f64 : f64
+    }
+    graphblas.print_tensor %1 { level=3 } : tensor<?xf64, #CV64>
+
+    // matrix x bitmap vector any_overlapi
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 2, 3)
+    // CHECK-NEXT: values=(2, 0, 2)
+    //
+    %2 = graphblas.matrix_multiply %m_csr, %v_bitmap { semiring = "any_overlapi" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #BV64>) to tensor<?xf64, #CV64>
+    graphblas.print_tensor %2 { level=3 } : tensor<?xf64, #CV64>
+
+    // matrix x bitmap vector any_overlapi with a complemented mask
+    //
+    // CHECK:      pointers=(0, 2)
+    // CHECK-NEXT: indices=(0, 2)
+    // CHECK-NEXT: values=(2, 0)
+    //
+    %3 = graphblas.matrix_multiply %m_csr, %v_bitmap, %mask { semiring = "any_overlapi", mask_complement = true } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #BV64>, tensor<?xf64, #CV64>) to tensor<?xf64, #CV64>
+    graphblas.print_tensor %3 { level=3 } : tensor<?xf64, #CV64>
+
+    // matrix x bitmap vector plus_times
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 2, 3)
+    // CHECK-NEXT: values=(2, 1, 1)
+    //
+    %4 = graphblas.matrix_multiply %m_csr, %v_bitmap { semiring = "plus_times" } : (tensor<?x?xf64, #CSR64>, tensor<?xf64, #BV64>) to tensor<?xf64, #CV64>
+    graphblas.print_tensor %4 { level=3 } : tensor<?xf64, #CV64>
+
+    return
+  }
+}
@@ -0,0 +1,148 @@
+// RUN: graphblas-opt %s | graphblas-exec entry | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CSC64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (j,i)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+  func @entry() {
+    %m = arith.constant dense<[
+      [ 1.0,  0.0,  2.0,  0.0,  0.0],
+      [ 0.0,  3.0,  0.0,  4.0,  0.0],
+      [ 5.0,  0.0,  6.0,  0.0,  0.0]
+    ]> : tensor<3x5xf64>
+    %m_csr = sparse_tensor.convert %m : tensor<3x5xf64> to tensor<?x?xf64, #CSR64>
+    %m_csc = sparse_tensor.convert %m : tensor<3x5xf64> to tensor<?x?xf64, #CSC64>
+
+    %mask = arith.constant sparse<[
+      [1], [3], [4]
+    ], [1.0, 1.0, 1.0]> : tensor<5xf64>
+    %mask_cv = sparse_tensor.convert %mask : tensor<5xf64> to tensor<?xf64, #CV64>
+
+    // CSR same-axis plus
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 1, 2)
+    // CHECK-NEXT: values=(3, 7, 11)
+    //
+    %0 = graphblas.reduce_to_vector %m_csr { aggregator = "plus", axis = 1 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %0 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSR cross-axis count
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(2, 1, 2, 1)
+    //
+    %1 = graphblas.reduce_to_vector %m_csr { aggregator = "count", axis = 0 } : tensor<?x?xf64, #CSR64> to tensor<?xi64, #CV64>
+    graphblas.print_tensor %1 { level=3 } : tensor<?xi64, #CV64>
+
+    // CSR cross-axis plus
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(6, 3, 8, 4)
+    //
+    %2 = graphblas.reduce_to_vector %m_csr { aggregator = "plus", axis = 0 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %2 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSR cross-axis first
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(1, 3, 2, 4)
+    //
+    %3 = graphblas.reduce_to_vector %m_csr { aggregator = "first", axis = 0 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %3 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSR cross-axis last
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(5, 3, 6, 4)
+    //
+    %4 = graphblas.reduce_to_vector %m_csr { aggregator = "last", axis = 0 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %4 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSR cross-axis plus with mask
+    //
+    // CHECK:      pointers=(0, 2)
+    // CHECK-NEXT: indices=(1, 3)
+    // CHECK-NEXT: values=(3, 4)
+    //
+    %5 = graphblas.reduce_to_vector %m_csr, %mask_cv { aggregator = "plus", axis = 0 } : tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %5 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSC cross-axis max
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 1, 2)
+    // CHECK-NEXT: values=(2, 4, 6)
+    //
+    %6 = graphblas.reduce_to_vector %m_csc { aggregator = "max", axis = 1 } : tensor<?x?xf64, #CSC64> to tensor<?xf64, #CV64>
+    graphblas.print_tensor %6 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSC same-axis count
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(2, 1, 2, 1)
+    //
+    %7 = graphblas.reduce_to_vector %m_csc { aggregator = "count", axis = 0 } : tensor<?x?xf64, #CSC64> to tensor<?xi64, #CV64>
+    graphblas.print_tensor %7 { level=3 } : tensor<?xi64, #CV64>
+
+    %cf0 = arith.constant 0.0 : f64
+
+    // CSR cross-axis generic sum of squares
+    //
+    // CHECK:      pointers=(0, 4)
+    // CHECK-NEXT: indices=(0, 1, 2, 3)
+    // CHECK-NEXT: values=(26, 9, 40, 16)
+    //
+    %8 = graphblas.reduce_to_vector_generic %m_csr { axis = 0 } : tensor<?x?xf64, #CSR64> to tensor<?xf64, #CV64> {
+        graphblas.yield agg_identity %cf0 : f64
+      }, {
+        ^bb0(%a : f64, %b : f64):
+          %sum = arith.addf %a, %b : f64
+          graphblas.yield agg %sum : f64
+      }, {
+        ^bb0(%x : f64):
+          %sq = arith.mulf %x, %x : f64
+          graphblas.yield transform_in_a %sq : f64
+      }
+    graphblas.print_tensor %8 { level=3 } : tensor<?xf64, #CV64>
+
+    // CSR cross-axis generic plus with complemented mask
+    //
+    // CHECK:      pointers=(0, 2)
+    // CHECK-NEXT: indices=(0, 2)
+    // CHECK-NEXT: values=(6, 8)
+    //
+    %9 = graphblas.reduce_to_vector_generic %m_csr, %mask_cv { axis = 0, mask_complement = true } : tensor<?x?xf64, #CSR64>, tensor<?xf64, #CV64> to tensor<?xf64, #CV64> {
+        graphblas.yield agg_identity %cf0 : f64
+      }, {
+        ^bb0(%a : f64, %b : f64):
+          %sum = arith.addf %a, %b : f64
+          graphblas.yield agg %sum : f64
+      }
+    graphblas.print_tensor %9 { level=3 } : tensor<?xf64, #CV64>
+
+    return
+  }
+}
@@ -0,0 +1,104 @@
+// RUN: graphblas-opt %s | graphblas-exec entry | FileCheck %s
+
+#CSR64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (i,j)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CSC64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "dense", "compressed" ],
+  dimOrdering = affine_map<(i,j) -> (j,i)>,
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+#CV64 = #sparse_tensor.encoding<{
+  dimLevelType = [ "compressed" ],
+  pointerBitWidth = 64,
+  indexBitWidth = 64
+}>
+
+module {
+  func @entry() {
+    %cf0 = arith.constant 0.0 : f64
+    %cf2 = arith.constant 2.0 : f64
+
+    ///////////////
+    // Test Matrix
+    ///////////////
+
+    %m = arith.constant dense<[
+      [ 1.0, -2.0,  0.0,  4.0],
+      [ 0.0,  5.0, -6.0,  0.0],
+      [ 7.0,  0.0,  8.0, -9.0]
+    ]> : tensor<3x4xf64>
+    %m_csr = sparse_tensor.convert %m : tensor<3x4xf64> to tensor<?x?xf64, #CSR64>
+    %m_csc = sparse_tensor.convert %m : tensor<3x4xf64> to tensor<?x?xf64, #CSC64>
+
+    // CSR tril
+    //
+    // CHECK:      pointers=(0, 0, 0, 1)
+    // CHECK-NEXT: indices=(0)
+    // CHECK-NEXT: values=(7)
+    //
+    %0 = graphblas.select %m_csr { selector = "tril" } : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+    graphblas.print_tensor %0 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    // CSR triu
+    //
+    // CHECK:      pointers=(0, 2, 3, 4)
+    // CHECK-NEXT: indices=(1, 3, 2, 3)
+    // CHECK-NEXT: values=(-2, 4, -6, -9)
+    //
+    %1 = graphblas.select %m_csr { selector = "triu" } : tensor<?x?xf64, #CSR64> to tensor<?x?xf64, #CSR64>
+    graphblas.print_tensor %1 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    // CSC triu
+    //
+    // CHECK:      pointers=(0, 0, 1, 2, 4)
+    // CHECK-NEXT: indices=(0, 1, 0, 2)
+    // CHECK-NEXT: values=(-2, -6, 4, -9)
+    //
+    %2 = graphblas.select %m_csc { selector = "triu" } : tensor<?x?xf64, #CSC64> to tensor<?x?xf64, #CSC64>
+    graphblas.print_tensor %2 { level=3 } : tensor<?x?xf64, #CSC64>
+
+    ///////////////
+    // Test Vector
+    ///////////////
+
+    %v = arith.constant dense<
+      [ 1.0, -2.0,  0.0,  3.5, -4.0,  0.0,  6.0 ]
+    > : tensor<7xf64>
+    %v_cv = sparse_tensor.convert %v : tensor<7xf64> to tensor<?xf64, #CV64>
+
+    // gt
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(0, 3, 6)
+    // CHECK-NEXT: values=(1, 3.5, 6)
+    //
+    %10 = graphblas.select %v_cv, %cf0 { selector = "gt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    graphblas.print_tensor %10 { level=3 } : tensor<?xf64, #CV64>
+
+    // select_generic keeps the transformed values
+    //
+    // CHECK:      pointers=(0, 3)
+    // CHECK-NEXT: indices=(3, 4, 6)
+    // CHECK-NEXT: values=(3.5, 4, 6)
+    //
+    %11 = graphblas.select_generic %v_cv : tensor<?xf64, #CV64> to tensor<?xf64, #CV64> {
+      ^bb0(%val: f64):
+        %abs = math.abs %val : f64
+        graphblas.yield transform_out %abs : f64
+    }, {
+      ^bb0(%x: f64):
+        %keep = arith.cmpf ogt, %x, %cf2 : f64
+        graphblas.yield select_out %keep : i1
+    }
+    graphblas.print_tensor %11 { level=3 } : tensor<?xf64, #CV64>
+
+    return
+  }
+}
@@ -107,26 +107,90 @@ module {
     graphblas.update %v2 -> %25(%mask) { accumulate_operator = "plus" } : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>(tensor<?xf64, #CV64>)
     graphblas.print %25 { strings=[] } : tensor<?xf64, #CV64>
 
-    // COM: TODO This doesn't work yet.
-    // COM: input -> output(mask) { accumulate_operator, replace }
-    // COM: 
-    // COM: CHECK:      Test 70
-    // COM: CHECK-NEXT: [_, 8.8, _, 11, _, _, _, _, _, _]
-    // COM: 
-    // COM: graphblas.print %c0 { strings=["Test 7"] } : index
-    // COM: %26 = graphblas.dup %v1 : tensor<?xf64, #CV64>
-    // COM: graphblas.update %v2 -> %26(%mask) { accumulate_operator = "plus", replace = true } : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>(tensor<?xf64, #CV64>)
-    // COM: graphblas.print %26 { strings=[] } : tensor<?xf64, #CV64>
+    // input -> output(mask) { accumulate_operator, replace }
+    //
+    // CHECK:      Test 70
+    // CHECK-NEXT: [_, 8.8, _, 11, _, _, _, _, _, _]
+    //
+    graphblas.print %c0 { strings=["Test 7"] } : index
+    %26 = graphblas.dup %v1 : tensor<?xf64, #CV64>
+    graphblas.update %v2 -> %26(%mask) { accumulate_operator = "plus", replace = true } : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>(tensor<?xf64, #CV64>)
+    graphblas.print %26 { strings=[] } : tensor<?xf64, #CV64>
+
+    // input -> output, where nothing else reads the input
+    //
+    // CHECK:      Test 80
+    // CHECK-NEXT: [_, -1.2, _, _, 3.4, _, _, 7.7, _, _]
+    // CHECK-NEXT: [_, _, _, _, 3.4, _, _, 7.7, _, _]
+    //
+    graphblas.print %c0 { strings=["Test 8"] } : index
+    %27 = graphblas.dup %v1 : tensor<?xf64, #CV64>
+    %v2_copy = graphblas.dup %v2 : tensor<?xf64, #CV64>
+    graphblas.update %v2_copy -> %27 : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>
+    graphblas.print %27 { strings=[] } : tensor<?xf64, #CV64>
+    %cf0 = arith.constant 0.0 : f64
+    %v2_pos = graphblas.select %v2, %cf0 { selector = "gt" } : tensor<?xf64, #CV64>, f64 to tensor<?xf64, #CV64>
+    graphblas.update %v2_pos -> %27 : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>
+    graphblas.print %27 { strings=[] } : tensor<?xf64, #CV64>
+
+    // input -> output(mask) { mask_complement }
+    //
+    // CHECK:      Test 90
+    // CHECK-NEXT: [_, 10, _, 11, 3.4, _, _, 7.7, _, _]
+    //
+    graphblas.print %c0 { strings=["Test 9"] } : index
+    %28 = graphblas.dup %v1 : tensor<?xf64, #CV64>
+    graphblas.update %v2 -> %28(%mask) { mask_complement = true } : tensor<?xf64, #CV64> -> tensor<?xf64, #CV64>(tensor<?xf64, #CV64>)
+    graphblas.print %28 { strings=[] } : tensor<?xf64, #CV64>
 
     ///////////////
     // Test Matrix
     ///////////////
 
+    %m1_dense = arith.constant dense<[
+      [1.0, 0.0, 2.0, 0.0],
+      [0.0, 3.0, 0.0, 4.0],
+      [5.0, 0.0, 0.0, 6.0]
+    ]> : tensor<3x4xf64>
+    %m1 = sparse_tensor.convert %m1_dense : tensor<3x4xf64> to tensor<?x?xf64, #CSR64>
+
+    %m2_dense = arith.constant dense<[
+      [0.0, 7.0, 8.0, 0.0],
+      [0.0, 0.0, 0.0, 9.0],
+      [0.0, 0.0, 0.0, 0.0]
+    ]> : tensor<3x4xf64>
+    %m2 = sparse_tensor.convert %m2_dense : tensor<3x4xf64> to tensor<?x?xf64, #CSR64>
+
+    %m_mask_dense = arith.constant dense<[
+      [1.0, 1.0, 0.0, 0.0],
+      [0.0, 1.0, 0.0, 1.0],
+      [1.0, 0.0, 0.0, 0.0]
+    ]> : tensor<3x4xf64>
+    %m_mask = sparse_tensor.convert %m_mask_dense : tensor<3x4xf64> to tensor<?x?xf64, #CSR64>
+
+    // input -> output(mask)
+    //
+    // CHECK:      pointers=(0, 2, 3, 4)
+    // CHECK-NEXT: indices=(1, 2, 3, 3)
+    // CHECK-NEXT: values=(7, 2, 9, 6)
+    //
+    %30 = graphblas.dup %m1 : tensor<?x?xf64, #CSR64>
+    graphblas.update %m2 -> %30(%m_mask) : tensor<?x?xf64, #CSR64> -> tensor<?x?xf64, #CSR64>(tensor<?x?xf64, #CSR64>)
+    graphblas.print_tensor %30 { level=3 } : tensor<?x?xf64, #CSR64>
+
+    // input -> output(mask) { accumulate_operator }
+    //
+    // CHECK:      pointers=(0, 3, 5, 7)
+    // CHECK-NEXT: indices=(0, 1, 2, 1, 3, 0, 3)
+    // CHECK-NEXT: values=(1, 7, 2, 3, 13, 5, 6)
+    //
+    %31 = graphblas.dup %m1 : tensor<?x?xf64, #CSR64>
+    graphblas.update %m2 -> %31(%m_mask) { accumulate_operator = "plus" } : tensor<?x?xf64, #CSR64> -> tensor<?x?xf64, #CSR64>(tensor<?x?xf64, #CSR64>)
+    graphblas.print_tensor %31 { level=3 } : tensor<?x?xf64, #CSR64>
+
     // COM: input -> output { replace? }
     // COM: input -> output { accumulate_operator, replace?}
-    // COM: input -> output(mask)
     // COM: input -> output(mask) { replace }
-    // COM: input -> output(mask) { accumulate_operator }
     // COM: input -> output(mask) { accumulate_operator, replace }
 
     return
@@ -348,7 +348,12 @@ def test_random_walk():
 
 
 @pytest.mark.parametrize("special_passes", [None, GRAPHBLAS_OPENMP_PASSES])
-def test_bfs(special_passes):
+@pytest.mark.parametrize(
+    "bfs",
+    [mlalgo.bfs, mlalgo.BFS(alpha=0.0), mlalgo.BFS(alpha=1e30, beta=1e30)],
+    ids=["default", "push", "pull"],
+)
+def test_bfs(special_passes, bfs):
     # 0 - 1    5 - 6
     # | X |    | /
     # 3 - 4 -- 2 - 7
@@ -375,7 +380,7 @@ def test_bfs(special_passes):
     a = MLIRSparseTensor(indices, values, sizes, sparsity)
     assert a.verify()
 
-    parents, levels = mlalgo.bfs(0, a, compile_with_passes=special_passes)
+    parents, levels = bfs(0, a, compile_with_passes=special_passes)
     expected_parents = np.array([0, 0, 4, 0, 0, 2, 2, 2])
     expected_levels = np.array([0, 1, 2, 1, 1, 3, 3, 3])
 
@@ -1,3 +1,4 @@
+import os
 import pytest
 import itertools
 import numpy as np
@@ -290,3 +291,301 @@ def test_sparsity():
     )
     assert tensor.verify()
     np.testing.assert_array_equal(sparsity, tensor.sparsity)
+
+
+def test_sort_coo():
+    # Enough elements for the radix sort to split the keys into per-thread
+    # blocks, and dimensions too large to pack all indices into one 64-bit key
+    rng = np.random.default_rng(11)
+    n = 200000
+    sizes = np.array([1 << 30, 1 << 30, 1 << 20], dtype=np.uint64)
+    # Drawing from a few indices per dimension makes duplicates likely
+    pools = [
+        rng.choice(int(size), count, replace=False)
+        for size, count in zip(sizes, [50, 50, 100])
+    ]
+    indices = np.stack([rng.choice(pool, n) for pool in pools], axis=1)
+    indices = indices.astype(np.uint64)
+    values = np.arange(n, dtype=np.float64)
+    sparsity = np.array([True, True, True], dtype=np.bool8)
+    tensor = mlir_graphblas.sparse_utils.MLIRSparseTensor(
+        indices, values, sizes, sparsity
+    )
+    assert tensor.verify()
+
+    # Lexicographic order; of duplicate elements the first one is kept
+    order = np.lexsort(indices.T[::-1])
+    sorted_indices = indices[order]
+    changed = np.any(sorted_indices[1:] != sorted_indices[:-1], axis=1)
+    first = np.concatenate([[True], changed])
+    assert first.sum() < n
+    for d in range(3):
+        prefix = sorted_indices[:, : d + 1]
+        prefix_changed = np.any(prefix[1:] != prefix[:-1], axis=1)
+        level_first = np.concatenate([[True], prefix_changed])
+        np.testing.assert_array_equal(
+            tensor.get_indices(d), sorted_indices[level_first, d]
+        )
+    np.testing.assert_array_equal(tensor.values, values[order][first])
+
+
+@pytest.mark.parametrize(
+    "pointer_dtype, index_dtype, value_dtype",
+    [(np.uint64, np.uint64, np.float64), (np.uint32, np.uint32, np.int8)],
+)
+def test_snapshot_roundtrip(tmp_path, pointer_dtype, index_dtype, value_dtype):
+    indices = np.array([[0, 1], [1, 0], [1, 2]], dtype=index_dtype)
+    values = np.array([1, 2, 3], dtype=value_dtype)
+    sizes = np.array([2, 3], dtype=np.uint64)
+    sparsity = np.array([False, True], dtype=np.bool8)
+    tensor = mlir_graphblas.sparse_utils.MLIRSparseTensor(
+        indices, values, sizes, sparsity, pointer_type=pointer_dtype
+    )
+    filename = tmp_path / "tensor.snap"
+    tensor.save(filename)
+
+    loaded = mlir_graphblas.sparse_utils.MLIRSparseTensor.load(filename)
+    assert loaded.verify()
+    assert loaded.pointer_dtype == pointer_dtype
+    assert loaded.index_dtype == index_dtype
+    assert loaded.value_dtype == value_dtype
+    assert loaded.shape == tensor.shape
+    np.testing.assert_array_equal(loaded.rev, tensor.rev)
+    np.testing.assert_array_equal(loaded.get_pointers(1), tensor.get_pointers(1))
+    np.testing.assert_array_equal(loaded.get_indices(1), tensor.get_indices(1))
+    np.testing.assert_array_equal(loaded.values, values)
+
+    # Writes go to a private copy of the mapped pages, never to the file
+    loaded.values[0] = 7
+    loaded.resize_values(5)
+    reloaded = mlir_graphblas.sparse_utils.MLIRSparseTensor.load(filename)
+    np.testing.assert_array_equal(reloaded.values, values)
+
+
+def test_snapshot_release_after_growth(tmp_path):
+    sparse_utils = mlir_graphblas.sparse_utils
+    # Dense CSR rows of 256 columns: 4MB of uint8 indices followed in the
+    # snapshot by 32MB of values
+    nrows = 1 << 14
+    nnz = nrows * 256
+    tensor = sparse_utils.MLIRSparseTensor.from_arrays(
+        [nrows, 256],
+        [None, np.arange(0, nnz + 1, 256, dtype=np.uint64)],
+        [None, np.tile(np.arange(256, dtype=np.uint8), nrows)],
+        np.arange(nnz, dtype=np.float64),
+    )
+    filename = tmp_path / "tensor.snap"
+    tensor.save(filename)
+    del tensor
+
+    sparse_utils.set_allocation_policy("first-touch")
+    try:
+        before = sparse_utils.allocation_report()
+        loaded = sparse_utils.MLIRSparseTensor.load(filename)
+        # Growing every array past its adopted size unmaps the snapshot
+        loaded.resize_index(1, nnz + 1)
+        loaded.resize_pointers(1, nrows + 2)
+        loaded.resize_values(nnz + 1)
+        # A buffer of about the snapshot's size is then mapped where the
+        # snapshot was, at an address within the indices it once held
+        loaded.resize_index(1, 34 << 20)
+        del loaded
+        after = sparse_utils.allocation_report()
+    finally:
+        sparse_utils.set_allocation_policy("default")
+    allocated = after["large_buffers"] - before["large_buffers"]
+    assert allocated == 3
+    assert after["large_released"] - before["large_released"] == allocated
+
+
+TEST_FOLDER = os.path.dirname(__file__)
+
+MATRIX_MARKET_FIXTURES = {
+    "pattern": [
+        [1, 0, 0, 1],
+        [0, 1, 0, 0],
+        [0, 0, 1, 0],
+    ],
+    "integer": [
+        [0, 7, 0],
+        [-3, 0, 0],
+        [0, 0, 12],
+    ],
+    # Off-diagonal entries are mirrored
+    "symmetric": [
+        [2.5, -1, 0],
+        [-1, 0, 0.4],
+        [0, 0.4, 1],
+    ],
+    # and negated when mirrored across the diagonal of a skew-symmetric matrix
+    "skew_symmetric": [
+        [0, -3, 2.25],
+        [3, 0, 0],
+        [-2.25, 0, 0],
+    ],
+}
+
+
+@pytest.mark.parametrize("name", list(MATRIX_MARKET_FIXTURES))
+def test_read_matrix_market(tmp_path, name):
+    MLIRSparseTensor = mlir_graphblas.sparse_utils.MLIRSparseTensor
+    expected = np.array(MATRIX_MARKET_FIXTURES[name], dtype=np.float64)
+    tensor = MLIRSparseTensor.read(os.path.join(TEST_FOLDER, f"data/{name}.mtx"))
+    assert tensor.verify()
+    assert tensor.value_dtype == np.float64
+    assert tensor.shape == expected.shape
+    np.testing.assert_array_equal(tensor.toarray(), expected)
+
+    # Survives a round trip through a snapshot
+    filename = tmp_path / f"{name}.snap"
+    tensor.save(filename)
+    loaded = MLIRSparseTensor.load(filename)
+    assert loaded.verify()
+    np.testing.assert_array_equal(loaded.toarray(), expected)
+
+
+@pytest.mark.parametrize("symmetry", ["general", "symmetric"])
+def test_read_matrix_market_parallel(tmp_path, symmetry):
+    # Files of a few megabytes are split into chunks parsed by several threads
+    n = 1000
+    nnz = 150000
+    rng = np.random.default_rng(7)
+    if symmetry == "general":
+        rows, cols = np.divmod(rng.choice(n * n, nnz, replace=False), n)
+    else:
+        rows, cols = np.tril_indices(n)
+        keep = rng.choice(len(rows), nnz, replace=False)
+        rows, cols = rows[keep], cols[keep]
+    values = rng.random(nnz)
+
+    filename = tmp_path / "large.mtx"
+    with open(filename, "w") as f:
+        f.write(f"%%MatrixMarket matrix coordinate real {symmetry}\n")
+        f.write(f"{n} {n} {nnz}\n")
+        for i, j, v in zip(rows, cols, values):
+            f.write(f"{i + 1} {j + 1} {v:.17g}\n")
+    assert os.path.getsize(filename) > 2 << 20
+
+    expected = np.zeros((n, n))
+    expected[rows, cols] = values
+    if symmetry == "symmetric":
+        expected[cols, rows] = values
+
+    tensor = mlir_graphblas.sparse_utils.MLIRSparseTensor.read(filename)
+    assert tensor.verify()
+    np.testing.assert_array_equal(tensor.toarray(), expected)
+
+
+@pytest.mark.parametrize(
+    "pointer_dtype, index_dtype, value_dtype",
+    [(np.uint64, np.uint64, np.float64), (np.uint32, np.uint16, np.int32)],
+)
+def test_from_arrays(pointer_dtype, index_dtype, value_dtype):
+    # CSR arrays of [[1, 0, 2, 0], [0, 0, 0, 0], [0, 3, 0, 4]]
+    indptr = np.array([0, 2, 2, 4], dtype=pointer_dtype)
+    col_indices = np.array([0, 2, 1, 3], dtype=index_dtype)
+    data = np.array([1, 2, 3, 4], dtype=value_dtype)
+    tensor = mlir_graphblas.sparse_utils.MLIRSparseTensor.from_arrays(
+        [3, 4], [None, indptr], [None, col_indices], data
+    )
+    assert tensor.verify()
+    assert tensor.pointer_dtype == pointer_dtype
+    assert tensor.index_dtype == index_dtype
+    assert tensor.value_dtype == value_dtype
+    assert tensor.shape == (3, 4)
+    np.testing.assert_array_equal(tensor.get_pointers(1), indptr)
+    np.testing.assert_array_equal(tensor.get_indices(1), col_indices)
+
+    # The arrays are adopted, not copied
+    tensor.values[0] = 7
+    assert data[0] == 7
+
+    # CSC of the same matrix
+    tensor = mlir_graphblas.sparse_utils.MLIRSparseTensor.from_arrays(
+        [4, 3],
+        [None, np.array([0, 1, 2, 3, 4], dtype=pointer_dtype)],
+        [None, np.array([0, 2, 0, 2], dtype=index_dtype)],
+        np.array([1, 3, 2, 4], dtype=value_dtype),
+        rev=[1, 0],
+    )
+    assert tensor.verify()
+    assert tensor.shape == (3, 4)
+
+    with pytest.raises(ValueError, match="Invalid"):
+        mlir_graphblas.sparse_utils.MLIRSparseTensor.from_arrays(
+            [3, 4],
+            [None, indptr],
+            [None, np.array([2, 0, 1, 3], dtype=index_dtype)],
+            data,
+        )
+
+
+def test_allocation_policy():
+    sparse_utils = mlir_graphblas.sparse_utils
+    with pytest.raises(ValueError, match="Invalid allocation policy"):
+        sparse_utils.set_allocation_policy("interleave,first-touch")
+
+    # Large enough for the values to be placed by a policy
+    n = 1 << 19
+    indices = np.arange(n, dtype=np.uint64)
+    values = np.arange(n, dtype=np.float64)
+    sizes = np.array([n], dtype=np.uint64)
+    sparsity = np.array([True], dtype=np.bool8)
+
+    sparse_utils.set_allocation_policy("first-touch,thp")
+    try:
+        before = sparse_utils.allocation_report()
+        assert before["policy"] == "first-touch,thp"
+        tensor = sparse_utils.MLIRSparseTensor(indices, values, sizes, sparsity)
+        np.testing.assert_array_equal(tensor.values, values)
+        after = sparse_utils.allocation_report()
+        assert after["large_buffers"] > before["large_buffers"]
+        assert after["first_touched"] > before["first_touched"]
+    finally:
+        sparse_utils.set_allocation_policy("default")
+    assert sparse_utils.allocation_report()["policy"] == "default"
+
+    # The default policy leaves every buffer to malloc
+    before = sparse_utils.allocation_report()
+    tensor = sparse_utils.MLIRSparseTensor(indices, values, sizes, sparsity)
+    np.testing.assert_array_equal(tensor.values, values)
+    after = sparse_utils.allocation_report()
+    assert after["large_buffers"] == before["large_buffers"]
+
+
+def test_memory_report():
+    MLIRSparseTensor = mlir_graphblas.sparse_utils.MLIRSparseTensor
+    sparsity = np.array([True, True], dtype=np.bool8)
+    sizes = np.array([10, 20], dtype=np.uint64)
+    indices = np.array([[0, 0], [1, 1], [1, 5]], dtype=np.uint64)
+    values = np.array([1.2, 3.4, 5.6], dtype=np.float64)
+
+    before = MLIRSparseTensor.memory_report(reset_peak=True)
+    a1 = MLIRSparseTensor(indices, values, sizes, sparsity)
+    report = MLIRSparseTensor.memory_report()
+    assert report["live_tensors"] == before["live_tensors"] + 1
+    assert report["tensor_allocations"] == before["tensor_allocations"] + 1
+    assert report["bytes"] == before["bytes"] + a1.nbytes
+    assert report["value_bytes"] >= before["value_bytes"] + values.nbytes
+
+    # Views share the buffers, which are only charged once
+    v = a1.view()
+    assert MLIRSparseTensor.memory_report()["bytes"] == before["bytes"] + a1.nbytes
+
+    a2 = a1.dup()
+    a2.resize_values(1000)
+    a2.resize_index(1, 1000)
+    report = MLIRSparseTensor.memory_report()
+    assert report["live_tensors"] == before["live_tensors"] + 3
+    assert report["bytes"] == before["bytes"] + a1.nbytes + a2.nbytes
+    assert report["peak_bytes"] >= report["bytes"]
+    peak = report["peak_bytes"]
+
+    del a2
+    del a1
+    assert MLIRSparseTensor.memory_report()["bytes"] > before["bytes"]  # still held by the view
+    del v
+    report = MLIRSparseTensor.memory_report()
+    assert report["live_tensors"] == before["live_tensors"]
+    assert report["bytes"] == before["bytes"]
+    assert report["peak_bytes"] == peak
@@ -810,6 +810,11 @@ def test_ir_select_random_uniform(engine: MlirJitEngine, aliases: AliasMap):
     assert result.verify()
     dense_result = result.toarray()
 
+    # rows are sampled in parallel from streams named by the seed and the row
+    same_rng = ChooseUniformContext(seed=2)
+    same_result = test_select_random_uniform(input_tensor, 2, same_rng)
+    np.testing.assert_equal(dense_result, same_result.toarray())
+
     expected_row_count = np.minimum((dense_input_tensor != 0).sum(axis=1), 2)
     actual_row_count = (dense_result != 0).sum(axis=1)
     np.testing.assert_equal(expected_row_count, actual_row_count)
@@ -1017,3 +1022,25 @@ def test_vector_to_from_coo(engine: MlirJitEngine, aliases: AliasMap):
 
     np.testing.assert_equal(input_indices, v2_indices)
     np.testing.assert_allclose(input_values, v2_values)
+
+    irb = MLIRFunctionBuilder(
+        "vector_from_coo_plus",
+        input_types=["tensor<?x?xindex>", "tensor<?xf64>", "index"],
+        return_types=["tensor<?xf64, #CV64>"],
+        aliases=aliases,
+    )
+    (indices, values, size) = irb.inputs
+    tensor = irb.graphblas.from_coo(indices, values, (size,), accumulate="plus")
+    irb.return_vars(tensor)
+    vector_from_coo_plus = irb.compile(engine=engine, passes=GRAPHBLAS_PASSES)
+
+    # Duplicates are summed
+    dup_indices = np.array([[8], [1], [8], [6]], dtype=np.uint64)
+    dup_values = np.array([1.5, 2.0, 4.0, 3.0], dtype=np.float64)
+    v3 = vector_from_coo_plus(dup_indices, dup_values, 20)
+    v3.verify()
+
+    v3_indices, v3_values = vector_to_coo(v3)
+
+    np.testing.assert_equal([[1], [6], [8]], v3_indices)
+    np.testing.assert_allclose([2.0, 3.0, 5.5], v3_values)
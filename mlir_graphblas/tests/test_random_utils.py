@@ -0,0 +1,110 @@
+import itertools
+from collections import Counter
+
+import numpy as np
+import pytest
+
+from mlir_graphblas.random_utils import (
+    ChooseUniformContext,
+    ChooseWeightedContext,
+    sample_uniform,
+    sample_weighted,
+)
+
+NUM_DRAWS = 20000
+
+
+def _assert_frequencies(counts, probabilities, num_draws):
+    for key, prob in probabilities.items():
+        expected = prob * num_draws
+        # binomial standard deviation
+        stddev = (num_draws * prob * (1 - prob)) ** 0.5
+        actual = counts.get(key, 0)
+        assert (
+            abs(actual - expected) < 5 * stddev
+        ), f"key: {key}, expected: {expected}, actual: {actual}, stddev: {stddev}"
+    assert set(counts) <= set(probabilities)
+
+
+@pytest.mark.parametrize("n, max_index", [(2, 5), (6, 8)], ids=["floyd", "method_a"])
+def test_uniform_distribution(n, max_index):
+    # Every subset of n indices is equally likely
+    counts = Counter(
+        tuple(sample_uniform(ChooseUniformContext(seed=seed), n, max_index))
+        for seed in range(NUM_DRAWS)
+    )
+    subsets = list(itertools.combinations(range(max_index), n))
+    _assert_frequencies(
+        counts, {subset: 1 / len(subsets) for subset in subsets}, NUM_DRAWS
+    )
+
+
+def test_weighted_distribution():
+    weights = np.array([1.0, 2.0, 4.0])
+
+    # One draw is proportional to the weights
+    counts = Counter(
+        tuple(sample_weighted(ChooseWeightedContext(seed=seed), 1, weights))
+        for seed in range(NUM_DRAWS)
+    )
+    _assert_frequencies(
+        counts, {(i,): w / weights.sum() for i, w in enumerate(weights)}, NUM_DRAWS
+    )
+
+    # Two draws without replacement: either order of a pair
+    total = weights.sum()
+
+    def ordered_probability(first, second):
+        return weights[first] / total * weights[second] / (total - weights[first])
+
+    def pair_probability(a, b):
+        return ordered_probability(a, b) + ordered_probability(b, a)
+
+    counts = Counter(
+        tuple(sample_weighted(ChooseWeightedContext(seed=seed), 2, weights))
+        for seed in range(NUM_DRAWS)
+    )
+    _assert_frequencies(
+        counts,
+        {(a, b): pair_probability(a, b) for a, b in [(0, 1), (0, 2), (1, 2)]},
+        NUM_DRAWS,
+    )
+
+
+def test_sample_whole_row():
+    # Rows with no more than n entries are taken whole
+    for n in [3, 5]:
+        np.testing.assert_array_equal(
+            sample_uniform(ChooseUniformContext(seed=1), n, 3), [0, 1, 2]
+        )
+        np.testing.assert_array_equal(
+            sample_weighted(ChooseWeightedContext(seed=1), n, [1.0, 0.0, 2.0]),
+            [0, 1, 2],
+        )
+
+
+def test_weighted_zero_weights():
+    weights = np.array([0.0, 3.0, 0.0, -1.0, np.nan])
+    for seed in range(100):
+        context = ChooseWeightedContext(seed=seed)
+        # Only positive weights can be drawn while there are any left
+        np.testing.assert_array_equal(sample_weighted(context, 1, weights), [1])
+
+        # Then entries without a positive weight fill the sample
+        sample = sample_weighted(context, 3, weights)
+        assert len(set(sample)) == 3
+        assert 1 in sample
+        assert np.all(np.diff(sample) > 0)
+
+    sample = sample_weighted(ChooseWeightedContext(seed=1), 2, np.zeros(4))
+    assert len(set(sample)) == 2
+    assert np.all((0 <= sample) & (sample < 4))
+
+
+def test_weighted_many_samples():
+    # More keys than fit in the sampler's stack buffer
+    weights = np.arange(1, 1001, dtype=np.float64)
+    sample = sample_weighted(ChooseWeightedContext(seed=3), 200, weights)
+    assert len(sample) == 200
+    assert np.all(np.diff(sample) > 0)
+    assert sample[-1] < 1000
@@ -221,3 +221,34 @@ def test_verify(nrows, ncols):
             np.testing.assert_array_equal(mt.values, d["values"].T.ravel())
             assert mt.shape == M.shape
             assert mt.sizes[::-1] == M.shape
+
+
+def test_view_shares_storage():
+    indices = np.array([[0, 1], [1, 0], [1, 2]], dtype=np.uint64)
+    values = np.array([1.0, 2.0, 3.0])
+    sizes = np.array([2, 3], dtype=np.uint64)
+    sparsity = np.array([False, True], dtype=np.bool8)
+    mt = MLIRSparseTensor(indices, values, sizes, sparsity)
+
+    before = MLIRSparseTensor.memory_report()
+    view = mt.view()
+    assert view.verify()
+    assert MLIRSparseTensor.memory_report()["bytes"] == before["bytes"]
+
+    # Arrays are handed out writable, so only the values are copied here
+    view.values[0] = 7.0
+    np.testing.assert_array_equal(mt.values, values)
+    np.testing.assert_array_equal(view.values, [7.0, 2.0, 3.0])
+    assert not np.shares_memory(view.values, mt.values)
+    report = MLIRSparseTensor.memory_report()
+    assert report["bytes"] == before["bytes"] + values.nbytes
+
+    # Resizing copies the shared buffer instead of changing the original
+    view.resize_index(1, 2)
+    np.testing.assert_array_equal(mt.get_indices(1), [1, 0, 2])
+    np.testing.assert_array_equal(view.get_indices(1), [1, 0])
+
+    view.detach()
+    assert not np.shares_memory(view.get_pointers(1), mt.get_pointers(1))
+    del mt
+    np.testing.assert_array_equal(view.get_pointers(1), [0, 1, 3])
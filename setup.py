@@ -60,7 +60,8 @@ ext_modules.append(
         "mlir_graphblas.SparseUtils",
         sources=["mlir_graphblas/SparseUtils.cpp"],
         include_dirs=[environment_include_dir],
-        extra_compile_args=["-std=c++11"],
+        extra_compile_args=["-std=c++11", "-pthread"],
+        extra_link_args=["-pthread"],
     )
 )
 